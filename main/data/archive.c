@@ -0,0 +1,307 @@
+/**
+ * @file archive.c
+ * @brief History archive segment implementation
+ */
+
+#include "archive.h"
+#include "esp_heap_caps.h"
+#include "esp_log.h"
+#include "esp_rom_crc.h"
+#include <dirent.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+static const char *TAG = "ARCHIVE";
+
+#define ARCHIVE_MAGIC 0x56435241 // "ARCV"
+#define ARCHIVE_VERSION 1
+#define ARCHIVE_MAX_STRIDE 512
+#define ARCHIVE_PATH_MAX 96
+#define MIN_SEGMENTS 32
+
+// Segment file header, followed by the table's schema_entry_t rows and
+// `count` records of `stride` bytes: chain link, fields, CRC32
+typedef struct __attribute__((packed)) {
+  uint32_t magic;
+  uint16_t version;
+  uint16_t section;
+  uint32_t first;
+  uint32_t count;
+  uint16_t entry_count;
+  uint16_t stride;
+} segment_header_t;
+
+#define LOCK(a)                                                                \
+  do {                                                                         \
+    if ((a)->lock)                                                             \
+      xSemaphoreTake((a)->lock, portMAX_DELAY);                                \
+  } while (0)
+#define UNLOCK(a)                                                              \
+  do {                                                                         \
+    if ((a)->lock)                                                             \
+      xSemaphoreGive((a)->lock);                                               \
+  } while (0)
+
+static void segment_path(const archive_t *a, const archive_segment_t *s,
+                         char *out, size_t len) {
+  snprintf(out, len, "%s/%04u-%02u_%08x_%x.seg", a->dir,
+           (unsigned)(1970 + s->month / 12), (unsigned)(s->month % 12 + 1),
+           (unsigned)s->first, (unsigned)s->count);
+}
+
+// Parse a segment file name; false for anything else
+static bool segment_parse(const char *name, archive_segment_t *s) {
+  unsigned year, mon, first, count;
+  int end = 0;
+  if (sscanf(name, "%4u-%2u_%8x_%x.seg%n", &year, &mon, &first, &count,
+             &end) != 4 ||
+      end == 0 || name[end] != '\0' || year < 1970 || mon < 1 || mon > 12 ||
+      count == 0)
+    return false;
+  s->first = first;
+  s->count = count;
+  s->month = (year - 1970) * 12 + (mon - 1);
+  return true;
+}
+
+static uint32_t record_crc(uint32_t seq, const uint8_t *data, size_t len) {
+  uint32_t crc = esp_rom_crc32_le(0, (const uint8_t *)&seq, sizeof(seq));
+  return esp_rom_crc32_le(crc, data, len);
+}
+
+static int compare_first(const void *a, const void *b) {
+  const archive_segment_t *x = a, *y = b;
+  return x->first < y->first ? -1 : x->first > y->first;
+}
+
+static esp_err_t segments_append(archive_t *a, const archive_segment_t *s) {
+  if (a->count == a->capacity) {
+    uint32_t capacity = a->capacity ? a->capacity * 2 : MIN_SEGMENTS;
+    archive_segment_t *p = heap_caps_realloc_prefer(
+        a->segments, capacity * sizeof(*p), 2, MALLOC_CAP_SPIRAM,
+        MALLOC_CAP_DEFAULT);
+    if (p == NULL)
+      return ESP_ERR_NO_MEM;
+    a->segments = p;
+    a->capacity = capacity;
+  }
+  a->segments[a->count++] = *s;
+  return ESP_OK;
+}
+
+static void close_cached(archive_t *a) {
+  if (a->file)
+    fclose(a->file);
+  a->file = NULL;
+}
+
+// ====================================================================================
+// API
+// ====================================================================================
+
+esp_err_t archive_open(archive_t *a) {
+  if (a->lock == NULL)
+    a->lock = xSemaphoreCreateMutex();
+  mkdir(ARCHIVE_ROOT, 0775);
+  mkdir(a->dir, 0775);
+
+  LOCK(a);
+  close_cached(a);
+  a->count = 0;
+  DIR *dir = opendir(a->dir);
+  if (dir == NULL) {
+    UNLOCK(a);
+    ESP_LOGW(TAG, "No archive directory %s", a->dir);
+    return ESP_ERR_NOT_FOUND;
+  }
+
+  esp_err_t ret = ESP_OK;
+  char path[ARCHIVE_PATH_MAX];
+  struct dirent *entry;
+  while (ret == ESP_OK && (entry = readdir(dir)) != NULL) {
+    archive_segment_t s;
+    size_t len = strlen(entry->d_name);
+    if (len > 4 && strcmp(entry->d_name + len - 4, ".tmp") == 0) {
+      // A write cut short by a reset: its records are still in RAM
+      snprintf(path, sizeof(path), "%s/%s", a->dir, entry->d_name);
+      remove(path);
+    } else if (segment_parse(entry->d_name, &s)) {
+      ret = segments_append(a, &s);
+    }
+  }
+  closedir(dir);
+  qsort(a->segments, a->count, sizeof(*a->segments), compare_first);
+
+  uint32_t records = 0;
+  for (uint32_t i = 0; i < a->count; i++) {
+    records += a->segments[i].count;
+    if (i > 0 && a->segments[i].first <
+                     a->segments[i - 1].first + a->segments[i - 1].count)
+      ESP_LOGW(TAG, "Overlapping segments at sequence %u in %s",
+               (unsigned)a->segments[i].first, a->dir);
+  }
+  UNLOCK(a);
+  ESP_LOGI(TAG, "%s: %u segments, %u records", a->dir, (unsigned)a->count,
+           (unsigned)records);
+  return ret;
+}
+
+uint32_t archive_end(archive_t *a) {
+  LOCK(a);
+  const archive_segment_t *last =
+      a->count ? &a->segments[a->count - 1] : NULL;
+  uint32_t end = last ? last->first + last->count : 0;
+  UNLOCK(a);
+  return end;
+}
+
+esp_err_t archive_write(archive_t *a, uint32_t first, const void *records,
+                        const uint32_t *links, uint32_t count, uint16_t month) {
+  static schema_entry_t entries[SCHEMA_MAX_ENTRIES];
+  const table_schema_t *t = schema_table(a->section);
+  if (t == NULL || count == 0 || first < archive_end(a))
+    return ESP_ERR_INVALID_ARG;
+
+  // Keep only this table's rows of the schema
+  int n = 0;
+  int total = schema_describe(entries, SCHEMA_MAX_ENTRIES);
+  for (int i = 0; i < total; i++)
+    if (entries[i].section == a->section)
+      entries[n++] = entries[i];
+
+  uint16_t width = schema_width(t);
+  segment_header_t hdr = {.magic = ARCHIVE_MAGIC,
+                          .version = ARCHIVE_VERSION,
+                          .section = a->section,
+                          .first = first,
+                          .count = count,
+                          .entry_count = n,
+                          .stride = width + 2 * sizeof(uint32_t)};
+  size_t head = sizeof(hdr) + n * sizeof(schema_entry_t);
+  size_t len = head + (size_t)count * hdr.stride;
+  uint8_t *image = heap_caps_malloc_prefer(len, 2, MALLOC_CAP_SPIRAM,
+                                           MALLOC_CAP_DEFAULT);
+  if (image == NULL) {
+    ESP_LOGE(TAG, "Out of memory for a %u-byte segment", (unsigned)len);
+    return ESP_ERR_NO_MEM;
+  }
+  memcpy(image, &hdr, sizeof(hdr));
+  memcpy(image + sizeof(hdr), entries, n * sizeof(schema_entry_t));
+  for (uint32_t i = 0; i < count; i++) {
+    uint8_t *p = image + head + (size_t)i * hdr.stride;
+    memcpy(p, &links[i], sizeof(uint32_t));
+    schema_encode_record(
+        t, (const uint8_t *)records + (size_t)i * t->record_size, p + 4);
+    uint32_t crc = record_crc(first + i, p, 4 + width);
+    memcpy(p + 4 + width, &crc, sizeof(crc));
+  }
+
+  // Write under a temporary name so a listed segment is always complete
+  const archive_segment_t s = {.first = first, .count = count, .month = month};
+  char tmp[ARCHIVE_PATH_MAX], path[ARCHIVE_PATH_MAX];
+  snprintf(tmp, sizeof(tmp), "%s/segment.tmp", a->dir);
+  segment_path(a, &s, path, sizeof(path));
+  FILE *f = fopen(tmp, "wb");
+  size_t ok = 0;
+  if (f) {
+    ok = fwrite(image, len, 1, f);
+    fflush(f);
+    fsync(fileno(f));
+    fclose(f);
+  }
+  heap_caps_free(image);
+  if (ok != 1 || rename(tmp, path) != 0) {
+    ESP_LOGE(TAG, "Failed to write segment %s", path);
+    remove(tmp);
+    return ESP_FAIL;
+  }
+
+  LOCK(a);
+  esp_err_t ret = segments_append(a, &s);
+  UNLOCK(a);
+  ESP_LOGI(TAG, "Archived %u records to %s", (unsigned)count, path);
+  return ret;
+}
+
+// Open segment `index` into the read cache (called with the lock held)
+static esp_err_t open_segment(archive_t *a, uint32_t index) {
+  static schema_entry_t entries[SCHEMA_MAX_FIELDS];
+  const archive_segment_t *s = &a->segments[index];
+  const table_schema_t *t = schema_table(a->section);
+  char path[ARCHIVE_PATH_MAX];
+  segment_header_t hdr;
+  uint16_t width = 0;
+
+  close_cached(a);
+  segment_path(a, s, path, sizeof(path));
+  FILE *f = fopen(path, "rb");
+  if (f == NULL)
+    return ESP_ERR_NOT_FOUND;
+  if (fread(&hdr, sizeof(hdr), 1, f) != 1 || hdr.magic != ARCHIVE_MAGIC ||
+      hdr.version != ARCHIVE_VERSION || hdr.section != a->section ||
+      hdr.first != s->first || hdr.count != s->count ||
+      hdr.entry_count > SCHEMA_MAX_FIELDS ||
+      hdr.stride > ARCHIVE_MAX_STRIDE ||
+      fread(entries, sizeof(schema_entry_t), hdr.entry_count, f) !=
+          hdr.entry_count ||
+      (a->plan_count = schema_plan_stored(t, entries, hdr.entry_count, a->plan,
+                                          &width)) < 0 ||
+      hdr.stride != width + 2 * sizeof(uint32_t)) {
+    ESP_LOGE(TAG, "Bad segment header in %s", path);
+    fclose(f);
+    return ESP_ERR_INVALID_CRC;
+  }
+  a->file = f;
+  a->file_segment = index;
+  a->stride = hdr.stride;
+  a->data_offset = sizeof(hdr) + hdr.entry_count * sizeof(schema_entry_t);
+  return ESP_OK;
+}
+
+esp_err_t archive_read(archive_t *a, uint32_t seq, void *record,
+                       uint32_t *link) {
+  static uint8_t buf[ARCHIVE_MAX_STRIDE];
+  esp_err_t ret = ESP_ERR_NOT_FOUND;
+
+  LOCK(a);
+  // Last segment starting at or before `seq`
+  uint32_t lo = 0, hi = a->count;
+  while (lo < hi) {
+    uint32_t mid = (lo + hi) / 2;
+    if (a->segments[mid].first <= seq)
+      lo = mid + 1;
+    else
+      hi = mid;
+  }
+  const archive_segment_t *s = lo > 0 ? &a->segments[lo - 1] : NULL;
+  if (s && seq < s->first + s->count) {
+    ret = a->file && a->file_segment == lo - 1 ? ESP_OK
+                                                : open_segment(a, lo - 1);
+  }
+  if (ret == ESP_OK) {
+    uint16_t width = a->stride - 2 * sizeof(uint32_t);
+    uint32_t crc;
+    long offset = a->data_offset + (long)(seq - s->first) * a->stride;
+    if (fseek(a->file, offset, SEEK_SET) != 0 ||
+        fread(buf, a->stride, 1, a->file) != 1) {
+      ret = ESP_FAIL;
+      close_cached(a);
+    } else {
+      memcpy(&crc, buf + 4 + width, sizeof(crc));
+      if (crc == record_crc(seq, buf, 4 + width)) {
+        memcpy(link, buf, sizeof(*link));
+        schema_decode_record(schema_table(a->section), a->plan,
+                             a->plan_count, buf + 4, record);
+      } else {
+        ESP_LOGE(TAG, "Damaged archived record %u in %s", (unsigned)seq,
+                 a->dir);
+        ret = ESP_ERR_INVALID_CRC;
+      }
+    }
+  }
+  UNLOCK(a);
+  return ret;
+}
@@ -0,0 +1,91 @@
+/**
+ * @file archive.h
+ * @brief Immutable, month-partitioned segment files for rolled-out history
+ *
+ * History records are numbered in insertion order (their sequence). Once a
+ * table holds more than its RAM ring, its oldest records are written to
+ * segment files, one calendar month per file, and released from RAM. A
+ * segment is written once under a temporary name and renamed into place; it
+ * is never modified afterwards. Its file name holds the month, the first
+ * sequence and the record count, so the segment list is rebuilt at boot from
+ * the directory listing alone, without opening any file.
+ *
+ * Each stored record carries the link of its per-animal history chain and a
+ * CRC, so a chain walk continues from RAM into the archive with one seek per
+ * record.
+ */
+
+#ifndef ARCHIVE_H
+#define ARCHIVE_H
+
+#include "db_schema.h"
+#include "esp_err.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include <stdint.h>
+#include <stdio.h>
+
+#ifndef SD_ROOT
+#define SD_ROOT "/sdcard" // Mount point of the card, see main.c
+#endif
+
+#define ARCHIVE_ROOT SD_ROOT "/archive"
+
+typedef struct {
+  uint32_t first; // Sequence of the first record
+  uint32_t count;
+  uint16_t month; // Months since January 1970
+} archive_segment_t;
+
+typedef struct {
+  const char *dir;  // Segment directory, under ARCHIVE_ROOT
+  uint16_t section; // Table schema of the records
+  archive_segment_t *segments; // Sorted by sequence
+  uint32_t count;
+  uint32_t capacity;
+  SemaphoreHandle_t lock; // Segment list and read cache
+
+  // Read cache: the segment last read from
+  FILE *file;
+  uint32_t file_segment;
+  uint32_t data_offset;
+  uint16_t stride;
+  int plan_count;
+  field_map_t plan[SCHEMA_MAX_FIELDS];
+} archive_t;
+
+#define ARCHIVE_INIT(path, table) {.dir = (path), .section = (table)}
+
+/**
+ * @brief List the segments on the card (call at boot, once it is mounted)
+ */
+esp_err_t archive_open(archive_t *a);
+
+/**
+ * @brief Sequence following the last archived record (0 if empty)
+ */
+uint32_t archive_end(archive_t *a);
+
+/**
+ * @brief Write `count` native records as one new segment
+ *
+ * Blocks on the SD card: call it from the save task, never with the
+ * database lock held.
+ *
+ * @param records Native records (schema_table(section) layout), contiguous
+ * @param links Chain link of each record
+ * @param month Months since January 1970 of the records
+ * @return ESP_ERR_INVALID_ARG if `first` is below archive_end()
+ */
+esp_err_t archive_write(archive_t *a, uint32_t first, const void *records,
+                        const uint32_t *links, uint32_t count, uint16_t month);
+
+/**
+ * @brief Read the record with sequence `seq` and its chain link
+ * @return ESP_ERR_NOT_FOUND if no segment holds it, ESP_ERR_INVALID_CRC if
+ *         the stored record is damaged
+ */
+esp_err_t archive_read(archive_t *a, uint32_t seq, void *record,
+                       uint32_t *link);
+
+#endif // ARCHIVE_H
@@ -0,0 +1,94 @@
+/**
+ * @file arena.c
+ * @brief Chunked record table implementation
+ */
+
+#include "arena.h"
+#include "esp_heap_caps.h"
+#include "esp_log.h"
+#include <stdlib.h>
+#include <string.h>
+
+static const char *TAG = "ARENA";
+
+void *arena_at(const arena_t *a, uint32_t index) {
+  if (index >= a->count || index < a->base || a->chunks == NULL)
+    return NULL;
+  uint32_t mask = (1u << a->chunk_shift) - 1;
+  index -= a->base; // Chunk-aligned, so the offset in the chunk is unchanged
+  uint8_t *chunk = a->chunks[index >> a->chunk_shift];
+  // NULL only to a lock-free reader racing the append that allocates it
+  return chunk ? chunk + (size_t)(index & mask) * a->record_size : NULL;
+}
+
+// Make sure the chunk holding `index` exists
+static esp_err_t arena_grow(arena_t *a, uint32_t index) {
+  uint32_t chunk = (index - a->base) >> a->chunk_shift;
+  if (a->chunks == NULL) {
+    // Room for `max` records at any chunk alignment, plus the spare chunk
+    // arena_drop_front() rotates to the end
+    uint32_t size = (a->max >> a->chunk_shift) + 2;
+    a->chunks = calloc(size, sizeof(*a->chunks));
+    if (a->chunks == NULL)
+      return ESP_ERR_NO_MEM;
+    a->dir_size = size;
+  }
+  while (a->chunk_count <= chunk) {
+    if (a->chunk_count == a->dir_size)
+      return ESP_ERR_NO_MEM;
+    size_t bytes = ((size_t)a->record_size) << a->chunk_shift;
+    uint8_t *mem = heap_caps_calloc_prefer(1, bytes, 2, MALLOC_CAP_SPIRAM,
+                                           MALLOC_CAP_DEFAULT);
+    if (mem == NULL) {
+      ESP_LOGE(TAG, "Out of memory for %u-byte chunk", (unsigned)bytes);
+      return ESP_ERR_NO_MEM;
+    }
+    a->chunks[a->chunk_count++] = mem;
+  }
+  return ESP_OK;
+}
+
+void *arena_append(arena_t *a) {
+  if (a->count - a->base >= a->max || arena_grow(a, a->count) != ESP_OK)
+    return NULL;
+  a->count++;
+  void *rec = arena_at(a, a->count - 1);
+  memset(rec, 0, a->record_size); // Chunks are reused after clear/shrink
+  return rec;
+}
+
+esp_err_t arena_reserve(arena_t *a, uint32_t count) {
+  if (count > a->base + a->max)
+    return ESP_ERR_INVALID_SIZE;
+  return count > a->base ? arena_grow(a, count - 1) : ESP_OK;
+}
+
+esp_err_t arena_resize(arena_t *a, uint32_t count) {
+  if (count <= a->count) {
+    a->count = count < a->base ? a->base : count;
+    return ESP_OK;
+  }
+  esp_err_t ret = arena_reserve(a, count);
+  while (ret == ESP_OK && a->count < count)
+    arena_append(a);
+  return ret;
+}
+
+void arena_clear(arena_t *a) { arena_rebase(a, 0); }
+
+void arena_rebase(arena_t *a, uint32_t base) {
+  a->base = base;
+  a->count = base;
+}
+
+esp_err_t arena_drop_front(arena_t *a) {
+  uint32_t size = 1u << a->chunk_shift;
+  if (a->count - a->base < size)
+    return ESP_ERR_INVALID_STATE;
+  // Rotate the directory: the released chunk becomes the spare at the end
+  uint8_t *first = a->chunks[0];
+  memmove(a->chunks, a->chunks + 1, (a->chunk_count - 1) * sizeof(*a->chunks));
+  a->chunks[a->chunk_count - 1] = first;
+  a->base += size;
+  return ESP_OK;
+}
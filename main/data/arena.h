@@ -0,0 +1,75 @@
+/**
+ * @file arena.h
+ * @brief Chunked, growable record tables in PSRAM
+ *
+ * Records live in fixed-size chunks allocated on demand. A chunk is never
+ * moved or freed while the table is in use, so a pointer to a record stays
+ * valid as the table grows. The chunk directory is sized for `max` records
+ * when the first chunk is allocated and never moves either, so a lock-free
+ * reader can index the table while a writer appends (see seqlock.h).
+ *
+ * A table can also be drained from the front a chunk at a time: indexes keep
+ * counting up and the released chunk is reused for new records, so a table
+ * that drops as much as it appends stays at a constant size.
+ */
+
+#ifndef ARENA_H
+#define ARENA_H
+
+#include "esp_err.h"
+#include <stddef.h>
+#include <stdint.h>
+
+typedef struct {
+  uint16_t record_size;
+  uint8_t chunk_shift; // log2(records per chunk)
+  uint32_t max;        // Hard cap on records held (count - base)
+  uint32_t base;       // Index of the oldest record held, chunk-aligned
+  uint32_t count;      // One past the newest index
+  uint32_t chunk_count; // Chunks allocated so far
+  uint32_t dir_size;    // Slots in `chunks`
+  uint8_t **chunks;
+} arena_t;
+
+#define ARENA_INIT(type, shift, limit)                                         \
+  {.record_size = sizeof(type), .chunk_shift = (shift), .max = (limit)}
+
+/**
+ * @brief Record at `index`, or NULL if it is not held (< base or >= count)
+ */
+void *arena_at(const arena_t *a, uint32_t index);
+
+/**
+ * @brief Append a zeroed record
+ * @return The new record, or NULL when the table is full or out of memory
+ */
+void *arena_append(arena_t *a);
+
+/**
+ * @brief Allocate chunks for indexes up to `count` - 1 up front
+ */
+esp_err_t arena_reserve(arena_t *a, uint32_t count);
+
+/**
+ * @brief Grow (with zeroed records) or shrink the table to `count` records
+ */
+esp_err_t arena_resize(arena_t *a, uint32_t count);
+
+/**
+ * @brief Drop all records; chunks are kept for reuse
+ */
+void arena_clear(arena_t *a);
+
+/**
+ * @brief Drop all records and number the next one `base`
+ * @param base A multiple of the chunk size
+ */
+void arena_rebase(arena_t *a, uint32_t base);
+
+/**
+ * @brief Release the oldest chunk of records; later indexes are unchanged
+ * @return ESP_ERR_INVALID_STATE if less than a full chunk is held
+ */
+esp_err_t arena_drop_front(arena_t *a);
+
+#endif // ARENA_H
@@ -0,0 +1,415 @@
+/**
+ * @file audit_log.c
+ * @brief Hash-chained audit log implementation
+ */
+
+#include "audit_log.h"
+#include "esp_log.h"
+#include "esp_rom_crc.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+#include "mbedtls/sha256.h"
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+static const char *TAG = "AUDIT";
+
+#define AUDIT_QUEUE_MIN 64     // Queue capacity at first; it doubles as needed
+#define AUDIT_READ_ENTRIES 32  // Entries per read when streaming the file
+#define AUDIT_WRITE_ENTRIES 32 // Entries per write when flushing the queue
+#define AUDIT_CHECKPOINT_MAGIC 0x4B435041 // "APCK"
+#define AUDIT_TASK_STACK 4096
+#define AUDIT_TASK_PRIORITY 1 // Below the save task, which waits on the file
+
+// Tail checkpoint: the first `count` entries were found intact
+typedef struct __attribute__((packed)) {
+  uint32_t magic;
+  uint32_t count;
+  uint8_t hash[AUDIT_HASH_LEN]; // Of entry count - 1
+  uint32_t crc;
+} audit_checkpoint_t;
+
+static SemaphoreHandle_t queue_lock = NULL; // Queue and chain head
+static SemaphoreHandle_t file_lock = NULL;  // Log file and checkpoint
+
+static audit_entry_t *queue = NULL; // Moves as it grows: use under queue_lock
+static uint32_t queued = 0;
+static uint32_t queue_capacity = 0;
+static uint32_t next_seq = 0;             // Of the next appended entry
+static uint8_t head_hash[AUDIT_HASH_LEN]; // Of the last appended entry
+static uint32_t on_card = 0;              // Entries in the file
+static audit_status_t status;
+
+// SHA-256(previous hash, entry up to its own hash)
+static void audit_hash(const uint8_t *prev, const audit_entry_t *e,
+                       uint8_t *out) {
+  mbedtls_sha256_context ctx;
+  mbedtls_sha256_init(&ctx);
+  mbedtls_sha256_starts(&ctx, 0);
+  mbedtls_sha256_update(&ctx, prev, AUDIT_HASH_LEN);
+  mbedtls_sha256_update(&ctx, (const uint8_t *)e,
+                        offsetof(audit_entry_t, hash));
+  mbedtls_sha256_finish(&ctx, out);
+  mbedtls_sha256_free(&ctx);
+}
+
+// ====================================================================================
+// CHECKPOINT
+// ====================================================================================
+
+static bool checkpoint_load(audit_checkpoint_t *c) {
+  FILE *f = fopen(AUDIT_CHECKPOINT_PATH, "rb");
+  if (f == NULL)
+    return false;
+  bool ok = fread(c, sizeof(*c), 1, f) == 1;
+  fclose(f);
+  return ok && c->magic == AUDIT_CHECKPOINT_MAGIC &&
+         c->crc == esp_rom_crc32_le(0, (const uint8_t *)c,
+                                    offsetof(audit_checkpoint_t, crc));
+}
+
+static void checkpoint_save(uint32_t count, const uint8_t *hash) {
+  audit_checkpoint_t c = {.magic = AUDIT_CHECKPOINT_MAGIC, .count = count};
+  memcpy(c.hash, hash, AUDIT_HASH_LEN);
+  c.crc = esp_rom_crc32_le(0, (const uint8_t *)&c,
+                           offsetof(audit_checkpoint_t, crc));
+  FILE *f = fopen(AUDIT_CHECKPOINT_PATH ".tmp", "wb");
+  bool ok = f && fwrite(&c, sizeof(c), 1, f) == 1;
+  if (f)
+    ok &= fclose(f) == 0;
+  // FATFS rename() does not replace an existing file
+  remove(AUDIT_CHECKPOINT_PATH);
+  if (!ok || rename(AUDIT_CHECKPOINT_PATH ".tmp", AUDIT_CHECKPOINT_PATH)) {
+    remove(AUDIT_CHECKPOINT_PATH ".tmp");
+    ESP_LOGW(TAG, "Failed to save the checkpoint, next check is full");
+  }
+}
+
+// ====================================================================================
+// VERIFICATION
+// ====================================================================================
+
+static bool read_entry(FILE *f, uint32_t seq, audit_entry_t *e) {
+  return fseek(f, (long)seq * sizeof(*e), SEEK_SET) == 0 &&
+         fread(e, sizeof(*e), 1, f) == 1;
+}
+
+// Check entries [from, end) against the chain starting at `prev`, which
+// ends up as the hash of the last intact one. Returns the first entry that
+// fails (or cannot be read), `end` if none.
+static uint32_t check_chain(FILE *f, uint32_t from, uint32_t end,
+                            uint8_t *prev, audit_entry_t *buf) {
+  uint32_t seq = from;
+  if (fseek(f, (long)from * sizeof(*buf), SEEK_SET) != 0)
+    return seq;
+  while (seq < end) {
+    uint32_t n = end - seq < AUDIT_READ_ENTRIES ? end - seq
+                                                 : AUDIT_READ_ENTRIES;
+    if (fread(buf, sizeof(*buf), n, f) != n)
+      return seq;
+    for (uint32_t i = 0; i < n; i++, seq++) {
+      uint8_t hash[AUDIT_HASH_LEN];
+      audit_hash(prev, &buf[i], hash);
+      if (buf[i].seq != seq || memcmp(hash, buf[i].hash, AUDIT_HASH_LEN))
+        return seq;
+      memcpy(prev, hash, AUDIT_HASH_LEN);
+    }
+  }
+  return end;
+}
+
+// Entries in the file; a torn entry left by a crash mid-append is dropped
+static uint32_t file_entries(void) {
+  struct stat st;
+  if (stat(AUDIT_FILE_PATH, &st) != 0)
+    return 0;
+  uint32_t n = st.st_size / sizeof(audit_entry_t);
+  if (st.st_size % sizeof(audit_entry_t) != 0) {
+    ESP_LOGW(TAG, "Dropping a torn entry after entry %u", (unsigned)n);
+    truncate(AUDIT_FILE_PATH, (off_t)n * sizeof(audit_entry_t));
+  }
+  return n;
+}
+
+// Called with file_lock held
+static esp_err_t verify_locked(bool full) {
+  uint32_t entries = file_entries();
+  status = (audit_status_t){.entries = entries};
+  if (entries == 0) {
+    audit_checkpoint_t c;
+    if (checkpoint_load(&c) && c.count > 0) {
+      ESP_LOGE(TAG, "Log is gone, the checkpoint had %u entries",
+               (unsigned)c.count);
+      status.state = AUDIT_BROKEN;
+      status.truncated = true;
+      return ESP_ERR_INVALID_CRC;
+    }
+    status.state = AUDIT_INTACT;
+    return ESP_OK;
+  }
+
+  FILE *f = fopen(AUDIT_FILE_PATH, "rb");
+  audit_entry_t *buf = malloc(AUDIT_READ_ENTRIES * sizeof(*buf));
+  if (f == NULL || buf == NULL) {
+    if (f)
+      fclose(f);
+    free(buf);
+    ESP_LOGE(TAG, "Cannot read the log");
+    return f ? ESP_ERR_NO_MEM : ESP_FAIL;
+  }
+
+  uint8_t prev[AUDIT_HASH_LEN] = {0}; // The first entry chains from zeros
+  uint32_t from = 0;
+  bool lost = false; // Entries found intact before are gone
+  audit_checkpoint_t c;
+  bool checkpoint = checkpoint_load(&c) && c.count > 0;
+  if (checkpoint && c.count > entries) { // Even when checking it all
+    lost = true;
+  } else if (checkpoint && !full) {
+    if (read_entry(f, c.count - 1, buf) &&
+        memcmp(buf->hash, c.hash, AUDIT_HASH_LEN) == 0) {
+      memcpy(prev, c.hash, AUDIT_HASH_LEN);
+      from = c.count;
+    } else {
+      ESP_LOGW(TAG, "Checkpoint does not match the log, checking it all");
+    }
+  }
+
+  esp_err_t ret = ESP_OK;
+  uint32_t bad = lost ? entries : check_chain(f, from, entries, prev, buf);
+  if (ferror(f)) {
+    ESP_LOGE(TAG, "Read error at entry %u", (unsigned)bad);
+    ret = ESP_FAIL;
+  } else if (lost || bad < entries) {
+    status.state = AUDIT_BROKEN;
+    status.first_bad = bad;
+    status.truncated = lost;
+    ESP_LOGE(TAG, "Chain broken at entry %u of %u%s", (unsigned)bad,
+             (unsigned)entries, lost ? " (log truncated)" : "");
+    ret = ESP_ERR_INVALID_CRC;
+  } else {
+    status.state = AUDIT_INTACT;
+    ESP_LOGI(TAG, "%u entries intact (%u checked)", (unsigned)entries,
+             (unsigned)(entries - from));
+  }
+  // Remember how far the chain holds, so the next check starts there
+  if (ret != ESP_FAIL && !lost && bad > from)
+    checkpoint_save(bad, prev);
+
+  free(buf);
+  fclose(f);
+  return ret;
+}
+
+esp_err_t audit_verify(bool full, audit_status_t *out) {
+  if (file_lock == NULL)
+    return ESP_ERR_INVALID_STATE;
+  xSemaphoreTake(file_lock, portMAX_DELAY);
+  esp_err_t ret = verify_locked(full);
+  if (out)
+    *out = status;
+  xSemaphoreGive(file_lock);
+  return ret;
+}
+
+static volatile audit_check_t check_state = AUDIT_CHECK_IDLE;
+static audit_status_t check_status; // Written before check_state is done
+static bool check_full;
+
+static void audit_verify_task(void *arg) {
+  esp_err_t ret = audit_verify(check_full, &check_status);
+  check_state = ret == ESP_OK || ret == ESP_ERR_INVALID_CRC
+                    ? AUDIT_CHECK_DONE
+                    : AUDIT_CHECK_FAILED;
+  vTaskDelete(NULL);
+}
+
+esp_err_t audit_verify_start(bool full) {
+  if (check_state == AUDIT_CHECK_RUNNING || file_lock == NULL)
+    return ESP_ERR_INVALID_STATE;
+  check_full = full;
+  check_state = AUDIT_CHECK_RUNNING;
+  if (xTaskCreate(audit_verify_task, "audit_check", AUDIT_TASK_STACK, NULL,
+                  AUDIT_TASK_PRIORITY, NULL) != pdPASS) {
+    ESP_LOGE(TAG, "Failed to start check task");
+    check_state = AUDIT_CHECK_FAILED;
+    return ESP_FAIL;
+  }
+  return ESP_OK;
+}
+
+audit_check_t audit_verify_progress(audit_status_t *out) {
+  audit_check_t state = check_state;
+  if (state != AUDIT_CHECK_RUNNING)
+    *out = check_status;
+  return state;
+}
+
+void audit_status(audit_status_t *out) { *out = status; }
+
+uint32_t audit_count(void) { return on_card; }
+
+// ====================================================================================
+// APPEND
+// ====================================================================================
+
+esp_err_t audit_open(void) {
+  if (queue_lock == NULL) {
+    queue_lock = xSemaphoreCreateMutex();
+    file_lock = xSemaphoreCreateMutex();
+    if (queue_lock == NULL || file_lock == NULL) {
+      ESP_LOGE(TAG, "Failed to create mutexes");
+      return ESP_ERR_NO_MEM;
+    }
+  }
+
+  xSemaphoreTake(file_lock, portMAX_DELAY);
+  esp_err_t ret = verify_locked(false);
+
+  // New entries chain after the last one on the card, intact or not
+  audit_entry_t last;
+  on_card = file_entries();
+  FILE *f = on_card ? fopen(AUDIT_FILE_PATH, "rb") : NULL;
+  bool have_last = f && read_entry(f, on_card - 1, &last);
+  if (f)
+    fclose(f);
+  if (on_card > 0 && !have_last)
+    ESP_LOGE(TAG, "Cannot read the last entry, the chain restarts");
+
+  xSemaphoreTake(queue_lock, portMAX_DELAY);
+  queued = 0;
+  next_seq = on_card;
+  if (have_last)
+    memcpy(head_hash, last.hash, AUDIT_HASH_LEN);
+  else
+    memset(head_hash, 0, AUDIT_HASH_LEN);
+  xSemaphoreGive(queue_lock);
+  xSemaphoreGive(file_lock);
+  return ret;
+}
+
+esp_err_t audit_append(uint32_t animal_id, uint16_t field, const char *before,
+                       const char *after) {
+  if (queue_lock == NULL)
+    return ESP_ERR_INVALID_STATE;
+  xSemaphoreTake(queue_lock, portMAX_DELAY);
+  if (queued == queue_capacity) {
+    // Never write from here: callers are modifiers, under the database lock.
+    // The entries wait for the save task, however long the card is away.
+    uint32_t capacity = queue_capacity ? queue_capacity * 2 : AUDIT_QUEUE_MIN;
+    audit_entry_t *q = realloc(queue, capacity * sizeof(*q));
+    if (q == NULL) {
+      xSemaphoreGive(queue_lock);
+      ESP_LOGE(TAG, "Out of memory, change of animal %u not logged",
+               (unsigned)animal_id);
+      return ESP_ERR_NO_MEM;
+    }
+    queue = q;
+    queue_capacity = capacity;
+  }
+
+  audit_entry_t *e = &queue[queued++];
+  memset(e, 0, sizeof(*e)); // Padding is hashed too
+  e->seq = next_seq++;
+  e->timestamp = time(NULL);
+  e->animal_id = animal_id;
+  e->field = field;
+  strncpy(e->before, before, AUDIT_VALUE_LEN - 1);
+  strncpy(e->after, after, AUDIT_VALUE_LEN - 1);
+  audit_hash(head_hash, e, e->hash);
+  memcpy(head_hash, e->hash, AUDIT_HASH_LEN);
+  xSemaphoreGive(queue_lock);
+  return ESP_OK;
+}
+
+esp_err_t audit_flush(void) {
+  if (file_lock == NULL)
+    return ESP_OK;
+  xSemaphoreTake(file_lock, portMAX_DELAY);
+  xSemaphoreTake(queue_lock, portMAX_DELAY);
+  uint32_t n = queued;
+  xSemaphoreGive(queue_lock);
+
+  // queue[0..n) keeps its entries while unlocked (appends only add after
+  // them) but not its address: it is written a slice at a time from a copy
+  esp_err_t ret = ESP_OK;
+  if (n > 0) {
+    FILE *f = fopen(AUDIT_FILE_PATH, "ab");
+    audit_entry_t *buf = malloc(AUDIT_WRITE_ENTRIES * sizeof(*buf));
+    bool ok = f && buf;
+    for (uint32_t done = 0; ok && done < n;) {
+      uint32_t k = n - done < AUDIT_WRITE_ENTRIES ? n - done
+                                                  : AUDIT_WRITE_ENTRIES;
+      xSemaphoreTake(queue_lock, portMAX_DELAY);
+      memcpy(buf, queue + done, k * sizeof(*buf));
+      xSemaphoreGive(queue_lock);
+      ok = fwrite(buf, sizeof(*buf), k, f) == k;
+      done += k;
+    }
+    free(buf);
+    if (f)
+      ok &= fclose(f) == 0;
+    if (ok) {
+      on_card += n;
+      xSemaphoreTake(queue_lock, portMAX_DELAY);
+      queued -= n;
+      memmove(queue, queue + n, queued * sizeof(queue[0]));
+      xSemaphoreGive(queue_lock);
+    } else {
+      ESP_LOGE(TAG, "Failed to write %u entries", (unsigned)n);
+      // Never leave part of an entry behind: the retry appends whole ones
+      truncate(AUDIT_FILE_PATH, (off_t)on_card * sizeof(audit_entry_t));
+      ret = ESP_FAIL;
+    }
+  }
+  xSemaphoreGive(file_lock);
+  return ret;
+}
+
+// ====================================================================================
+// READING
+// ====================================================================================
+
+esp_err_t audit_read(uint32_t first, audit_visit_cb_t visit, void *ctx,
+                     uint32_t *end) {
+  *end = first;
+  if (file_lock == NULL)
+    return ESP_ERR_INVALID_STATE;
+  xSemaphoreTake(file_lock, portMAX_DELAY);
+  if (first >= on_card) {
+    xSemaphoreGive(file_lock);
+    return ESP_OK;
+  }
+
+  FILE *f = fopen(AUDIT_FILE_PATH, "rb");
+  audit_entry_t *buf = malloc(AUDIT_READ_ENTRIES * sizeof(*buf));
+  esp_err_t ret = f && buf ? ESP_OK : ESP_FAIL;
+  uint32_t seq = first;
+  if (ret == ESP_OK && fseek(f, (long)first * sizeof(*buf), SEEK_SET) != 0)
+    ret = ESP_FAIL;
+  bool more = true;
+  while (ret == ESP_OK && more && seq < on_card) {
+    uint32_t n = on_card - seq < AUDIT_READ_ENTRIES ? on_card - seq
+                                                     : AUDIT_READ_ENTRIES;
+    if (fread(buf, sizeof(*buf), n, f) != n) {
+      ret = ESP_FAIL;
+      break;
+    }
+    for (uint32_t i = 0; i < n && (more = visit(&buf[i], ctx)); i++)
+      seq++;
+  }
+  if (ret != ESP_OK)
+    ESP_LOGE(TAG, "Cannot read the log from entry %u", (unsigned)seq);
+  free(buf);
+  if (f)
+    fclose(f);
+  *end = seq;
+  xSemaphoreGive(file_lock);
+  return ret;
+}
@@ -0,0 +1,133 @@
+/**
+ * @file audit_log.h
+ * @brief Append-only, hash-chained audit log of the Livre de Police fields
+ *
+ * Every change to a regulatory field (entry, exit, recipient, CITES) is
+ * appended as one fixed-size entry holding the old and new values. Each
+ * entry carries SHA-256(previous entry's hash, its own content), so editing,
+ * removing or reordering any entry breaks every hash after it. Entries are
+ * never rewritten; the file only grows.
+ *
+ * Verification is a streaming pass over the file. A checkpoint file records
+ * how many entries were last found intact and the hash of the last one, so
+ * the boot check only reads what was appended since: its cost follows the
+ * edits since the last boot, not the size of the log. audit_verify() with
+ * `full` re-reads everything from the first entry for an inspection; the
+ * conformity page runs it on a task of its own with audit_verify_start().
+ *
+ * Entries are queued in RAM by audit_append() and written by audit_flush(),
+ * which the save task calls before writing the journal, so a change is never
+ * on the card without its audit entry.
+ */
+
+#ifndef AUDIT_LOG_H
+#define AUDIT_LOG_H
+
+#include "esp_err.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifndef SD_ROOT
+#define SD_ROOT "/sdcard" // Mount point of the card, see main.c
+#endif
+
+#define AUDIT_FILE_PATH SD_ROOT "/livre_police.log"
+#define AUDIT_CHECKPOINT_PATH SD_ROOT "/livre_police.chk"
+#define AUDIT_HASH_LEN 32   // SHA-256
+#define AUDIT_VALUE_LEN 128 // Text of a value, NUL-padded
+
+// On-disk entry; entry `seq` sits at offset seq * sizeof(audit_entry_t)
+typedef struct __attribute__((packed)) {
+  uint32_t seq;       // From 0, no gaps
+  int64_t timestamp;  // time() of the change
+  uint32_t animal_id; // reptile_t.id
+  uint16_t field;     // db_schema tag of the reptile_t field
+  uint16_t reserved;
+  char before[AUDIT_VALUE_LEN];
+  char after[AUDIT_VALUE_LEN];
+  uint8_t hash[AUDIT_HASH_LEN]; // SHA-256(previous hash, bytes above)
+} audit_entry_t;
+
+typedef enum {
+  AUDIT_UNVERIFIED = 0, // Not checked yet, or the card could not be read
+  AUDIT_INTACT,
+  AUDIT_BROKEN, // An entry was altered, removed or truncated
+} audit_state_t;
+
+typedef struct {
+  audit_state_t state;
+  uint32_t entries;   // On the card
+  uint32_t first_bad; // First entry that fails the chain (AUDIT_BROKEN)
+  bool truncated;     // Entries below the checkpoint are gone (AUDIT_BROKEN)
+} audit_status_t;
+
+typedef enum {
+  AUDIT_CHECK_IDLE = 0,
+  AUDIT_CHECK_RUNNING,
+  AUDIT_CHECK_DONE,   // Intact or broken, see the status
+  AUDIT_CHECK_FAILED, // The card could not be read
+} audit_check_t;
+
+/**
+ * @brief Check the entries appended since the last checkpoint and resume
+ *        the chain after the last entry (call at boot, once the card is
+ *        mounted)
+ * @return ESP_ERR_INVALID_CRC if the log is broken; it still accepts new
+ *         entries, chained after the last one on the card
+ */
+esp_err_t audit_open(void);
+
+/**
+ * @brief Queue one change; `before` and `after` are truncated to
+ *        AUDIT_VALUE_LEN - 1 bytes
+ *
+ * Never writes to the card: the queue grows in RAM until the next
+ * audit_flush(), however long the card is away.
+ */
+esp_err_t audit_append(uint32_t animal_id, uint16_t field, const char *before,
+                       const char *after);
+
+/**
+ * @brief Write the queued entries (blocks on the SD card)
+ */
+esp_err_t audit_flush(void);
+
+/**
+ * @brief Streaming check of the chain: from the checkpoint, or from the
+ *        first entry if `full`; the checkpoint moves up to the last
+ *        intact entry. A log shorter than the checkpoint is reported
+ *        truncated either way.
+ */
+esp_err_t audit_verify(bool full, audit_status_t *out);
+
+/**
+ * @brief Run audit_verify() on its own task; poll with audit_verify_progress()
+ * @return ESP_ERR_INVALID_STATE if a check is already running
+ */
+esp_err_t audit_verify_start(bool full);
+
+/**
+ * @brief State of the last audit_verify_start(); `out` gets its result once
+ *        done
+ */
+audit_check_t audit_verify_progress(audit_status_t *out);
+
+/**
+ * @brief Result of the last audit_open() or audit_verify()
+ */
+void audit_status(audit_status_t *out);
+
+/**
+ * @brief Entries written to the card (queued ones not included)
+ */
+uint32_t audit_count(void);
+
+/**
+ * @brief Visit the entries on the card from `first`, in order, until `visit`
+ *        returns false; `*end` gets the sequence after the last one visited
+ */
+typedef bool (*audit_visit_cb_t)(const audit_entry_t *e, void *ctx);
+esp_err_t audit_read(uint32_t first, audit_visit_cb_t visit, void *ctx,
+                     uint32_t *end);
+
+#endif // AUDIT_LOG_H
@@ -0,0 +1,269 @@
+/**
+ * @file boot_view.c
+ * @brief Flash-mapped registry preview implementation
+ */
+
+#include "boot_view.h"
+#include "esp_log.h"
+#include "esp_partition.h"
+#include "esp_rom_crc.h"
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+static const char *TAG = "BOOT_VIEW";
+
+#define HEADER_BYTES 32 // Header padded so the columns start 8-byte aligned
+#define NO_SLOT -1
+
+static const esp_partition_t *partition = NULL;
+static int newest_slot = NO_SLOT; // Slot holding the newest valid image
+static uint32_t generation = 0;
+static int mapped_slot = NO_SLOT;
+static esp_partition_mmap_handle_t mapped_handle;
+
+// Column offsets of an image, from its row count and pool length
+typedef struct {
+  uint32_t name_key;
+  uint32_t last_feeding;
+  uint32_t id;
+  uint32_t name;
+  uint32_t species_common;
+  uint32_t active;
+  uint32_t species;
+  uint32_t sex;
+  uint32_t cites_annex;
+  uint32_t health;
+  uint32_t terrarium;
+  uint32_t strings;
+  uint32_t size;
+} layout_t;
+
+static void layout(uint32_t count, uint32_t strings_len, layout_t *l) {
+  uint32_t at = HEADER_BYTES;
+  // Widest columns first keeps every column aligned
+  l->name_key = at;
+  at += count * sizeof(uint64_t);
+  l->last_feeding = at;
+  at += count * sizeof(time_t);
+  l->id = at;
+  at += count * sizeof(uint32_t);
+  l->name = at;
+  at += count * sizeof(uint32_t);
+  l->species_common = at;
+  at += count * sizeof(str_ref_t);
+  l->active = at;
+  l->species = l->active + count;
+  l->sex = l->species + count;
+  l->cites_annex = l->sex + count;
+  l->health = l->cites_annex + count;
+  l->terrarium = l->health + count;
+  l->strings = l->terrarium + count;
+  l->size = l->strings + strings_len;
+}
+
+static uint32_t slot_size(void) {
+  return (partition->size / 2) & ~(partition->erase_size - 1);
+}
+
+static bool open_partition(void) {
+  if (partition == NULL)
+    partition = esp_partition_find_first(ESP_PARTITION_TYPE_DATA,
+                                         ESP_PARTITION_SUBTYPE_ANY,
+                                         BOOT_VIEW_PARTITION);
+  return partition != NULL;
+}
+
+static uint32_t image_crc(const uint8_t *image, uint32_t size) {
+  boot_view_header_t hdr;
+  memcpy(&hdr, image, sizeof(hdr));
+  hdr.crc = 0;
+  uint32_t crc = esp_rom_crc32_le(0, (const uint8_t *)&hdr, sizeof(hdr));
+  return esp_rom_crc32_le(crc, image + sizeof(hdr), size - sizeof(hdr));
+}
+
+// ====================================================================================
+// READ
+// ====================================================================================
+
+static bool header_valid(const boot_view_header_t *hdr) {
+  layout_t l;
+  if (hdr->magic != BOOT_VIEW_MAGIC || hdr->version != BOOT_VIEW_VERSION ||
+      hdr->size > slot_size() || hdr->count > hdr->size)
+    return false;
+  layout(hdr->count, hdr->strings_len, &l);
+  return l.size == hdr->size && hdr->strings_len > 0;
+}
+
+esp_err_t boot_view_map(hot_table_t *out) {
+  if (!open_partition()) {
+    ESP_LOGW(TAG, "No \"%s\" partition", BOOT_VIEW_PARTITION);
+    return ESP_ERR_NOT_SUPPORTED;
+  }
+
+  boot_view_header_t hdr[2];
+  bool valid[2];
+  for (int s = 0; s < 2; s++) {
+    valid[s] = esp_partition_read(partition, s * slot_size(), &hdr[s],
+                                  sizeof(hdr[s])) == ESP_OK &&
+               header_valid(&hdr[s]);
+  }
+
+  // Newest generation first; fall back to the other slot on a bad CRC
+  int order[2] = {0, 1};
+  if (valid[0] && valid[1] && hdr[1].generation > hdr[0].generation) {
+    order[0] = 1;
+    order[1] = 0;
+  }
+  for (int k = 0; k < 2; k++) {
+    int s = order[k];
+    const uint8_t *image;
+    esp_partition_mmap_handle_t handle;
+    if (!valid[s] ||
+        esp_partition_mmap(partition, s * slot_size(), hdr[s].size,
+                           ESP_PARTITION_MMAP_DATA, (const void **)&image,
+                           &handle) != ESP_OK)
+      continue;
+    if (image_crc(image, hdr[s].size) != hdr[s].crc) {
+      ESP_LOGW(TAG, "Slot %d fails its CRC", s);
+      esp_partition_munmap(handle);
+      continue;
+    }
+
+    layout_t l;
+    layout(hdr[s].count, hdr[s].strings_len, &l);
+    memset(out, 0, sizeof(*out));
+    out->count = hdr[s].count;
+    out->name_key = (uint64_t *)(image + l.name_key);
+    out->last_feeding = (time_t *)(image + l.last_feeding);
+    out->id = (uint32_t *)(image + l.id);
+    out->name = (uint32_t *)(image + l.name);
+    out->species_common = (str_ref_t *)(image + l.species_common);
+    out->active = (uint8_t *)(image + l.active);
+    out->species = (uint8_t *)(image + l.species);
+    out->sex = (uint8_t *)(image + l.sex);
+    out->cites_annex = (uint8_t *)(image + l.cites_annex);
+    out->health = (uint8_t *)(image + l.health);
+    out->terrarium = (uint8_t *)(image + l.terrarium);
+    out->strings = (char *)(image + l.strings);
+    out->strings_len = hdr[s].strings_len;
+
+    newest_slot = mapped_slot = s;
+    mapped_handle = handle;
+    generation = hdr[s].generation;
+    ESP_LOGI(TAG, "Mapped generation %u: %u rows", (unsigned)generation,
+             (unsigned)out->count);
+    return ESP_OK;
+  }
+  // Numbering resumes after whatever valid image the CRC check rejected
+  for (int s = 0; s < 2; s++)
+    if (valid[s] && hdr[s].generation > generation)
+      generation = hdr[s].generation;
+  return ESP_ERR_NOT_FOUND;
+}
+
+// ====================================================================================
+// WRITE
+// ====================================================================================
+
+uint8_t *boot_view_build(const hot_table_t *t, boot_view_str_fn species_name,
+                         size_t *out_len) {
+  // Pool offset of each species handle in use, appended after the names
+  uint32_t max_ref = 0;
+  for (uint32_t i = 0; i < t->count; i++)
+    if (t->species_common[i] > max_ref)
+      max_ref = t->species_common[i];
+  uint32_t *species_at = calloc(max_ref + 1, sizeof(uint32_t));
+  if (species_at == NULL)
+    return NULL;
+  uint32_t names_len = t->strings ? t->strings_len : 1;
+  uint32_t strings_len = names_len;
+  for (uint32_t i = 0; i < t->count; i++) {
+    str_ref_t ref = t->species_common[i];
+    if (ref != 0 && species_at[ref] == 0) {
+      species_at[ref] = strings_len;
+      strings_len += strlen(species_name(ref)) + 1;
+    }
+  }
+
+  layout_t l;
+  layout(t->count, strings_len, &l);
+  uint8_t *image = malloc(l.size);
+  if (image == NULL) {
+    free(species_at);
+    return NULL;
+  }
+  memset(image, 0, HEADER_BYTES);
+  boot_view_header_t *hdr = (boot_view_header_t *)image;
+  hdr->magic = BOOT_VIEW_MAGIC;
+  hdr->version = BOOT_VIEW_VERSION;
+  hdr->count = t->count;
+  hdr->strings_len = strings_len;
+  hdr->size = l.size;
+
+  uint32_t n = t->count;
+  memcpy(image + l.name_key, t->name_key, n * sizeof(*t->name_key));
+  memcpy(image + l.last_feeding, t->last_feeding,
+         n * sizeof(*t->last_feeding));
+  memcpy(image + l.id, t->id, n * sizeof(*t->id));
+  memcpy(image + l.name, t->name, n * sizeof(*t->name));
+  memcpy(image + l.active, t->active, n);
+  memcpy(image + l.species, t->species, n);
+  memcpy(image + l.sex, t->sex, n);
+  memcpy(image + l.cites_annex, t->cites_annex, n);
+  memcpy(image + l.health, t->health, n);
+  memcpy(image + l.terrarium, t->terrarium, n);
+
+  str_ref_t *species = (str_ref_t *)(image + l.species_common);
+  char *strings = (char *)(image + l.strings);
+  if (t->strings)
+    memcpy(strings, t->strings, names_len);
+  else
+    strings[0] = '\0';
+  for (uint32_t i = 0; i < n; i++)
+    species[i] = species_at[t->species_common[i]]; // Handle 0 stays ""
+  for (uint32_t ref = 1; ref <= max_ref; ref++)
+    if (species_at[ref] != 0)
+      strcpy(strings + species_at[ref], species_name(ref));
+  free(species_at);
+
+  *out_len = l.size;
+  return image;
+}
+
+esp_err_t boot_view_commit(uint8_t *image, size_t len) {
+  if (!open_partition())
+    return ESP_ERR_NOT_SUPPORTED;
+  if (len > slot_size()) {
+    ESP_LOGE(TAG, "Image of %u bytes does not fit a slot", (unsigned)len);
+    return ESP_ERR_INVALID_SIZE;
+  }
+  int slot = newest_slot == 0 ? 1 : 0;
+  if (slot == mapped_slot) {
+    // The database stopped reading the boot mapping once it loaded
+    esp_partition_munmap(mapped_handle);
+    mapped_slot = NO_SLOT;
+  }
+
+  boot_view_header_t *hdr = (boot_view_header_t *)image;
+  hdr->generation = generation + 1;
+  hdr->crc = image_crc(image, len);
+
+  // Header last: until it is written the slot reads as invalid
+  size_t offset = slot * slot_size();
+  size_t erase = (len + partition->erase_size - 1) &
+                 ~(size_t)(partition->erase_size - 1);
+  esp_err_t ret = esp_partition_erase_range(partition, offset, erase);
+  if (ret == ESP_OK)
+    ret = esp_partition_write(partition, offset + sizeof(*hdr),
+                              image + sizeof(*hdr), len - sizeof(*hdr));
+  if (ret == ESP_OK)
+    ret = esp_partition_write(partition, offset, image, sizeof(*hdr));
+  if (ret != ESP_OK) {
+    ESP_LOGE(TAG, "Write to slot %d failed: %s", slot, esp_err_to_name(ret));
+    return ret;
+  }
+  newest_slot = slot;
+  generation = hdr->generation;
+  return ESP_OK;
+}
@@ -0,0 +1,72 @@
+/**
+ * @file boot_view.h
+ * @brief Read-only registry preview in the flash "storage" partition
+ *
+ * The hot columns (see hot_table.h) are written after every SD checkpoint as
+ * one pointer-free image: a header, the columns at fixed offsets computed
+ * from the row count, then the name pool. Species names are copied into the
+ * pool and the species column holds their pool offsets instead of string
+ * handles, so the image needs nothing else to be read.
+ *
+ * At boot the newest valid image is mapped with esp_partition_mmap() and the
+ * columns of a hot_table_t point straight into flash, so the home page and
+ * the animal list render before the SD card is even mounted. The partition
+ * holds two slots written in turn; each image carries a generation and a
+ * CRC, so an interrupted write leaves the previous one in place.
+ */
+
+#ifndef BOOT_VIEW_H
+#define BOOT_VIEW_H
+
+#include "esp_err.h"
+#include "hot_table.h"
+#include <stddef.h>
+#include <stdint.h>
+
+#define BOOT_VIEW_PARTITION "storage"
+#define BOOT_VIEW_MAGIC 0x57454956 // "VIEW"
+#define BOOT_VIEW_VERSION 1
+
+typedef struct __attribute__((packed)) {
+  uint32_t magic;
+  uint32_t version;
+  uint32_t generation; // Incremented on every write
+  uint32_t count;      // Rows
+  uint32_t strings_len;
+  uint32_t size; // Whole image, header included
+  uint32_t crc;  // CRC32 of the image with this field zeroed
+} boot_view_header_t;
+
+// Resolves the species string handles of the hot table
+typedef const char *(*boot_view_str_fn)(str_ref_t ref);
+
+/**
+ * @brief Map the newest valid image and point the columns of `out` at it
+ *
+ * `out` is read-only: never pass it to hot_table_set() or hot_table_clear().
+ * Its species_common column holds offsets for hot_table_str(). The mapping
+ * stays until boot_view_commit() reuses its slot.
+ *
+ * @return ESP_OK, ESP_ERR_NOT_FOUND if no slot holds a valid image,
+ *         ESP_ERR_NOT_SUPPORTED without a BOOT_VIEW_PARTITION partition
+ */
+esp_err_t boot_view_map(hot_table_t *out);
+
+/**
+ * @brief Copy the hot table into a new image
+ *
+ * Only copies memory, so it is cheap enough to call while holding the
+ * database lock. The generation and CRC are filled in by boot_view_commit().
+ *
+ * @return Heap buffer (free with free()) or NULL on allocation failure
+ */
+uint8_t *boot_view_build(const hot_table_t *t, boot_view_str_fn species_name,
+                         size_t *out_len);
+
+/**
+ * @brief Checksum an image from boot_view_build() and write it to the slot
+ *        not holding the newest image
+ */
+esp_err_t boot_view_commit(uint8_t *image, size_t len);
+
+#endif // BOOT_VIEW_H
@@ -0,0 +1,188 @@
+/**
+ * @file calendar.c
+ * @brief Breeding events by date
+ */
+
+#include "calendar.h"
+#include "esp_heap_caps.h"
+#include "esp_log.h"
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+
+static const char *TAG = "CALENDAR";
+
+#define MIN_EVENTS 64
+#define SECONDS_PER_DAY (24 * 3600)
+
+// Species first, by name prefix; the group defaults close the table
+static const incubation_profile_t profiles[] = {
+    {"python regius", SPECIES_SNAKE, 60, 110, 55, 62},       // 31-32 C
+    {"morelia", SPECIES_SNAKE, 50, 100, 52, 60},             // 31 C
+    {"pantherophis", SPECIES_SNAKE, 30, 45, 55, 65},         // 28 C
+    {"lampropeltis", SPECIES_SNAKE, 30, 60, 55, 65},         // 28 C
+    {"eublepharis", SPECIES_LIZARD, 16, 25, 40, 60},         // 29 C
+    {"correlophus", SPECIES_LIZARD, 30, 45, 60, 90},         // 24 C
+    {"pogona", SPECIES_LIZARD, 20, 40, 55, 75},              // 29 C
+    {"testudo", SPECIES_TURTLE, 20, 60, 55, 70},             // 31 C
+    {NULL, SPECIES_SNAKE, 30, 60, 50, 70},
+    {NULL, SPECIES_LIZARD, 20, 45, 45, 75},
+    {NULL, SPECIES_TURTLE, 20, 60, 55, 80},
+    {NULL, SPECIES_OTHER, 20, 60, 45, 90},
+};
+
+#define PROFILE_COUNT (sizeof(profiles) / sizeof(profiles[0]))
+
+const incubation_profile_t *calendar_profile(reptile_species_t species,
+                                             const char *scientific) {
+  if (scientific && scientific[0])
+    for (size_t i = 0; i < PROFILE_COUNT && profiles[i].scientific; i++)
+      if (strncasecmp(scientific, profiles[i].scientific,
+                      strlen(profiles[i].scientific)) == 0)
+        return &profiles[i];
+  for (size_t i = 0; i < PROFILE_COUNT; i++)
+    if (profiles[i].scientific == NULL && profiles[i].species == species)
+      return &profiles[i];
+  return &profiles[PROFILE_COUNT - 1]; // SPECIES_OTHER
+}
+
+static int64_t days(int n) { return (int64_t)n * SECONDS_PER_DAY; }
+
+int calendar_predict(const breeding_record_t *b, uint16_t clutch,
+                     const incubation_profile_t *p,
+                     calendar_event_t out[CALENDAR_EVENTS_PER_CLUTCH]) {
+  if (!b->active)
+    return 0;
+  int n = 0;
+  int64_t lay_min = 0, lay_max = 0;
+  if (b->laying_date) {
+    lay_min = lay_max = b->laying_date;
+    out[n++] = (calendar_event_t){
+        .start = lay_min, .end = lay_max, .clutch = clutch,
+        .kind = CALENDAR_LAYING};
+  } else if (b->pairing_date) {
+    lay_min = b->pairing_date + days(p->laying_min);
+    lay_max = b->pairing_date + days(p->laying_max);
+    out[n++] = (calendar_event_t){
+        .start = lay_min, .end = lay_max, .clutch = clutch,
+        .kind = CALENDAR_LAYING, .predicted = 1};
+  }
+
+  if (b->hatch_date)
+    out[n++] = (calendar_event_t){
+        .start = b->hatch_date, .end = b->hatch_date, .clutch = clutch,
+        .kind = CALENDAR_HATCH};
+  else if (lay_min)
+    out[n++] = (calendar_event_t){.start = lay_min + days(p->incubation_min),
+                                  .end = lay_max + days(p->incubation_max),
+                                  .clutch = clutch,
+                                  .kind = CALENDAR_HATCH,
+                                  .predicted = 1};
+  return n;
+}
+
+static esp_err_t calendar_reserve(calendar_t *c, uint32_t count) {
+  if (count <= c->capacity)
+    return ESP_OK;
+  uint32_t cap = c->capacity ? c->capacity : MIN_EVENTS;
+  while (cap < count)
+    cap *= 2;
+  void *p = heap_caps_realloc_prefer(c->events, cap * sizeof(*c->events), 2,
+                                     MALLOC_CAP_SPIRAM, MALLOC_CAP_DEFAULT);
+  if (p == NULL) {
+    ESP_LOGE(TAG, "Out of memory for %u events", (unsigned)cap);
+    return ESP_ERR_NO_MEM;
+  }
+  c->events = p;
+  c->capacity = cap;
+  return ESP_OK;
+}
+
+// First event starting at or after `t`
+static uint32_t lower_bound(const calendar_t *c, int64_t t) {
+  uint32_t lo = 0, hi = c->count;
+  while (lo < hi) {
+    uint32_t mid = lo + (hi - lo) / 2;
+    if (c->events[mid].start < t)
+      lo = mid + 1;
+    else
+      hi = mid;
+  }
+  return lo;
+}
+
+static void note_span(calendar_t *c, const calendar_event_t *e) {
+  if (e->end - e->start > c->max_span)
+    c->max_span = e->end - e->start;
+}
+
+esp_err_t calendar_set(calendar_t *c, uint16_t clutch,
+                       const calendar_event_t *events, int n) {
+  uint32_t kept = 0;
+  for (uint32_t i = 0; i < c->count; i++)
+    if (c->events[i].clutch != clutch)
+      c->events[kept++] = c->events[i];
+  c->count = kept;
+  if (calendar_reserve(c, c->count + n) != ESP_OK)
+    return ESP_ERR_NO_MEM;
+
+  for (int i = 0; i < n; i++) {
+    // After any event of the same start, so equal dates keep their order
+    uint32_t at = lower_bound(c, events[i].start + 1);
+    memmove(&c->events[at + 1], &c->events[at],
+            (c->count - at) * sizeof(*c->events));
+    c->events[at] = events[i];
+    c->count++;
+    note_span(c, &events[i]);
+  }
+  return ESP_OK;
+}
+
+esp_err_t calendar_append(calendar_t *c, const calendar_event_t *events,
+                          int n) {
+  if (calendar_reserve(c, c->count + n) != ESP_OK)
+    return ESP_ERR_NO_MEM;
+  for (int i = 0; i < n; i++) {
+    c->events[c->count++] = events[i];
+    note_span(c, &events[i]);
+  }
+  return ESP_OK;
+}
+
+static int compare_start(const void *a, const void *b) {
+  const calendar_event_t *x = a, *y = b;
+  if (x->start != y->start)
+    return x->start < y->start ? -1 : 1;
+  if (x->clutch != y->clutch)
+    return x->clutch < y->clutch ? -1 : 1;
+  return (int)x->kind - (int)y->kind;
+}
+
+void calendar_sort(calendar_t *c) {
+  if (c->count > 1)
+    qsort(c->events, c->count, sizeof(*c->events), compare_start);
+}
+
+int calendar_range(const calendar_t *c, int64_t from, int64_t to,
+                   calendar_event_t *out, int max) {
+  int n = 0;
+  for (uint32_t i = lower_bound(c, from - c->max_span);
+       i < c->count && c->events[i].start <= to && n < max; i++)
+    if (c->events[i].end >= from)
+      out[n++] = c->events[i];
+  return n;
+}
+
+int calendar_open_count(const calendar_t *c, int64_t now) {
+  int n = 0;
+  for (uint32_t i = lower_bound(c, now - c->max_span);
+       i < c->count && c->events[i].start <= now; i++)
+    if (c->events[i].predicted && c->events[i].end >= now)
+      n++;
+  return n;
+}
+
+void calendar_clear(calendar_t *c) {
+  c->count = 0;
+  c->max_span = 0;
+}
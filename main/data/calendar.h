@@ -0,0 +1,112 @@
+/**
+ * @file calendar.h
+ * @brief Laying and hatching dates of the clutches, actual or predicted, in
+ *        date order
+ *
+ * Each breeding record yields up to two events: its laying and its
+ * hatching. A date the keeper entered is an actual event on that day. A
+ * missing one is predicted as a window from the incubation profile of the
+ * female's species: laying from the pairing date, hatching from the laying
+ * date (or, before laying, from the predicted laying window).
+ *
+ * Events are held in one array sorted by window start. Windows still open
+ * at the start of a range began at most `max_span` (the widest window held)
+ * earlier: a range query binary searches there, copies forward and skips
+ * the events already closed. "The next 30 days" thus costs O(log n + k + s),
+ * s being the events that start within `max_span` before the range: the
+ * clutches of the last few months (windows stay under 90 days with the
+ * profiles in calendar.c), not the whole history. There is no end-ordered
+ * index; at MAX_BREEDINGS clutches the scan is a few thousand events at
+ * worst. `max_span` only shrinks at calendar_clear().
+ */
+
+#ifndef CALENDAR_H
+#define CALENDAR_H
+
+#include "../models.h"
+#include "esp_err.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+#define CALENDAR_EVENTS_PER_CLUTCH 2
+
+typedef enum {
+  CALENDAR_LAYING = 0,
+  CALENDAR_HATCH,
+} calendar_kind_t;
+
+typedef struct {
+  int64_t start; // Unix time; the day itself for an actual event
+  int64_t end;   // Last possible time, `start` for an actual event
+  uint16_t clutch; // Breeding table index
+  uint8_t kind;    // calendar_kind_t
+  uint8_t predicted;
+} calendar_event_t;
+
+typedef struct {
+  calendar_event_t *events; // Sorted by start
+  uint32_t count;
+  uint32_t capacity;
+  int64_t max_span; // Widest window held since the last clear
+} calendar_t;
+
+// Days after pairing a clutch is laid, and after laying it hatches, at the
+// usual incubation temperature of the species
+typedef struct {
+  const char *scientific; // Lower-case name prefix, NULL for a whole group
+  uint8_t species;        // reptile_species_t group
+  uint8_t laying_min;
+  uint8_t laying_max;
+  uint8_t incubation_min;
+  uint8_t incubation_max;
+} incubation_profile_t;
+
+/**
+ * @brief Profile of a species: by scientific name when it is in the table,
+ *        by species group otherwise (never NULL)
+ */
+const incubation_profile_t *calendar_profile(reptile_species_t species,
+                                             const char *scientific);
+
+/**
+ * @brief Events of breeding record `clutch`; none for an inactive one
+ * @return Number of events written to `out`
+ */
+int calendar_predict(const breeding_record_t *b, uint16_t clutch,
+                     const incubation_profile_t *p,
+                     calendar_event_t out[CALENDAR_EVENTS_PER_CLUTCH]);
+
+/**
+ * @brief Replace the events of `clutch` with `events` (O(n) moves)
+ */
+esp_err_t calendar_set(calendar_t *c, uint16_t clutch,
+                       const calendar_event_t *events, int n);
+
+/**
+ * @brief Add events in any order; calendar_sort() before the next query
+ *        (for rebuilding every clutch at once)
+ */
+esp_err_t calendar_append(calendar_t *c, const calendar_event_t *events,
+                          int n);
+void calendar_sort(calendar_t *c);
+
+/**
+ * @brief Copy up to `max` events whose day or window meets [from, to], by
+ *        start
+ * @return Number copied
+ */
+int calendar_range(const calendar_t *c, int64_t from, int64_t to,
+                   calendar_event_t *out, int max);
+
+/**
+ * @brief Predicted windows open at `now`: clutches that may lay or hatch
+ *        any day
+ */
+int calendar_open_count(const calendar_t *c, int64_t now);
+
+/**
+ * @brief Drop every event; memory is kept
+ */
+void calendar_clear(calendar_t *c);
+
+#endif // CALENDAR_H
@@ -0,0 +1,178 @@
+/**
+ * @file csv_writer.c
+ * @brief Buffered CSV writer implementation
+ */
+
+#include "csv_writer.h"
+#include "esp_heap_caps.h"
+#include "esp_log.h"
+#include <string.h>
+#include <unistd.h>
+
+static const char *TAG = "CSV_WRITER";
+
+#define CSV_BUF_BYTES (CSV_CHUNK_BYTES + CSV_ROW_MAX)
+#define CSV_BUF_ALIGN 64 // Cache line, so the SDMMC driver can DMA in place
+
+// Reserve `need` bytes; a row overflowing CSV_ROW_MAX is an error, not a
+// silent truncation
+static char *csv_room(csv_writer_t *w, size_t need) {
+  if (w->len + need > CSV_BUF_BYTES) {
+    w->error = ESP_ERR_INVALID_SIZE;
+    return NULL;
+  }
+  return w->buf + w->len;
+}
+
+// Separator before every field but the first of a row
+static void csv_sep(csv_writer_t *w) {
+  if (w->in_row && w->len < CSV_BUF_BYTES)
+    w->buf[w->len++] = ',';
+  w->in_row = true;
+}
+
+static char *put_digits(char *p, uint32_t v, int min_width) {
+  char tmp[10];
+  int n = 0;
+  do {
+    tmp[n++] = '0' + v % 10;
+    v /= 10;
+  } while (v);
+  while (n < min_width)
+    tmp[n++] = '0';
+  while (n)
+    *p++ = tmp[--n];
+  return p;
+}
+
+// ====================================================================================
+// API
+// ====================================================================================
+
+esp_err_t csv_open(csv_writer_t *w, const char *path, bool append) {
+  memset(w, 0, sizeof(*w));
+  w->buf = heap_caps_aligned_alloc(CSV_BUF_ALIGN, CSV_BUF_BYTES,
+                                   MALLOC_CAP_DMA | MALLOC_CAP_INTERNAL);
+  if (w->buf == NULL)
+    w->buf = heap_caps_aligned_alloc(CSV_BUF_ALIGN, CSV_BUF_BYTES,
+                                     MALLOC_CAP_SPIRAM);
+  if (w->buf == NULL) {
+    ESP_LOGE(TAG, "Out of memory for the export buffer");
+    return ESP_ERR_NO_MEM;
+  }
+  w->file = fopen(path, append ? "ab" : "wb");
+  if (w->file == NULL) {
+    ESP_LOGE(TAG, "Failed to create %s", path);
+    heap_caps_free(w->buf);
+    w->buf = NULL;
+    return ESP_ERR_NOT_FOUND;
+  }
+  setvbuf(w->file, NULL, _IONBF, 0); // The chunks are the buffering
+  return ESP_OK;
+}
+
+void csv_text(csv_writer_t *w, const char *s) {
+  csv_sep(w);
+  size_t len = strlen(s);
+  char *p = csv_room(w, 2 * len + 2);
+  if (p == NULL)
+    return;
+  *p++ = '"';
+  for (size_t i = 0; i < len; i++) {
+    if (s[i] == '"')
+      *p++ = '"';
+    *p++ = s[i];
+  }
+  *p++ = '"';
+  w->len = p - w->buf;
+}
+
+void csv_raw(csv_writer_t *w, const char *s) {
+  csv_sep(w);
+  size_t len = strlen(s);
+  char *p = csv_room(w, len);
+  if (p == NULL)
+    return;
+  memcpy(p, s, len);
+  w->len += len;
+}
+
+void csv_uint(csv_writer_t *w, uint32_t v) {
+  csv_sep(w);
+  char *p = csv_room(w, 10);
+  if (p)
+    w->len = put_digits(p, v, 1) - w->buf;
+}
+
+void csv_int(csv_writer_t *w, int32_t v) {
+  csv_sep(w);
+  char *p = csv_room(w, 11);
+  if (p == NULL)
+    return;
+  if (v < 0)
+    *p++ = '-';
+  w->len = put_digits(p, v < 0 ? 0u - (uint32_t)v : (uint32_t)v, 1) - w->buf;
+}
+
+void csv_ymd(csv_writer_t *w, int year, int month, int day) {
+  csv_sep(w);
+  char *p = csv_room(w, 10);
+  if (p == NULL || year <= 0 || year > 9999)
+    return;
+  p = put_digits(p, year, 4);
+  *p++ = '-';
+  p = put_digits(p, month % 100, 2);
+  *p++ = '-';
+  w->len = put_digits(p, day % 100, 2) - w->buf;
+}
+
+void csv_date(csv_writer_t *w, time_t t) {
+  struct tm tm;
+  if (t == 0 || localtime_r(&t, &tm) == NULL) {
+    csv_sep(w);
+    return;
+  }
+  csv_ymd(w, tm.tm_year + 1900, tm.tm_mon + 1, tm.tm_mday);
+}
+
+void csv_end_row(csv_writer_t *w) {
+  char *p = csv_room(w, 1);
+  if (p) {
+    *p = '\n';
+    w->len++;
+  }
+  w->in_row = false;
+}
+
+bool csv_full(const csv_writer_t *w) { return w->len >= CSV_CHUNK_BYTES; }
+
+esp_err_t csv_flush(csv_writer_t *w) {
+  size_t whole = w->len - w->len % CSV_CHUNK_BYTES;
+  if (w->error == ESP_OK && whole > 0) {
+    if (fwrite(w->buf, 1, whole, w->file) != whole) {
+      ESP_LOGE(TAG, "Write failed after %ld bytes", ftell(w->file));
+      w->error = ESP_FAIL;
+    }
+    // The tail is under CSV_ROW_MAX bytes
+    memmove(w->buf, w->buf + whole, w->len - whole);
+    w->len -= whole;
+  }
+  return w->error;
+}
+
+esp_err_t csv_close(csv_writer_t *w) {
+  if (w->file == NULL)
+    return ESP_ERR_INVALID_STATE;
+  csv_flush(w);
+  if (w->error == ESP_OK && w->len > 0 &&
+      fwrite(w->buf, 1, w->len, w->file) != w->len)
+    w->error = ESP_FAIL;
+  if (w->error == ESP_OK && (fflush(w->file) != 0 || fsync(fileno(w->file))))
+    w->error = ESP_FAIL;
+  if (fclose(w->file) != 0 && w->error == ESP_OK)
+    w->error = ESP_FAIL;
+  heap_caps_free(w->buf);
+  w->file = NULL;
+  w->buf = NULL;
+  return w->error;
+}
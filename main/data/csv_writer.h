@@ -0,0 +1,80 @@
+/**
+ * @file csv_writer.h
+ * @brief Buffered CSV row formatter writing whole clusters to the SD card
+ *
+ * Fields are formatted straight into one large, DMA-capable buffer (no
+ * printf, no stdio buffering). The file only receives whole multiples of
+ * CSV_CHUNK_BYTES, so FATFS hands full, aligned clusters to the card instead
+ * of a small write per field. Formatting never touches the file: the caller
+ * fills the buffer up to csv_full(), then writes it out with csv_flush(),
+ * which lets it format under a lock and write with the lock released.
+ */
+
+#ifndef CSV_WRITER_H
+#define CSV_WRITER_H
+
+#include "esp_err.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <time.h>
+
+#define CSV_CHUNK_BYTES (32 * 1024) // Multiple of the FAT cluster size
+#define CSV_ROW_MAX 2048            // Longest row formatted past csv_full()
+
+typedef struct {
+  FILE *file;
+  char *buf; // CSV_CHUNK_BYTES + CSV_ROW_MAX
+  size_t len;
+  bool in_row;     // Next field needs a separator
+  esp_err_t error; // First error, reported by csv_flush()/csv_close()
+} csv_writer_t;
+
+/**
+ * @brief Create (truncate) or append to `path` and allocate the buffer
+ */
+esp_err_t csv_open(csv_writer_t *w, const char *path, bool append);
+
+/**
+ * @brief Quoted text field, embedded quotes doubled (RFC 4180)
+ */
+void csv_text(csv_writer_t *w, const char *s);
+
+/**
+ * @brief Unquoted field, written as is
+ */
+void csv_raw(csv_writer_t *w, const char *s);
+
+void csv_uint(csv_writer_t *w, uint32_t v);
+void csv_int(csv_writer_t *w, int32_t v);
+
+/**
+ * @brief Local date as YYYY-MM-DD; empty field for 0
+ */
+void csv_date(csv_writer_t *w, time_t t);
+
+/**
+ * @brief YYYY-MM-DD from its parts; empty field for year 0
+ */
+void csv_ymd(csv_writer_t *w, int year, int month, int day);
+
+void csv_end_row(csv_writer_t *w);
+
+/**
+ * @brief True once a chunk is ready; stop formatting and csv_flush()
+ */
+bool csv_full(const csv_writer_t *w);
+
+/**
+ * @brief Write the whole chunks formatted so far (blocks on the SD card)
+ */
+esp_err_t csv_flush(csv_writer_t *w);
+
+/**
+ * @brief Write the rest, close the file and free the buffer
+ * @return The first error met since csv_open()
+ */
+esp_err_t csv_close(csv_writer_t *w);
+
+#endif // CSV_WRITER_H
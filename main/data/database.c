@@ -5,450 +5,3726 @@
 
 #include "database.h"
 #include "../ui_theme.h" // For colors if needed, or remove if decoupling strict
+#include "arena.h"
+#include "archive.h"
+#include "audit_log.h"
+#include "boot_view.h"
+#include "calendar.h"
+#include "csv_writer.h"
+#include "db_schema.h"
+#include "due_queue.h"
+#include "hash_index.h"
+#include "hot_table.h"
 #include "esp_err.h"
 #include "esp_log.h"
+#include "esp_rom_crc.h"
+#include "esp_system.h"
+#include "esp_timer.h"
+#include "forecast.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/event_groups.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+#include "journal.h"
+#include "query.h"
+#include "sdkconfig.h"
+#include "seqlock.h"
+#include "snapshot.h"
+#include "stats.h"
+#include "string_pool.h"
+#include "text_index.h"
+#include "uuid_gen.h"
+#include "weight_series.h"
 #include <dirent.h>
+#include <stddef.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
+#include <strings.h>
 #include <sys/stat.h>
 #include <time.h>
+#include <unistd.h>
 
 static const char *TAG = "DATABASE";
 
+// RAM tables + pending state. Recursive.
+static SemaphoreHandle_t db_mutex = NULL;
+
+// While db_load_data() fills the tables it holds no lock: the tables are its
+// own until it publishes them. Every other task waits for DB_EVENT_LOADED
+// before it takes db_mutex, and readers see the preview (or nothing) until
+// then, so none of them waits on the SD card.
+static EventGroupHandle_t db_events = NULL;
+#define DB_EVENT_LOADED (1u << 0)
+static TaskHandle_t volatile load_task = NULL; // Running the load, if any
+
+static void db_lock(void) {
+  if (!db_mutex)
+    return;
+  for (;;) {
+    TaskHandle_t loader = load_task;
+    if (loader && loader != xTaskGetCurrentTaskHandle())
+      xEventGroupWaitBits(db_events, DB_EVENT_LOADED, pdFALSE, pdTRUE,
+                          portMAX_DELAY);
+    xSemaphoreTakeRecursive(db_mutex, portMAX_DELAY);
+    loader = load_task;
+    if (!loader || loader == xTaskGetCurrentTaskHandle())
+      return;
+    xSemaphoreGiveRecursive(db_mutex); // A load started meanwhile
+  }
+}
+
+#define DB_LOCK() db_lock()
+#define DB_UNLOCK()                                                            \
+  do {                                                                         \
+    if (db_mutex)                                                              \
+      xSemaphoreGiveRecursive(db_mutex);                                       \
+  } while (0)
+
+// Readers do not take db_mutex: they copy what they need under seqlocks
+// (see seqlock.h) and retry if a modifier was writing meanwhile. Modifiers
+// still serialize on db_mutex, and bracket every store a reader could see:
+// - an in-place change to one reptile record in its record_locks stripe;
+// - anything else (hot columns, string pools, appends, loads, the cold
+//   tables) in tables_lock.
+// A reptile reader checks both; every other reader checks tables_lock.
+#define RECORD_LOCKS 64
+#ifndef READ_ATTEMPTS
+#define READ_ATTEMPTS 8 // Then wait for the writer on db_mutex
+#endif
+
+static seqlock_t record_locks[RECORD_LOCKS];
+static seqlock_t tables_lock;
+
+static seqlock_t *record_lock(uint32_t index) {
+  return &record_locks[index % RECORD_LOCKS];
+}
+
+// Copy at most len - 1 bytes: a reader racing a writer may see a stale
+// pointer into memory that is no longer NUL-terminated where it expects
+static void copy_text(char *buf, size_t len, const char *s) {
+  size_t n = strnlen(s, len - 1);
+  memcpy(buf, s, n);
+  buf[n] = '\0';
+}
+
+// ====================================================================================
+// DATA STORAGE
+// ====================================================================================
+// Tables grow in PSRAM chunks, so record pointers stay valid as they grow.
+
+static arena_t reptile_table = ARENA_INIT(reptile_t, 6, MAX_REPTILES);
+static arena_t feeding_table = ARENA_INIT(feeding_record_t, 10, MAX_FEEDINGS);
+static arena_t health_table =
+    ARENA_INIT(health_record_t, 8, MAX_HEALTH_RECORDS);
+static arena_t breeding_table =
+    ARENA_INIT(breeding_record_t, 4, MAX_BREEDINGS);
+static arena_t inventory_table =
+    ARENA_INIT(inventory_item_t, 4, MAX_INVENTORY_ITEMS);
+
+static reptile_t *reptile_at(uint32_t index) {
+  return arena_at(&reptile_table, index);
+}
+
+// Interned texts referenced by str_ref_t fields
+static string_pool_t strings;
+
+static str_ref_t intern(const char *s, size_t len) {
+  str_ref_t ref = 0;
+  seqlock_write_begin(&tables_lock); // The pool may move as it grows
+  string_pool_intern(&strings, s, len, &ref); // Logs and yields "" on OOM
+  seqlock_write_end(&tables_lock);
+  return ref;
+}
+
+static const char *lookup(str_ref_t ref) {
+  return string_pool_get(&strings, ref);
+}
+
+static const schema_strings_t schema_strings = {intern, lookup};
+
+// Weight history, one series per reptile slot
+static arena_t weight_table = ARENA_INIT(weight_series_t, 6, MAX_REPTILES);
+
+static weight_series_t *weight_series_at(uint32_t index) {
+  if (index >= reptile_table.count)
+    return NULL;
+  if (index >= weight_table.count &&
+      arena_resize(&weight_table, reptile_table.count) != ESP_OK)
+    return NULL;
+  return arena_at(&weight_table, index);
+}
+
+// Free the series of every slot from `count` on
+static void db_weights_truncate(uint32_t count) {
+  for (uint32_t i = count; i < weight_table.count; i++)
+    weight_series_free(arena_at(&weight_table, i));
+  if (count < weight_table.count)
+    arena_resize(&weight_table, count);
+}
+
+// ====================================================================================
+// INDEXES
+// ====================================================================================
+// Reptile lookups by id, UUID and microchip, and the text search index. Kept
+// in sync by every modifier that changes a key, and rebuilt after loading.
+
+static hash_index_t id_index;
+static hash_index_t uuid_index;
+static hash_index_t chip_index;
+static uint32_t max_reptile_id = 0;
+// Ids below this were handed out once and are never reused, even after their
+// record is gone (truncated table, file edited on a PC); kept in the snapshot
+static uint32_t next_reptile_id = 0;
+static uint32_t max_mod_seq = 0; // Highest reptile_t.mod_seq, see CSV EXPORT
+static hot_table_t hot; // Scan columns, see hot_table.h
+static stats_t stats;   // Dashboard aggregates, see stats.h
+static calendar_t calendar; // Breeding events by date, see calendar.h
+static forecast_t forecast; // Prey consumption rates, see forecast.h
+static text_index_t words; // Search words of every record, see text_index.h
+
+// Until db_load_data() completes, the hot column readers see the preview
+// mapped from flash instead (see boot_view.h); every other reader reads as
+// empty or not found
+static hot_table_t boot_hot;
+static const hot_table_t *volatile view = &hot;
+static esp_err_t boot_view_state = ESP_ERR_NOT_SUPPORTED;
+
+// Public readers outside the hot columns: nothing to read during a load
+#define DB_LOADING() (view != &hot)
+
+// ====================================================================================
+// FEEDING ALERTS
+// ====================================================================================
+// Every active, fed animal waits in a due-time heap until its next meal is
+// due. One esp_timer is armed for the head of the heap; when it fires, the
+// animals now due move to the due set, so the alert count is a counter.
+// Sleeps are capped so a wall-clock jump (SNTP sync) is caught within
+// ALERT_MAX_SLEEP_S.
+
+#define ALERT_MAX_SLEEP_S 60
+#define ALERT_RETRY_US (100 * 1000) // Database busy when the timer fired
+#define SECONDS_PER_DAY (24 * 3600)
+
+static due_queue_t feed_alerts;
+static esp_timer_handle_t alert_timer = NULL;
+static int64_t alert_armed_for = 0; // When the timer fires, 0 if stopped
+
+static const uint8_t species_feed_days[] = {
+    [SPECIES_SNAKE] = CONFIG_APP_FEED_DAYS_SNAKE,
+    [SPECIES_LIZARD] = CONFIG_APP_FEED_DAYS_LIZARD,
+    [SPECIES_TURTLE] = CONFIG_APP_FEED_DAYS_TURTLE,
+    [SPECIES_OTHER] = CONFIG_APP_FEED_DAYS_OTHER,
+};
+
+static int feeding_interval(const reptile_t *r) {
+  if (r->feeding_interval_days)
+    return r->feeding_interval_days;
+  if ((unsigned)r->species < sizeof(species_feed_days))
+    return species_feed_days[r->species];
+  return CONFIG_APP_FEED_DAYS_OTHER;
+}
+
+// Make sure the timer fires by the head of the heap (called under DB_LOCK)
+static void alert_arm(int64_t now) {
+  int64_t next = due_queue_next(&feed_alerts);
+  if (alert_timer == NULL || next == 0)
+    return;
+  int64_t at = next < now + ALERT_MAX_SLEEP_S ? next : now + ALERT_MAX_SLEEP_S;
+  if (at < now)
+    at = now;
+  if (alert_armed_for != 0 && alert_armed_for <= at)
+    return;
+  esp_timer_stop(alert_timer);
+  if (esp_timer_start_once(alert_timer, (at - now) * 1000000 + 1000) ==
+      ESP_OK)
+    alert_armed_for = at;
+}
+
+static void alert_timer_cb(void *arg) {
+  // Never block the timer task behind a save: retry shortly instead
+  if (db_mutex && xSemaphoreTakeRecursive(db_mutex, 0) != pdTRUE) {
+    esp_timer_start_once(alert_timer, ALERT_RETRY_US);
+    return;
+  }
+  if (load_task) { // The tables are the load's: it arms the timer again
+    DB_UNLOCK();
+    return;
+  }
+  int64_t now = time(NULL);
+  alert_armed_for = 0;
+  due_queue_advance(&feed_alerts, now);
+  alert_arm(now);
+  DB_UNLOCK();
+}
+
+// Reschedule one animal after any change to it
+static void db_alert_sync(uint32_t index) {
+  const reptile_t *r = reptile_at(index);
+  int64_t now = time(NULL);
+  int64_t due = 0;
+  if (r->active && r->last_feeding != 0)
+    due = (int64_t)r->last_feeding +
+          (int64_t)feeding_interval(r) * SECONDS_PER_DAY;
+  if (due_queue_set(&feed_alerts, index, due, now) != ESP_OK)
+    ESP_LOGE(TAG, "Feeding alert update failed for slot %u", (unsigned)index);
+  alert_arm(now);
+}
+
+static bool match_id(uint32_t index, const void *key) {
+  return reptile_at(index)->id == *(const uint32_t *)key;
+}
+
+static bool match_uuid(uint32_t index, const void *key) {
+  return strcmp(reptile_at(index)->uuid, key) == 0;
+}
+
+static bool match_chip(uint32_t index, const void *key) {
+  return strcmp(reptile_at(index)->microchip, key) == 0;
+}
+
+// The fields a text query searches, one per line
+static void search_text(uint16_t index, char *buf, size_t len, void *ctx) {
+  const reptile_t *r = reptile_at(index);
+  snprintf(buf, len, "%s\n%s\n%s\n%s\n%s\n%s", r->name,
+           lookup(r->species_common), lookup(r->species_scientific),
+           r->morph, r->microchip, lookup(r->breeder_name));
+}
+
+static void db_words_update(uint32_t index, bool add) {
+  static char text[TEXT_INDEX_MAX_TEXT];
+  search_text(index, text, sizeof(text), NULL);
+  if (!add)
+    text_index_remove(&words, index, text);
+  else if (text_index_add(&words, index, text) != ESP_OK)
+    ESP_LOGE(TAG, "Search index update failed for slot %u", (unsigned)index);
+}
+
+// Refresh the scan columns of a record after any change to it
+static void db_hot_sync(uint32_t index) {
+  if (index > hot.count)
+    return; // Mid-load: db_index_rebuild() fills the table afterwards
+  seqlock_write_begin(&tables_lock);
+  if (hot_table_set(&hot, index, reptile_at(index)) != ESP_OK)
+    ESP_LOGE(TAG, "Hot table update failed for slot %u", (unsigned)index);
+  if (stats_row_set(&stats, index, reptile_at(index)) != ESP_OK)
+    ESP_LOGE(TAG, "Statistics update failed for slot %u", (unsigned)index);
+  seqlock_write_end(&tables_lock);
+  db_alert_sync(index);
+}
+
+static void db_index_add(uint32_t index) {
+  const reptile_t *r = reptile_at(index);
+  db_hot_sync(index);
+  esp_err_t ret = hash_index_insert(&id_index, hash_u32(r->id), index);
+  if (ret == ESP_OK && r->uuid[0])
+    ret = hash_index_insert(&uuid_index, hash_string(r->uuid), index);
+  if (ret == ESP_OK && r->microchip[0])
+    ret = hash_index_insert(&chip_index, hash_string(r->microchip), index);
+  if (ret != ESP_OK)
+    ESP_LOGE(TAG, "Index insert failed for reptile %u", (unsigned)r->id);
+  db_words_update(index, true);
+  if (r->id > max_reptile_id)
+    max_reptile_id = r->id;
+  if (r->mod_seq > max_mod_seq)
+    max_mod_seq = r->mod_seq;
+}
+
+// A random UUID no indexed reptile has. A repeat is practically impossible,
+// but an imported one may come from anywhere: check rather than trust.
+static void db_new_uuid(char out[UUID_STR_LEN]) {
+  do
+    uuid_v4(out);
+  while (hash_index_find(&uuid_index, hash_string(out), match_uuid, out) >= 0);
+}
+
+// Incubation profile of a clutch, from its female's species
+static const incubation_profile_t *
+db_breeding_profile(const breeding_record_t *b) {
+  int32_t index = hash_index_find(&id_index, hash_u32(b->female_id), match_id,
+                                  &b->female_id);
+  if (index < 0)
+    return calendar_profile(SPECIES_OTHER, NULL);
+  const reptile_t *f = reptile_at(index);
+  return calendar_profile(f->species, lookup(f->species_scientific));
+}
+
+// Predict the events of one clutch again (called under tables_lock)
+static void db_calendar_sync(uint32_t index) {
+  calendar_event_t ev[CALENDAR_EVENTS_PER_CLUTCH];
+  const breeding_record_t *b = arena_at(&breeding_table, index);
+  int n = calendar_predict(b, index, db_breeding_profile(b), ev);
+  if (calendar_set(&calendar, index, ev, n) != ESP_OK)
+    ESP_LOGE(TAG, "Calendar update failed for clutch %u", (unsigned)index);
+}
+
+// Every clutch, once the id index is complete: predictions follow the
+// females' species as of now
+static void db_calendar_rebuild(void) {
+  calendar_event_t ev[CALENDAR_EVENTS_PER_CLUTCH];
+  calendar_clear(&calendar);
+  for (uint32_t i = 0; i < breeding_table.count; i++) {
+    const breeding_record_t *b = arena_at(&breeding_table, i);
+    int n = calendar_predict(b, i, db_breeding_profile(b), ev);
+    if (calendar_append(&calendar, ev, n) != ESP_OK)
+      ESP_LOGE(TAG, "Calendar update failed for clutch %u", (unsigned)i);
+  }
+  calendar_sort(&calendar);
+}
+
+// Call before changing the keys of a record
+static void db_index_remove(uint32_t index) {
+  const reptile_t *r = reptile_at(index);
+  hash_index_remove(&id_index, hash_u32(r->id), index);
+  if (r->uuid[0])
+    hash_index_remove(&uuid_index, hash_string(r->uuid), index);
+  if (r->microchip[0])
+    hash_index_remove(&chip_index, hash_string(r->microchip), index);
+  db_words_update(index, false);
+}
+
+// History chains: every feeding and health record links to the previous
+// record of the same animal, and each reptile slot holds the newest one, so
+// one animal's last N events cost O(N) whatever the size of the tables.
+// Links are record sequence + 1, 0 ends the chain.
+//
+// A record's sequence is its index in the table and never changes. The
+// tables only keep their newest records in RAM: once one holds more than its
+// ring size, its oldest chunk is rolled out to archive segments on the SD
+// card, links included, so a chain walk simply continues into the archive.
+
+typedef struct {
+  uint32_t feeding_head;
+  uint32_t health_head;
+  uint32_t feeding_count;
+  uint32_t health_count;
+} history_chain_t;
+
+typedef struct {
+  history_chain_t all;
+  history_chain_t archived; // Rolled-out part, persisted in SECTION_HISTORY
+} history_head_t;
+
+static arena_t history_heads = ARENA_INIT(history_head_t, 6, MAX_REPTILES);
+static arena_t feeding_links = ARENA_INIT(uint32_t, 10, MAX_FEEDINGS);
+static arena_t health_links = ARENA_INIT(uint32_t, 8, MAX_HEALTH_RECORDS);
+
+static archive_t feeding_archive =
+    ARCHIVE_INIT(ARCHIVE_ROOT "/feedings", SECTION_FEEDINGS);
+static archive_t health_archive =
+    ARCHIVE_INIT(ARCHIVE_ROOT "/health", SECTION_HEALTH);
+
+// One history table: its records, their links and where they roll out to.
+// Links share the records' chunk size so both release in step.
+typedef struct {
+  arena_t *records;
+  arena_t *links;
+  archive_t *archive;
+  uint32_t ring_size; // Records kept in RAM
+  size_t animal_offset;
+  size_t timestamp_offset;
+  bool feeding;
+} history_t;
+
+static const history_t feedings = {
+    &feeding_table,
+    &feeding_links,
+    &feeding_archive,
+    FEEDING_RING_SIZE,
+    offsetof(feeding_record_t, animal_id),
+    offsetof(feeding_record_t, timestamp),
+    true};
+static const history_t healths = {
+    &health_table,
+    &health_links,
+    &health_archive,
+    HEALTH_RING_SIZE,
+    offsetof(health_record_t, animal_id),
+    offsetof(health_record_t, timestamp),
+    false};
+
+static uint32_t *chain_head(history_chain_t *c, bool feeding) {
+  return feeding ? &c->feeding_head : &c->health_head;
+}
+
+static uint32_t *chain_count(history_chain_t *c, bool feeding) {
+  return feeding ? &c->feeding_count : &c->health_count;
+}
+
+static uint32_t history_animal(const history_t *h, uint32_t seq) {
+  uint32_t id;
+  memcpy(&id, (const uint8_t *)arena_at(h->records, seq) + h->animal_offset,
+         sizeof(id));
+  return id;
+}
+
+static history_head_t *history_head(uint32_t animal_id) {
+  int32_t index =
+      hash_index_find(&id_index, hash_u32(animal_id), match_id, &animal_id);
+  if (index < 0)
+    return NULL;
+  if ((uint32_t)index >= history_heads.count &&
+      arena_resize(&history_heads, reptile_table.count) != ESP_OK)
+    return NULL;
+  return arena_at(&history_heads, index);
+}
+
+// Link record `seq` of a history table to its animal's chain
+static void history_link(const history_t *h, uint32_t seq) {
+  if (arena_resize(h->links, seq + 1) != ESP_OK)
+    return;
+  uint32_t *link = arena_at(h->links, seq);
+  history_head_t *head = history_head(history_animal(h, seq));
+  if (head == NULL)
+    return; // Orphaned record: kept, but in no chain
+  *link = *chain_head(&head->all, h->feeding);
+  *chain_head(&head->all, h->feeding) = seq + 1;
+  (*chain_count(&head->all, h->feeding))++;
+}
+
+static void history_relink(const history_t *h) {
+  arena_rebase(h->links, h->records->base);
+  for (uint32_t seq = h->records->base; seq < h->records->count; seq++)
+    history_link(h, seq);
+}
+
+// The oldest chunk of a table is in the archive: move it to the archived
+// part of its animals' chains and release it (called under DB_LOCK)
+static void history_release_front(const history_t *h) {
+  seqlock_write_begin(&tables_lock);
+  uint32_t first = h->records->base;
+  uint32_t end = first + (1u << h->records->chunk_shift);
+  for (uint32_t seq = first; seq < end; seq++) {
+    history_head_t *head = history_head(history_animal(h, seq));
+    if (head) {
+      *chain_head(&head->archived, h->feeding) = seq + 1;
+      (*chain_count(&head->archived, h->feeding))++;
+    }
+  }
+  arena_drop_front(h->records);
+  arena_drop_front(h->links);
+  seqlock_write_end(&tables_lock);
+}
+
+// Empty a table, numbering on after whatever the archive already holds
+static void history_clear(const history_t *h) {
+  uint32_t chunk = 1u << h->records->chunk_shift;
+  uint32_t end = archive_end(h->archive);
+  arena_rebase(h->records, (end + chunk - 1) & ~(chunk - 1));
+}
+
+static void db_index_rebuild(void) {
+  seqlock_write_begin(&tables_lock); // Readers never see a half-built table
+  hash_index_clear(&id_index);
+  hash_index_clear(&uuid_index);
+  hash_index_clear(&chip_index);
+  text_index_clear(&words);
+  hot_table_clear(&hot);
+  stats_clear_rows(&stats);
+  due_queue_clear(&feed_alerts);
+  max_reptile_id = 0;
+  for (uint32_t i = 0; i < reptile_table.count; i++)
+    db_index_add(i);
+  db_calendar_rebuild();
+
+  // Chains restart from their archived part, then take the records in RAM
+  arena_resize(&history_heads, reptile_table.count);
+  for (uint32_t i = 0; i < history_heads.count; i++) {
+    history_head_t *head = arena_at(&history_heads, i);
+    head->all = head->archived;
+  }
+  history_relink(&feedings);
+  history_relink(&healths);
+  seqlock_write_end(&tables_lock);
+}
+
+// ====================================================================================
+// ACCESSORS
+// ====================================================================================
+
+// Copy record `index` of a table. Modifiers change the table shape under
+// tables_lock, and a reptile record in place under its stripe (`lock`).
+static bool read_record(const arena_t *a, seqlock_t *lock, uint32_t index,
+                        void *out) {
+  if (DB_LOADING())
+    return false;
+  for (int i = 0; i < READ_ATTEMPTS; i++) {
+    uint32_t seq = seqlock_read_begin(&tables_lock);
+    uint32_t rec_seq = lock ? seqlock_read_begin(lock) : 0;
+    const void *rec = arena_at(a, index);
+    if (rec)
+      memcpy(out, rec, a->record_size);
+    if (!seqlock_read_retry(&tables_lock, seq) &&
+        !(lock && seqlock_read_retry(lock, rec_seq)))
+      return rec != NULL;
+  }
+  // Still colliding: the writer may be a task this one preempted, which
+  // cannot finish while it spins. Waiting on db_mutex lends it our priority.
+  DB_LOCK();
+  const void *rec = arena_at(a, index);
+  if (rec)
+    memcpy(out, rec, a->record_size);
+  DB_UNLOCK();
+  return rec != NULL;
+}
+
+typedef void (*read_fn)(const hot_table_t *v, uint32_t arg, void *out);
+
+// Run `copy` over `v` until no modifier wrote meanwhile, as read_record()
+// does. The preview never changes: it is read once, so lists render while
+// the load writes the live tables.
+static void read_tables(const hot_table_t *v, read_fn copy, uint32_t arg,
+                        void *out) {
+  if (v != &hot) {
+    copy(v, arg, out);
+    return;
+  }
+  for (int i = 0; i < READ_ATTEMPTS; i++) {
+    uint32_t seq = seqlock_read_begin(&tables_lock);
+    copy(v, arg, out);
+    if (!seqlock_read_retry(&tables_lock, seq))
+      return;
+  }
+  DB_LOCK();
+  copy(v, arg, out);
+  DB_UNLOCK();
+}
+
+typedef struct {
+  char *buf;
+  size_t len;
+} text_out_t;
+
+static void undo_clear(void); // See TRANSACTIONS
+
+int db_get_reptile_count(void) { return view->count; }
+void db_set_reptile_count(int count) {
+  DB_LOCK();
+  undo_clear();
+  seqlock_write_begin(&tables_lock);
+  arena_resize(&reptile_table, count < 0 ? 0 : count);
+  db_weights_truncate(reptile_table.count);
+  stats_resize(&stats, reptile_table.count);
+  db_index_rebuild();
+  seqlock_write_end(&tables_lock);
+  DB_UNLOCK();
+}
+
+// Full records only exist once loaded
+bool db_read_reptile(int index, reptile_t *out) {
+  return index >= 0 &&
+         read_record(&reptile_table, record_lock(index), index, out);
+}
+
+int db_find_reptile_by_id(int id) {
+  uint32_t key = id;
+  if (DB_LOADING())
+    return -1;
+  DB_LOCK();
+  int32_t index = hash_index_find(&id_index, hash_u32(key), match_id, &key);
+  DB_UNLOCK();
+  return index;
+}
+
+int db_find_reptile_by_uuid(const char *uuid) {
+  if (uuid == NULL || uuid[0] == '\0' || DB_LOADING())
+    return -1;
+  DB_LOCK();
+  int32_t index =
+      hash_index_find(&uuid_index, hash_string(uuid), match_uuid, uuid);
+  DB_UNLOCK();
+  return index;
+}
+
+int db_find_reptile_by_microchip(const char *microchip) {
+  if (microchip == NULL || microchip[0] == '\0' || DB_LOADING())
+    return -1;
+  DB_LOCK();
+  int32_t index = hash_index_find(&chip_index, hash_string(microchip),
+                                  match_chip, microchip);
+  DB_UNLOCK();
+  return index;
+}
+
+int db_get_reptile_next_id(void) {
+  return next_reptile_id > max_reptile_id ? next_reptile_id
+                                          : max_reptile_id + 1;
+}
+
+// Hot columns: an index past the table reads as an inactive, unnamed slot.
+// They are read through `view` (taken once per call: it switches from the
+// flash preview to the live table when loading completes).
+typedef struct {
+  time_t last_feeding;
+  uint8_t active;
+  uint8_t species;
+  uint8_t sex;
+  uint8_t cites_annex;
+  uint8_t health;
+} hot_cells_t;
+
+static void copy_cells(const hot_table_t *v, uint32_t index, void *out) {
+  hot_cells_t *c = out;
+  if (index >= v->count) {
+    *c = (hot_cells_t){.species = SPECIES_OTHER,
+                       .sex = SEX_UNKNOWN,
+                       .cites_annex = CITES_NOT_LISTED,
+                       .health = HEALTH_GOOD};
+    return;
+  }
+  c->last_feeding = v->last_feeding[index];
+  c->active = v->active[index];
+  c->species = v->species[index];
+  c->sex = v->sex[index];
+  c->cites_annex = v->cites_annex[index];
+  c->health = v->health[index];
+}
+
+static hot_cells_t hot_cells(int index) {
+  hot_cells_t c;
+  read_tables(view, copy_cells, index < 0 ? UINT32_MAX : (uint32_t)index, &c);
+  return c;
+}
+
+bool db_reptile_active(int index) { return hot_cells(index).active; }
+
+reptile_species_t db_reptile_species(int index) {
+  return hot_cells(index).species;
+}
+
+reptile_sex_t db_reptile_sex(int index) { return hot_cells(index).sex; }
+
+cites_annex_t db_reptile_cites_annex(int index) {
+  return hot_cells(index).cites_annex;
+}
+
+health_status_t db_reptile_health(int index) {
+  return hot_cells(index).health;
+}
+
+time_t db_reptile_last_feeding(int index) {
+  return hot_cells(index).last_feeding;
+}
+
+static void copy_name(const hot_table_t *v, uint32_t index, void *out) {
+  const text_out_t *t = out;
+  copy_text(t->buf, t->len,
+            index < v->count ? hot_table_str(v, v->name[index]) : "");
+}
+
+// The preview holds species names in its own pool
+static void copy_species_name(const hot_table_t *v, uint32_t index,
+                              void *out) {
+  const text_out_t *t = out;
+  const char *s = "";
+  if (index < v->count)
+    s = v == &hot ? lookup(v->species_common[index])
+                  : hot_table_str(v, v->species_common[index]);
+  copy_text(t->buf, t->len, s);
+}
+
+const char *db_reptile_name(int index, char *buf, size_t len) {
+  text_out_t t = {buf, len};
+  read_tables(view, copy_name, index < 0 ? UINT32_MAX : (uint32_t)index, &t);
+  return buf;
+}
+
+const char *db_reptile_species_name(int index, char *buf, size_t len) {
+  text_out_t t = {buf, len};
+  read_tables(view, copy_species_name,
+              index < 0 ? UINT32_MAX : (uint32_t)index, &t);
+  return buf;
+}
+
+esp_err_t db_query(const query_t *q, query_result_t *out) {
+  static const due_queue_t no_alerts;
+  const hot_table_t *v = view;
+  if (v != &hot && !(q->text && q->text[0])) {
+    // The preview never changes: no lock, so lists render during the load.
+    // Alerts and the search index come with the full data.
+    return query_run(v, &no_alerts, q, out);
+  }
+  if (v != &hot) {
+    out->count = 0; // No search before the index is loaded
+    return ESP_OK;
+  }
+
+  esp_err_t ret = ESP_OK;
+  DB_LOCK();
+  if (q->text && q->text[0]) {
+    // Search hits first, then the other predicates over them only
+    query_t hits = *q;
+    hits.where |= QUERY_ROWS;
+    out->count = 0;
+    ret = query_reserve(out, reptile_table.count);
+    if (ret == ESP_OK) {
+      out->count = text_index_search(&words, q->text, search_text, NULL,
+                                     out->rows, out->capacity);
+      ret = query_run(&hot, &feed_alerts, &hits, out);
+    }
+  } else {
+    ret = query_run(&hot, &feed_alerts, q, out);
+  }
+  DB_UNLOCK();
+  return ret;
+}
+
+static void copy_string(const hot_table_t *v, uint32_t ref, void *out) {
+  const text_out_t *t = out;
+  copy_text(t->buf, t->len, lookup(ref));
+}
+
+const char *db_string(str_ref_t ref, char *buf, size_t len) {
+  text_out_t t = {buf, len};
+  if (DB_LOADING())
+    copy_text(buf, len, "");
+  else
+    read_tables(&hot, copy_string, ref, &t);
+  return buf;
+}
+
+// Interning from the UI grows the pool the save task snapshots
+str_ref_t db_intern_string(const char *s) {
+  if (s == NULL)
+    return 0;
+  DB_LOCK();
+  str_ref_t ref = intern(s, STRING_POOL_MAX_LEN);
+  DB_UNLOCK();
+  return ref;
+}
+
+str_ref_t db_find_string(const char *s) {
+  if (s == NULL || DB_LOADING())
+    return 0;
+  DB_LOCK();
+  str_ref_t ref = string_pool_find(&strings, s);
+  DB_UNLOCK();
+  return ref;
+}
+
+// Index 0 is the oldest record still in RAM. If a chunk rolls out between
+// reading the base and the record, the record has rolled out too and reads
+// as absent.
+static bool read_history(const arena_t *a, int index, void *out) {
+  return index >= 0 && read_record(a, NULL, a->base + index, out);
+}
+
+static void add_history(const history_t *h, const void *record) {
+  DB_LOCK();
+  seqlock_write_begin(&tables_lock);
+  void *rec = arena_append(h->records);
+  if (rec) {
+    memcpy(rec, record, h->records->record_size);
+    history_link(h, h->records->count - 1);
+  }
+  if (rec && h->feeding) {
+    const feeding_record_t *f = record;
+    int32_t index = hash_index_find(&id_index, hash_u32(f->animal_id),
+                                    match_id, &f->animal_id);
+    if (index >= 0)
+      stats_meal(&stats, index, reptile_at(index)->species, f->timestamp,
+                 f->accepted);
+  }
+  seqlock_write_end(&tables_lock);
+  DB_UNLOCK();
+}
+
+int db_get_feeding_count(void) {
+  return DB_LOADING() ? 0 : (int)(feeding_table.count - feeding_table.base);
+}
+bool db_read_feeding(int index, feeding_record_t *out) {
+  return read_history(&feeding_table, index, out);
+}
+void db_add_feeding(feeding_record_t *record) {
+  add_history(&feedings, record);
+}
+
+int db_get_health_count(void) {
+  return DB_LOADING() ? 0 : (int)(health_table.count - health_table.base);
+}
+bool db_read_health(int index, health_record_t *out) {
+  return read_history(&health_table, index, out);
+}
+void db_add_health(health_record_t *record) { add_history(&healths, record); }
+
+// Copy one page of a chain from `*cursor`, newest first. Records that have
+// rolled out of RAM are read back from the archive, one seek each, when
+// `archived` is set (scans off the LVGL task); otherwise the page stops at
+// the first of them, see db_history_fetch_start().
+static int history_page(const history_t *h, int index, uint32_t *cursor,
+                        void *out, int max, bool archived) {
+  uint16_t size = h->records->record_size;
+  int n = 0;
+  if (index < 0 || *cursor == DB_HISTORY_END)
+    return 0;
+
+  DB_LOCK();
+  history_head_t *head = arena_at(&history_heads, index);
+  uint32_t ref = *cursor;
+  if (ref == DB_HISTORY_START)
+    ref = head ? *chain_head(&head->all, h->feeding) : 0;
+  while (n < max && ref != 0) {
+    uint8_t *dst = (uint8_t *)out + (size_t)n * size;
+    const void *rec = arena_at(h->records, ref - 1);
+    if (rec) {
+      memcpy(dst, rec, size);
+      const uint32_t *link = arena_at(h->links, ref - 1);
+      ref = link ? *link : 0;
+    } else if (!archived) {
+      break;
+    } else if (archive_read(h->archive, ref - 1, dst, &ref) != ESP_OK) {
+      ref = 0; // Segment missing or damaged: the chain ends here
+      break;
+    }
+    n++;
+  }
+  DB_UNLOCK();
+  *cursor = ref == 0 ? DB_HISTORY_END : ref;
+  return n;
+}
+
+int db_get_feeding_history(int index, uint32_t *cursor, feeding_record_t *out,
+                           int max) {
+  if (DB_LOADING())
+    return 0;
+  return history_page(&feedings, index, cursor, out, max, false);
+}
+
+int db_get_health_history(int index, uint32_t *cursor, health_record_t *out,
+                          int max) {
+  if (DB_LOADING())
+    return 0;
+  return history_page(&healths, index, cursor, out, max, false);
+}
+
+int db_get_feeding_history_count(int index) {
+  const history_head_t *head =
+      index >= 0 && !DB_LOADING() ? arena_at(&history_heads, index) : NULL;
+  return head ? (int)head->all.feeding_count : 0;
+}
+
+int db_get_health_history_count(int index) {
+  const history_head_t *head =
+      index >= 0 && !DB_LOADING() ? arena_at(&history_heads, index) : NULL;
+  return head ? (int)head->all.health_count : 0;
+}
+
+// Archived records never change and the archive has its own lock, so the
+// worker walks the chain without DB_LOCK: the LVGL task and the modifiers
+// never wait for its reads. Chains only lead to older records, so past the
+// first archived one the rest of the walk stays in the archive.
+
+#define FETCH_TASK_STACK 4096
+#define FETCH_TASK_PRIORITY 1 // Below the save task, as the export
+
+// Set last by the worker, so the page is complete once it reads DONE
+static _Atomic(db_fetch_state_t) fetch_state = DB_FETCH_IDLE;
+static const history_t *fetch_history;
+static uint32_t fetch_cursor;
+static int fetch_max;
+static int fetch_count;
+static union {
+  feeding_record_t feeding[DB_HISTORY_FETCH_MAX];
+  health_record_t health[DB_HISTORY_FETCH_MAX];
+} fetch_page;
+
+static void db_fetch_task(void *arg) {
+  const history_t *h = fetch_history;
+  uint8_t *dst = (uint8_t *)&fetch_page;
+  uint32_t ref = fetch_cursor;
+  bool ok = true;
+  int n = 0;
+  while (n < fetch_max && ref != 0) {
+    if (archive_read(h->archive, ref - 1,
+                     dst + (size_t)n * h->records->record_size,
+                     &ref) != ESP_OK) {
+      ok = n > 0; // Hand out what was read; the next fetch fails
+      break;
+    }
+    n++;
+  }
+  fetch_count = n;
+  fetch_cursor = ref == 0 ? DB_HISTORY_END : ref;
+  fetch_state = ok ? DB_FETCH_DONE : DB_FETCH_FAILED;
+  vTaskDelete(NULL);
+}
+
+esp_err_t db_history_fetch_start(bool health, uint32_t cursor, int max) {
+  if (fetch_state == DB_FETCH_RUNNING)
+    return ESP_ERR_INVALID_STATE;
+  if (cursor == DB_HISTORY_START || cursor == DB_HISTORY_END || max <= 0)
+    return ESP_ERR_INVALID_ARG;
+  fetch_history = health ? &healths : &feedings;
+  fetch_cursor = cursor;
+  fetch_max = max < DB_HISTORY_FETCH_MAX ? max : DB_HISTORY_FETCH_MAX;
+  fetch_count = 0;
+  fetch_state = DB_FETCH_RUNNING;
+  TaskHandle_t task;
+  if (xTaskCreate(db_fetch_task, "db_fetch", FETCH_TASK_STACK, NULL,
+                  FETCH_TASK_PRIORITY, &task) != pdPASS) {
+    ESP_LOGE(TAG, "Failed to start history fetch task");
+    fetch_state = DB_FETCH_FAILED;
+    return ESP_FAIL;
+  }
+  return ESP_OK;
+}
+
+db_fetch_state_t db_history_fetch_result(void *out, int *count,
+                                         uint32_t *cursor) {
+  db_fetch_state_t state = fetch_state;
+  *count = 0;
+  if (state == DB_FETCH_RUNNING || state == DB_FETCH_IDLE)
+    return state;
+  if (state == DB_FETCH_DONE) {
+    memcpy(out, &fetch_page,
+           (size_t)fetch_count * fetch_history->records->record_size);
+    *count = fetch_count;
+    *cursor = fetch_cursor;
+  } else {
+    *cursor = DB_HISTORY_END;
+  }
+  fetch_state = DB_FETCH_IDLE;
+  return state;
+}
+
+// Series buffers move as they grow: read them under the lock, like
+// history_page()
+int db_get_weight_count(int index) {
+  if (DB_LOADING())
+    return 0;
+  DB_LOCK();
+  const weight_series_t *s =
+      index >= 0 ? arena_at(&weight_table, index) : NULL;
+  int count = s ? s->count : 0;
+  DB_UNLOCK();
+  return count;
+}
+
+int db_get_weight_buckets(int index, weight_tier_t tier, weight_bucket_t *out,
+                          int max) {
+  if (DB_LOADING())
+    return 0;
+  DB_LOCK();
+  const weight_series_t *s =
+      index >= 0 ? arena_at(&weight_table, index) : NULL;
+  int n = s ? weight_series_buckets(s, tier, out, max) : 0;
+  DB_UNLOCK();
+  return n;
+}
+
+// Over the boot preview, only the counts its columns hold, by a scan until
+// the load completes
+static void copy_stats(const hot_table_t *v, uint32_t arg, void *out) {
+  stats_summary_t *m = out;
+  if (v == &hot) {
+    memcpy(m, &stats.summary, sizeof(*m));
+    return;
+  }
+  memset(m, 0, sizeof(*m));
+  for (uint32_t i = 0; i < v->count; i++) {
+    if (!v->active[i])
+      continue;
+    m->active++;
+    if (v->species[i] < STATS_SPECIES)
+      m->species[v->species[i]]++;
+    if (v->cites_annex[i] < STATS_ANNEXES)
+      m->annex[v->cites_annex[i]]++;
+    if (v->sex[i] < STATS_SEXES)
+      m->sex[v->sex[i]]++;
+  }
+}
+
+void db_get_stats(stats_summary_t *out) {
+  read_tables(view, copy_stats, 0, out);
+}
+
+// Every aggregate from the records themselves: the rows, each animal's whole
+// feeding chain (archived part included) and its weight series. Events
+// count for the animal's current species.
+static esp_err_t db_stats_scan(stats_t *s) {
+  static feeding_record_t page[32];
+  stats_clear(s);
+  if (stats_resize(s, reptile_table.count) != ESP_OK)
+    return ESP_ERR_NO_MEM;
+  stats_events_t *e = &s->summary.events;
+  for (uint32_t i = 0; i < reptile_table.count; i++) {
+    const reptile_t *r = reptile_at(i);
+    uint8_t sp = r->species < STATS_SPECIES ? r->species : SPECIES_OTHER;
+    stats_row_set(s, i, r);
+
+    // Chains run newest first: pair each meal with the one after it
+    uint32_t cursor = DB_HISTORY_START;
+    bool newest = true;
+    int64_t newer = 0;
+    int n;
+    while ((n = history_page(&feedings, i, &cursor, page, 32, true)) > 0) {
+      for (int k = 0; k < n; k++) {
+        int64_t ts = page[k].timestamp;
+        e->meals[sp]++;
+        if (page[k].accepted)
+          e->accepted[sp]++;
+        if (newest)
+          s->rows[i].last_meal = ts;
+        else if (ts != 0 && newer > ts)
+          stats_welford_add(&e->interval[sp],
+                            (double)(newer - ts) / SECONDS_PER_DAY);
+        newest = false;
+        newer = ts;
+      }
+    }
+
+    const weight_series_t *w = weight_series_at(i);
+    weight_cursor_t c = WEIGHT_CURSOR_INIT;
+    weight_point_t p;
+    while (w && weight_series_next(w, &c, &p))
+      stats_weigh(s, i, sp, p.timestamp, p.grams);
+  }
+  return ESP_OK;
+}
+
+esp_err_t db_stats_recompute(stats_summary_t *out) {
+  stats_t s = {0};
+  if (DB_LOADING())
+    return ESP_ERR_INVALID_STATE;
+  DB_LOCK();
+  esp_err_t ret = db_stats_scan(&s);
+  DB_UNLOCK();
+  if (ret == ESP_OK)
+    *out = s.summary;
+  free(s.rows);
+  return ret;
+}
+
+int db_get_breeding_count(void) {
+  return DB_LOADING() ? 0 : (int)breeding_table.count;
+}
+bool db_read_breeding(int index, breeding_record_t *out) {
+  return index >= 0 && read_record(&breeding_table, NULL, index, out);
+}
+typedef struct {
+  int64_t from;
+  int64_t to;
+  calendar_event_t *out;
+  int max;
+  int count;
+} calendar_query_t;
+
+// The calendar is built with the tables: empty over the boot preview
+static void copy_calendar(const hot_table_t *v, uint32_t arg, void *out) {
+  calendar_query_t *q = out;
+  q->count = v == &hot ? calendar_range(&calendar, q->from, q->to, q->out,
+                                        q->max)
+                       : 0;
+}
+
+int db_breeding_calendar(time_t from, time_t to, calendar_event_t *out,
+                         int max) {
+  calendar_query_t q = {.from = from, .to = to, .out = out, .max = max};
+  read_tables(view, copy_calendar, 0, &q);
+  return q.count;
+}
+
+static void count_open(const hot_table_t *v, uint32_t arg, void *out) {
+  *(int *)out = v == &hot ? calendar_open_count(&calendar, time(NULL)) : 0;
+}
+
+int db_breeding_alert_count(void) {
+  int n = 0;
+  read_tables(view, count_open, 0, &n);
+  return n;
+}
+
+int db_get_inventory_count(void) {
+  return DB_LOADING() ? 0 : (int)inventory_table.count;
+}
+bool db_read_inventory_item(int index, inventory_item_t *out) {
+  return index >= 0 && read_record(&inventory_table, NULL, index, out);
+}
+
+// Stock of the item a prey type is taken from: matched by name, ignoring
+// case, in a table of a few hundred items at most
+static inventory_item_t *db_stock_item(const char *prey) {
+  for (uint32_t i = 0; prey && prey[0] && i < inventory_table.count; i++) {
+    inventory_item_t *it = arena_at(&inventory_table, i);
+    if (strncasecmp(it->name, prey, sizeof(it->name)) == 0)
+      return it;
+  }
+  return NULL;
+}
+
+typedef struct {
+  int32_t days_left;
+  bool reorder;
+} stock_state_t;
+
+static stock_state_t stock_state(const inventory_item_t *it, int64_t now) {
+  stock_state_t s = {
+      .days_left = forecast_days_left(&forecast, it->name, it->quantity, now)};
+  s.reorder = it->quantity < it->alert_threshold ||
+              (s.days_left >= 0 && s.days_left < CONFIG_APP_PREY_REORDER_DAYS);
+  return s;
+}
+
+// The forecast is loaded with the tables: no state over the boot preview
+static void copy_stock_state(const hot_table_t *v, uint32_t index,
+                             void *out) {
+  const inventory_item_t *it = arena_at(&inventory_table, index);
+  *(stock_state_t *)out = v == &hot && it ? stock_state(it, time(NULL))
+                                          : (stock_state_t){-1, false};
+}
+
+int db_inventory_days_left(int index) {
+  stock_state_t s = {-1, false};
+  if (index >= 0)
+    read_tables(view, copy_stock_state, index, &s);
+  return s.days_left;
+}
+
+bool db_inventory_needs_reorder(int index) {
+  stock_state_t s = {-1, false};
+  if (index >= 0)
+    read_tables(view, copy_stock_state, index, &s);
+  return s.reorder;
+}
+
+static void count_reorders(const hot_table_t *v, uint32_t arg, void *out) {
+  int64_t now = time(NULL);
+  int n = 0;
+  for (uint32_t i = 0; v == &hot && i < inventory_table.count; i++)
+    n += stock_state(arena_at(&inventory_table, i), now).reorder;
+  *(int *)out = n;
+}
+
+int db_inventory_reorder_count(void) {
+  int n = 0;
+  read_tables(view, count_reorders, 0, &n);
+  return n;
+}
+
+// ====================================================================================
+// PERSISTENCE
+// ====================================================================================
+
+// Version 1 layout: header followed by raw arrays, no checksums
+typedef struct {
+  uint32_t magic;
+  uint32_t version;
+  uint8_t reptile_count;
+  uint8_t feeding_count;
+  uint8_t health_count;
+  uint8_t breeding_count;
+  uint8_t inventory_count;
+} legacy_header_t;
+
+// ====================================================================================
+// BACKGROUND SAVE
+// ====================================================================================
+// Modifiers only touch RAM and queue journal records; a dedicated task writes
+// them to the SD card once edits have been quiet for SAVE_QUIET_MS, so bursts
+// of edits become a single write and the LVGL task never waits on FATFS.
+
+#define SAVE_QUIET_MS 500       // Flush after this much inactivity
+#define SAVE_MAX_DELAY_MS 5000  // ...but never hold edits longer than this
+#define SAVE_TASK_STACK 4096
+#define SAVE_TASK_PRIORITY 2
+#define PENDING_JOURNAL_BYTES 4096
+
+static SemaphoreHandle_t io_mutex = NULL; // Serialises SD writes
+static TaskHandle_t save_task = NULL;
+
+static uint8_t pending_journal[PENDING_JOURNAL_BYTES];
+static size_t pending_len = 0;
+static bool snapshot_dirty = false;
+static bool persist_blocked = false; // Saved data exists but was not loaded
+static int txn_depth = 0; // Open db_txn_begin() calls, see TRANSACTIONS
+
+static esp_err_t db_persist_pending(void);
+
+static void db_kick_save(void) {
+  if (txn_depth > 0)
+    return; // The transaction kicks once it commits
+  if (save_task)
+    xTaskNotifyGive(save_task);
+  else
+    db_persist_pending(); // No worker (init failed): save synchronously
+}
+
+#define DB_TABLE(section, arena)                                               \
+  {section, schema_width(schema_table(section)), (arena)->count, arena,       \
+   db_encode_record, schema_table(section)}
+
+#define DB_HISTORY_TABLE(section, arena)                                       \
+  {section,        schema_width(schema_table(section)),                        \
+   (arena)->count - (arena)->base, arena, db_encode_record,                    \
+   schema_table(section)}
+
+// `index` counts from the oldest record held
+static void db_encode_record(const void *arena, uint32_t index, uint8_t *out,
+                             const void *schema) {
+  const arena_t *a = arena;
+  schema_encode_record(schema, arena_at(a, a->base + index), out);
+}
+
+// Weight section: a weight_blob_t and its encoded points for every slot that
+// has any. Stored as a byte section (record size 1).
+typedef struct __attribute__((packed)) {
+  uint32_t index; // Reptile slot
+  uint32_t count; // Points
+  uint32_t len;   // Encoded bytes that follow
+} weight_blob_t;
+
+static uint8_t *db_encode_weights(size_t *out_len) {
+  size_t len = 0;
+  for (uint32_t i = 0; i < weight_table.count; i++) {
+    const weight_series_t *s = arena_at(&weight_table, i);
+    if (s->count > 0)
+      len += sizeof(weight_blob_t) + s->len;
+  }
+  uint8_t *blob = malloc(len ? len : 1);
+  if (blob == NULL)
+    return NULL;
+
+  uint8_t *p = blob;
+  for (uint32_t i = 0; i < weight_table.count; i++) {
+    const weight_series_t *s = arena_at(&weight_table, i);
+    if (s->count == 0)
+      continue;
+    const weight_blob_t hdr = {.index = i, .count = s->count, .len = s->len};
+    memcpy(p, &hdr, sizeof(hdr));
+    memcpy(p + sizeof(hdr), s->data, s->len);
+    p += sizeof(hdr) + s->len;
+  }
+  *out_len = len;
+  return blob;
+}
+
+// History section: where the history tables resume, then the archived part
+// of each slot's chains. Stored as a byte section (record size 1).
+typedef struct __attribute__((packed)) {
+  uint32_t feeding_base; // Sequence of the first record in SECTION_FEEDINGS
+  uint32_t health_base;  // Sequence of the first record in SECTION_HEALTH
+  uint32_t slot_count;   // history_chain_t that follow, by reptile slot
+} history_blob_t;
+
+static uint8_t *db_encode_history(size_t *out_len) {
+  const history_blob_t hdr = {.feeding_base = feeding_table.base,
+                              .health_base = health_table.base,
+                              .slot_count = history_heads.count};
+  size_t len = sizeof(hdr) + hdr.slot_count * sizeof(history_chain_t);
+  uint8_t *blob = malloc(len);
+  if (blob == NULL)
+    return NULL;
+  memcpy(blob, &hdr, sizeof(hdr));
+  for (uint32_t i = 0; i < hdr.slot_count; i++) {
+    const history_head_t *head = arena_at(&history_heads, i);
+    memcpy(blob + sizeof(hdr) + i * sizeof(history_chain_t), &head->archived,
+           sizeof(history_chain_t));
+  }
+  *out_len = len;
+  return blob;
+}
+
+// Statistics section: the event aggregates, then the last events of each
+// slot they pair new events with. Stored as a byte section (record size 1);
+// the row aggregates are rebuilt from the records at load.
+typedef struct __attribute__((packed)) {
+  uint32_t events_size; // sizeof(stats_events_t) when written
+  uint32_t slot_count;  // stats_slot_blob_t that follow the events
+} stats_blob_t;
+
+typedef struct __attribute__((packed)) {
+  int64_t last_meal;
+  int64_t last_weigh;
+  uint16_t last_grams;
+} stats_slot_blob_t;
+
+static uint8_t *db_encode_stats(size_t *out_len) {
+  const stats_blob_t hdr = {.events_size = sizeof(stats_events_t),
+                            .slot_count = stats.count};
+  size_t len = sizeof(hdr) + hdr.events_size +
+               hdr.slot_count * sizeof(stats_slot_blob_t);
+  uint8_t *blob = malloc(len);
+  if (blob == NULL)
+    return NULL;
+  memcpy(blob, &hdr, sizeof(hdr));
+  memcpy(blob + sizeof(hdr), &stats.summary.events, hdr.events_size);
+  uint8_t *p = blob + sizeof(hdr) + hdr.events_size;
+  for (uint32_t i = 0; i < hdr.slot_count; i++) {
+    const stats_row_t *row = &stats.rows[i];
+    const stats_slot_blob_t slot = {.last_meal = row->last_meal,
+                                    .last_weigh = row->last_weigh,
+                                    .last_grams = row->last_grams};
+    memcpy(p + i * sizeof(slot), &slot, sizeof(slot));
+  }
+  *out_len = len;
+  return blob;
+}
+
+// Encode the tables into one snapshot image (called under DB_LOCK). The meta
+// and schema sections come first so a loader sees them before any table.
+static uint8_t *db_build_snapshot(size_t *out_len) {
+  static schema_meta_t meta = {.schema_version = DB_SCHEMA_VERSION};
+  static schema_entry_t schema[SCHEMA_MAX_ENTRIES];
+  static int schema_count = 0;
+
+  if (schema_count == 0)
+    schema_count = schema_describe(schema, SCHEMA_MAX_ENTRIES);
+  meta.next_reptile_id = db_get_reptile_next_id();
+
+  size_t weights_len = 0, history_len = 0, stats_len = 0;
+  uint8_t *weights = db_encode_weights(&weights_len);
+  uint8_t *history = db_encode_history(&history_len);
+  uint8_t *stats_blob = db_encode_stats(&stats_len);
+  if (weights == NULL || history == NULL || stats_blob == NULL) {
+    free(weights);
+    free(history);
+    free(stats_blob);
+    return NULL;
+  }
+
+  const snapshot_section_desc_t sections[] = {
+      {SECTION_META, sizeof(meta), 1, &meta, NULL, NULL},
+      {SECTION_SCHEMA, sizeof(schema_entry_t), schema_count, schema, NULL,
+       NULL},
+      // Before the tables, so handles resolve as soon as records load
+      {SECTION_STRINGS, 1, strings.len, strings.data ? strings.data : "", NULL,
+       NULL},
+      // Before the history tables, which are numbered from its bases
+      {SECTION_HISTORY, 1, history_len, history, NULL, NULL},
+      DB_TABLE(SECTION_REPTILES, &reptile_table),
+      DB_HISTORY_TABLE(SECTION_FEEDINGS, &feeding_table),
+      DB_HISTORY_TABLE(SECTION_HEALTH, &health_table),
+      DB_TABLE(SECTION_BREEDINGS, &breeding_table),
+      DB_TABLE(SECTION_INVENTORY, &inventory_table),
+      {SECTION_WEIGHTS, 1, weights_len, weights, NULL, NULL},
+      {SECTION_STATS, 1, stats_len, stats_blob, NULL, NULL},
+      {SECTION_FORECAST, sizeof(forecast_prey_t), forecast.count,
+       forecast.prey ? (const void *)forecast.prey : "", NULL, NULL},
+  };
+  uint8_t *image =
+      snapshot_build(sections, sizeof(sections) / sizeof(sections[0]),
+                     journal_last_seq(), out_len);
+  free(weights);
+  free(history);
+  free(stats_blob);
+  return image;
+}
+
+static uint16_t record_month(const history_t *h, const uint8_t *record) {
+  time_t t;
+  struct tm tm;
+  memcpy(&t, record + h->timestamp_offset, sizeof(t));
+  if (t < 0 || localtime_r(&t, &tm) == NULL)
+    return 0;
+  return (tm.tm_year - 70) * 12 + tm.tm_mon;
+}
+
+// Roll the oldest chunk of a history table out to its archive, one segment
+// per calendar month, once the table holds more than its ring. Only the copy
+// and the release take DB_LOCK: the SD writes run unlocked, so modifiers and
+// the UI never wait on them. Returns true if a chunk was released.
+static bool history_roll_out(const history_t *h) {
+  const uint32_t chunk = 1u << h->records->chunk_shift;
+  const uint16_t size = h->records->record_size;
+  uint32_t *links = NULL;
+  uint8_t *records = NULL;
+
+  DB_LOCK();
+  uint32_t first = h->records->base;
+  // Only archive what the snapshot and journal already hold, so a reset can
+  // never leave a record in the archive that the tables have lost
+  if (h->records->count - first > h->ring_size && pending_len == 0 &&
+      !snapshot_dirty)
+    links = malloc(chunk * (sizeof(uint32_t) + size));
+  if (links) {
+    records = (uint8_t *)(links + chunk);
+    for (uint32_t i = 0; i < chunk; i++) {
+      const uint32_t *link = arena_at(h->links, first + i);
+      links[i] = link ? *link : 0;
+      memcpy(records + i * size, arena_at(h->records, first + i), size);
+    }
+  }
+  DB_UNLOCK();
+  if (links == NULL)
+    return false;
+
+  // Resume after any segment an interrupted roll-out already wrote
+  uint32_t end = archive_end(h->archive);
+  uint32_t i = end > first ? end - first : 0;
+  esp_err_t ret = ESP_OK;
+  while (i < chunk && ret == ESP_OK) {
+    uint16_t month = record_month(h, records + i * size);
+    uint32_t n = 1;
+    while (i + n < chunk && record_month(h, records + (i + n) * size) == month)
+      n++;
+    ret = archive_write(h->archive, first + i, records + i * size, links + i,
+                        n, month);
+    i += n;
+  }
+  free(links);
+  if (ret != ESP_OK)
+    return false; // Kept in RAM; retried on the next save
+
+  DB_LOCK();
+  history_release_front(h);
+  DB_UNLOCK();
+  return true;
+}
+
+// Write whatever is pending: queued journal records, or a full snapshot when
+// one was requested or the journal has grown past its checkpoint size.
+static esp_err_t db_persist_pending(void) {
+  static uint8_t io_buf[PENDING_JOURNAL_BYTES];
+  esp_err_t ret = persist_blocked ? ESP_ERR_INVALID_STATE : ESP_OK;
+
+  if (io_mutex)
+    xSemaphoreTake(io_mutex, portMAX_DELAY);
+
+  // Audit entries go first: a crash never leaves a change on the card
+  // without its entry in the Livre de Police
+  audit_flush();
+
+  while (!persist_blocked) {
+    uint8_t *image = NULL, *preview = NULL;
+    size_t image_len = 0, preview_len = 0;
+    size_t journal_len = 0;
+
+    DB_LOCK();
+    bool full = snapshot_dirty;
+    if (full) {
+      image = db_build_snapshot(&image_len);
+      preview = boot_view_build(&hot, lookup, &preview_len);
+      if (image) {
+        snapshot_dirty = false;
+        pending_len = 0; // Already part of the snapshot
+      }
+    } else if (pending_len > 0) {
+      memcpy(io_buf, pending_journal, pending_len);
+      journal_len = pending_len;
+      pending_len = 0;
+    }
+    DB_UNLOCK();
+
+    if (full) {
+      ret = image ? snapshot_commit(image, image_len) : ESP_ERR_NO_MEM;
+      free(image);
+      if (ret == ESP_OK) {
+        // Snapshot now contains everything the journal described
+        journal_reset();
+        // Boot preview of the same state; the SD card stays authoritative,
+        // so a failed flash write only costs a slower next boot
+        if (preview)
+          boot_view_commit(preview, preview_len);
+      } else {
+        DB_LOCK();
+        snapshot_dirty = true;
+        DB_UNLOCK();
+      }
+      free(preview);
+      break;
+    }
+    if (journal_len == 0)
+      break;
+
+    ret = journal_write(io_buf, journal_len);
+    if (ret == ESP_OK && journal_size() < JOURNAL_CHECKPOINT_BYTES)
+      break;
+    // Append failed or journal is due for a checkpoint: snapshot instead
+    DB_LOCK();
+    snapshot_dirty = true;
+    DB_UNLOCK();
+  }
+
+  while (ret == ESP_OK &&
+         (history_roll_out(&feedings) || history_roll_out(&healths))) {
+  }
+
+  if (io_mutex)
+    xSemaphoreGive(io_mutex);
+  return ret;
+}
+
+static void db_save_task(void *arg) {
+  for (;;) {
+    ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+
+    // Coalesce: keep waiting while edits keep arriving, up to a max latency
+    TickType_t start = xTaskGetTickCount();
+    while (xTaskGetTickCount() - start < pdMS_TO_TICKS(SAVE_MAX_DELAY_MS) &&
+           ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(SAVE_QUIET_MS)) > 0) {
+    }
+    db_persist_pending();
+  }
+}
+
+static void db_shutdown(void) { db_flush(); }
+
+esp_err_t db_init(void) {
+  if (save_task)
+    return ESP_OK;
+
+  db_mutex = xSemaphoreCreateRecursiveMutex();
+  io_mutex = xSemaphoreCreateMutex();
+  db_events = xEventGroupCreate();
+  if (!db_mutex || !io_mutex || !db_events) {
+    ESP_LOGE(TAG, "Failed to create database mutexes");
+    return ESP_ERR_NO_MEM;
+  }
+  xEventGroupSetBits(db_events, DB_EVENT_LOADED);
+  const esp_timer_create_args_t alert_args = {.callback = alert_timer_cb,
+                                              .name = "feed_alerts"};
+  if (esp_timer_create(&alert_args, &alert_timer) != ESP_OK) {
+    ESP_LOGE(TAG, "Failed to create the feeding alert timer");
+    alert_timer = NULL;
+  }
+  // esp_restart() writes what the save task has not yet
+  if (esp_register_shutdown_handler(db_shutdown) != ESP_OK)
+    ESP_LOGW(TAG, "Failed to register the shutdown flush");
+  if (xTaskCreate(db_save_task, "db_save", SAVE_TASK_STACK, NULL,
+                  SAVE_TASK_PRIORITY, &save_task) != pdPASS) {
+    ESP_LOGE(TAG, "Failed to start save task, saving synchronously");
+    save_task = NULL;
+    return ESP_FAIL;
+  }
+  return ESP_OK;
+}
+
+void db_save_data(void) {
+  DB_LOCK();
+  snapshot_dirty = true;
+  DB_UNLOCK();
+  db_kick_save();
+}
+
+esp_err_t db_flush(void) { return db_persist_pending(); }
+
+void db_init_demo_data(void) {
+  ESP_LOGI(TAG, "Initializing DEMO data...");
+  DB_LOCK();
+  undo_clear();
+  seqlock_write_begin(&tables_lock);
+  db_weights_truncate(0);
+  arena_clear(&reptile_table);
+  if (arena_reserve(&reptile_table, 3) != ESP_OK) {
+    seqlock_write_end(&tables_lock);
+    DB_UNLOCK();
+    return;
+  }
+
+  // 1. Python Royal
+  reptile_t *r = arena_append(&reptile_table);
+  r->id = 1;
+  strcpy(r->name, "Nagini");
+  r->species_common = intern("Python Royal", STRING_POOL_MAX_LEN);
+  r->species_scientific = intern("Python regius", STRING_POOL_MAX_LEN);
+  strcpy(r->morph, "Banana Pastel");
+  r->species = SPECIES_SNAKE;
+  r->sex = SEX_MALE;
+  r->birth_year = 2022;
+  r->weight_grams = 450;
+  r->active = true;
+  strcpy(r->microchip, "250269600123456");
+  r->cites_annex = CITES_ANNEX_B;
+  r->last_feeding = time(NULL) - (5 * 24 * 3600);
+
+  // 2. Gecko
+  r = arena_append(&reptile_table);
+  r->id = 2;
+  strcpy(r->name, "Yoshi");
+  r->species_common = intern("Gecko Leo", STRING_POOL_MAX_LEN);
+  r->species_scientific = intern("Eublepharis m.", STRING_POOL_MAX_LEN);
+  strcpy(r->morph, "Tangerine");
+  r->species = SPECIES_LIZARD;
+  r->sex = SEX_FEMALE;
+  r->birth_year = 2021;
+  r->weight_grams = 65;
+  r->active = true;
+  r->cites_annex = CITES_NOT_LISTED;
+  r->last_feeding = time(NULL) - (2 * 24 * 3600);
+
+  // 3. Boa
+  r = arena_append(&reptile_table);
+  r->id = 3;
+  strcpy(r->name, "Kaa");
+  r->species_common = intern("Boa Constrictor", STRING_POOL_MAX_LEN);
+  r->species_scientific = intern("Boa imperator", STRING_POOL_MAX_LEN);
+  strcpy(r->morph, "Hypo Jungle");
+  r->species = SPECIES_SNAKE;
+  r->sex = SEX_FEMALE;
+  r->birth_year = 2019;
+  r->weight_grams = 2100;
+  r->active = true;
+  strcpy(r->microchip, "250269600987654");
+  r->cites_annex = CITES_ANNEX_B;
+  r->last_feeding = time(NULL) - (10 * 24 * 3600);
+
+  // A year of monthly weigh-ins growing to the current weight
+  for (uint32_t i = 0; i < reptile_table.count; i++) {
+    r = reptile_at(i);
+    for (int m = 0; m < 12; m++) {
+      time_t date = time(NULL) - (11 - m) * (30 * 24 * 3600);
+      weight_series_append(weight_series_at(i), date,
+                           r->weight_grams * (70 + m * 30 / 11) / 100);
+    }
+    r->last_weight = time(NULL);
+  }
+  for (uint32_t i = 0; i < reptile_table.count; i++)
+    db_new_uuid(reptile_at(i)->uuid);
+  db_index_rebuild();
+  db_stats_scan(&stats); // The weigh-ins above went straight to the series
+  seqlock_write_end(&tables_lock);
+  DB_UNLOCK();
+}
+
+static void journal_apply(journal_rec_type_t type, const void *payload,
+                          uint16_t length);
+
+static void db_clear_tables(void) {
+  undo_clear();
+  seqlock_write_begin(&tables_lock);
+  arena_clear(&reptile_table);
+  history_clear(&feedings);
+  history_clear(&healths);
+  arena_clear(&breeding_table);
+  arena_clear(&inventory_table);
+  arena_clear(&history_heads);
+  db_weights_truncate(0);
+  string_pool_clear(&strings);
+  stats_clear(&stats);
+  forecast_clear(&forecast);
+  next_reptile_id = 0;
+  db_index_rebuild();
+  seqlock_write_end(&tables_lock);
+}
+
+// Start from a clean base: demo data plus a snapshot the journal can follow
+static void db_reset_to_demo(void) {
+  journal_reset();
+  db_clear_tables();
+  db_init_demo_data();
+  db_save_data();
+}
+
+// ====================================================================================
+// MIGRATIONS
+// ====================================================================================
+// Semantic upgrades run after decoding a file older than DB_SCHEMA_VERSION.
+// Layout changes (new, widened or dropped fields) are handled by the tagged
+// decoder and need no entry here. Entries are in ascending version order.
+
+typedef struct {
+  uint32_t version; // Applied to files older than this version
+  void (*apply)(void);
+  bool replayed; // Runs after the journal replay, on its records too
+} db_migration_t;
+
+// v4: seed each weight history with the single weight older files kept
+static void db_migrate_weights(void) {
+  db_weights_truncate(0);
+  for (uint32_t i = 0; i < reptile_table.count; i++) {
+    const reptile_t *r = reptile_at(i);
+    time_t date = r->last_weight ? r->last_weight : r->date_acquisition;
+    if (r->weight_grams > 0 && date > 0)
+      weight_series_append(weight_series_at(i), date, r->weight_grams);
+  }
+}
+
+// v7: give a UUID to every reptile that has none, in one pass (records
+// added by older firmware and still in the journal included)
+static void db_migrate_uuids(void) {
+  uint32_t filled = 0;
+  for (uint32_t i = 0; i < reptile_table.count; i++) {
+    reptile_t *r = reptile_at(i);
+    if (r->uuid[0] == '\0') {
+      db_new_uuid(r->uuid);
+      r->mod_seq = ++max_mod_seq; // Exported again with its UUID
+      filled++;
+    }
+  }
+  ESP_LOGI(TAG, "%u reptiles given a UUID", (unsigned)filled);
+}
+
+static const db_migration_t migrations[] = {
+    {4, db_migrate_weights, false},
+    {7, db_migrate_uuids, true},
+    {0, NULL, false}, // End of table
+};
+
+// Run the migrations of one phase: before or after the journal replay
+static void db_migrate(uint32_t from_version, bool replayed) {
+  for (const db_migration_t *m = migrations; m->apply; m++) {
+    if (from_version < m->version && m->replayed == replayed) {
+      ESP_LOGI(TAG, "Migrating data to schema version %u",
+               (unsigned)m->version);
+      m->apply();
+    }
+  }
+}
+
+// ====================================================================================
+// LOADING
+// ====================================================================================
+
+typedef struct {
+  uint32_t version;             // Schema version of the file being loaded
+  const schema_entry_t *schema; // Stored field list, NULL for raw layouts
+  int schema_count;
+  uint32_t feeding_base; // From SECTION_HISTORY; 0 in older files
+  uint32_t health_base;
+  bool stats; // SECTION_STATS loaded; older files rescan the records
+  bool forecast; // SECTION_FORECAST loaded
+} db_load_ctx_t;
+
+static arena_t *db_table_arena(uint16_t section) {
+  switch (section) {
+  case SECTION_REPTILES:
+    return &reptile_table;
+  case SECTION_FEEDINGS:
+    return &feeding_table;
+  case SECTION_HEALTH:
+    return &health_table;
+  case SECTION_BREEDINGS:
+    return &breeding_table;
+  case SECTION_INVENTORY:
+    return &inventory_table;
+  default:
+    return NULL;
+  }
+}
+
+// Decode `count` stored records of one table into its RAM table
+static esp_err_t db_load_table(uint16_t section, uint16_t record_size,
+                               uint32_t count, const uint8_t *data,
+                               const db_load_ctx_t *ctx) {
+  static field_map_t plan[SCHEMA_MAX_FIELDS];
+  const table_schema_t *t = schema_table(section);
+  arena_t *arena = db_table_arena(section);
+  uint16_t stride = 0;
+  int n = -1;
+
+  if (t == NULL || arena == NULL)
+    return ESP_OK;
+  if (ctx->schema)
+    n = schema_plan_stored(t, ctx->schema, ctx->schema_count, plan, &stride);
+  else if (ctx->version < 3)
+    n = schema_plan_raw(t, schema_raw_v2(section), plan, &stride);
+
+  if (n < 0 || record_size != stride || count > arena->max) {
+    ESP_LOGE(TAG, "Section %d: %u x %u bytes does not match schema v%u",
+             section, (unsigned)count, record_size, (unsigned)ctx->version);
+    return ESP_ERR_INVALID_SIZE;
+  }
+  uint32_t base = section == SECTION_FEEDINGS ? ctx->feeding_base
+                  : section == SECTION_HEALTH ? ctx->health_base
+                                              : 0;
+  arena_rebase(arena, base);
+  if (arena_reserve(arena, base + count) != ESP_OK)
+    return ESP_ERR_NO_MEM;
+  for (uint32_t i = 0; i < count; i++)
+    schema_decode_record(t, plan, n, data + (size_t)i * stride,
+                         arena_append(arena));
+  return ESP_OK;
+}
+
+// Decode the weight section; needs the reptile table loaded first
+static esp_err_t db_load_weights(const uint8_t *data, uint32_t len) {
+  db_weights_truncate(0);
+  uint32_t pos = 0;
+  while (pos < len) {
+    weight_blob_t hdr;
+    if (len - pos < sizeof(hdr))
+      return ESP_ERR_INVALID_SIZE;
+    memcpy(&hdr, data + pos, sizeof(hdr));
+    pos += sizeof(hdr);
+    if (hdr.len > len - pos)
+      return ESP_ERR_INVALID_SIZE;
+
+    weight_series_t *s = weight_series_at(hdr.index);
+    if (s == NULL) {
+      ESP_LOGW(TAG, "Weights for missing reptile slot %u dropped",
+               (unsigned)hdr.index);
+    } else {
+      esp_err_t ret = weight_series_load(s, data + pos, hdr.len, hdr.count);
+      if (ret != ESP_OK)
+        return ret;
+    }
+    pos += hdr.len;
+  }
+  return ESP_OK;
+}
+
+// Decode the history section; must come before the history tables
+static esp_err_t db_load_history(const uint8_t *data, uint32_t len,
+                                 db_load_ctx_t *ctx) {
+  history_blob_t hdr;
+  if (len < sizeof(hdr))
+    return ESP_ERR_INVALID_SIZE;
+  memcpy(&hdr, data, sizeof(hdr));
+  if (hdr.slot_count > MAX_REPTILES ||
+      len != sizeof(hdr) + hdr.slot_count * sizeof(history_chain_t) ||
+      hdr.feeding_base % (1u << feeding_table.chunk_shift) != 0 ||
+      hdr.health_base % (1u << health_table.chunk_shift) != 0)
+    return ESP_ERR_INVALID_SIZE;
+
+  arena_clear(&history_heads);
+  if (arena_resize(&history_heads, hdr.slot_count) != ESP_OK)
+    return ESP_ERR_NO_MEM;
+  for (uint32_t i = 0; i < hdr.slot_count; i++) {
+    history_head_t *head = arena_at(&history_heads, i);
+    memcpy(&head->archived, data + sizeof(hdr) + i * sizeof(history_chain_t),
+           sizeof(history_chain_t));
+  }
+  ctx->feeding_base = hdr.feeding_base;
+  ctx->health_base = hdr.health_base;
+  return ESP_OK;
+}
+
+// Decode the statistics section. A layout this build does not know is
+// dropped, and the aggregates rescanned from the records.
+static esp_err_t db_load_stats(const uint8_t *data, uint32_t len,
+                               db_load_ctx_t *ctx) {
+  stats_blob_t hdr;
+  if (len < sizeof(hdr))
+    return ESP_ERR_INVALID_SIZE;
+  memcpy(&hdr, data, sizeof(hdr));
+  if (hdr.slot_count > MAX_REPTILES ||
+      len != sizeof(hdr) + hdr.events_size +
+                 hdr.slot_count * sizeof(stats_slot_blob_t))
+    return ESP_ERR_INVALID_SIZE;
+  if (hdr.events_size != sizeof(stats_events_t)) {
+    ESP_LOGW(TAG, "Statistics of another layout, rescanning");
+    return ESP_OK;
+  }
+
+  stats_clear(&stats);
+  if (stats_resize(&stats, hdr.slot_count) != ESP_OK)
+    return ESP_ERR_NO_MEM;
+  memcpy(&stats.summary.events, data + sizeof(hdr), hdr.events_size);
+  const uint8_t *p = data + sizeof(hdr) + hdr.events_size;
+  for (uint32_t i = 0; i < hdr.slot_count; i++) {
+    stats_slot_blob_t slot;
+    memcpy(&slot, p + i * sizeof(slot), sizeof(slot));
+    stats.rows[i].last_meal = slot.last_meal;
+    stats.rows[i].last_weigh = slot.last_weigh;
+    stats.rows[i].last_grams = slot.last_grams;
+  }
+  ctx->stats = true;
+  return ESP_OK;
+}
+
+static esp_err_t db_load_section(const snapshot_section_t *sec,
+                                 const void *data, void *ctx) {
+  db_load_ctx_t *load = ctx;
+  switch (sec->id) {
+  case SECTION_META: {
+    schema_meta_t meta = {0};
+    if (sec->count != 1 || sec->record_size < sizeof(meta.schema_version))
+      return ESP_ERR_INVALID_SIZE;
+    // Older files end at the version, newer ones may add fields after ours
+    memcpy(&meta, data,
+           sec->record_size < sizeof(meta) ? sec->record_size : sizeof(meta));
+    if (meta.schema_version > DB_SCHEMA_VERSION) {
+      ESP_LOGE(TAG, "Data written by newer firmware (schema v%u)",
+               (unsigned)meta.schema_version);
+      return ESP_ERR_NOT_SUPPORTED;
+    }
+    load->version = meta.schema_version;
+    next_reptile_id = meta.next_reptile_id;
+    return ESP_OK;
+  }
+  case SECTION_SCHEMA:
+    if (sec->record_size != sizeof(schema_entry_t))
+      return ESP_ERR_INVALID_SIZE;
+    load->schema = data; // Image stays alive until snapshot_load() returns
+    load->schema_count = sec->count;
+    return ESP_OK;
+  case SECTION_WEIGHTS:
+    if (sec->record_size != 1)
+      return ESP_ERR_INVALID_SIZE;
+    return db_load_weights(data, sec->count);
+  case SECTION_STRINGS:
+    if (sec->record_size != 1)
+      return ESP_ERR_INVALID_SIZE;
+    return string_pool_load(&strings, data, sec->count);
+  case SECTION_HISTORY:
+    if (sec->record_size != 1)
+      return ESP_ERR_INVALID_SIZE;
+    return db_load_history(data, sec->count, load);
+  case SECTION_STATS:
+    if (sec->record_size != 1)
+      return ESP_ERR_INVALID_SIZE;
+    return db_load_stats(data, sec->count, load);
+  case SECTION_FORECAST:
+    if (sec->record_size != sizeof(forecast_prey_t))
+      return ESP_ERR_INVALID_SIZE;
+    load->forecast = true;
+    return forecast_load(&forecast, data, sec->count);
+  default:
+    if (schema_table(sec->id) == NULL) {
+      ESP_LOGW(TAG, "Skipping unknown snapshot section %d", sec->id);
+      return ESP_OK;
+    }
+    return db_load_table(sec->id, sec->record_size, sec->count, data, load);
+  }
+}
+
+// Read a version 1 file (raw arrays) so existing cards upgrade in place
+static esp_err_t db_load_legacy(void) {
+  static const uint16_t order[] = {SECTION_REPTILES, SECTION_FEEDINGS,
+                                   SECTION_HEALTH, SECTION_BREEDINGS,
+                                   SECTION_INVENTORY};
+  FILE *f = fopen(SNAPSHOT_FILE_PATH, "rb");
+  if (f == NULL)
+    return ESP_ERR_NOT_FOUND;
+
+  legacy_header_t header;
+  struct stat st;
+  uint8_t *body = NULL;
+  esp_err_t ret = ESP_ERR_INVALID_STATE;
+  if (fstat(fileno(f), &st) == 0 &&
+      fread(&header, sizeof(header), 1, f) == 1 &&
+      header.magic == SNAPSHOT_MAGIC && header.version == 1) {
+    const uint32_t counts[] = {header.reptile_count, header.feeding_count,
+                               header.health_count, header.breeding_count,
+                               header.inventory_count};
+    size_t expected = sizeof(header);
+    for (int i = 0; i < 5; i++)
+      expected += counts[i] * schema_raw_v2(order[i])->record_size;
+
+    if ((size_t)st.st_size == expected &&
+        (body = malloc(expected - sizeof(header))) != NULL &&
+        fread(body, expected - sizeof(header), 1, f) == 1) {
+      const db_load_ctx_t ctx = {.version = 1};
+      const uint8_t *p = body;
+      ret = ESP_OK;
+      for (int i = 0; i < 5 && ret == ESP_OK; i++) {
+        uint16_t stride = schema_raw_v2(order[i])->record_size;
+        ret = db_load_table(order[i], stride, counts[i], p, &ctx);
+        p += (size_t)counts[i] * stride;
+      }
+    }
+  }
+  free(body);
+  fclose(f);
+  return ret;
+}
+
+// Rebuild the string pool from the handles records still use, dropping texts
+// orphaned by edits. Renumbers handles: run before the indexes are rebuilt.
+static void db_strings_compact(void) {
+  const table_schema_t *t = schema_table(SECTION_REPTILES);
+  string_pool_t next = {0};
+  str_ref_t ref;
+
+  for (uint32_t i = 0; i < reptile_table.count; i++) {
+    const reptile_t *r = reptile_at(i);
+    for (int j = 0; j < t->field_count; j++) {
+      const field_desc_t *f = &t->fields[j];
+      if (f->kind != FIELD_STRREF)
+        continue;
+      memcpy(&ref, (const uint8_t *)r + f->offset, sizeof(ref));
+      if (string_pool_intern(&next, lookup(ref), STRING_POOL_MAX_LEN, &ref) !=
+          ESP_OK) {
+        string_pool_free(&next); // Keep the old pool: it is still valid
+        return;
+      }
+    }
+  }
+  if (next.count == strings.count) {
+    string_pool_free(&next); // Nothing orphaned
+    return;
+  }
+
+  seqlock_write_begin(&tables_lock);
+  for (uint32_t i = 0; i < reptile_table.count; i++) {
+    uint8_t *r = (uint8_t *)reptile_at(i);
+    for (int j = 0; j < t->field_count; j++) {
+      const field_desc_t *f = &t->fields[j];
+      if (f->kind != FIELD_STRREF)
+        continue;
+      memcpy(&ref, r + f->offset, sizeof(ref));
+      ref = string_pool_find(&next, lookup(ref));
+      memcpy(r + f->offset, &ref, sizeof(ref));
+    }
+  }
+  ESP_LOGI(TAG, "String pool compacted: %u -> %u strings",
+           (unsigned)strings.count, (unsigned)next.count);
+  string_pool_free(&strings);
+  strings = next;
+  seqlock_write_end(&tables_lock);
+}
+
+// A reset between writing a segment and the next snapshot leaves archived
+// records in the loaded tables: release them again
+static bool history_reconcile(const history_t *h) {
+  const uint32_t chunk = 1u << h->records->chunk_shift;
+  uint32_t end = archive_end(h->archive);
+  bool released = false;
+  while (h->records->base + chunk <= end &&
+         h->records->count - h->records->base >= chunk) {
+    history_release_front(h);
+    released = true;
+  }
+  if (end > h->records->count)
+    ESP_LOGW(TAG, "%s holds records newer than the loaded data",
+             h->archive->dir);
+  return released;
+}
+
+static void db_load_tables(void) {
+  uint32_t journal_seq = 0;
+  schema_set_strings(&schema_strings);
+  archive_open(&feeding_archive);
+  archive_open(&health_archive);
+  audit_open();
+  stats_clear(&stats);
+  forecast_clear(&forecast);
+  db_load_ctx_t ctx = {.version = 2}; // Sectioned files without meta are v2
+  esp_err_t ret = snapshot_load(db_load_section, &ctx, &journal_seq);
+
+  if (ret == ESP_ERR_NO_MEM || ret == ESP_ERR_NOT_SUPPORTED) {
+    // The card holds data this build cannot load: never write over it
+    ESP_LOGE(TAG, "Saved data not loaded (%s), saving disabled",
+             esp_err_to_name(ret));
+    db_clear_tables();
+    persist_blocked = true;
+    return;
+  }
+  if (ret != ESP_OK) {
+    db_clear_tables();
+    if (db_load_legacy() == ESP_OK) {
+      // Pre-v2 journals have no sequence numbers and cannot be replayed
+      ESP_LOGW(TAG, "Upgrading version 1 data file");
+      db_migrate(1, false);
+      db_migrate(1, true);
+      db_index_rebuild();
+      db_stats_scan(&stats);
+      journal_reset();
+      db_save_data();
+    } else {
+      if (ret == ESP_ERR_NOT_FOUND)
+        ESP_LOGW(TAG, "No saved data found, using defaults");
+      else
+        ESP_LOGE(TAG, "No valid snapshot generation, using defaults");
+      db_reset_to_demo();
+    }
+    return;
+  }
+
+  db_migrate(ctx.version, false);
+  // Replayed weights are stamped after the newest stamp of the snapshot
+  max_mod_seq = 0;
+  for (uint32_t i = 0; i < reptile_table.count; i++)
+    if (reptile_at(i)->mod_seq > max_mod_seq)
+      max_mod_seq = reptile_at(i)->mod_seq;
+  // Bring the snapshot up to date with edits made since the last checkpoint
+  journal_replay(journal_apply, journal_seq);
+  db_migrate(ctx.version, true);
+  db_strings_compact();
+  db_index_rebuild();
+  bool released = history_reconcile(&feedings);
+  released |= history_reconcile(&healths);
+  if (released)
+    db_index_rebuild(); // Relink the chains onto their new archived part
+  if (!ctx.forecast) {
+    // Older file: start the rates from the meals still in RAM, the weeks
+    // that weigh in them (replayed ones included)
+    forecast_clear(&forecast);
+    for (uint32_t seq = feeding_table.base; seq < feeding_table.count; seq++) {
+      const feeding_record_t *f = arena_at(&feeding_table, seq);
+      forecast_consume(&forecast, f->prey_type, f->prey_count, f->timestamp);
+    }
+  }
+  if (!ctx.stats) {
+    // Older file: count the history once, then keep it in the snapshot
+    ESP_LOGW(TAG, "Computing statistics from the records");
+    db_stats_scan(&stats);
+    if (ctx.version == DB_SCHEMA_VERSION)
+      db_save_data();
+  }
+  if (ctx.version < DB_SCHEMA_VERSION) {
+    ESP_LOGW(TAG, "Upgrading schema v%u data file", (unsigned)ctx.version);
+    db_save_data();
+  }
+  ESP_LOGI(TAG, "Data loaded safely. %u reptiles.",
+           (unsigned)reptile_table.count);
+}
+
+// Hand the tables to the calling task until db_load_data() publishes them.
+// With no preview the readers see an empty table (boot_hot stays zeroed)
+// rather than the live tables the load is writing.
+static void db_load_begin(void) {
+  if (load_task)
+    return;
+  if (db_events)
+    xEventGroupClearBits(db_events, DB_EVENT_LOADED);
+  load_task = xTaskGetCurrentTaskHandle();
+  view = &boot_hot;
+  // A modifier already inside finishes first; later ones wait (db_lock())
+  DB_LOCK();
+  DB_UNLOCK();
+}
+
+esp_err_t db_map_boot_view(void) {
+  boot_view_state = boot_view_map(&boot_hot);
+  db_load_begin();
+  return boot_view_state;
+}
+
+void db_load_data(void) {
+  db_load_begin();
+  undo_clear(); // Slots are renumbered by the load
+  db_load_tables();
+
+  // Publish: a short write section, then the waiting modifiers go on
+  DB_LOCK();
+  seqlock_write_begin(&tables_lock);
+  view = &hot;
+  load_task = NULL;
+  seqlock_write_end(&tables_lock);
+  if (db_events)
+    xEventGroupSetBits(db_events, DB_EVENT_LOADED);
+  DB_UNLOCK();
+  if (boot_view_state == ESP_ERR_NOT_FOUND && !persist_blocked)
+    db_save_data(); // First boot with a preview partition: fill it
+}
+
+// ====================================================================================
+// HELPERS
+// ====================================================================================
+
+const char *db_cites_annex_to_string(cites_annex_t annex) {
+  switch (annex) {
+  case CITES_ANNEX_A:
+    return "A";
+  case CITES_ANNEX_B:
+    return "B";
+  case CITES_ANNEX_C:
+    return "C";
+  case CITES_ANNEX_D:
+    return "D";
+  default:
+    return "Non listé";
+  }
+}
+
+const char *db_exit_reason_to_string(exit_reason_t reason) {
+  switch (reason) {
+  case EXIT_SOLD:
+    return "Vente";
+  case EXIT_DONATED:
+    return "Don";
+  case EXIT_DECEASED:
+    return "Décès";
+  case EXIT_ESCAPED:
+    return "Évasion";
+  case EXIT_CONFISCATED:
+    return "Confiscation";
+  default:
+    return "";
+  }
+}
+
 // ====================================================================================
-// DATA STORAGE (Moved from main.c)
+// LIVRE DE POLICE AUDIT
 // ====================================================================================
+// Changes to the regulatory fields are appended to the audit log (see
+// audit_log.h) as text, old and new value, so the log reads on its own and
+// stays valid across schema changes. Only live changes are logged: loading
+// and journal replay restore what was already logged.
+
+typedef enum {
+  AUDIT_FMT_TEXT = 0, // char[]
+  AUDIT_FMT_REF,      // str_ref_t
+  AUDIT_FMT_DATE,     // time_t
+  AUDIT_FMT_FLAG,     // bool
+  AUDIT_FMT_CITES,    // cites_annex_t
+  AUDIT_FMT_EXIT,     // exit_reason_t
+  AUDIT_FMT_PRICE,    // uint16_t
+} audit_format_t;
+
+// Audited reptile_t fields, by db_schema tag, named as in the export
+static const struct {
+  uint16_t tag;
+  uint8_t format;
+  const char *name;
+} audit_fields[] = {
+    {9, AUDIT_FMT_TEXT, "Identification"},
+    {15, AUDIT_FMT_CITES, "CITES_Annexe"},
+    {16, AUDIT_FMT_TEXT, "CITES_Permis"},
+    {17, AUDIT_FMT_TEXT, "CITES_Date"},
+    {19, AUDIT_FMT_DATE, "Date_Entree"},
+    {20, AUDIT_FMT_REF, "Provenance"},
+    {21, AUDIT_FMT_TEXT, "Pays_Origine"},
+    {22, AUDIT_FMT_REF, "Eleveur_Nom"},
+    {23, AUDIT_FMT_REF, "Eleveur_Adresse"},
+    {24, AUDIT_FMT_TEXT, "Eleveur_CDC"},
+    {25, AUDIT_FMT_FLAG, "Ne_Captivite"},
+    {26, AUDIT_FMT_DATE, "Date_Sortie"},
+    {27, AUDIT_FMT_EXIT, "Motif_Sortie"},
+    {28, AUDIT_FMT_TEXT, "Destinataire_Nom"},
+    {29, AUDIT_FMT_TEXT, "Destinataire_Adresse"},
+    {30, AUDIT_FMT_PRICE, "Prix_Vente"},
+    {43, AUDIT_FMT_FLAG, "Actif"},
+};
+
+#define AUDIT_FIELD_COUNT (sizeof(audit_fields) / sizeof(audit_fields[0]))
+
+static const char *audit_field_name(uint16_t tag) {
+  for (size_t i = 0; i < AUDIT_FIELD_COUNT; i++)
+    if (audit_fields[i].tag == tag)
+      return audit_fields[i].name;
+  return "?";
+}
+
+// Text of a field, formatted as the export writes it
+static void audit_value(const reptile_t *r, const field_desc_t *f,
+                        uint8_t format, char *out) {
+  const uint8_t *p = (const uint8_t *)r + f->offset;
+  union {
+    str_ref_t ref;
+    time_t time;
+    bool flag;
+    cites_annex_t cites;
+    exit_reason_t exit;
+    uint16_t price;
+  } v;
+  struct tm tm;
+
+  memcpy(&v, p, f->size < sizeof(v) ? f->size : sizeof(v));
+  switch (format) {
+  case AUDIT_FMT_TEXT:
+    snprintf(out, AUDIT_VALUE_LEN, "%.*s", (int)f->size, (const char *)p);
+    break;
+  case AUDIT_FMT_REF:
+    snprintf(out, AUDIT_VALUE_LEN, "%s", lookup(v.ref));
+    break;
+  case AUDIT_FMT_DATE:
+    if (v.time == 0 || localtime_r(&v.time, &tm) == NULL)
+      out[0] = '\0';
+    else
+      strftime(out, AUDIT_VALUE_LEN, "%Y-%m-%d", &tm);
+    break;
+  case AUDIT_FMT_FLAG:
+    strcpy(out, v.flag ? "Oui" : "Non");
+    break;
+  case AUDIT_FMT_CITES:
+    snprintf(out, AUDIT_VALUE_LEN, "%s", db_cites_annex_to_string(v.cites));
+    break;
+  case AUDIT_FMT_EXIT:
+    snprintf(out, AUDIT_VALUE_LEN, "%s", db_exit_reason_to_string(v.exit));
+    break;
+  default:
+    snprintf(out, AUDIT_VALUE_LEN, "%u", (unsigned)v.price);
+    break;
+  }
+}
+
+// Entries of the open transaction, handed to the log when it commits: an
+// aborted transaction leaves nothing in the hash chain
+typedef struct {
+  uint32_t animal_id;
+  uint16_t field;
+  char before[AUDIT_VALUE_LEN];
+  char after[AUDIT_VALUE_LEN];
+} audit_staged_t;
+
+static audit_staged_t *audit_staged = NULL;
+static uint32_t audit_staged_count = 0;
+static uint32_t audit_staged_capacity = 0;
 
-reptile_t reptiles[MAX_REPTILES];
-feeding_record_t feedings[MAX_FEEDINGS];
-health_record_t health_records[MAX_HEALTH_RECORDS];
-breeding_record_t breedings[MAX_BREEDINGS];
-inventory_item_t inventory[MAX_INVENTORY_ITEMS];
+static audit_staged_t *audit_stage(void) {
+  if (audit_staged_count == audit_staged_capacity) {
+    uint32_t capacity = audit_staged_capacity ? audit_staged_capacity * 2 : 8;
+    audit_staged_t *p =
+        realloc(audit_staged, capacity * sizeof(*audit_staged));
+    if (p == NULL)
+      return NULL;
+    audit_staged = p;
+    audit_staged_capacity = capacity;
+  }
+  return &audit_staged[audit_staged_count++];
+}
+
+// Log the audited fields that differ between two versions of a slot, once
+// the transaction commits (called in a transaction)
+static void db_audit_reptile(const reptile_t *before, const reptile_t *after) {
+  const table_schema_t *t = schema_table(SECTION_REPTILES);
+  for (size_t i = 0; i < AUDIT_FIELD_COUNT; i++) {
+    const field_desc_t *f = schema_field(t, audit_fields[i].tag);
+    if (memcmp((const uint8_t *)before + f->offset,
+               (const uint8_t *)after + f->offset, f->size) == 0)
+      continue;
+    audit_staged_t *e = audit_stage();
+    if (e == NULL) {
+      ESP_LOGE(TAG, "Out of memory, change of animal %u not logged",
+               (unsigned)after->id);
+      return;
+    }
+    e->animal_id = after->id;
+    e->field = f->tag;
+    audit_value(before, f, audit_fields[i].format, e->before);
+    audit_value(after, f, audit_fields[i].format, e->after);
+  }
+}
 
-uint8_t reptile_count = 0;
-uint8_t feeding_count = 0;
-uint8_t health_record_count = 0;
-uint8_t breeding_count = 0;
-uint8_t inventory_count = 0;
+// Close the staged entries of a transaction: logged if it committed
+static void db_audit_end(bool commit) {
+  for (uint32_t i = 0; commit && i < audit_staged_count; i++) {
+    const audit_staged_t *e = &audit_staged[i];
+    audit_append(e->animal_id, e->field, e->before, e->after);
+  }
+  audit_staged_count = 0;
+}
 
 // ====================================================================================
-// ACCESSORS
+// CSV EXPORT
 // ====================================================================================
+// Rows are formatted a chunk at a time under DB_LOCK, and each chunk is
+// written with the lock released, so edits and saves go on during an export.
+//
+// Incremental exports rely on reptile_t.mod_seq: each modifier that changes a
+// reptile stamps it with ++max_mod_seq, and the stamp is journaled like any
+// other field. Rows are never removed (deletion is soft), so the counter is
+// the highest stamp of the table and is not saved separately. An export
+// flushes the journal before recording its watermark, so a stamp at or below
+// the watermark is never handed out again after a reset.
 
-int db_get_reptile_count(void) { return reptile_count; }
-void db_set_reptile_count(int count) { reptile_count = count; }
+#define EXPORT_TASK_STACK 4096
+#define EXPORT_TASK_PRIORITY 1 // Below the save task
+#define EXPORT_PATH_MAX 64
+#define EXPORT_STATE_MAGIC 0x57505845 // "EXPW"
+#define EXPORT_COMPACT_DAYS 30 // Rewrite the registre at least this often
 
-reptile_t *db_get_reptile(int index) {
-  if (index >= 0 && index < MAX_REPTILES)
-    return &reptiles[index];
-  return NULL;
+// Watermark file, next to the registre
+typedef struct __attribute__((packed)) {
+  uint32_t magic;
+  uint32_t watermark;    // Highest stamp in the exported files
+  int64_t full_time;     // Last full export
+  uint32_t changed_rows; // Rows appended to the changes file since
+  uint32_t audit_rows;   // Audit entries in the history file
+  uint32_t crc;
+} export_mark_t;
+
+static TaskHandle_t export_task = NULL;
+static char export_path[EXPORT_PATH_MAX];
+static db_export_mode_t export_mode = DB_EXPORT_AUTO;
+static volatile db_export_state_t export_state = DB_EXPORT_IDLE;
+static volatile bool export_cancel = false;
+static volatile uint32_t export_done = 0;
+static volatile uint32_t export_total = 0;
+
+static const char *const export_header =
+    "ID,UUID,Nom,Espece_Commune,Espece_Scientifique,Identification,Sexe,"
+    "Date_Naissance,Naissance_Estimee,CITES_Annexe,CITES_Permis,"
+    "Date_Entree,Provenance,Pays_Origine,Eleveur_Nom,Ne_Captivite,"
+    "Date_Sortie,Motif_Sortie,Destinataire_Nom,Destinataire_Adresse,"
+    "Poids_Grammes,Actif";
+
+// "<dir>/registre.csv" -> "<dir>/registre<suffix>"
+static bool export_sibling(const char *path, const char *suffix, char *out) {
+  size_t base = strlen(path);
+  if (base > 4 && strcmp(path + base - 4, ".csv") == 0)
+    base -= 4;
+  return snprintf(out, EXPORT_PATH_MAX, "%.*s%s", (int)base, path, suffix) <
+         EXPORT_PATH_MAX;
+}
+
+static bool export_mark_load(const char *path, export_mark_t *m) {
+  FILE *f = fopen(path, "rb");
+  if (f == NULL)
+    return false;
+  bool ok = fread(m, sizeof(*m), 1, f) == 1;
+  fclose(f);
+  return ok && m->magic == EXPORT_STATE_MAGIC &&
+         m->crc == esp_rom_crc32_le(0, (const uint8_t *)m,
+                                    offsetof(export_mark_t, crc));
 }
 
-reptile_t *db_get_reptile_by_id(int id) {
-  for (int i = 0; i < reptile_count; i++) {
-    if (reptiles[i].id == id)
-      return &reptiles[i];
+static esp_err_t export_mark_save(const char *path, export_mark_t *m) {
+  char tmp[EXPORT_PATH_MAX + 4];
+  snprintf(tmp, sizeof(tmp), "%s.tmp", path);
+  m->magic = EXPORT_STATE_MAGIC;
+  m->crc =
+      esp_rom_crc32_le(0, (const uint8_t *)m, offsetof(export_mark_t, crc));
+  FILE *f = fopen(tmp, "wb");
+  if (f == NULL)
+    return ESP_FAIL;
+  bool ok = fwrite(m, sizeof(*m), 1, f) == 1;
+  ok &= fclose(f) == 0;
+  // FATFS rename() does not replace an existing file
+  remove(path);
+  if (!ok || rename(tmp, path) != 0) {
+    remove(tmp);
+    return ESP_FAIL;
   }
-  return NULL;
+  return ESP_OK;
 }
 
-int db_get_reptile_next_id(void) {
-  int max = 0;
-  for (int i = 0; i < reptile_count; i++) {
-    if (reptiles[i].id > max)
-      max = reptiles[i].id;
+// Put a complete rewrite, written to `tmp`, in place of `path`. FATFS
+// rename() does not replace an existing file; should the rename fail, the
+// new copy is left in `tmp` rather than lost.
+static esp_err_t export_replace(const char *tmp, const char *path) {
+  remove(path);
+  if (rename(tmp, path) != 0) {
+    ESP_LOGE(TAG, "Failed to rename %s, the export is left there", tmp);
+    return ESP_FAIL;
   }
-  return max + 1;
+  return ESP_OK;
 }
 
-int db_get_feeding_count(void) { return feeding_count; }
-feeding_record_t *db_get_feeding(int index) {
-  if (index >= 0 && index < MAX_FEEDINGS)
-    return &feedings[index];
-  return NULL;
+static void export_row(csv_writer_t *w, const reptile_t *r) {
+  csv_uint(w, r->id);
+  csv_text(w, r->uuid);
+  csv_text(w, r->name);
+  csv_text(w, lookup(r->species_common));
+  csv_text(w, lookup(r->species_scientific));
+  csv_text(w, r->microchip);
+  csv_raw(w, (r->sex == SEX_MALE)     ? "M"
+             : (r->sex == SEX_FEMALE) ? "F"
+                                      : "?");
+  csv_ymd(w, r->birth_year, r->birth_month ? r->birth_month : 1,
+          r->birth_day ? r->birth_day : 1);
+  csv_raw(w, r->birth_estimated ? "Oui" : "Non");
+  csv_raw(w, db_cites_annex_to_string(r->cites_annex));
+  csv_text(w, r->cites_permit);
+  csv_date(w, r->date_acquisition);
+  csv_text(w, lookup(r->origin));
+  csv_text(w, r->origin_country);
+  csv_text(w, lookup(r->breeder_name));
+  csv_raw(w, r->captive_bred ? "Oui" : "Non");
+  csv_date(w, r->date_exit);
+  csv_raw(w, db_exit_reason_to_string(r->exit_reason));
+  csv_text(w, r->recipient_name);
+  csv_text(w, r->recipient_address);
+  csv_int(w, r->weight_grams);
+  csv_raw(w, r->active ? "Oui" : "Non");
+  csv_end_row(w);
 }
-void db_add_feeding(feeding_record_t *record) {
-  if (feeding_count < MAX_FEEDINGS) {
-    feedings[feeding_count] = *record;
-    feeding_count++;
+
+static bool export_history_row(const audit_entry_t *e, void *arg) {
+  csv_writer_t *w = arg;
+  char text[AUDIT_VALUE_LEN], hash[AUDIT_HASH_LEN * 2 + 1];
+  csv_uint(w, e->seq);
+  csv_date(w, e->timestamp);
+  csv_uint(w, e->animal_id);
+  csv_raw(w, audit_field_name(e->field));
+  // Bounded: the entry comes from the card
+  snprintf(text, sizeof(text), "%.*s", AUDIT_VALUE_LEN - 1, e->before);
+  csv_text(w, text);
+  snprintf(text, sizeof(text), "%.*s", AUDIT_VALUE_LEN - 1, e->after);
+  csv_text(w, text);
+  for (int i = 0; i < AUDIT_HASH_LEN; i++)
+    snprintf(hash + i * 2, 3, "%02x", e->hash[i]);
+  csv_raw(w, hash);
+  csv_end_row(w);
+  return !csv_full(w) || csv_flush(w) == ESP_OK;
+}
+
+// Append the audit entries from `from` on to the history file, or rewrite
+// it from the first entry if `from` is 0 or past the end of the log (a
+// different card). `*end` gets the entry count now in the file.
+static esp_err_t export_history(const char *path, uint32_t from,
+                                uint32_t *end) {
+  csv_writer_t w;
+  struct stat st;
+  off_t size = stat(path, &st) == 0 ? st.st_size : 0;
+  if (from > audit_count() || size == 0)
+    from = 0;
+
+  // A rewrite goes to a copy so the last good history survives a failure
+  char tmp[EXPORT_PATH_MAX + 4];
+  snprintf(tmp, sizeof(tmp), "%s.tmp", path);
+  esp_err_t ret = csv_open(&w, from > 0 ? path : tmp, from > 0);
+  if (ret != ESP_OK)
+    return ret;
+  if (from == 0) {
+    csv_raw(&w, "Entree,Date,ID,Champ,Avant,Apres,Empreinte_SHA256");
+    csv_end_row(&w);
   }
+  ret = audit_read(from, export_history_row, &w, end);
+  esp_err_t closed = csv_close(&w);
+  if (ret == ESP_OK)
+    ret = closed;
+  if (ret != ESP_OK) {
+    if (from > 0)
+      truncate(path, size);
+    else
+      remove(tmp);
+  } else if (from == 0) {
+    ret = export_replace(tmp, path);
+  }
+  return ret;
 }
 
-int db_get_health_count(void) { return health_record_count; }
-health_record_t *db_get_health(int index) {
-  if (index >= 0 && index < MAX_HEALTH_RECORDS)
-    return &health_records[index];
-  return NULL;
+// Write every row stamped after `since` (all rows if `all`) to `path`.
+// A full export is written to "<path>.tmp" and only replaces the registre
+// once complete; on failure or cancel the registre is left as it was.
+static esp_err_t export_rows(const char *path, bool all, uint32_t since,
+                             uint32_t *written) {
+  struct stat st;
+  off_t size = stat(path, &st) == 0 ? st.st_size : 0;
+  bool append = !all && size > 0;
+  char tmp[EXPORT_PATH_MAX + 4];
+  snprintf(tmp, sizeof(tmp), "%s.tmp", path);
+
+  csv_writer_t w;
+  esp_err_t ret = csv_open(&w, append ? path : tmp, append);
+  if (ret != ESP_OK)
+    return ret;
+  if (!append) {
+    csv_raw(&w, export_header);
+    csv_end_row(&w);
+  }
+
+  uint32_t i = 0, n = 0, count;
+  do {
+    if (export_cancel) {
+      ret = ESP_ERR_INVALID_STATE;
+      break;
+    }
+    DB_LOCK();
+    count = reptile_table.count;
+    while (i < count && !csv_full(&w)) {
+      const reptile_t *r = reptile_at(i++);
+      if (all || r->mod_seq > since) {
+        export_row(&w, r);
+        n++;
+      }
+    }
+    DB_UNLOCK();
+    export_done = i;
+    export_total = count;
+    ret = csv_flush(&w);
+  } while (ret == ESP_OK && i < count);
+
+  esp_err_t closed = csv_close(&w);
+  if (ret == ESP_OK)
+    ret = closed;
+  if (ret != ESP_OK) {
+    // Never leave a truncated registre or a half-appended row behind
+    if (append)
+      truncate(path, size);
+    else
+      remove(tmp);
+  } else if (!append) {
+    ret = export_replace(tmp, path);
+  }
+  *written = n;
+  return ret;
 }
-void db_add_health(health_record_t *record) {
-  if (health_record_count < MAX_HEALTH_RECORDS) {
-    health_records[health_record_count] = *record;
-    health_record_count++;
+
+esp_err_t db_export_csv(const char *filepath, db_export_mode_t mode) {
+  char changes[EXPORT_PATH_MAX], mark_path[EXPORT_PATH_MAX];
+  char history[EXPORT_PATH_MAX];
+  if (!export_sibling(filepath, "_maj.csv", changes) ||
+      !export_sibling(filepath, ".exp", mark_path) ||
+      !export_sibling(filepath, "_historique.csv", history))
+    return ESP_ERR_INVALID_ARG;
+
+  export_mark_t mark = {0};
+  bool have_mark = export_mark_load(mark_path, &mark);
+  uint32_t stamp, count, changed = 0;
+  DB_LOCK();
+  stamp = max_mod_seq;
+  count = reptile_table.count;
+  for (uint32_t i = 0; have_mark && i < count; i++)
+    if (reptile_at(i)->mod_seq > mark.watermark)
+      changed++;
+  DB_UNLOCK();
+  // Every stamp up to `stamp` must be on the card before it is recorded
+  esp_err_t ret = db_flush();
+  if (ret != ESP_OK)
+    return ret;
+
+  // A watermark above the counter belongs to other data (restored backup,
+  // reset to demo): only a full export is safe then
+  struct stat st;
+  bool full = mode == DB_EXPORT_FULL || !have_mark ||
+              mark.watermark > stamp || stat(filepath, &st) != 0;
+  if (!full && mode == DB_EXPORT_AUTO)
+    full = mark.changed_rows + changed > count / 2 ||
+           time(NULL) - mark.full_time >
+               (int64_t)EXPORT_COMPACT_DAYS * 24 * 3600;
+  if (!full && changed == 0) {
+    ESP_LOGI(TAG, "Registre unchanged since the last export");
+    return ESP_OK;
+  }
+
+  ESP_LOGI(TAG, "Exporting registre to CSV: %s (%s)",
+           full ? filepath : changes, full ? "full" : "changes");
+  uint32_t written;
+  ret = export_rows(full ? filepath : changes, full, mark.watermark,
+                    &written);
+  if (ret != ESP_OK) {
+    ESP_LOGE(TAG, "Export to %s %s", full ? filepath : changes,
+             export_cancel ? "cancelled" : "failed");
+    return ret;
+  }
+
+  if (full) {
+    remove(changes); // Folded into the registre
+    mark.full_time = time(NULL);
+    mark.changed_rows = 0;
+  } else {
+    mark.changed_rows += written;
   }
+  mark.watermark = stamp;
+  // The Livre de Police history goes with the registre it explains
+  uint32_t audit_rows;
+  if (export_history(history, have_mark ? mark.audit_rows : 0,
+                     &audit_rows) == ESP_OK)
+    mark.audit_rows = audit_rows;
+  else
+    ESP_LOGW(TAG, "Failed to export the history to %s", history);
+  if (export_mark_save(mark_path, &mark) != ESP_OK)
+    ESP_LOGW(TAG, "Failed to save %s, next export will be full", mark_path);
+  ESP_LOGI(TAG, "Registre exported: %u animals to %s", (unsigned)written,
+           full ? filepath : changes);
+  return ESP_OK;
 }
 
-int db_get_breeding_count(void) { return breeding_count; }
-breeding_record_t *db_get_breeding(int index) {
-  if (index >= 0 && index < MAX_BREEDINGS)
-    return &breedings[index];
-  return NULL;
+static void db_export_task(void *arg) {
+  esp_err_t ret = db_export_csv(export_path, export_mode);
+  export_state = ret == ESP_OK   ? DB_EXPORT_DONE
+                 : export_cancel ? DB_EXPORT_CANCELLED
+                                 : DB_EXPORT_FAILED;
+  export_task = NULL;
+  vTaskDelete(NULL);
 }
-int db_add_breeding(breeding_record_t *record) {
-  if (breeding_count < MAX_BREEDINGS) {
-    breedings[breeding_count] = *record;
-    breeding_count++;
-    return breeding_count - 1;
+
+esp_err_t db_export_csv_start(const char *filepath, db_export_mode_t mode) {
+  if (export_state == DB_EXPORT_RUNNING)
+    return ESP_ERR_INVALID_STATE;
+  if (strlen(filepath) >= sizeof(export_path))
+    return ESP_ERR_INVALID_ARG;
+  strcpy(export_path, filepath);
+  export_mode = mode;
+  export_cancel = false;
+  export_done = 0;
+  export_total = reptile_table.count;
+  export_state = DB_EXPORT_RUNNING;
+  if (xTaskCreate(db_export_task, "db_export", EXPORT_TASK_STACK, NULL,
+                  EXPORT_TASK_PRIORITY, &export_task) != pdPASS) {
+    ESP_LOGE(TAG, "Failed to start export task");
+    export_task = NULL;
+    export_state = DB_EXPORT_FAILED;
+    return ESP_FAIL;
   }
-  return -1;
+  return ESP_OK;
 }
 
-int db_get_inventory_count(void) { return inventory_count; }
-void db_set_inventory_count(int count) { inventory_count = count; }
-inventory_item_t *db_get_inventory_item(int index) {
-  if (index >= 0 && index < MAX_INVENTORY_ITEMS)
-    return &inventory[index];
-  return NULL;
+void db_export_csv_cancel(void) {
+  if (export_state == DB_EXPORT_RUNNING)
+    export_cancel = true;
+}
+
+db_export_state_t db_export_csv_progress(uint32_t *done, uint32_t *total) {
+  *done = export_done;
+  *total = export_total;
+  return export_state;
 }
 
 // ====================================================================================
-// PERSISTENCE
+// MODIFIERS (MVC)
 // ====================================================================================
+// Each modifier applies the change in RAM, then appends a small typed record
+// to the journal. The full snapshot is only rewritten at checkpoints.
 
-#define DATA_FILE_PATH "/sdcard/reptile_data.bin"
-
-typedef struct {
-  uint32_t magic;
-  uint32_t version;
-  uint8_t reptile_count;
-  uint8_t feeding_count;
-  uint8_t health_count;
-  uint8_t breeding_count;
-  uint8_t inventory_count;
-} data_header_t;
+static void txn_save_stock(void); // See TRANSACTIONS
 
-static const uint32_t DATA_MAGIC = 0x52455054; // "REPT"
-static const uint32_t DATA_VERSION = 1;
+static void apply_feeding(int id, time_t date, const char *prey, int qty,
+                          bool accepted) {
+  reptile_t *r = reptile_at(id);
+  if (accepted) { // A refusal leaves the animal due
+    seqlock_write_begin(record_lock(id));
+    r->last_feeding = date;
+    seqlock_write_end(record_lock(id));
+    db_hot_sync(id);
+  }
 
-// Stub for toast since UI is not here
-// In full refactor, UI observes Data changes, or Controller calls Data then UI.
-// For now, we will assume save is called from UI which handles Toast.
-// Or we print log.
+  // Add history record (if space)
+  feeding_record_t rec = {.animal_id = r->id,
+                          .timestamp = date,
+                          .prey_count = (uint8_t)qty,
+                          .accepted = accepted};
+  if (prey)
+    strncpy(rec.prey_type, prey, sizeof(rec.prey_type) - 1);
+  seqlock_write_begin(&tables_lock);
+  feeding_record_t *f = arena_append(&feeding_table);
+  if (f) {
+    *f = rec;
+    history_link(&feedings, feeding_table.count - 1);
+    stats_meal(&stats, id, r->species, date, rec.accepted);
+  }
+  // Taken from the stock in the same step, so replaying the journal
+  // replays both
+  txn_save_stock();
+  inventory_item_t *stock = db_stock_item(rec.prey_type);
+  if (stock)
+    stock->quantity -= qty < stock->quantity ? qty : stock->quantity;
+  forecast_consume(&forecast, rec.prey_type, qty, date);
+  seqlock_write_end(&tables_lock);
+  if (f == NULL)
+    ESP_LOGW(TAG, "Feeding history full, record not kept");
+}
 
-void db_save_data(void) {
-  // Check if SD mounted? We assume main.c checks or we check global flag if
-  // accessible. For strict separation, we should try open.
-  FILE *f = fopen(DATA_FILE_PATH, "wb");
-  if (f == NULL) {
-    ESP_LOGE(TAG, "Failed to open data file for writing");
-    return;
+static void apply_health(int id, time_t date, const char *type,
+                         const char *notes) {
+  health_record_t rec = {.animal_id = reptile_at(id)->id,
+                         .timestamp = date,
+                         .weight_grams = reptile_at(id)->weight_grams};
+  strncpy(rec.event_type, type, sizeof(rec.event_type) - 1);
+  if (notes)
+    strncpy(rec.description, notes, sizeof(rec.description) - 1);
+  seqlock_write_begin(&tables_lock);
+  health_record_t *h = arena_append(&health_table);
+  if (h) {
+    *h = rec;
+    history_link(&healths, health_table.count - 1);
   }
+  seqlock_write_end(&tables_lock);
+  if (h == NULL)
+    ESP_LOGW(TAG, "Health history full, record not kept");
+}
 
-  data_header_t header = {.magic = DATA_MAGIC,
-                          .version = DATA_VERSION,
-                          .reptile_count = reptile_count,
-                          .feeding_count = feeding_count,
-                          .health_count = health_record_count,
-                          .breeding_count = breeding_count,
-                          .inventory_count = inventory_count};
-  fwrite(&header, sizeof(data_header_t), 1, f);
-
-  if (reptile_count > 0)
-    fwrite(reptiles, sizeof(reptile_t), reptile_count, f);
-  if (feeding_count > 0)
-    fwrite(feedings, sizeof(feeding_record_t), feeding_count, f);
-  if (health_record_count > 0)
-    fwrite(health_records, sizeof(health_record_t), health_record_count, f);
-  if (breeding_count > 0)
-    fwrite(breedings, sizeof(breeding_record_t), breeding_count, f);
-  if (inventory_count > 0)
-    fwrite(inventory, sizeof(inventory_item_t), inventory_count, f);
+static void apply_weight(int id, time_t date, uint16_t grams) {
+  reptile_t *r = reptile_at(id);
+  seqlock_write_begin(record_lock(id));
+  if (r->weight_grams != grams)
+    r->mod_seq = ++max_mod_seq; // Exported column
+  r->weight_grams = grams;
+  r->last_weight = date;
+  seqlock_write_end(record_lock(id));
 
-  fclose(f);
-  ESP_LOGI(TAG, "Data saved successfully to %s", DATA_FILE_PATH);
+  weight_series_t *s = weight_series_at(id);
+  bool kept = s && weight_series_append(s, date, grams) == ESP_OK;
+  if (!kept)
+    ESP_LOGW(TAG, "Weight history full, point not kept");
+
+  // The weight is no hot column: update its aggregates here
+  seqlock_write_begin(&tables_lock);
+  stats_row_set(&stats, id, r);
+  if (kept)
+    stats_weigh(&stats, id, r->species, date, grams);
+  seqlock_write_end(&tables_lock);
 }
 
-void db_init_demo_data(void) {
-  ESP_LOGI(TAG, "Initializing DEMO data...");
-  reptile_count = 0;
+static void apply_shed(int id, time_t date) {
+  seqlock_write_begin(record_lock(id));
+  reptile_at(id)->last_shed = date;
+  seqlock_write_end(record_lock(id));
+}
 
-  // 1. Python Royal
-  reptiles[0].id = 1;
-  strcpy(reptiles[0].name, "Nagini");
-  strcpy(reptiles[0].species_common, "Python Royal");
-  strcpy(reptiles[0].species_scientific, "Python regius");
-  strcpy(reptiles[0].morph, "Banana Pastel");
-  reptiles[0].species = SPECIES_SNAKE;
-  reptiles[0].sex = SEX_MALE;
-  reptiles[0].birth_year = 2022;
-  reptiles[0].weight_grams = 450;
-  reptiles[0].active = true;
-  strcpy(reptiles[0].microchip, "250269600123456");
-  reptiles[0].cites_annex = CITES_ANNEX_B;
-  reptiles[0].last_feeding = time(NULL) - (5 * 24 * 3600);
-  reptile_count++;
+static void txn_save_breeding(void); // See TRANSACTIONS
 
-  // 2. Gecko
-  reptiles[1].id = 2;
-  strcpy(reptiles[1].name, "Yoshi");
-  strcpy(reptiles[1].species_common, "Gecko Leo");
-  strcpy(reptiles[1].species_scientific, "Eublepharis m.");
-  strcpy(reptiles[1].morph, "Tangerine");
-  reptiles[1].species = SPECIES_LIZARD;
-  reptiles[1].sex = SEX_FEMALE;
-  reptiles[1].birth_year = 2021;
-  reptiles[1].weight_grams = 65;
-  reptiles[1].active = true;
-  reptiles[1].cites_annex = CITES_NOT_LISTED;
-  reptiles[1].last_feeding = time(NULL) - (2 * 24 * 3600);
-  reptile_count++;
+// Store clutch `index`, appending it if it is the next one
+static bool apply_breeding(uint32_t index, const breeding_record_t *record) {
+  if (index > breeding_table.count)
+    return false;
+  seqlock_write_begin(&tables_lock);
+  txn_save_breeding();
+  breeding_record_t *b = index == breeding_table.count
+                             ? arena_append(&breeding_table)
+                             : arena_at(&breeding_table, index);
+  if (b) {
+    *b = *record;
+    db_calendar_sync(index);
+  }
+  seqlock_write_end(&tables_lock);
+  return b != NULL;
+}
 
-  // 3. Boa
-  reptiles[2].id = 3;
-  strcpy(reptiles[2].name, "Kaa");
-  strcpy(reptiles[2].species_common, "Boa Constrictor");
-  strcpy(reptiles[2].species_scientific, "Boa imperator");
-  strcpy(reptiles[2].morph, "Hypo Jungle");
-  reptiles[2].species = SPECIES_SNAKE;
-  reptiles[2].sex = SEX_FEMALE;
-  reptiles[2].birth_year = 2019;
-  reptiles[2].weight_grams = 2100;
-  reptiles[2].active = true;
-  strcpy(reptiles[2].microchip, "250269600987654");
-  reptiles[2].cites_annex = CITES_ANNEX_B;
-  reptiles[2].last_feeding = time(NULL) - (10 * 24 * 3600);
-  reptile_count++;
+// Inventory edits take the stock copy meals take: an abort restores both
+static void apply_inventory_count(uint32_t count) {
+  seqlock_write_begin(&tables_lock);
+  txn_save_stock();
+  if (arena_resize(&inventory_table, count) != ESP_OK)
+    ESP_LOGE(TAG, "Inventory resize to %u failed", (unsigned)count);
+  seqlock_write_end(&tables_lock);
 }
 
-void db_load_data(void) {
-  FILE *f = fopen(DATA_FILE_PATH, "rb");
-  if (f == NULL) {
-    ESP_LOGW(TAG, "No saved data found, using defaults");
-    db_init_demo_data();
+static void apply_inventory_item(uint32_t index, const inventory_item_t *item) {
+  if (index >= inventory_table.count)
     return;
+  seqlock_write_begin(&tables_lock);
+  txn_save_stock();
+  *(inventory_item_t *)arena_at(&inventory_table, index) = *item;
+  seqlock_write_end(&tables_lock);
+}
+
+// Make `index` a valid slot, appending a zeroed record if it is the next one
+static reptile_t *patch_target(uint16_t index) {
+  if (index == reptile_table.count) {
+    seqlock_write_begin(&tables_lock);
+    arena_append(&reptile_table);
+    seqlock_write_end(&tables_lock);
+  }
+  return reptile_at(index);
+}
+
+// Store the values of a field patch into `r`
+static void patch_fields(const journal_fields_t *patch, uint16_t length,
+                         reptile_t *r) {
+  const table_schema_t *t = schema_table(SECTION_REPTILES);
+  const uint8_t *p = (const uint8_t *)patch;
+  size_t pos = sizeof(*patch);
+
+  for (int i = 0; i < patch->count; i++) {
+    journal_field_value_t v;
+    if (pos + sizeof(v) > length)
+      return;
+    memcpy(&v, p + pos, sizeof(v));
+    pos += sizeof(v);
+    if (pos + v.width > length)
+      return;
+    const field_desc_t *f = schema_field(t, v.tag);
+    if (f)
+      schema_store_field(f, r, p + pos, v.width,
+                         f->kind == FIELD_STRREF ? FIELD_STR : f->kind);
+    pos += v.width;
   }
+}
 
-  data_header_t header;
-  fread(&header, sizeof(data_header_t), 1, f);
+static void apply_fields(const journal_fields_t *patch, uint16_t length) {
+  reptile_t *r = patch_target(patch->index);
+  if (r == NULL)
+    return;
+  patch_fields(patch, length, r);
+  if (r->mod_seq > max_mod_seq)
+    max_mod_seq = r->mod_seq;
+  db_hot_sync(patch->index);
+}
 
-  if (header.magic != DATA_MAGIC) {
-    ESP_LOGE(TAG, "Invalid data file format");
-    fclose(f);
-    db_init_demo_data();
+// Schema v2 journals patched raw struct bytes: rebuild the raw v2 record,
+// patch it, and store the fields back through the frozen layout.
+static void apply_raw_patch(const journal_field_t *patch) {
+  static uint8_t raw[SCHEMA_V2_REPTILE_SIZE];
+  const table_schema_t *t = schema_table(SECTION_REPTILES);
+  const table_schema_t *rt = schema_raw_v2(SECTION_REPTILES);
+  if ((size_t)patch->offset + patch->length > sizeof(raw))
     return;
+  reptile_t *r = patch_target(patch->index);
+  if (r == NULL)
+    return;
+
+  memset(raw, 0, sizeof(raw));
+  for (int i = 0; i < rt->field_count; i++) {
+    const field_desc_t *f = schema_field(t, rt->fields[i].tag);
+    if (f)
+      schema_store_field(&rt->fields[i], raw, (const uint8_t *)r + f->offset,
+                         f->size, f->kind);
+  }
+  memcpy(raw + patch->offset, patch->data, patch->length);
+  for (int i = 0; i < rt->field_count; i++) {
+    const field_desc_t *f = schema_field(t, rt->fields[i].tag);
+    if (f)
+      schema_store_field(f, r, raw + rt->fields[i].offset,
+                         rt->fields[i].size, rt->fields[i].kind);
+  }
+  db_hot_sync(patch->index);
+}
+
+static void journal_apply(journal_rec_type_t type, const void *payload,
+                          uint16_t length) {
+  switch (type) {
+  case JOURNAL_REC_FEEDING: {
+    const journal_feeding_t *rec = payload;
+    bool accepted = length == offsetof(journal_feeding_t, accepted);
+    if ((accepted || length == sizeof(*rec)) &&
+        rec->index < reptile_table.count) {
+      char prey[sizeof(rec->prey_type) + 1];
+      memcpy(prey, rec->prey_type, sizeof(rec->prey_type));
+      prey[sizeof(rec->prey_type)] = '\0';
+      apply_feeding(rec->index, (time_t)rec->timestamp, prey, rec->prey_count,
+                    accepted || rec->accepted);
+    }
+    break;
+  }
+  case JOURNAL_REC_WEIGHT: {
+    const journal_weight_t *rec = payload;
+    if (length == sizeof(*rec) && rec->index < reptile_table.count)
+      apply_weight(rec->index, (time_t)rec->timestamp, rec->grams);
+    break;
+  }
+  case JOURNAL_REC_SHED: {
+    const journal_shed_t *rec = payload;
+    if (length == sizeof(*rec) && rec->index < reptile_table.count)
+      apply_shed(rec->index, (time_t)rec->timestamp);
+    break;
+  }
+  case JOURNAL_REC_HEALTH: {
+    const journal_health_t *rec = payload;
+    if (length == sizeof(*rec) && rec->index < reptile_table.count) {
+      char type_buf[sizeof(rec->event_type) + 1];
+      char desc_buf[sizeof(rec->description) + 1];
+      memcpy(type_buf, rec->event_type, sizeof(rec->event_type));
+      type_buf[sizeof(rec->event_type)] = '\0';
+      memcpy(desc_buf, rec->description, sizeof(rec->description));
+      desc_buf[sizeof(rec->description)] = '\0';
+      apply_health(rec->index, (time_t)rec->timestamp, type_buf, desc_buf);
+    }
+    break;
+  }
+  case JOURNAL_REC_FIELD: {
+    const journal_field_t *rec = payload;
+    if (length >= sizeof(*rec) && length == sizeof(*rec) + rec->length)
+      apply_raw_patch(rec);
+    break;
+  }
+  case JOURNAL_REC_FIELDS:
+    if (length >= sizeof(journal_fields_t))
+      apply_fields(payload, length);
+    break;
+  case JOURNAL_REC_BREEDING: {
+    const journal_breeding_t *rec = payload;
+    if (length == sizeof(*rec)) {
+      breeding_record_t b = {.id = rec->id,
+                             .female_id = rec->female_id,
+                             .male_id = rec->male_id,
+                             .pairing_date = (time_t)rec->pairing_date,
+                             .laying_date = (time_t)rec->laying_date,
+                             .egg_count = rec->egg_count,
+                             .hatch_date = (time_t)rec->hatch_date,
+                             .hatched_count = rec->hatched_count,
+                             .active = rec->active};
+      apply_breeding(rec->index, &b);
+    }
+    break;
+  }
+  case JOURNAL_REC_INVENTORY: {
+    const journal_inventory_t *rec = payload;
+    if (length == sizeof(*rec)) {
+      inventory_item_t it = {.quantity = rec->quantity,
+                             .alert_threshold = rec->alert_threshold};
+      memcpy(it.name, rec->name, sizeof(it.name));
+      memcpy(it.unit, rec->unit, sizeof(it.unit));
+      apply_inventory_item(rec->index, &it);
+    }
+    break;
+  }
+  case JOURNAL_REC_INVENTORY_COUNT: {
+    const journal_inventory_count_t *rec = payload;
+    if (length == sizeof(*rec) && rec->count <= MAX_INVENTORY_ITEMS)
+      apply_inventory_count(rec->count);
+    break;
+  }
+  case JOURNAL_REC_BATCH: {
+    const uint8_t *p = payload;
+    journal_batch_entry_t e;
+    for (size_t pos = 0; pos + sizeof(e) <= length; pos += e.length) {
+      memcpy(&e, p + pos, sizeof(e));
+      pos += sizeof(e);
+      if (pos + e.length > length)
+        break;
+      if (e.type != JOURNAL_REC_BATCH)
+        journal_apply((journal_rec_type_t)e.type, p + pos, e.length);
+    }
+    break;
+  }
+  default:
+    ESP_LOGW(TAG, "Unknown journal record type %d", type);
+    break;
+  }
+}
+
+// Queue a journal record for the save task (called under DB_LOCK)
+static void db_journal_queue(journal_rec_type_t type, const void *payload,
+                             uint16_t length) {
+  size_t n =
+      journal_encode(type, payload, length, pending_journal + pending_len,
+                     sizeof(pending_journal) - pending_len);
+  if (n == 0) {
+    // Queue full: the next snapshot will capture everything instead
+    snapshot_dirty = true;
+    pending_len = 0;
+  } else {
+    pending_len += n;
   }
+}
 
-  reptile_count = header.reptile_count;
-  feeding_count = header.feeding_count;
-  health_record_count = header.health_count;
-  breeding_count = header.breeding_count;
-  inventory_count = header.inventory_count;
+// Stamp a changed slot for the incremental export; call before journaling
+// it, so the stamp is journaled with the other fields
+static void db_stamp_reptile(const reptile_t *before, reptile_t *after) {
+  const table_schema_t *t = schema_table(SECTION_REPTILES);
+  after->mod_seq = before->mod_seq;
+  for (int i = 0; i < t->field_count; i++) {
+    const field_desc_t *f = &t->fields[i];
+    if (memcmp((const uint8_t *)before + f->offset,
+               (const uint8_t *)after + f->offset, f->size) != 0) {
+      after->mod_seq = ++max_mod_seq;
+      return;
+    }
+  }
+}
 
-  if (reptile_count > 0)
-    fread(reptiles, sizeof(reptile_t), reptile_count, f);
-  if (feeding_count > 0)
-    fread(feedings, sizeof(feeding_record_t), feeding_count, f);
-  if (health_record_count > 0)
-    fread(health_records, sizeof(health_record_t), health_record_count, f);
-  if (breeding_count > 0)
-    fread(breedings, sizeof(breeding_record_t), breeding_count, f);
-  if (inventory_count > 0)
-    fread(inventory, sizeof(inventory_item_t), inventory_count, f);
+// Encode the fields that differ between two versions of a slot, by tag, so
+// the patch stays valid across struct layout changes. Returns its length in
+// `buf` (JOURNAL_MAX_PAYLOAD bytes), 0 if nothing differs.
+static size_t db_encode_patch(int index, const reptile_t *before,
+                              const reptile_t *after, uint8_t *buf) {
+  const table_schema_t *t = schema_table(SECTION_REPTILES);
+  journal_fields_t *patch = (journal_fields_t *)buf;
+  size_t len = sizeof(*patch);
 
-  fclose(f);
-  ESP_LOGI(TAG, "Data loaded safely. %d reptiles.", reptile_count);
+  patch->index = (uint16_t)index;
+  patch->count = 0;
+  patch->reserved = 0;
+  for (int i = 0; i < t->field_count; i++) {
+    const field_desc_t *f = &t->fields[i];
+    if (memcmp((const uint8_t *)before + f->offset,
+               (const uint8_t *)after + f->offset, f->size) == 0)
+      continue;
+    journal_field_value_t v = {.tag = f->tag, .width = f->size};
+    if (f->kind == FIELD_STRREF) {
+      // Journal the text: replay must not depend on handle numbering
+      str_ref_t ref;
+      memcpy(&ref, (const uint8_t *)after + f->offset, sizeof(ref));
+      const char *text = lookup(ref);
+      v.width = strlen(text);
+      memcpy(buf + len + sizeof(v), text, v.width);
+    } else {
+      schema_encode_field(f, after, buf + len + sizeof(v));
+    }
+    memcpy(buf + len, &v, sizeof(v));
+    len += sizeof(v) + v.width;
+    patch->count++;
+  }
+  return patch->count > 0 ? len : 0;
 }
 
 // ====================================================================================
-// HELPERS
+// TRANSACTIONS
 // ====================================================================================
+// Every modifier runs in a transaction: it holds DB_LOCK, its journal
+// records are queued as one batch record, and the save task is kicked once
+// at the end. db_txn_begin()/db_txn_commit() widen that to several
+// modifiers.
+//
+// The first time a transaction changes a reptile slot, the slot is copied.
+// On commit the copies become field patches back to the old values, in the
+// journal's FIELDS encoding, pushed as one group on the undo log. Undo
+// applies such a group through the regular update path, so it is journaled
+// and exported like any edit. Feedings, health records and weigh-ins are
+// history: undo restores the animal's fields, but events already recorded
+// stay in its history.
+//
+// Abort is a rollback instead: nothing of the transaction was journaled or
+// logged yet, so its batch and audit entries are dropped and everything it
+// changed is put back in place. Appends (history, weigh-ins, new slots) are
+// cut back to their size at db_txn_begin(), and the aggregates, stock and
+// forecast restored from copies taken then, or at the first meal.
 
-const char *db_cites_annex_to_string(cites_annex_t annex) {
-  switch (annex) {
-  case CITES_ANNEX_A:
-    return "A";
-  case CITES_ANNEX_B:
-    return "B";
-  case CITES_ANNEX_C:
-    return "C";
-  case CITES_ANNEX_D:
-    return "D";
-  default:
-    return "Non listé";
+#define TXN_MAX_SLOTS 16 // Slots a transaction can change and stay undoable
+#define UNDO_DEPTH 16    // Undoable transactions kept
+
+typedef struct {
+  uint8_t *patches; // uint16_t length, then a journal_fields_t patch
+  size_t len;
+} undo_group_t;
+
+static reptile_t *txn_before = NULL; // TXN_MAX_SLOTS copies
+static uint16_t txn_slots[TXN_MAX_SLOTS];
+static bool txn_added[TXN_MAX_SLOTS]; // Slot appended by the transaction
+static stats_row_t txn_rows[TXN_MAX_SLOTS]; // Statistics row of each slot
+static uint32_t txn_weights[TXN_MAX_SLOTS]; // Weigh-ins of each slot
+static int txn_count = 0;
+static bool txn_untracked = false; // Changed too many slots to undo
+static bool txn_aborted = false;   // An inner db_txn_abort(): revert all
+static bool txn_undoing = false;   // db_undo() running: push no group
+
+static uint8_t txn_batch[JOURNAL_MAX_PAYLOAD];
+static size_t txn_batch_len = 0;
+static int txn_batch_count = 0;
+static bool txn_batch_full = false;
+
+// What an abort puts back besides the slots
+static struct {
+  uint32_t reptiles; // Table sizes at db_txn_begin()
+  uint32_t feedings;
+  uint32_t healths;
+  uint32_t next_id;
+  stats_summary_t stats;
+  bool stock_saved;        // Copies below taken for this transaction
+  inventory_item_t *stock; // Kept between transactions
+  uint32_t stock_count;
+  forecast_prey_t *prey;
+  uint32_t prey_count;
+  bool breeding_saved; // Same, before the first clutch edit
+  breeding_record_t *breeding;
+  uint32_t breeding_count;
+} txn_base;
+
+static undo_group_t undo_log[UNDO_DEPTH]; // Ring, newest before undo_top
+static int undo_top = 0;
+static int undo_count = 0;
+
+// Add a journal record to the transaction's batch (called in a transaction)
+static void db_journal(journal_rec_type_t type, const void *payload,
+                       uint16_t length) {
+  journal_batch_entry_t e = {.type = (uint8_t)type, .length = length};
+  if (txn_batch_full ||
+      txn_batch_len + sizeof(e) + length > sizeof(txn_batch)) {
+    txn_batch_full = true; // Too big for one record: snapshot instead
+    return;
   }
+  memcpy(txn_batch + txn_batch_len, &e, sizeof(e));
+  memcpy(txn_batch + txn_batch_len + sizeof(e), payload, length);
+  txn_batch_len += sizeof(e) + length;
+  txn_batch_count++;
 }
 
-const char *db_exit_reason_to_string(exit_reason_t reason) {
-  switch (reason) {
-  case EXIT_SOLD:
-    return "Vente";
-  case EXIT_DONATED:
-    return "Don";
-  case EXIT_DECEASED:
-    return "Décès";
-  case EXIT_ESCAPED:
-    return "Évasion";
-  case EXIT_CONFISCATED:
-    return "Confiscation";
-  default:
-    return "";
+// Queue the batch for the save task; a lone record is queued as itself
+static void txn_flush(void) {
+  journal_batch_entry_t e;
+  if (txn_batch_full) {
+    snapshot_dirty = true;
+  } else if (txn_batch_count == 1) {
+    memcpy(&e, txn_batch, sizeof(e));
+    db_journal_queue((journal_rec_type_t)e.type, txn_batch + sizeof(e),
+                     e.length);
+  } else if (txn_batch_count > 1) {
+    db_journal_queue(JOURNAL_REC_BATCH, txn_batch, txn_batch_len);
   }
+  txn_batch_len = 0;
+  txn_batch_count = 0;
+  txn_batch_full = false;
 }
 
-static void format_date(time_t timestamp, char *buf, size_t len) {
-  if (timestamp == 0) {
-    buf[0] = '\0';
+// Keep slot `index` as it is before the transaction changes it. Call before
+// the change; the next slot of the table for an append.
+static void txn_touch(uint32_t index) {
+  for (int i = 0; i < txn_count; i++)
+    if (txn_slots[i] == index)
+      return;
+  if (txn_before == NULL)
+    txn_before = malloc(TXN_MAX_SLOTS * sizeof(*txn_before));
+  if (txn_before == NULL || txn_count == TXN_MAX_SLOTS) {
+    txn_untracked = true;
     return;
   }
-  struct tm *tm_info = localtime(&timestamp);
-  strftime(buf, len, "%Y-%m-%d", tm_info);
+  const reptile_t *r = reptile_at(index);
+  txn_added[txn_count] = r == NULL;
+  if (r)
+    txn_before[txn_count] = *r;
+  txn_rows[txn_count] =
+      index < stats.count ? stats.rows[index] : (stats_row_t){0};
+  const weight_series_t *s =
+      index < weight_table.count ? arena_at(&weight_table, index) : NULL;
+  txn_weights[txn_count] = s ? s->count : 0;
+  txn_slots[txn_count++] = index;
 }
 
-esp_err_t db_export_csv(const char *filepath) {
-  ESP_LOGI(TAG, "Exporting registre to CSV: %s", filepath);
+static void txn_save_base(void) {
+  txn_base.reptiles = reptile_table.count;
+  txn_base.feedings = feeding_table.count;
+  txn_base.healths = health_table.count;
+  txn_base.next_id = next_reptile_id;
+  txn_base.stats = stats.summary;
+  txn_base.stock_saved = false;
+  txn_base.breeding_saved = false;
+}
 
-  FILE *f = fopen(filepath, "w");
-  if (!f) {
-    ESP_LOGE(TAG, "Failed to create CSV file: %s", filepath);
-    return ESP_ERR_NOT_FOUND;
+// Copy the stock and the forecast before the first meal of a transaction
+// takes from them (called under tables_lock)
+static void txn_save_stock(void) {
+  if (txn_depth == 0 || txn_base.stock_saved || txn_untracked)
+    return;
+  inventory_item_t *stock =
+      realloc(txn_base.stock, (inventory_table.count + 1) * sizeof(*stock));
+  if (stock)
+    txn_base.stock = stock;
+  forecast_prey_t *prey =
+      realloc(txn_base.prey, (forecast.count + 1) * sizeof(*prey));
+  if (prey)
+    txn_base.prey = prey;
+  if (stock == NULL || prey == NULL) {
+    txn_untracked = true; // Cannot abort without them
+    return;
+  }
+  for (uint32_t i = 0; i < inventory_table.count; i++)
+    stock[i] = *(const inventory_item_t *)arena_at(&inventory_table, i);
+  memcpy(prey, forecast.prey, forecast.count * sizeof(*prey));
+  txn_base.stock_count = inventory_table.count;
+  txn_base.prey_count = forecast.count;
+  txn_base.stock_saved = true;
+}
+
+// Copy the clutches before the first edit of a transaction (called under
+// tables_lock)
+static void txn_save_breeding(void) {
+  if (txn_depth == 0 || txn_base.breeding_saved || txn_untracked)
+    return;
+  breeding_record_t *b = realloc(txn_base.breeding,
+                                 (breeding_table.count + 1) * sizeof(*b));
+  if (b == NULL) {
+    txn_untracked = true;
+    return;
   }
+  txn_base.breeding = b;
+  for (uint32_t i = 0; i < breeding_table.count; i++)
+    b[i] = *(const breeding_record_t *)arena_at(&breeding_table, i);
+  txn_base.breeding_count = breeding_table.count;
+  txn_base.breeding_saved = true;
+}
 
-  // CSV Header
-  fprintf(f,
-          "ID,UUID,Nom,Espece_Commune,Espece_Scientifique,Identification,Sexe,"
-          "Date_Naissance,Naissance_Estimee,CITES_Annexe,CITES_Permis,"
-          "Date_Entree,Provenance,Pays_Origine,Eleveur_Nom,Ne_Captivite,"
-          "Date_Sortie,Motif_Sortie,Destinataire_Nom,Destinataire_Adresse,"
-          "Poids_Grammes,Actif\n");
+// Take the records a transaction appended to a table back off their
+// animals' chains, newest first, down to `count`
+static void history_truncate(const history_t *h, uint32_t count) {
+  while (h->records->count > count) {
+    uint32_t seq = h->records->count - 1;
+    const uint32_t *link = arena_at(h->links, seq);
+    history_head_t *head = history_head(history_animal(h, seq));
+    if (link && head && *chain_head(&head->all, h->feeding) == seq + 1) {
+      *chain_head(&head->all, h->feeding) = *link;
+      (*chain_count(&head->all, h->feeding))--;
+    }
+    arena_resize(h->records, seq);
+    arena_resize(h->links, seq);
+  }
+}
 
-  char date_birth[16], date_acq[16], date_exit[16];
+// Put back everything the transaction changed, journaling nothing
+static void txn_rollback(void) {
+  seqlock_write_begin(&tables_lock);
+  history_truncate(&feedings, txn_base.feedings);
+  history_truncate(&healths, txn_base.healths);
+  for (int i = 0; i < txn_count; i++) {
+    uint32_t index = txn_slots[i];
+    if (txn_added[i])
+      continue; // Cut off with the table below
+    db_index_remove(index);
+    seqlock_write_begin(record_lock(index));
+    *reptile_at(index) = txn_before[i];
+    seqlock_write_end(record_lock(index));
+    db_index_add(index);
+    weight_series_t *s = weight_series_at(index);
+    if (s && s->count > txn_weights[i] &&
+        weight_series_truncate(s, txn_weights[i]) != ESP_OK)
+      ESP_LOGE(TAG, "Weight history of slot %u lost on abort",
+               (unsigned)index);
+  }
+  if (reptile_table.count > txn_base.reptiles) {
+    arena_resize(&reptile_table, txn_base.reptiles);
+    db_weights_truncate(txn_base.reptiles);
+    stats_resize(&stats, txn_base.reptiles);
+    next_reptile_id = txn_base.next_id; // Never seen outside
+    db_index_rebuild();
+  } else if (hot_table_needs_compaction(&hot)) {
+    db_index_rebuild();
+  }
 
-  for (int i = 0; i < reptile_count; i++) {
-    reptile_t *r = &reptiles[i];
+  // Every row is back as it was, so are the aggregates
+  for (int i = 0; i < txn_count; i++)
+    if (!txn_added[i] && txn_slots[i] < stats.count)
+      stats.rows[txn_slots[i]] = txn_rows[i];
+  stats.summary = txn_base.stats;
+  if (txn_base.stock_saved) {
+    arena_resize(&inventory_table, txn_base.stock_count);
+    for (uint32_t i = 0; i < txn_base.stock_count; i++)
+      *(inventory_item_t *)arena_at(&inventory_table, i) = txn_base.stock[i];
+    forecast.count = txn_base.prey_count; // Only ever grows
+    memcpy(forecast.prey, txn_base.prey,
+           txn_base.prey_count * sizeof(*forecast.prey));
+  }
+  if (txn_base.breeding_saved) {
+    arena_resize(&breeding_table, txn_base.breeding_count);
+    for (uint32_t i = 0; i < txn_base.breeding_count; i++)
+      *(breeding_record_t *)arena_at(&breeding_table, i) =
+          txn_base.breeding[i];
+    db_calendar_rebuild();
+  }
+  seqlock_write_end(&tables_lock);
+}
 
-    if (r->birth_year > 0) {
-      snprintf(date_birth, sizeof(date_birth), "%04d-%02d-%02d", r->birth_year,
-               r->birth_month ? r->birth_month : 1,
-               r->birth_day ? r->birth_day : 1);
+// Patches taking every touched slot back to its copy. An appended slot is
+// soft-deleted instead: slots are never removed.
+static bool txn_undo_group(undo_group_t *g) {
+  static reptile_t target;
+  static uint8_t patch[JOURNAL_MAX_PAYLOAD];
+  *g = (undo_group_t){0};
+  for (int i = 0; i < txn_count; i++) {
+    const reptile_t *r = reptile_at(txn_slots[i]);
+    if (r == NULL)
+      continue;
+    if (txn_added[i]) {
+      target = *r;
+      target.active = false;
     } else {
-      date_birth[0] = '\0';
-    }
-    format_date(r->date_acquisition, date_acq, sizeof(date_acq));
-    format_date(r->date_exit, date_exit, sizeof(date_exit));
-
-    fprintf(f,
-            "%d,\"%s\",\"%s\",\"%s\",\"%s\",\"%s\",%s,"
-            "%s,%s,%s,\"%s\","
-            "%s,\"%s\",\"%s\",\"%s\",%s,"
-            "%s,%s,\"%s\",\"%s\","
-            "%d,%s\n",
-            r->id, r->uuid, r->name, r->species_common, r->species_scientific,
-            r->microchip,
-            (r->sex == SEX_MALE)     ? "M"
-            : (r->sex == SEX_FEMALE) ? "F"
-                                     : "?",
-            date_birth, r->birth_estimated ? "Oui" : "Non",
-            db_cites_annex_to_string(r->cites_annex), r->cites_permit, date_acq,
-            r->origin, r->origin_country, r->breeder_name,
-            r->captive_bred ? "Oui" : "Non", date_exit,
-            db_exit_reason_to_string(r->exit_reason), r->recipient_name,
-            r->recipient_address, r->weight_grams, r->active ? "Oui" : "Non");
+      target = txn_before[i];
+    }
+    uint16_t len = db_encode_patch(txn_slots[i], r, &target, patch);
+    if (len == 0)
+      continue;
+    uint8_t *p = realloc(g->patches, g->len + sizeof(len) + len);
+    if (p == NULL) {
+      free(g->patches);
+      return false;
+    }
+    memcpy(p + g->len, &len, sizeof(len));
+    memcpy(p + g->len + sizeof(len), patch, len);
+    g->patches = p;
+    g->len += sizeof(len) + len;
   }
+  return true;
+}
 
-  fclose(f);
-  ESP_LOGI(TAG, "Registre exported: %d animals to %s", reptile_count, filepath);
-  return ESP_OK;
+static void db_replace_reptile(int index, const reptile_t *data);
+
+static void undo_apply(const undo_group_t *g) {
+  static reptile_t r;
+  uint16_t len;
+  for (size_t pos = 0; pos + sizeof(len) <= g->len; pos += len) {
+    memcpy(&len, g->patches + pos, sizeof(len));
+    pos += sizeof(len);
+    const journal_fields_t *patch = (const void *)(g->patches + pos);
+    r = *reptile_at(patch->index);
+    patch_fields(patch, len, &r);
+    db_replace_reptile(patch->index, &r);
+  }
+}
+
+static void undo_push(const undo_group_t *g) {
+  undo_group_t *slot = &undo_log[undo_top];
+  free(slot->patches); // Oldest group once the ring is full
+  *slot = *g;
+  undo_top = (undo_top + 1) % UNDO_DEPTH;
+  if (undo_count < UNDO_DEPTH)
+    undo_count++;
+}
+
+static void undo_clear(void) {
+  for (int i = 0; i < UNDO_DEPTH; i++) {
+    free(undo_log[i].patches);
+    undo_log[i] = (undo_group_t){0};
+  }
+  undo_top = 0;
+  undo_count = 0;
+}
+
+// Close the outermost transaction
+static void txn_end(bool revert) {
+  undo_group_t g = {0};
+  if (revert && txn_untracked) {
+    ESP_LOGE(TAG, "Transaction too large to abort, changes kept");
+    revert = false;
+  }
+  bool undoable = !txn_untracked && (revert || txn_undo_group(&g));
+  if (revert) {
+    txn_rollback();
+    txn_batch_count = 0; // Nothing of it reaches the journal
+    txn_batch_full = false;
+  }
+  txn_flush();
+  db_audit_end(!revert);
+
+  if (!undoable) {
+    if (!txn_undoing)
+      undo_clear(); // Older groups would skip over this change
+  } else if (g.len > 0 && !revert && !txn_undoing) {
+    undo_push(&g);
+  } else {
+    free(g.patches);
+  }
+  txn_count = 0;
+  txn_untracked = false;
+  txn_aborted = false;
+  txn_undoing = false;
+}
+
+void db_txn_begin(void) {
+  DB_LOCK();
+  if (txn_depth++ == 0)
+    txn_save_base();
+}
+
+static void txn_finish(bool abort) {
+  if (txn_depth == 0) {
+    ESP_LOGE(TAG, "Transaction end without begin");
+    return;
+  }
+  txn_aborted |= abort;
+  bool outermost = txn_depth == 1;
+  if (outermost)
+    txn_end(txn_aborted);
+  txn_depth--;
+  DB_UNLOCK();
+  if (outermost)
+    db_kick_save();
+}
+
+void db_txn_commit(void) { txn_finish(false); }
+
+void db_txn_abort(void) { txn_finish(true); }
+
+int db_undo_count(void) { return undo_count; }
+
+bool db_undo(void) {
+  db_txn_begin();
+  bool done = undo_count > 0 && txn_depth == 1; // Not inside a transaction
+  if (done) {
+    undo_top = (undo_top + UNDO_DEPTH - 1) % UNDO_DEPTH;
+    undo_count--;
+    undo_group_t g = undo_log[undo_top];
+    undo_log[undo_top] = (undo_group_t){0};
+    txn_undoing = true;
+    undo_apply(&g);
+    free(g.patches);
+  }
+  db_txn_commit();
+  return done;
 }
 
 // ====================================================================================
-// MODIFIERS (MVC)
+// MODIFIERS
 // ====================================================================================
 
+// Journal the changes between two versions of a slot
+static void db_journal_reptile(int index, const reptile_t *before,
+                               const reptile_t *after) {
+  static uint8_t buf[JOURNAL_MAX_PAYLOAD];
+  size_t len = db_encode_patch(index, before, after, buf);
+  if (len > 0) {
+    db_audit_reptile(before, after);
+    db_journal(JOURNAL_REC_FIELDS, buf, len);
+  }
+}
+
+// Overwrite an existing slot (called in a transaction)
+static void db_replace_reptile(int index, const reptile_t *data) {
+  static reptile_t before;
+  reptile_t *r = reptile_at(index);
+  before = *r;
+  db_index_remove(index);
+  seqlock_write_begin(record_lock(index));
+  *r = *data;
+  db_stamp_reptile(&before, r);
+  seqlock_write_end(record_lock(index));
+  db_index_add(index);
+  if (hot_table_needs_compaction(&hot))
+    db_index_rebuild();
+  db_journal_reptile(index, &before, r);
+}
+
 void db_update_reptile(int id, reptile_t *data) {
-  if (id >= 0 && id < MAX_REPTILES) {
-    if (id >= reptile_count) {
-      // Adding new
-      reptiles[reptile_count] = *data;
-      reptiles[reptile_count].id = reptile_count + 1; // Basic ID gen
-      reptile_count++;
-    } else {
-      // Updating existing
-      // Preserve ID? Or assume *data has it.
-      // We generally assume *data has proper content, but ID should be
-      // immutable or strictly managed. Copy content
-      reptiles[id] = *data;
+  static const reptile_t empty;
+
+  db_txn_begin();
+  if (id < 0 || (uint32_t)id >= reptile_table.count) {
+    // Adding new: readers see the row once it is complete
+    txn_touch(reptile_table.count);
+    seqlock_write_begin(&tables_lock);
+    reptile_t *r = arena_append(&reptile_table);
+    if (r) {
+      int index = reptile_table.count - 1;
+      *r = *data;
+      r->id = db_get_reptile_next_id();
+      next_reptile_id = r->id + 1;
+      if (r->uuid[0] == '\0')
+        db_new_uuid(r->uuid);
+      db_stamp_reptile(&empty, r);
+      db_index_add(index);
+      db_journal_reptile(index, &empty, r);
     }
-    db_save_data();
+    seqlock_write_end(&tables_lock);
+  } else {
+    // Updating existing
+    // Preserve ID? Or assume *data has it.
+    // We generally assume *data has proper content, but ID should be
+    // immutable or strictly managed. Copy content
+    txn_touch(id);
+    db_replace_reptile(id, data);
   }
+  db_txn_commit();
 }
 
 void db_delete_reptile(int id) {
-  if (id >= 0 && id < reptile_count) {
-    reptiles[id].active = false; // Soft delete
-    db_save_data();
+  static reptile_t before;
+
+  db_txn_begin();
+  if (id < 0 || (uint32_t)id >= reptile_table.count) {
+    db_txn_commit();
+    return;
   }
+  txn_touch(id);
+  reptile_t *r = reptile_at(id);
+  before = *r;
+  seqlock_write_begin(record_lock(id));
+  r->active = false; // Soft delete
+  db_stamp_reptile(&before, r);
+  seqlock_write_end(record_lock(id));
+  db_hot_sync(id);
+  db_journal_reptile(id, &before, r);
+  db_txn_commit();
 }
 
-void db_record_feeding(int id, time_t date, const char *prey, int qty) {
-  if (id >= 0 && id < reptile_count) {
-    reptiles[id].last_feeding = date;
-
-    // Add history record (if space)
-    if (feeding_count < MAX_FEEDINGS) {
-      feedings[feeding_count].animal_id = reptiles[id].id;
-      feedings[feeding_count].timestamp = date;
-      if (prey) {
-        strncpy(feedings[feeding_count].prey_type, prey,
-                sizeof(feedings[feeding_count].prey_type) - 1);
-      } else {
-        feedings[feeding_count].prey_type[0] = '\0';
-      }
-      feedings[feeding_count].prey_count = (uint8_t)qty;
-      feedings[feeding_count].accepted = true;
-      feeding_count++;
-    }
-    db_save_data();
+// The table size is read under the lock: it may shrink between an unlocked
+// check and db_txn_begin()
+esp_err_t db_record_feeding(int id, time_t date, const char *prey, int qty,
+                            bool accepted) {
+  // The history, the journal, the stock and the forecast all take this count
+  if (qty < 1 || qty > MAX_PREY_COUNT) {
+    ESP_LOGW(TAG, "Feeding of %d prey rejected (1 to %d)", qty,
+             MAX_PREY_COUNT);
+    return ESP_ERR_INVALID_ARG;
+  }
+  db_txn_begin();
+  if (id < 0 || (uint32_t)id >= reptile_table.count) {
+    db_txn_commit();
+    return ESP_ERR_INVALID_ARG;
   }
+  journal_feeding_t rec = {.index = (uint16_t)id,
+                           .timestamp = date,
+                           .prey_count = (uint8_t)qty,
+                           .accepted = accepted};
+  if (prey)
+    strncpy(rec.prey_type, prey, sizeof(rec.prey_type) - 1);
+  txn_touch(id);
+  apply_feeding(id, date, prey, qty, accepted);
+  db_journal(JOURNAL_REC_FEEDING, &rec, sizeof(rec));
+  db_txn_commit();
+  return ESP_OK;
 }
 
 void db_record_shed(int id, time_t date) {
-  if (id >= 0 && id < reptile_count) {
-    reptiles[id].last_shed = date;
-    db_save_data();
+  db_txn_begin();
+  if (id < 0 || (uint32_t)id >= reptile_table.count) {
+    db_txn_commit();
+    return;
   }
+  journal_shed_t rec = {.index = (uint16_t)id, .timestamp = date};
+  txn_touch(id);
+  apply_shed(id, date);
+  db_journal(JOURNAL_REC_SHED, &rec, sizeof(rec));
+  db_txn_commit();
 }
 
-void db_record_weight(int id, time_t date, int grams) {
-  if (id >= 0 && id < reptile_count) {
-    reptiles[id].weight_grams = grams;
-    db_save_data();
+// Journal clutch `index` as it now is (called in a transaction)
+static void db_journal_breeding(uint32_t index) {
+  const breeding_record_t *b = arena_at(&breeding_table, index);
+  journal_breeding_t rec = {.index = (uint16_t)index,
+                            .id = b->id,
+                            .female_id = b->female_id,
+                            .male_id = b->male_id,
+                            .pairing_date = b->pairing_date,
+                            .laying_date = b->laying_date,
+                            .hatch_date = b->hatch_date,
+                            .egg_count = b->egg_count,
+                            .hatched_count = b->hatched_count,
+                            .active = b->active};
+  db_journal(JOURNAL_REC_BREEDING, &rec, sizeof(rec));
+}
+
+int db_add_breeding(breeding_record_t *record) {
+  db_txn_begin();
+  int index = (int)breeding_table.count;
+  if (apply_breeding(index, record))
+    db_journal_breeding(index);
+  else
+    index = -1;
+  db_txn_commit();
+  return index;
+}
+
+void db_update_breeding(int index, const breeding_record_t *record) {
+  db_txn_begin();
+  if (index < 0 || (uint32_t)index >= breeding_table.count) {
+    db_txn_commit();
+    return;
+  }
+  apply_breeding(index, record);
+  db_journal_breeding(index);
+  db_txn_commit();
+}
+
+void db_set_inventory_count(int count) {
+  journal_inventory_count_t rec = {
+      .count = (uint16_t)(count < 0                     ? 0
+                          : count > MAX_INVENTORY_ITEMS ? MAX_INVENTORY_ITEMS
+                                                        : count)};
+  db_txn_begin();
+  apply_inventory_count(rec.count);
+  db_journal(JOURNAL_REC_INVENTORY_COUNT, &rec, sizeof(rec));
+  db_txn_commit();
+}
+
+void db_set_inventory_item(int index, const inventory_item_t *item) {
+  db_txn_begin();
+  if (index < 0 || (uint32_t)index >= inventory_table.count) {
+    db_txn_commit();
+    return;
+  }
+  journal_inventory_t rec = {.index = (uint16_t)index,
+                             .quantity = item->quantity,
+                             .alert_threshold = item->alert_threshold};
+  memcpy(rec.name, item->name, sizeof(rec.name));
+  memcpy(rec.unit, item->unit, sizeof(rec.unit));
+  apply_inventory_item(index, item);
+  db_journal(JOURNAL_REC_INVENTORY, &rec, sizeof(rec));
+  db_txn_commit();
+}
+
+esp_err_t db_record_weight(int id, time_t date, int grams) {
+  if (grams < 0 || grams > MAX_WEIGHT_GRAMS) {
+    ESP_LOGW(TAG, "Weight of %d g rejected (0 to %d)", grams,
+             MAX_WEIGHT_GRAMS);
+    return ESP_ERR_INVALID_ARG;
+  }
+  db_txn_begin();
+  if (id < 0 || (uint32_t)id >= reptile_table.count) {
+    db_txn_commit();
+    return ESP_ERR_INVALID_ARG;
   }
+  journal_weight_t rec = {
+      .index = (uint16_t)id, .timestamp = date, .grams = (uint16_t)grams};
+  txn_touch(id);
+  apply_weight(id, date, rec.grams);
+  db_journal(JOURNAL_REC_WEIGHT, &rec, sizeof(rec));
+  db_txn_commit();
+  return ESP_OK;
 }
 
 void db_record_vet_visit(int id, time_t date, const char *notes) {
-  // Basic placeholder
-  db_save_data();
+  db_txn_begin();
+  if (id < 0 || (uint32_t)id >= reptile_table.count) {
+    db_txn_commit();
+    return;
+  }
+  journal_health_t rec = {.index = (uint16_t)id, .timestamp = date};
+  strncpy(rec.event_type, "Veterinaire", sizeof(rec.event_type) - 1);
+  if (notes)
+    strncpy(rec.description, notes, sizeof(rec.description) - 1);
+  apply_health(id, date, "Veterinaire", notes);
+  db_journal(JOURNAL_REC_HEALTH, &rec, sizeof(rec));
+  db_txn_commit();
 }
 
 // ====================================================================================
 // LOGIC HELPERS
 // ====================================================================================
 
-int reptile_days_since_feeding(uint8_t id) {
-  if (id >= reptile_count || reptiles[id].last_feeding == 0)
+int reptile_days_since_feeding(int id) {
+  time_t last = db_reptile_last_feeding(id);
+  if (last == 0)
     return -1;
   time_t now = time(NULL);
-  return (now - reptiles[id].last_feeding) / (24 * 3600);
+  return (now - last) / (24 * 3600);
 }
 
-int reptile_count_feeding_alerts(void) {
-  int count = 0;
-  for (int i = 0; i < reptile_count; i++) {
-    if (!reptiles[i].active)
-      continue;
-    int days = reptile_days_since_feeding(i);
-    int threshold = (reptiles[i].species == SPECIES_SNAKE) ? 7 : 3;
-    if (days >= threshold)
-      count++;
-  }
-  return count;
+// Kept up to date by the alert timer and the modifiers: a single word read
+int reptile_count_feeding_alerts(void) { return feed_alerts.due_count; }
+
+bool reptile_is_feeding_due(int id) {
+  return id >= 0 && due_queue_is_due(&feed_alerts, id);
+}
+
+int reptile_feeding_interval(int id) {
+  int days = CONFIG_APP_FEED_DAYS_OTHER;
+  if (DB_LOADING())
+    return days;
+  DB_LOCK();
+  if (id >= 0 && (uint32_t)id < reptile_table.count)
+    days = feeding_interval(reptile_at(id));
+  DB_UNLOCK();
+  return days;
 }
@@ -7,85 +7,256 @@
 #define DATABASE_H
 
 #include "../models.h"
+#include "calendar.h"
 #include "esp_err.h"
+#include "query.h"
+#include "stats.h"
+#include "weight_series.h"
 
-// Limits
-#define MAX_REPTILES 30
-#define MAX_FEEDINGS 100
-#define MAX_HEALTH_RECORDS 50
-#define MAX_BREEDINGS 10
-#define MAX_INVENTORY_ITEMS 10
+// Limits: tables grow on demand in PSRAM up to these caps
+#define MAX_REPTILES 10000 // Journal records address reptiles with 16 bits
+#define MAX_FEEDINGS 1000000
+#define MAX_HEALTH_RECORDS 100000
+
+// Feeding and health history keep about this many recent records in RAM and
+// roll older ones out to archive segments on the SD card (see archive.h).
+// Their caps above only matter while the archive cannot be written.
+#define FEEDING_RING_SIZE 8192 // Multiple of 1024, the table chunk
+#define HEALTH_RING_SIZE 2048  // Multiple of 256
+#define MAX_BREEDINGS 1000
+#define MAX_INVENTORY_ITEMS 256
+#define MAX_PREY_COUNT 255     // Prey per meal, kept in 8 bits
+#define MAX_WEIGHT_GRAMS 65535 // reptile_t.weight_grams is 16 bits
 
 // ====================================================================================
 // ACCESSORS (GETTERS/SETTERS)
 // ====================================================================================
 
+// Readers copy records out and never see one half-written by a modifier in
+// another task. They take no lock unless a modifier keeps them retrying.
+// db_read_*() return false for an index past the table.
+
+// Buffer size for any name or interned text
+#define DB_TEXT_LEN 128
+
 // Reptiles
 int db_get_reptile_count(void);
 void db_set_reptile_count(int count);
-reptile_t *db_get_reptile(int index);
-reptile_t *db_get_reptile_by_id(int id);
+bool db_read_reptile(int index, reptile_t *out);
+// O(1) lookups through hash indexes: the reptile index, -1 if not found
+int db_find_reptile_by_id(int id);
+int db_find_reptile_by_uuid(const char *uuid);
+int db_find_reptile_by_microchip(const char *microchip);
 int db_get_reptile_next_id(void);
+// Interned strings (species, origin, breeder): records hold str_ref_t
+// handles, so equal texts compare as equal integers. db_string() copies the
+// text into `buf` and returns it; db_find_string() returns 0 for unknown
+// texts.
+const char *db_string(str_ref_t ref, char *buf, size_t len);
+str_ref_t db_intern_string(const char *s);
+str_ref_t db_find_string(const char *s);
+
+// Hot fields by index, read from compact columns: use these for scans over
+// the whole collection and keep db_read_reptile() for single-record views.
+// Names are copied into `buf`, which is returned.
+bool db_reptile_active(int index);
+reptile_species_t db_reptile_species(int index);
+reptile_sex_t db_reptile_sex(int index);
+cites_annex_t db_reptile_cites_annex(int index);
+health_status_t db_reptile_health(int index);
+time_t db_reptile_last_feeding(int index);
+const char *db_reptile_name(int index, char *buf, size_t len);
+const char *db_reptile_species_name(int index, char *buf, size_t len);
+
+// Filtered, sorted selection of reptile indexes (see query.h). Read it with
+// query_page(); release it with query_result_free() or reuse it. A text
+// query matches words of the name, species names, morph, microchip and
+// breeder, 3 letters anywhere in a word, 1 or 2 letters at its start.
+esp_err_t db_query(const query_t *q, query_result_t *out);
 
-// Feedings
+// Feedings still in RAM, oldest first; older ones are read through the
+// per-animal history below
 int db_get_feeding_count(void);
-feeding_record_t *db_get_feeding(int index);
+bool db_read_feeding(int index, feeding_record_t *out);
 void db_add_feeding(feeding_record_t *record);
 
 // Health
 int db_get_health_count(void);
-health_record_t *db_get_health(int index);
+bool db_read_health(int index, health_record_t *out);
 void db_add_health(health_record_t *record);
 
+// Per-animal history, newest first, by reptile index. Start with
+// *cursor = DB_HISTORY_START; each call copies up to `max` records, advances
+// the cursor and returns how many were written. Cost is proportional to the
+// page, not to the table size. These only read RAM: they stop before the
+// first record that has rolled out to the SD archive, returning 0 there with
+// the cursor not yet DB_HISTORY_END.
+#define DB_HISTORY_START 0
+#define DB_HISTORY_END UINT32_MAX
+int db_get_feeding_history(int index, uint32_t *cursor, feeding_record_t *out,
+                           int max);
+int db_get_health_history(int index, uint32_t *cursor, health_record_t *out,
+                          int max);
+int db_get_feeding_history_count(int index);
+int db_get_health_history_count(int index);
+
+// Archived history pages block on the SD card, so a worker task reads them:
+// db_history_fetch_start() takes the cursor the readers above stopped at,
+// and the UI polls db_history_fetch_result() from a timer, like the export.
+// `out` takes up to `max` records of the fetched kind; the result is handed
+// out once, then the fetch is idle again.
+#define DB_HISTORY_FETCH_MAX 32
+
+typedef enum {
+  DB_FETCH_IDLE = 0,
+  DB_FETCH_RUNNING,
+  DB_FETCH_DONE,
+  DB_FETCH_FAILED, // Segment missing or damaged: the history ends there
+} db_fetch_state_t;
+
+// ESP_ERR_INVALID_STATE while a fetch is running
+esp_err_t db_history_fetch_start(bool health, uint32_t cursor, int max);
+db_fetch_state_t db_history_fetch_result(void *out, int *count,
+                                         uint32_t *cursor);
+
+// Weight history, by reptile index. db_get_weight_buckets() copies the newest
+// `max` buckets of a tier, oldest first, without touching the raw points.
+int db_get_weight_count(int index);
+int db_get_weight_buckets(int index, weight_tier_t tier, weight_bucket_t *out,
+                          int max);
+
+// Collection statistics (see stats.h), kept up to date by the modifiers:
+// reading them is a copy, not a scan. db_stats_recompute() computes the same
+// figures from every record, archived history included, and blocks on the
+// SD card: it is there to check the running aggregates.
+void db_get_stats(stats_summary_t *out);
+esp_err_t db_stats_recompute(stats_summary_t *out);
+
 // Breeding
 int db_get_breeding_count(void);
-breeding_record_t *db_get_breeding(int index);
+bool db_read_breeding(int index, breeding_record_t *out);
+// Clutch edits are journaled like the reptile modifiers and taken back by
+// db_txn_abort(); db_add_breeding() returns the new index, -1 if out of memory
 int db_add_breeding(breeding_record_t *record);
+void db_update_breeding(int index, const breeding_record_t *record);
+// Laying and hatching of the active clutches, actual or predicted from the
+// female's species (see calendar.h): up to `max` events meeting [from, to],
+// by date. Predictions follow the female's species as of the last change to
+// the clutch or the last load.
+int db_breeding_calendar(time_t from, time_t to, calendar_event_t *out,
+                         int max);
+// Predicted windows open today: clutches that may lay or hatch any day
+int db_breeding_alert_count(void);
 
 // Modifiers (MVC)
 void db_update_reptile(int id, reptile_t *data);
 void db_delete_reptile(int id);
-void db_record_feeding(int id, time_t date, const char *prey, int qty);
+// A refused meal (`accepted` false) is kept in the history and the
+// statistics, and its prey leaves the stock, but the animal stays due.
+// ESP_ERR_INVALID_ARG, and nothing recorded, for an unknown animal or a
+// `qty` outside 1..MAX_PREY_COUNT.
+esp_err_t db_record_feeding(int id, time_t date, const char *prey, int qty,
+                            bool accepted);
 void db_record_shed(int id, time_t date);
-void db_record_weight(int id, time_t date, int grams);
+// ESP_ERR_INVALID_ARG, and nothing recorded, for an unknown animal or
+// `grams` outside 0..MAX_WEIGHT_GRAMS
+esp_err_t db_record_weight(int id, time_t date, int grams);
 void db_record_vet_visit(int id, time_t date, const char *notes);
 
+// Transactions: the modifiers called between db_txn_begin() and
+// db_txn_commit() are journaled as one record, saved in one flush and undone
+// as one step. Nestable; the outermost commit applies. db_txn_abort() rolls
+// everything back to its state at db_txn_begin(): animals, their history and
+// weigh-ins, stock, statistics; nothing is journaled or audited. Beyond 16
+// animals changed, a transaction cannot be aborted and is kept. The calling
+// task holds the database lock throughout: keep them short.
+void db_txn_begin(void);
+void db_txn_commit(void);
+void db_txn_abort(void);
+
+// Undo the last transaction (or single modifier call), newest first, up to
+// db_undo_count() steps. Restores the animals' fields; feedings, health
+// records and weigh-ins already recorded stay in the history. False if
+// there is nothing to undo, or when called inside a transaction.
+bool db_undo(void);
+int db_undo_count(void);
+
 // Helpers
 
-// Inventory
+// Inventory. Sizing the table and setting or restocking an item are
+// journaled like the reptile modifiers and taken back by db_txn_abort().
 int db_get_inventory_count(void);
 void db_set_inventory_count(int count);
-inventory_item_t *db_get_inventory_item(int index);
+bool db_read_inventory_item(int index, inventory_item_t *out);
+void db_set_inventory_item(int index, const inventory_item_t *item);
+// db_record_feeding() takes the meal's prey count from the item named as
+// its prey type (ignoring case). Days of stock left at the recent
+// consumption of that prey (see forecast.h), -1 if none is being eaten. An
+// item needs reordering under its alert threshold, or once it would run out
+// within CONFIG_APP_PREY_REORDER_DAYS.
+int db_inventory_days_left(int index);
+bool db_inventory_needs_reorder(int index);
+int db_inventory_reorder_count(void);
 
 // ====================================================================================
 // PERSISTENCE
 // ====================================================================================
 
+// Start the background save task. Call once before db_load_data().
+esp_err_t db_init(void);
+// Map the registry preview kept in flash (see boot_view.h), so the hot
+// column readers and db_query() work before the SD card is mounted. Call
+// after db_init(); db_load_data() must follow from the same task. Until it
+// completes, modifiers from other tasks wait for it, and every other reader
+// returns empty or not found without waiting.
+esp_err_t db_map_boot_view(void);
+// Request a full snapshot; written asynchronously by the save task
 void db_save_data(void);
+// Synchronously write everything pending. db_export_csv() calls it first,
+// and esp_restart() through a shutdown handler set by db_init(); call it
+// before copying the card's files. Blocks on the SD card: do not call from
+// the LVGL task.
+esp_err_t db_flush(void);
 void db_load_data(void);
-esp_err_t db_export_csv(const char *filepath);
-void db_init_demo_data(void);
 
-// ====================================================================================
-// EXTERN ACCESS (TEMPORARY FOR REFACTORING)
-// ====================================================================================
-// Allows main.c to compile before full UI refactoring
-extern reptile_t reptiles[MAX_REPTILES];
-extern feeding_record_t feedings[MAX_FEEDINGS];
-extern health_record_t health_records[MAX_HEALTH_RECORDS];
-extern breeding_record_t breedings[MAX_BREEDINGS];
-extern inventory_item_t inventory[MAX_INVENTORY_ITEMS];
-
-extern uint8_t reptile_count;
-extern uint8_t feeding_count;
-extern uint8_t health_record_count;
-extern uint8_t breeding_count;
-extern uint8_t inventory_count;
+// Registre CSV export. db_export_csv() blocks on the SD card; the UI uses
+// db_export_csv_start() and polls db_export_csv_progress() from a timer.
+//
+// Every change to a reptile stamps it with a modification sequence. A full
+// export rewrites `filepath` (registre.csv); a changes export appends the
+// rows stamped since the last export to registre_maj.csv, so the two files
+// together hold the current registre (the last row of an ID wins). The
+// export watermark is kept next to them in registre.exp.
+typedef enum {
+  DB_EXPORT_AUTO = 0, // Changes, or a full export when compaction is due
+  DB_EXPORT_CHANGES,  // Changes only (full if there is no usable watermark)
+  DB_EXPORT_FULL,     // Rewrite the registre, drop the changes file
+} db_export_mode_t;
+
+typedef enum {
+  DB_EXPORT_IDLE = 0,
+  DB_EXPORT_RUNNING,
+  DB_EXPORT_DONE,
+  DB_EXPORT_FAILED,
+  DB_EXPORT_CANCELLED,
+} db_export_state_t;
+
+esp_err_t db_export_csv(const char *filepath, db_export_mode_t mode);
+// ESP_ERR_INVALID_STATE if an export is already running
+esp_err_t db_export_csv_start(const char *filepath, db_export_mode_t mode);
+void db_export_csv_cancel(void);
+// Rows written so far out of `total`
+db_export_state_t db_export_csv_progress(uint32_t *done, uint32_t *total);
+void db_init_demo_data(void);
 
 // Helpers
 const char *db_cites_annex_to_string(cites_annex_t annex);
 const char *db_exit_reason_to_string(exit_reason_t reason);
-int reptile_days_since_feeding(uint8_t id);
+int reptile_days_since_feeding(int id);
+// Feeding alerts: an animal is due once its interval (its own, or its
+// species' from Kconfig) has passed since its last meal. O(1) reads.
 int reptile_count_feeding_alerts(void);
+bool reptile_is_feeding_due(int id);
+int reptile_feeding_interval(int id); // Days
 
 #endif // DATABASE_H
@@ -0,0 +1,360 @@
+/**
+ * @file db_schema.c
+ * @brief Field-tagged record serialization implementation
+ */
+
+#include "db_schema.h"
+#include "../models.h"
+#include <string.h>
+
+#define FIELD(tag, kind, type, member)                                         \
+  {tag, kind, offsetof(type, member), sizeof(((type *)0)->member)}
+#define TABLE(section, type, fields)                                           \
+  {section, sizeof(type), sizeof(fields) / sizeof(fields[0]), fields}
+
+// ====================================================================================
+// CURRENT LAYOUT
+// ====================================================================================
+// Tags are permanent. A removed field keeps its tag reserved; a new field, or
+// one whose kind changes, gets the next unused number in its table. The one
+// exception is FIELD_STR <-> FIELD_STRREF, which converts losslessly.
+
+#define R(tag, kind, member) FIELD(tag, kind, reptile_t, member)
+static const field_desc_t reptile_fields[] = {
+    R(1, FIELD_UINT, id),
+    R(2, FIELD_STR, uuid),
+    R(3, FIELD_STR, name),
+    R(4, FIELD_STRREF, species_common),
+    R(5, FIELD_STRREF, species_scientific),
+    R(6, FIELD_STR, morph),
+    R(7, FIELD_INT, species),
+    R(8, FIELD_INT, sex),
+    R(9, FIELD_STR, microchip),
+    R(10, FIELD_STR, ring_number),
+    R(11, FIELD_UINT, birth_year),
+    R(12, FIELD_UINT, birth_month),
+    R(13, FIELD_UINT, birth_day),
+    R(14, FIELD_UINT, birth_estimated),
+    R(15, FIELD_INT, cites_annex),
+    R(16, FIELD_STR, cites_permit),
+    R(17, FIELD_STR, cites_date),
+    R(18, FIELD_UINT, cdc_required),
+    R(19, FIELD_INT, date_acquisition),
+    R(20, FIELD_STRREF, origin),
+    R(21, FIELD_STR, origin_country),
+    R(22, FIELD_STRREF, breeder_name),
+    R(23, FIELD_STRREF, breeder_address),
+    R(24, FIELD_STR, breeder_cdc),
+    R(25, FIELD_UINT, captive_bred),
+    R(26, FIELD_INT, date_exit),
+    R(27, FIELD_INT, exit_reason),
+    R(28, FIELD_STR, recipient_name),
+    R(29, FIELD_STR, recipient_address),
+    R(30, FIELD_UINT, sale_price),
+    R(31, FIELD_UINT, weight_grams),
+    R(32, FIELD_UINT, terrarium_id),
+    R(33, FIELD_UINT, purchase_price),
+    R(34, FIELD_INT, last_feeding),
+    R(35, FIELD_INT, last_weight),
+    R(36, FIELD_INT, last_shed),
+    R(37, FIELD_INT, health),
+    R(38, FIELD_UINT, is_breeding),
+    R(39, FIELD_STR, photo_path),
+    R(40, FIELD_STR, notes),
+    R(41, FIELD_UINT, doc_cession_ok),
+    R(42, FIELD_UINT, doc_entree_ok),
+    R(43, FIELD_UINT, active),
+    R(44, FIELD_UINT, mod_seq),
+    R(45, FIELD_UINT, feeding_interval_days),
+};
+#undef R
+
+#define F(tag, kind, member) FIELD(tag, kind, feeding_record_t, member)
+static const field_desc_t feeding_fields[] = {
+    F(1, FIELD_UINT, animal_id),  F(2, FIELD_INT, timestamp),
+    F(3, FIELD_STR, prey_type),   F(4, FIELD_UINT, prey_count),
+    F(5, FIELD_UINT, accepted),
+};
+#undef F
+
+#define H(tag, kind, member) FIELD(tag, kind, health_record_t, member)
+static const field_desc_t health_fields[] = {
+    H(1, FIELD_UINT, animal_id),   H(2, FIELD_INT, timestamp),
+    H(3, FIELD_STR, event_type),   H(4, FIELD_STR, description),
+    H(5, FIELD_UINT, weight_grams),
+};
+#undef H
+
+#define B(tag, kind, member) FIELD(tag, kind, breeding_record_t, member)
+static const field_desc_t breeding_fields[] = {
+    B(1, FIELD_UINT, id),          B(2, FIELD_UINT, female_id),
+    B(3, FIELD_UINT, male_id),     B(4, FIELD_INT, pairing_date),
+    B(5, FIELD_INT, laying_date),  B(6, FIELD_UINT, egg_count),
+    B(7, FIELD_INT, hatch_date),   B(8, FIELD_UINT, hatched_count),
+    B(9, FIELD_UINT, active),
+};
+#undef B
+
+#define I(tag, kind, member) FIELD(tag, kind, inventory_item_t, member)
+static const field_desc_t inventory_fields[] = {
+    I(1, FIELD_STR, name),
+    I(2, FIELD_UINT, quantity),
+    I(3, FIELD_UINT, alert_threshold),
+    I(4, FIELD_STR, unit),
+};
+#undef I
+
+static const table_schema_t tables[] = {
+    TABLE(SECTION_REPTILES, reptile_t, reptile_fields),
+    TABLE(SECTION_FEEDINGS, feeding_record_t, feeding_fields),
+    TABLE(SECTION_HEALTH, health_record_t, health_fields),
+    TABLE(SECTION_BREEDINGS, breeding_record_t, breeding_fields),
+    TABLE(SECTION_INVENTORY, inventory_item_t, inventory_fields),
+};
+
+#define TABLE_COUNT (sizeof(tables) / sizeof(tables[0]))
+
+// ====================================================================================
+// FROZEN RAW LAYOUT (versions 1-2)
+// ====================================================================================
+// Versions 1 and 2 dumped the structs verbatim (32-bit RISC-V, 64-bit time_t).
+// These offsets describe those files and must never change.
+
+static const field_desc_t raw_reptile_fields[] = {
+    {1, FIELD_UINT, 0, 1},     {2, FIELD_STR, 1, 37},
+    {3, FIELD_STR, 38, 32},    {4, FIELD_STR, 70, 48},
+    {5, FIELD_STR, 118, 64},   {6, FIELD_STR, 182, 32},
+    {7, FIELD_INT, 216, 4},    {8, FIELD_INT, 220, 4},
+    {9, FIELD_STR, 224, 20},   {10, FIELD_STR, 244, 16},
+    {11, FIELD_UINT, 260, 2},  {12, FIELD_UINT, 262, 1},
+    {13, FIELD_UINT, 263, 1},  {14, FIELD_UINT, 264, 1},
+    {15, FIELD_INT, 268, 4},   {16, FIELD_STR, 272, 32},
+    {17, FIELD_STR, 304, 16},  {18, FIELD_UINT, 320, 1},
+    {19, FIELD_INT, 328, 8},   {20, FIELD_STR, 336, 64},
+    {21, FIELD_STR, 400, 3},   {22, FIELD_STR, 403, 64},
+    {23, FIELD_STR, 467, 128}, {24, FIELD_STR, 595, 32},
+    {25, FIELD_UINT, 627, 1},  {26, FIELD_INT, 632, 8},
+    {27, FIELD_INT, 640, 4},   {28, FIELD_STR, 644, 64},
+    {29, FIELD_STR, 708, 128}, {30, FIELD_UINT, 836, 2},
+    {31, FIELD_UINT, 838, 2},  {32, FIELD_UINT, 840, 1},
+    {33, FIELD_UINT, 842, 2},  {34, FIELD_INT, 848, 8},
+    {35, FIELD_INT, 856, 8},   {36, FIELD_INT, 864, 8},
+    {37, FIELD_INT, 872, 4},   {38, FIELD_UINT, 876, 1},
+    {39, FIELD_STR, 877, 64},  {40, FIELD_STR, 941, 128},
+    {41, FIELD_UINT, 1069, 1}, {42, FIELD_UINT, 1070, 1},
+    {43, FIELD_UINT, 1071, 1},
+};
+
+static const field_desc_t raw_feeding_fields[] = {
+    {1, FIELD_UINT, 0, 1},  {2, FIELD_INT, 8, 8},   {3, FIELD_STR, 16, 24},
+    {4, FIELD_UINT, 40, 1}, {5, FIELD_UINT, 41, 1},
+};
+
+static const field_desc_t raw_health_fields[] = {
+    {1, FIELD_UINT, 0, 1},  {2, FIELD_INT, 8, 8},    {3, FIELD_STR, 16, 24},
+    {4, FIELD_STR, 40, 64}, {5, FIELD_UINT, 104, 2},
+};
+
+static const field_desc_t raw_breeding_fields[] = {
+    {1, FIELD_UINT, 0, 1},  {2, FIELD_UINT, 1, 1},  {3, FIELD_UINT, 2, 1},
+    {4, FIELD_INT, 8, 8},   {5, FIELD_INT, 16, 8},  {6, FIELD_UINT, 24, 1},
+    {7, FIELD_INT, 32, 8},  {8, FIELD_UINT, 40, 1}, {9, FIELD_UINT, 41, 1},
+};
+
+static const field_desc_t raw_inventory_fields[] = {
+    {1, FIELD_STR, 0, 24},
+    {2, FIELD_UINT, 24, 2},
+    {3, FIELD_UINT, 26, 2},
+    {4, FIELD_STR, 28, 8},
+};
+
+#define RAW(section, stride, fields)                                           \
+  {section, stride, sizeof(fields) / sizeof(fields[0]), fields}
+static const table_schema_t raw_tables[] = {
+    RAW(SECTION_REPTILES, SCHEMA_V2_REPTILE_SIZE, raw_reptile_fields),
+    RAW(SECTION_FEEDINGS, 48, raw_feeding_fields),
+    RAW(SECTION_HEALTH, 112, raw_health_fields),
+    RAW(SECTION_BREEDINGS, 48, raw_breeding_fields),
+    RAW(SECTION_INVENTORY, 36, raw_inventory_fields),
+};
+
+// ====================================================================================
+// LOOKUP
+// ====================================================================================
+
+static const schema_strings_t *string_table = NULL;
+
+void schema_set_strings(const schema_strings_t *strings) {
+  string_table = strings;
+}
+
+static const table_schema_t *find_table(const table_schema_t *list, int count,
+                                        uint16_t section) {
+  for (int i = 0; i < count; i++) {
+    if (list[i].section == section)
+      return &list[i];
+  }
+  return NULL;
+}
+
+const table_schema_t *schema_table(uint16_t section) {
+  return find_table(tables, TABLE_COUNT, section);
+}
+
+const table_schema_t *schema_raw_v2(uint16_t section) {
+  return find_table(raw_tables, sizeof(raw_tables) / sizeof(raw_tables[0]),
+                    section);
+}
+
+const field_desc_t *schema_field(const table_schema_t *t, uint16_t tag) {
+  for (int i = 0; i < t->field_count; i++) {
+    if (t->fields[i].tag == tag)
+      return &t->fields[i];
+  }
+  return NULL;
+}
+
+uint16_t schema_width(const table_schema_t *t) {
+  uint16_t width = 0;
+  for (int i = 0; i < t->field_count; i++)
+    width += t->fields[i].size;
+  return width;
+}
+
+int schema_describe(schema_entry_t *out, int max) {
+  int n = 0;
+  for (size_t i = 0; i < TABLE_COUNT; i++) {
+    for (int j = 0; j < tables[i].field_count && n < max; j++, n++) {
+      out[n].section = tables[i].section;
+      out[n].tag = tables[i].fields[j].tag;
+      out[n].kind = tables[i].fields[j].kind;
+      out[n].reserved = 0;
+      out[n].width = tables[i].fields[j].size;
+    }
+  }
+  return n;
+}
+
+// ====================================================================================
+// ENCODE / DECODE
+// ====================================================================================
+
+// Stored integers are little-endian, which is also the native order on every
+// ESP32 target, so native fields go through the same helpers.
+static uint64_t read_le(const uint8_t *p, uint16_t width) {
+  uint64_t v = 0;
+  for (int i = (width > 8 ? 8 : width) - 1; i >= 0; i--)
+    v = (v << 8) | p[i];
+  return v;
+}
+
+static void write_le(uint8_t *p, uint16_t width, uint64_t v) {
+  for (int i = 0; i < width; i++) {
+    p[i] = (uint8_t)v;
+    v = i < 7 ? v >> 8 : 0;
+  }
+}
+
+void schema_encode_field(const field_desc_t *f, const void *rec,
+                         uint8_t *out) {
+  const uint8_t *src = (const uint8_t *)rec + f->offset;
+  if (f->kind == FIELD_STR) {
+    memcpy(out, src, f->size);
+  } else {
+    write_le(out, f->size, read_le(src, f->size));
+  }
+}
+
+void schema_encode_record(const table_schema_t *t, const void *rec,
+                          uint8_t *out) {
+  for (int i = 0; i < t->field_count; i++) {
+    schema_encode_field(&t->fields[i], rec, out);
+    out += t->fields[i].size;
+  }
+}
+
+static void store_text(const field_desc_t *dst, uint8_t *p, const void *src,
+                       size_t len) {
+  size_t n = len < dst->size ? len : dst->size;
+  memcpy(p, src, n);
+  memset(p + n, 0, dst->size - n);
+  p[dst->size - 1] = '\0';
+}
+
+void schema_store_field(const field_desc_t *dst, void *rec, const uint8_t *src,
+                        uint16_t src_width, uint8_t src_kind) {
+  uint8_t *p = (uint8_t *)rec + dst->offset;
+
+  if (dst->kind == FIELD_STRREF && src_kind == FIELD_STR) {
+    uint32_t ref = string_table ? string_table->intern((const char *)src,
+                                                       src_width)
+                                : 0;
+    write_le(p, dst->size, ref);
+    return;
+  }
+  if (dst->kind == FIELD_STR && src_kind == FIELD_STRREF) {
+    const char *text =
+        string_table ? string_table->lookup(read_le(src, src_width)) : "";
+    store_text(dst, p, text, strlen(text));
+    return;
+  }
+  if (dst->kind == FIELD_STR || src_kind == FIELD_STR) {
+    if (dst->kind != src_kind)
+      return; // Text <-> number changes need an explicit migration
+    store_text(dst, p, src, src_width);
+    return;
+  }
+  if ((dst->kind == FIELD_STRREF) != (src_kind == FIELD_STRREF))
+    return;
+
+  uint64_t v = read_le(src, src_width);
+  if (src_kind == FIELD_INT && src_width < 8 &&
+      (v >> (src_width * 8 - 1)) & 1)
+    v |= ~0ULL << (src_width * 8); // Sign-extend
+  write_le(p, dst->size, v);
+}
+
+int schema_plan_stored(const table_schema_t *t, const schema_entry_t *entries,
+                       int count, field_map_t *plan, uint16_t *stride) {
+  int n = 0;
+  uint32_t offset = 0;
+  for (int i = 0; i < count; i++) {
+    if (entries[i].section != t->section)
+      continue;
+    if (n >= SCHEMA_MAX_FIELDS || entries[i].width == 0 ||
+        entries[i].kind > FIELD_STRREF)
+      return -1;
+    plan[n].src_offset = offset;
+    plan[n].src_width = entries[i].width;
+    plan[n].src_kind = entries[i].kind;
+    plan[n].dst = schema_field(t, entries[i].tag);
+    offset += entries[i].width;
+    n++;
+  }
+  if (offset > UINT16_MAX)
+    return -1;
+  *stride = offset;
+  return n;
+}
+
+int schema_plan_raw(const table_schema_t *t, const table_schema_t *raw,
+                    field_map_t *plan, uint16_t *stride) {
+  for (int i = 0; i < raw->field_count; i++) {
+    plan[i].src_offset = raw->fields[i].offset;
+    plan[i].src_width = raw->fields[i].size;
+    plan[i].src_kind = raw->fields[i].kind;
+    plan[i].dst = schema_field(t, raw->fields[i].tag);
+  }
+  *stride = raw->record_size;
+  return raw->field_count;
+}
+
+void schema_decode_record(const table_schema_t *t, const field_map_t *plan,
+                          int count, const uint8_t *src, void *dst) {
+  memset(dst, 0, t->record_size);
+  for (int i = 0; i < count; i++) {
+    if (plan[i].dst)
+      schema_store_field(plan[i].dst, dst, src + plan[i].src_offset,
+                         plan[i].src_width, plan[i].src_kind);
+  }
+}
@@ -0,0 +1,164 @@
+/**
+ * @file db_schema.h
+ * @brief Field-tagged, fixed-width record serialization
+ *
+ * Every persisted struct is described by a table of fields, each with a
+ * stable numeric tag. Records are stored as the concatenation of their fields
+ * (little-endian integers, fixed-size strings) and the field list itself is
+ * saved alongside the data. Loading maps stored fields to the current struct
+ * by tag, so adding, widening or dropping fields never corrupts old files.
+ */
+
+#ifndef DB_SCHEMA_H
+#define DB_SCHEMA_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Version history:
+//   1 - single header + raw struct arrays
+//   2 - sectioned snapshot, raw struct arrays
+//   3 - sectioned snapshot, tagged fixed-width records
+//   4 - weight time-series section
+//   5 - interned strings section, FIELD_STRREF fields
+//   6 - history section: feeding/health tables hold a ring of recent records
+//   7 - every reptile has a UUID; the reptile id allocator is in the meta
+#define DB_SCHEMA_VERSION 7
+
+typedef enum {
+  FIELD_UINT = 0, // Unsigned integer / bool
+  FIELD_INT,      // Signed integer / enum / time_t
+  FIELD_STR,      // Fixed-size, NUL-terminated char array
+  FIELD_STRREF,   // uint32 handle into the interned string table
+} field_kind_t;
+
+typedef struct {
+  uint16_t tag; // Stable identifier: never renumber or reuse
+  uint8_t kind;
+  uint16_t offset; // In the native struct (or a frozen raw layout)
+  uint16_t size;
+} field_desc_t;
+
+typedef struct {
+  uint16_t section;     // Snapshot section id of the table
+  uint16_t record_size; // sizeof native struct (or raw layout stride)
+  uint16_t field_count;
+  const field_desc_t *fields;
+} table_schema_t;
+
+// One row of the persisted schema section
+typedef struct __attribute__((packed)) {
+  uint16_t section;
+  uint16_t tag;
+  uint8_t kind;
+  uint8_t reserved;
+  uint16_t width;
+} schema_entry_t;
+
+// Decoding plan entry: where a stored field sits and where it goes
+typedef struct {
+  uint16_t src_offset;
+  uint16_t src_width;
+  uint8_t src_kind;
+  const field_desc_t *dst; // NULL if the field no longer exists
+} field_map_t;
+
+// Snapshot section ids shared by the schema and the database
+enum {
+  SECTION_REPTILES = 1,
+  SECTION_FEEDINGS,
+  SECTION_HEALTH,
+  SECTION_BREEDINGS,
+  SECTION_INVENTORY,
+  SECTION_WEIGHTS,     // Encoded weight series, see database.c
+  SECTION_STRINGS,     // Interned string pool, see string_pool.h
+  SECTION_HISTORY,     // History table bases and archived chains
+  SECTION_STATS,       // Event aggregates, see stats.h
+  SECTION_FORECAST,    // forecast_prey_t[], see forecast.h
+  SECTION_META = 0x40, // schema_meta_t
+  SECTION_SCHEMA,      // schema_entry_t[]
+};
+
+typedef struct __attribute__((packed)) {
+  uint32_t schema_version;
+  uint32_t next_reptile_id; // Lowest id never handed out; absent before v7
+} schema_meta_t;
+
+#define SCHEMA_MAX_FIELDS 64   // Per table
+#define SCHEMA_MAX_ENTRIES 256 // All tables together
+#define SCHEMA_V2_REPTILE_SIZE 1072
+
+// Converts between FIELD_STR and FIELD_STRREF when the stored kind of a
+// field differs from the current one
+typedef struct {
+  uint32_t (*intern)(const char *s, size_t len);
+  const char *(*lookup)(uint32_t ref);
+} schema_strings_t;
+
+/**
+ * @brief Install the string table used for text <-> handle conversions
+ */
+void schema_set_strings(const schema_strings_t *strings);
+
+/**
+ * @brief Current schema of a table, NULL for unknown sections
+ */
+const table_schema_t *schema_table(uint16_t section);
+
+/**
+ * @brief Frozen raw struct layout written by schema versions 1 and 2
+ */
+const table_schema_t *schema_raw_v2(uint16_t section);
+
+/**
+ * @brief Look up a field by tag
+ */
+const field_desc_t *schema_field(const table_schema_t *t, uint16_t tag);
+
+/**
+ * @brief Serialized width of one record
+ */
+uint16_t schema_width(const table_schema_t *t);
+
+/**
+ * @brief Describe every current table for the schema section
+ * @return Number of entries written
+ */
+int schema_describe(schema_entry_t *out, int max);
+
+/**
+ * @brief Serialize one field / one record
+ */
+void schema_encode_field(const field_desc_t *f, const void *rec, uint8_t *out);
+void schema_encode_record(const table_schema_t *t, const void *rec,
+                          uint8_t *out);
+
+/**
+ * @brief Store a serialized value into a native field, converting width and
+ *        kind (integers are extended or truncated, strings clipped, text
+ *        interned into or looked up from a FIELD_STRREF handle)
+ */
+void schema_store_field(const field_desc_t *dst, void *rec, const uint8_t *src,
+                        uint16_t src_width, uint8_t src_kind);
+
+/**
+ * @brief Build a decoding plan from a stored schema section
+ * @param[out] stride Serialized record width of the stored layout
+ * @return Number of plan entries, or -1 if the stored schema is malformed
+ */
+int schema_plan_stored(const table_schema_t *t, const schema_entry_t *entries,
+                       int count, field_map_t *plan, uint16_t *stride);
+
+/**
+ * @brief Build a decoding plan from a frozen raw layout (versions 1-2)
+ */
+int schema_plan_raw(const table_schema_t *t, const table_schema_t *raw,
+                    field_map_t *plan, uint16_t *stride);
+
+/**
+ * @brief Decode one record; fields absent from the plan are zeroed
+ */
+void schema_decode_record(const table_schema_t *t, const field_map_t *plan,
+                          int count, const uint8_t *src, void *dst);
+
+#endif // DB_SCHEMA_H
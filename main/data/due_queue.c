@@ -0,0 +1,145 @@
+/**
+ * @file due_queue.c
+ * @brief Indexed due-time heap implementation
+ */
+
+#include "due_queue.h"
+#include "esp_heap_caps.h"
+#include "esp_log.h"
+#include <string.h>
+
+static const char *TAG = "DUE_QUEUE";
+
+#define MIN_ENTRIES 64
+
+static bool grow(void **buf, uint32_t *cap, uint32_t need, size_t size) {
+  if (need <= *cap)
+    return true;
+  uint32_t n = *cap ? *cap : MIN_ENTRIES;
+  while (n < need)
+    n *= 2;
+  void *p = heap_caps_realloc_prefer(*buf, (size_t)n * size, 2,
+                                     MALLOC_CAP_SPIRAM, MALLOC_CAP_DEFAULT);
+  if (p == NULL)
+    return false;
+  *buf = p;
+  *cap = n;
+  return true;
+}
+
+static void place(due_queue_t *q, uint32_t i, due_entry_t e) {
+  q->heap[i] = e;
+  q->pos[e.slot] = i + 1;
+}
+
+static void sift_up(due_queue_t *q, uint32_t i) {
+  due_entry_t e = q->heap[i];
+  while (i > 0 && q->heap[(i - 1) / 2].due > e.due) {
+    place(q, i, q->heap[(i - 1) / 2]);
+    i = (i - 1) / 2;
+  }
+  place(q, i, e);
+}
+
+static void sift_down(due_queue_t *q, uint32_t i) {
+  due_entry_t e = q->heap[i];
+  for (;;) {
+    uint32_t child = 2 * i + 1;
+    if (child >= q->size)
+      break;
+    if (child + 1 < q->size && q->heap[child + 1].due < q->heap[child].due)
+      child++;
+    if (q->heap[child].due >= e.due)
+      break;
+    place(q, i, q->heap[child]);
+    i = child;
+  }
+  place(q, i, e);
+}
+
+// Take the entry at heap position `i` out
+static void heap_remove(due_queue_t *q, uint32_t i) {
+  q->pos[q->heap[i].slot] = 0;
+  if (i == --q->size)
+    return;
+  int64_t old = q->heap[i].due;
+  place(q, i, q->heap[q->size]);
+  if (q->heap[i].due < old)
+    sift_up(q, i);
+  else
+    sift_down(q, i);
+}
+
+// ====================================================================================
+// API
+// ====================================================================================
+
+esp_err_t due_queue_set(due_queue_t *q, uint32_t slot, int64_t due,
+                        int64_t now) {
+  if (slot >= q->slots) {
+    uint32_t old = q->slots;
+    if (!grow((void **)&q->pos, &q->slots, slot + 1, sizeof(*q->pos))) {
+      ESP_LOGE(TAG, "Out of memory for %u slots", (unsigned)slot + 1);
+      return ESP_ERR_NO_MEM;
+    }
+    memset(q->pos + old, 0, (q->slots - old) * sizeof(*q->pos));
+  }
+
+  uint32_t pos = q->pos[slot];
+  if (pos == DUE_QUEUE_DUE) {
+    q->pos[slot] = 0;
+    q->due_count--;
+  } else if (pos != 0) {
+    if (due > now) {
+      // Reschedule in place
+      int64_t old = q->heap[pos - 1].due;
+      q->heap[pos - 1].due = due;
+      if (due < old)
+        sift_up(q, pos - 1);
+      else
+        sift_down(q, pos - 1);
+      return ESP_OK;
+    }
+    heap_remove(q, pos - 1);
+  }
+
+  if (due == 0)
+    return ESP_OK;
+  if (due <= now) {
+    q->pos[slot] = DUE_QUEUE_DUE;
+    q->due_count++;
+    return ESP_OK;
+  }
+  if (!grow((void **)&q->heap, &q->capacity, q->size + 1, sizeof(*q->heap))) {
+    ESP_LOGE(TAG, "Out of memory for %u entries", (unsigned)q->size + 1);
+    return ESP_ERR_NO_MEM;
+  }
+  place(q, q->size, (due_entry_t){.due = due, .slot = slot});
+  sift_up(q, q->size++);
+  return ESP_OK;
+}
+
+uint32_t due_queue_advance(due_queue_t *q, int64_t now) {
+  while (q->size > 0 && q->heap[0].due <= now) {
+    uint32_t slot = q->heap[0].slot;
+    heap_remove(q, 0);
+    q->pos[slot] = DUE_QUEUE_DUE;
+    q->due_count++;
+  }
+  return q->due_count;
+}
+
+int64_t due_queue_next(const due_queue_t *q) {
+  return q->size > 0 ? q->heap[0].due : 0;
+}
+
+bool due_queue_is_due(const due_queue_t *q, uint32_t slot) {
+  return slot < q->slots && q->pos[slot] == DUE_QUEUE_DUE;
+}
+
+void due_queue_clear(due_queue_t *q) {
+  if (q->pos)
+    memset(q->pos, 0, q->slots * sizeof(*q->pos));
+  q->size = 0;
+  q->due_count = 0;
+}
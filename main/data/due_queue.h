@@ -0,0 +1,61 @@
+/**
+ * @file due_queue.h
+ * @brief Indexed min-heap of per-slot due times
+ *
+ * Each slot (a reptile table index) is idle, waiting in the heap for its due
+ * time, or due. The heap is keyed on due time, so the slots whose time has
+ * come are moved to the due set from the top in O(log n) each, and the
+ * number of due slots is a counter. Every slot knows its heap position, so
+ * rescheduling one (a feeding) is O(log n) as well.
+ */
+
+#ifndef DUE_QUEUE_H
+#define DUE_QUEUE_H
+
+#include "esp_err.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+typedef struct {
+  int64_t due; // Unix time
+  uint32_t slot;
+} due_entry_t;
+
+typedef struct {
+  due_entry_t *heap; // Min-heap on `due`
+  uint32_t size;
+  uint32_t capacity;
+  uint32_t *pos; // Per slot: heap position + 1, 0 idle, DUE_QUEUE_DUE
+  uint32_t slots;
+  uint32_t due_count;
+} due_queue_t;
+
+#define DUE_QUEUE_DUE UINT32_MAX
+
+/**
+ * @brief Schedule `slot` for `due`, or make it idle with `due` 0
+ *
+ * A time at or before `now` makes the slot due at once.
+ */
+esp_err_t due_queue_set(due_queue_t *q, uint32_t slot, int64_t due,
+                        int64_t now);
+
+/**
+ * @brief Move every slot due at `now` from the heap to the due set
+ * @return Number of due slots
+ */
+uint32_t due_queue_advance(due_queue_t *q, int64_t now);
+
+/**
+ * @brief Earliest scheduled time, 0 if nothing waits
+ */
+int64_t due_queue_next(const due_queue_t *q);
+
+bool due_queue_is_due(const due_queue_t *q, uint32_t slot);
+
+/**
+ * @brief Make every slot idle; memory is kept
+ */
+void due_queue_clear(due_queue_t *q);
+
+#endif // DUE_QUEUE_H
@@ -0,0 +1,101 @@
+/**
+ * @file forecast.c
+ * @brief Rolling prey consumption rates
+ */
+
+#include "forecast.h"
+#include "esp_heap_caps.h"
+#include "esp_log.h"
+#include <math.h>
+#include <string.h>
+#include <strings.h>
+
+static const char *TAG = "FORECAST";
+
+#define MIN_PREY 8
+#define SECONDS_PER_DAY (24 * 3600)
+#define TAU_S ((double)FORECAST_TAU_DAYS * SECONDS_PER_DAY)
+
+static forecast_prey_t *find(const forecast_t *f, const char *prey) {
+  for (uint32_t i = 0; i < f->count; i++)
+    if (strncasecmp(f->prey[i].prey, prey, FORECAST_NAME_LEN) == 0)
+      return &f->prey[i];
+  return NULL;
+}
+
+static esp_err_t reserve(forecast_t *f, uint32_t count) {
+  if (count <= f->capacity)
+    return ESP_OK;
+  if (count > FORECAST_MAX_PREY)
+    return ESP_ERR_NO_MEM;
+  uint32_t cap = f->capacity ? f->capacity : MIN_PREY;
+  while (cap < count)
+    cap *= 2;
+  void *p = heap_caps_realloc_prefer(f->prey, cap * sizeof(*f->prey), 2,
+                                     MALLOC_CAP_SPIRAM, MALLOC_CAP_DEFAULT);
+  if (p == NULL)
+    return ESP_ERR_NO_MEM;
+  f->prey = p;
+  f->capacity = cap;
+  return ESP_OK;
+}
+
+esp_err_t forecast_consume(forecast_t *f, const char *prey, uint32_t pieces,
+                           int64_t ts) {
+  if (prey == NULL || prey[0] == '\0' || pieces == 0)
+    return ESP_OK;
+  forecast_prey_t *p = find(f, prey);
+  if (p == NULL) {
+    if (reserve(f, f->count + 1) != ESP_OK) {
+      ESP_LOGW(TAG, "No room for prey type %s", prey);
+      return ESP_ERR_NO_MEM;
+    }
+    p = &f->prey[f->count++];
+    memset(p, 0, sizeof(*p));
+    strncpy(p->prey, prey, sizeof(p->prey) - 1);
+    p->first = p->last = ts;
+  }
+  if (ts >= p->last) {
+    p->sum = p->sum * exp(-(ts - p->last) / TAU_S) + pieces;
+    p->last = ts;
+  } else {
+    p->sum += pieces * exp(-(p->last - ts) / TAU_S); // Entered late
+  }
+  if (ts < p->first)
+    p->first = ts;
+  return ESP_OK;
+}
+
+double forecast_rate(const forecast_t *f, const char *prey, int64_t now) {
+  const forecast_prey_t *p = prey ? find(f, prey) : NULL;
+  if (p == NULL)
+    return 0.0;
+  double sum = now > p->last ? p->sum * exp(-(now - p->last) / TAU_S) : p->sum;
+  // Share of the window the history covers, at least a day of it
+  double span = now - p->first;
+  if (span < SECONDS_PER_DAY)
+    span = SECONDS_PER_DAY;
+  return sum / FORECAST_TAU_DAYS / (1.0 - exp(-span / TAU_S));
+}
+
+int32_t forecast_days_left(const forecast_t *f, const char *prey,
+                           uint32_t stock, int64_t now) {
+  double rate = forecast_rate(f, prey, now);
+  if (rate < 1e-3) // Under a piece every three years
+    return -1;
+  return (int32_t)(stock / rate);
+}
+
+esp_err_t forecast_load(forecast_t *f, const forecast_prey_t *prey,
+                        uint32_t count) {
+  forecast_clear(f);
+  if (reserve(f, count) != ESP_OK)
+    return ESP_ERR_NO_MEM;
+  memcpy(f->prey, prey, count * sizeof(*prey));
+  for (uint32_t i = 0; i < count; i++)
+    f->prey[i].prey[FORECAST_NAME_LEN - 1] = '\0';
+  f->count = count;
+  return ESP_OK;
+}
+
+void forecast_clear(forecast_t *f) { f->count = 0; }
@@ -0,0 +1,71 @@
+/**
+ * @file forecast.h
+ * @brief Rolling consumption rate of each prey type, for reorder forecasts
+ *
+ * Each prey type keeps an exponentially decayed sum of the pieces eaten:
+ * every meal adds its count, and the sum fades with a time constant of
+ * FORECAST_TAU_DAYS. Divided by that constant it is a rate in pieces per
+ * day that follows the recent weeks, updated in O(1) per meal with no
+ * history kept. Until a type has been eaten for a few time constants, the
+ * rate is scaled up by the part of the window its history covers, so a new
+ * prey type is not taken for a slow one.
+ *
+ * Prey types are matched by name, ignoring case, as typed in the feeding
+ * record and the inventory.
+ */
+
+#ifndef FORECAST_H
+#define FORECAST_H
+
+#include "esp_err.h"
+#include <stdint.h>
+
+#define FORECAST_TAU_DAYS 28
+#define FORECAST_NAME_LEN 24 // As feeding_record_t.prey_type
+#define FORECAST_MAX_PREY 256
+
+// One prey type; also the snapshot record, see database.c
+typedef struct __attribute__((packed)) {
+  char prey[FORECAST_NAME_LEN];
+  int64_t first; // First meal counted
+  int64_t last;  // Time `sum` is decayed to
+  double sum;    // Pieces, each weighted exp(-(last - meal time) / tau)
+} forecast_prey_t;
+
+typedef struct {
+  forecast_prey_t *prey;
+  uint32_t count;
+  uint32_t capacity;
+} forecast_t;
+
+/**
+ * @brief Count `pieces` of `prey` eaten at `ts`; meals may arrive out of
+ *        time order
+ */
+esp_err_t forecast_consume(forecast_t *f, const char *prey, uint32_t pieces,
+                           int64_t ts);
+
+/**
+ * @brief Pieces of `prey` eaten per day lately, as of `now`; 0 if unknown
+ */
+double forecast_rate(const forecast_t *f, const char *prey, int64_t now);
+
+/**
+ * @brief Days until `stock` pieces of `prey` are eaten at the current rate,
+ *        -1 if it is not being eaten
+ */
+int32_t forecast_days_left(const forecast_t *f, const char *prey,
+                           uint32_t stock, int64_t now);
+
+/**
+ * @brief Replace every prey type with `count` records (snapshot load)
+ */
+esp_err_t forecast_load(forecast_t *f, const forecast_prey_t *prey,
+                        uint32_t count);
+
+/**
+ * @brief Drop every prey type; memory is kept
+ */
+void forecast_clear(forecast_t *f);
+
+#endif // FORECAST_H
@@ -0,0 +1,137 @@
+/**
+ * @file hash_index.c
+ * @brief Open-addressing hash index implementation
+ */
+
+#include "hash_index.h"
+#include "esp_heap_caps.h"
+#include "esp_log.h"
+#include <string.h>
+
+static const char *TAG = "HASH_INDEX";
+
+#define MIN_CAPACITY 16
+#define REF_EMPTY 0
+#define REF_REMOVED UINT32_MAX
+
+uint32_t hash_u32(uint32_t value) {
+  // murmur3 finalizer: sequential ids spread over the whole table
+  value ^= value >> 16;
+  value *= 0x85ebca6b;
+  value ^= value >> 13;
+  value *= 0xc2b2ae35;
+  value ^= value >> 16;
+  return value;
+}
+
+uint32_t hash_string(const char *s) {
+  uint32_t hash = 2166136261u; // FNV-1a
+  while (*s) {
+    hash ^= (uint8_t)*s++;
+    hash *= 16777619u;
+  }
+  return hash;
+}
+
+uint32_t hash_bytes(const void *data, size_t len) {
+  const uint8_t *p = data;
+  uint32_t hash = 2166136261u;
+  while (len--) {
+    hash ^= *p++;
+    hash *= 16777619u;
+  }
+  return hash;
+}
+
+static esp_err_t hash_index_rehash(hash_index_t *h, uint32_t capacity) {
+  hash_slot_t *slots = heap_caps_calloc_prefer(
+      capacity, sizeof(hash_slot_t), 2, MALLOC_CAP_SPIRAM, MALLOC_CAP_DEFAULT);
+  if (slots == NULL) {
+    ESP_LOGE(TAG, "Out of memory for %u slots", (unsigned)capacity);
+    return ESP_ERR_NO_MEM;
+  }
+
+  for (uint32_t i = 0; i < h->capacity; i++) {
+    hash_slot_t *old = &h->slots[i];
+    if (old->ref == REF_EMPTY || old->ref == REF_REMOVED)
+      continue;
+    uint32_t pos = old->hash & (capacity - 1);
+    while (slots[pos].ref != REF_EMPTY)
+      pos = (pos + 1) & (capacity - 1);
+    slots[pos] = *old;
+  }
+
+  heap_caps_free(h->slots);
+  h->slots = slots;
+  h->capacity = capacity;
+  h->used = h->count;
+  return ESP_OK;
+}
+
+esp_err_t hash_index_insert(hash_index_t *h, uint32_t hash, uint32_t index) {
+  if ((h->used + 1) * 4 > h->capacity * 3) {
+    // Size for the live entries, dropping tombstones along the way
+    uint32_t capacity = MIN_CAPACITY;
+    while (capacity * 3 < (h->count + 1) * 4 * 2)
+      capacity *= 2;
+    esp_err_t ret = hash_index_rehash(h, capacity);
+    if (ret != ESP_OK)
+      return ret;
+  }
+
+  uint32_t mask = h->capacity - 1;
+  uint32_t pos = hash & mask;
+  while (h->slots[pos].ref != REF_EMPTY && h->slots[pos].ref != REF_REMOVED)
+    pos = (pos + 1) & mask;
+  if (h->slots[pos].ref == REF_EMPTY)
+    h->used++;
+  h->slots[pos].hash = hash;
+  h->slots[pos].ref = index + 1;
+  h->count++;
+  return ESP_OK;
+}
+
+bool hash_index_remove(hash_index_t *h, uint32_t hash, uint32_t index) {
+  if (h->capacity == 0)
+    return false;
+  uint32_t mask = h->capacity - 1;
+  for (uint32_t pos = hash & mask; h->slots[pos].ref != REF_EMPTY;
+       pos = (pos + 1) & mask) {
+    if (h->slots[pos].hash == hash && h->slots[pos].ref == index + 1) {
+      h->slots[pos].ref = REF_REMOVED;
+      h->count--;
+      return true;
+    }
+  }
+  return false;
+}
+
+int32_t hash_index_find(const hash_index_t *h, uint32_t hash,
+                        hash_match_cb_t match, const void *key) {
+  if (h->capacity == 0)
+    return -1;
+  uint32_t mask = h->capacity - 1;
+  for (uint32_t pos = hash & mask; h->slots[pos].ref != REF_EMPTY;
+       pos = (pos + 1) & mask) {
+    const hash_slot_t *slot = &h->slots[pos];
+    if (slot->ref != REF_REMOVED && slot->hash == hash &&
+        match(slot->ref - 1, key))
+      return slot->ref - 1;
+  }
+  return -1;
+}
+
+void hash_index_clear(hash_index_t *h) {
+  if (h->slots)
+    memset(h->slots, 0, h->capacity * sizeof(hash_slot_t));
+  h->count = 0;
+  h->used = 0;
+}
+
+void hash_index_free(hash_index_t *h) {
+  heap_caps_free(h->slots);
+  h->slots = NULL;
+  h->capacity = 0;
+  h->count = 0;
+  h->used = 0;
+}
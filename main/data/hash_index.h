@@ -0,0 +1,69 @@
+/**
+ * @file hash_index.h
+ * @brief Open-addressing hash index from record keys to table indexes
+ *
+ * The index only stores the key hash and the record index; the caller
+ * resolves collisions with a match callback against the record itself, so
+ * string keys are never duplicated. Linear probing, power-of-two capacity,
+ * tombstones on removal.
+ */
+
+#ifndef HASH_INDEX_H
+#define HASH_INDEX_H
+
+#include "esp_err.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+typedef struct {
+  uint32_t hash;
+  uint32_t ref; // Record index + 1; 0 = empty, UINT32_MAX = removed
+} hash_slot_t;
+
+typedef struct {
+  hash_slot_t *slots;
+  uint32_t capacity; // Power of two, 0 until the first insert
+  uint32_t count;    // Live entries
+  uint32_t used;     // Live entries + tombstones
+} hash_index_t;
+
+/**
+ * @brief Return true if record `index` has the key being looked up
+ */
+typedef bool (*hash_match_cb_t)(uint32_t index, const void *key);
+
+uint32_t hash_u32(uint32_t value);
+uint32_t hash_string(const char *s);
+// Same hash as hash_string() over `len` bytes (no terminator needed)
+uint32_t hash_bytes(const void *data, size_t len);
+
+/**
+ * @brief Add an entry, growing the table when it is 3/4 full
+ */
+esp_err_t hash_index_insert(hash_index_t *h, uint32_t hash, uint32_t index);
+
+/**
+ * @brief Remove the entry for record `index` under `hash`
+ * @return true if it was present
+ */
+bool hash_index_remove(hash_index_t *h, uint32_t hash, uint32_t index);
+
+/**
+ * @brief Find the first record whose hash matches and `match` accepts
+ * @return Record index, or -1 if none
+ */
+int32_t hash_index_find(const hash_index_t *h, uint32_t hash,
+                        hash_match_cb_t match, const void *key);
+
+/**
+ * @brief Drop all entries (keeps the allocation)
+ */
+void hash_index_clear(hash_index_t *h);
+
+/**
+ * @brief Release the table memory
+ */
+void hash_index_free(hash_index_t *h);
+
+#endif // HASH_INDEX_H
@@ -0,0 +1,133 @@
+/**
+ * @file hot_table.c
+ * @brief Column store of hot reptile fields
+ */
+
+#include "hot_table.h"
+#include "esp_heap_caps.h"
+#include "esp_log.h"
+#include <string.h>
+
+static const char *TAG = "HOT_TABLE";
+
+#define MIN_ROWS 64
+#define MIN_STRINGS 1024
+
+static bool grow(void **column, size_t size) {
+  void *p = heap_caps_realloc_prefer(*column, size, 2, MALLOC_CAP_SPIRAM,
+                                     MALLOC_CAP_DEFAULT);
+  if (p == NULL)
+    return false;
+  *column = p;
+  return true;
+}
+
+static esp_err_t hot_table_reserve(hot_table_t *t, uint32_t rows) {
+  if (rows <= t->capacity)
+    return ESP_OK;
+  uint32_t cap = t->capacity ? t->capacity : MIN_ROWS;
+  while (cap < rows)
+    cap *= 2;
+
+  // A column that grew before a later one failed just keeps spare room
+  if (!grow((void **)&t->id, cap * sizeof(*t->id)) ||
+      !grow((void **)&t->last_feeding, cap * sizeof(*t->last_feeding)) ||
+      !grow((void **)&t->name, cap * sizeof(*t->name)) ||
+      !grow((void **)&t->name_key, cap * sizeof(*t->name_key)) ||
+      !grow((void **)&t->species_common, cap * sizeof(*t->species_common)) ||
+      !grow((void **)&t->active, cap) || !grow((void **)&t->species, cap) ||
+      !grow((void **)&t->sex, cap) || !grow((void **)&t->cites_annex, cap) ||
+      !grow((void **)&t->health, cap) || !grow((void **)&t->terrarium, cap)) {
+    ESP_LOGE(TAG, "Out of memory for %u rows", (unsigned)cap);
+    return ESP_ERR_NO_MEM;
+  }
+  t->capacity = cap;
+  return ESP_OK;
+}
+
+// Store `s` in the pool unless the row already points at the same text
+static esp_err_t hot_table_intern(hot_table_t *t, uint32_t *offset,
+                                  bool existing, const char *s) {
+  if (existing && strcmp(t->strings + *offset, s) == 0)
+    return ESP_OK;
+
+  size_t len = strlen(s);
+  uint32_t off = 0;
+  if (len > 0) {
+    if (t->strings_len + len + 1 > t->strings_cap) {
+      uint32_t cap = t->strings_cap ? t->strings_cap : MIN_STRINGS;
+      while (cap < t->strings_len + len + 1)
+        cap *= 2;
+      if (!grow((void **)&t->strings, cap))
+        return ESP_ERR_NO_MEM;
+      t->strings_cap = cap;
+    }
+    off = t->strings_len;
+    memcpy(t->strings + off, s, len + 1);
+    t->strings_len += len + 1;
+  }
+  if (existing && *offset != 0)
+    t->strings_dead += strlen(t->strings + *offset) + 1;
+  *offset = off;
+  return ESP_OK;
+}
+
+esp_err_t hot_table_set(hot_table_t *t, uint32_t index, const reptile_t *r) {
+  if (index > t->count)
+    return ESP_ERR_INVALID_ARG;
+  if (hot_table_reserve(t, index + 1) != ESP_OK)
+    return ESP_ERR_NO_MEM;
+  if (t->strings == NULL) {
+    // Offset 0 is the shared empty string
+    if (!grow((void **)&t->strings, MIN_STRINGS))
+      return ESP_ERR_NO_MEM;
+    t->strings[0] = '\0';
+    t->strings_len = 1;
+    t->strings_cap = MIN_STRINGS;
+  }
+
+  bool existing = index < t->count;
+  if (hot_table_intern(t, &t->name[index], existing, r->name) != ESP_OK) {
+    ESP_LOGE(TAG, "Out of memory for names");
+    return ESP_ERR_NO_MEM;
+  }
+  if (!existing)
+    t->count++;
+
+  t->id[index] = r->id;
+  t->name_key[index] = hot_table_name_key(r->name);
+  t->last_feeding[index] = r->last_feeding;
+  t->species_common[index] = r->species_common;
+  t->active[index] = r->active;
+  t->species[index] = (uint8_t)r->species;
+  t->sex[index] = (uint8_t)r->sex;
+  t->cites_annex[index] = (uint8_t)r->cites_annex;
+  t->health[index] = (uint8_t)r->health;
+  t->terrarium[index] = r->terrarium_id;
+  return ESP_OK;
+}
+
+bool hot_table_needs_compaction(const hot_table_t *t) {
+  return t->strings_dead > MIN_STRINGS && t->strings_dead > t->strings_len / 2;
+}
+
+void hot_table_clear(hot_table_t *t) {
+  t->count = 0;
+  t->strings_len = t->strings ? 1 : 0;
+  t->strings_dead = 0;
+}
+
+uint64_t hot_table_name_key(const char *name) {
+  uint64_t key = 0;
+  for (int i = 0; i < 8; i++) {
+    uint8_t c = *name ? (uint8_t)*name++ : 0;
+    if (c >= 'A' && c <= 'Z')
+      c += 'a' - 'A';
+    key = key << 8 | c;
+  }
+  return key;
+}
+
+const char *hot_table_str(const hot_table_t *t, uint32_t offset) {
+  return t->strings ? t->strings + offset : "";
+}
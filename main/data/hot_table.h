@@ -0,0 +1,69 @@
+/**
+ * @file hot_table.h
+ * @brief Column store of the reptile fields read by list and alert scans
+ *
+ * A reptile_t is over a kilobyte, but lists, alert counts and the
+ * conformity page only read a handful of small fields. Those are mirrored
+ * here one array per field, so a scan reads tens of bytes per animal from a
+ * few contiguous arrays instead of striding through the full records. Names
+ * are packed in a string pool and referenced by offset.
+ */
+
+#ifndef HOT_TABLE_H
+#define HOT_TABLE_H
+
+#include "../models.h"
+#include "esp_err.h"
+#include <stdint.h>
+
+typedef struct {
+  uint32_t count;
+  uint32_t capacity;
+  uint32_t *id;
+  time_t *last_feeding;
+  uint32_t *name;            // Offset in `strings`
+  uint64_t *name_key;        // Name sort key, see hot_table_name_key()
+  str_ref_t *species_common; // Interned handle
+  uint8_t *active;
+  uint8_t *species;
+  uint8_t *sex;
+  uint8_t *cites_annex;
+  uint8_t *health;
+  uint8_t *terrarium;
+
+  char *strings; // NUL-terminated names; offset 0 is ""
+  uint32_t strings_len;
+  uint32_t strings_cap;
+  uint32_t strings_dead; // Bytes no row refers to any more
+} hot_table_t;
+
+/**
+ * @brief Copy the hot fields of record `index` into the columns
+ *
+ * `index` may be at most `count` (appending a row).
+ */
+esp_err_t hot_table_set(hot_table_t *t, uint32_t index, const reptile_t *r);
+
+/**
+ * @brief True if the string pool holds mostly dead names and should be
+ *        rebuilt with hot_table_clear() and hot_table_set() on every row
+ */
+bool hot_table_needs_compaction(const hot_table_t *t);
+
+/**
+ * @brief Drop all rows and strings; memory is kept for reuse
+ */
+void hot_table_clear(hot_table_t *t);
+
+/**
+ * @brief Sort key of a name: its first 8 bytes, ASCII letters folded to
+ *        lower case, big-endian, so keys order like strcasecmp() prefixes
+ */
+uint64_t hot_table_name_key(const char *name);
+
+/**
+ * @brief Name stored at a pool offset; valid until the next hot_table_set()
+ */
+const char *hot_table_str(const hot_table_t *t, uint32_t offset);
+
+#endif // HOT_TABLE_H
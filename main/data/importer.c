@@ -0,0 +1,690 @@
+/**
+ * @file importer.c
+ * @brief Streaming CSV/JSON bulk import
+ */
+
+#include "importer.h"
+#include "cJSON.h"
+#include "database.h"
+#include "esp_log.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <time.h>
+
+static const char *TAG = "IMPORT";
+
+#define IMPORT_TASK_STACK 6144
+#define IMPORT_TASK_PRIORITY 1 // Below the save task
+#define IMPORT_PATH_MAX 64
+#define IMPORT_MAX_FIELDS 48 // Per CSV row, known columns or not
+#define IMPORT_NUMBER_LEN 24 // JSON number formatted as text
+#define IMPORT_BATCH_ROWS 64 // Rows added per transaction
+
+// ====================================================================================
+// COLUMNS
+// ====================================================================================
+// Same names as the db_export_csv() header
+
+typedef enum {
+  COL_ID = 0,
+  COL_UUID,
+  COL_NAME,
+  COL_SPECIES_COMMON,
+  COL_SPECIES_SCIENTIFIC,
+  COL_MICROCHIP,
+  COL_SEX,
+  COL_BIRTH,
+  COL_BIRTH_ESTIMATED,
+  COL_CITES_ANNEX,
+  COL_CITES_PERMIT,
+  COL_DATE_ENTRY,
+  COL_ORIGIN,
+  COL_ORIGIN_COUNTRY,
+  COL_BREEDER,
+  COL_CAPTIVE_BRED,
+  COL_DATE_EXIT,
+  COL_EXIT_REASON,
+  COL_RECIPIENT_NAME,
+  COL_RECIPIENT_ADDRESS,
+  COL_WEIGHT,
+  COL_ACTIVE,
+  COL_COUNT
+} column_t;
+
+static const char *const column_names[COL_COUNT] = {
+    "ID",
+    "UUID",
+    "Nom",
+    "Espece_Commune",
+    "Espece_Scientifique",
+    "Identification",
+    "Sexe",
+    "Date_Naissance",
+    "Naissance_Estimee",
+    "CITES_Annexe",
+    "CITES_Permis",
+    "Date_Entree",
+    "Provenance",
+    "Pays_Origine",
+    "Eleveur_Nom",
+    "Ne_Captivite",
+    "Date_Sortie",
+    "Motif_Sortie",
+    "Destinataire_Nom",
+    "Destinataire_Adresse",
+    "Poids_Grammes",
+    "Actif",
+};
+
+static int column_find(const char *name) {
+  for (int c = 0; c < COL_COUNT; c++)
+    if (strcasecmp(name, column_names[c]) == 0)
+      return c;
+  return -1;
+}
+
+// ====================================================================================
+// IMPORT STATE
+// ====================================================================================
+
+typedef struct {
+  char row[IMPORT_ROW_MAX]; // Fields, each NUL-terminated
+  uint32_t len;
+  uint16_t start[IMPORT_MAX_FIELDS + 1]; // Offset of each field in `row`
+  int fields;                            // Completed fields
+  int8_t map[IMPORT_MAX_FIELDS];         // Field -> column_t, -1 to ignore
+  char sep;                              // ',' or ';', from the header
+  bool have_header;
+  bool quoted;   // Inside a quoted field
+  bool quote;    // Quote inside a quoted field: closing, or first of ""
+  bool overflow; // Row too long or too many fields
+} csv_reader_t;
+
+typedef struct {
+  char obj[IMPORT_ROW_MAX]; // Object being captured
+  uint32_t len;
+  int depth;     // Bracket nesting
+  int obj_depth; // Nesting at which the captured object opened
+  bool in_array; // The document is an array of objects
+  bool in_string;
+  bool escape;
+  bool capturing;
+  bool overflow; // Object too long
+} json_reader_t;
+
+// Texts interned once the row is added
+static const column_t interned[] = {COL_SPECIES_COMMON, COL_SPECIES_SCIENTIFIC,
+                                    COL_ORIGIN, COL_BREEDER};
+#define INTERNED_COUNT (sizeof(interned) / sizeof(interned[0]))
+
+// A validated row waiting for its batch
+typedef struct {
+  reptile_t record;
+  uint32_t row; // For the error message
+  char texts[INTERNED_COUNT][DB_TEXT_LEN];
+} import_staged_t;
+
+typedef struct {
+  import_result_t *res;
+  esp_err_t ret;                 // Stops the import once set
+  const char *values[COL_COUNT]; // Current row, NULL where absent
+  char numbers[COL_COUNT][IMPORT_NUMBER_LEN];
+  import_staged_t batch[IMPORT_BATCH_ROWS];
+  int staged;
+  union {
+    csv_reader_t csv;
+    json_reader_t json;
+  };
+} import_t;
+
+// ====================================================================================
+// ROW VALIDATION
+// ====================================================================================
+
+static const char *value(const import_t *im, column_t c) {
+  return im->values[c] ? im->values[c] : "";
+}
+
+// Copy into a fixed-size field; false if it does not fit
+static bool text_field(char *dst, size_t size, const char *s) {
+  size_t len = strlen(s);
+  if (len >= size)
+    return false;
+  memcpy(dst, s, len + 1);
+  return true;
+}
+
+static bool is_digit(char c) { return c >= '0' && c <= '9'; }
+
+static bool is_hex(char c) {
+  return is_digit(c) || (c >= 'a' && c <= 'f') || (c >= 'A' && c <= 'F');
+}
+
+// Empty, or 8-4-4-4-12 hex digits; stored in lower case so it dedupes
+static bool parse_uuid(const char *s, char *out) {
+  if (*s == '\0') {
+    *out = '\0';
+    return true;
+  }
+  if (strlen(s) != 36)
+    return false;
+  for (int i = 0; i < 36; i++) {
+    bool dash = i == 8 || i == 13 || i == 18 || i == 23;
+    if (dash ? s[i] != '-' : !is_hex(s[i]))
+      return false;
+    out[i] = (s[i] >= 'A' && s[i] <= 'F') ? s[i] + ('a' - 'A') : s[i];
+  }
+  out[36] = '\0';
+  return true;
+}
+
+// YYYY-MM-DD, as written by csv_ymd()
+static bool parse_ymd(const char *s, int *year, int *month, int *day) {
+  for (int i = 0; i < 10; i++)
+    if ((i == 4 || i == 7) ? s[i] != '-' : !is_digit(s[i]))
+      return false;
+  if (s[10] != '\0')
+    return false;
+  *year = (s[0] - '0') * 1000 + (s[1] - '0') * 100 + (s[2] - '0') * 10 +
+          (s[3] - '0');
+  *month = (s[5] - '0') * 10 + (s[6] - '0');
+  *day = (s[8] - '0') * 10 + (s[9] - '0');
+  return *year >= 1900 && *month >= 1 && *month <= 12 && *day >= 1 &&
+         *day <= 31;
+}
+
+// Local noon of the day, so the date reads back the same in any DST state
+static bool parse_date(const char *s, time_t *out) {
+  int year, month, day;
+  if (*s == '\0') {
+    *out = 0;
+    return true;
+  }
+  if (!parse_ymd(s, &year, &month, &day))
+    return false;
+  struct tm tm = {.tm_year = year - 1900,
+                  .tm_mon = month - 1,
+                  .tm_mday = day,
+                  .tm_hour = 12,
+                  .tm_isdst = -1};
+  *out = mktime(&tm);
+  return *out != (time_t)-1;
+}
+
+static bool parse_flag(const char *s, bool fallback, bool *out) {
+  if (*s == '\0')
+    *out = fallback;
+  else if (strcasecmp(s, "Oui") == 0 || strcmp(s, "1") == 0)
+    *out = true;
+  else if (strcasecmp(s, "Non") == 0 || strcmp(s, "0") == 0)
+    *out = false;
+  else
+    return false;
+  return true;
+}
+
+static bool parse_sex(const char *s, reptile_sex_t *out) {
+  if (strcasecmp(s, "M") == 0)
+    *out = SEX_MALE;
+  else if (strcasecmp(s, "F") == 0)
+    *out = SEX_FEMALE;
+  else if (*s == '\0' || strcmp(s, "?") == 0)
+    *out = SEX_UNKNOWN;
+  else
+    return false;
+  return true;
+}
+
+// Inverse of db_cites_annex_to_string()
+static bool parse_cites(const char *s, cites_annex_t *out) {
+  if (*s == '\0') {
+    *out = CITES_NOT_LISTED;
+    return true;
+  }
+  for (int a = CITES_NOT_LISTED; a <= CITES_ANNEX_D; a++) {
+    if (strcasecmp(s, db_cites_annex_to_string(a)) == 0) {
+      *out = a;
+      return true;
+    }
+  }
+  return false;
+}
+
+// Inverse of db_exit_reason_to_string()
+static bool parse_exit_reason(const char *s, exit_reason_t *out) {
+  for (int e = EXIT_NONE; e <= EXIT_CONFISCATED; e++) {
+    if (strcasecmp(s, db_exit_reason_to_string(e)) == 0) {
+      *out = e;
+      return true;
+    }
+  }
+  return false;
+}
+
+static bool parse_grams(const char *s, uint16_t *out) {
+  uint32_t v = 0;
+  for (; *s; s++) {
+    if (!is_digit(*s) || (v = v * 10 + (*s - '0')) > UINT16_MAX)
+      return false;
+  }
+  *out = (uint16_t)v;
+  return true;
+}
+
+// Fill `r` from the current row; the first invalid column, or COL_COUNT.
+// Interned texts are left to import_flush(), once the row is accepted.
+static column_t parse_row(const import_t *im, reptile_t *r) {
+  int year, month, day;
+  const char *birth = value(im, COL_BIRTH);
+
+  memset(r, 0, sizeof(*r));
+  r->species = SPECIES_OTHER;
+  if (*value(im, COL_NAME) == '\0' ||
+      !text_field(r->name, sizeof(r->name), value(im, COL_NAME)))
+    return COL_NAME;
+  if (!parse_uuid(value(im, COL_UUID), r->uuid))
+    return COL_UUID;
+  if (!text_field(r->microchip, sizeof(r->microchip),
+                  value(im, COL_MICROCHIP)))
+    return COL_MICROCHIP;
+  if (!parse_sex(value(im, COL_SEX), &r->sex))
+    return COL_SEX;
+  if (*birth != '\0') {
+    if (!parse_ymd(birth, &year, &month, &day))
+      return COL_BIRTH;
+    r->birth_year = year;
+    r->birth_month = month;
+    r->birth_day = day;
+  }
+  if (!parse_flag(value(im, COL_BIRTH_ESTIMATED), false, &r->birth_estimated))
+    return COL_BIRTH_ESTIMATED;
+  if (!parse_cites(value(im, COL_CITES_ANNEX), &r->cites_annex))
+    return COL_CITES_ANNEX;
+  if (!text_field(r->cites_permit, sizeof(r->cites_permit),
+                  value(im, COL_CITES_PERMIT)))
+    return COL_CITES_PERMIT;
+  if (!parse_date(value(im, COL_DATE_ENTRY), &r->date_acquisition))
+    return COL_DATE_ENTRY;
+  if (!text_field(r->origin_country, sizeof(r->origin_country),
+                  value(im, COL_ORIGIN_COUNTRY)))
+    return COL_ORIGIN_COUNTRY;
+  if (!parse_flag(value(im, COL_CAPTIVE_BRED), false, &r->captive_bred))
+    return COL_CAPTIVE_BRED;
+  if (!parse_date(value(im, COL_DATE_EXIT), &r->date_exit))
+    return COL_DATE_EXIT;
+  if (!parse_exit_reason(value(im, COL_EXIT_REASON), &r->exit_reason))
+    return COL_EXIT_REASON;
+  if (!text_field(r->recipient_name, sizeof(r->recipient_name),
+                  value(im, COL_RECIPIENT_NAME)))
+    return COL_RECIPIENT_NAME;
+  if (!text_field(r->recipient_address, sizeof(r->recipient_address),
+                  value(im, COL_RECIPIENT_ADDRESS)))
+    return COL_RECIPIENT_ADDRESS;
+  if (!parse_grams(value(im, COL_WEIGHT), &r->weight_grams))
+    return COL_WEIGHT;
+  if (!parse_flag(value(im, COL_ACTIVE), true, &r->active))
+    return COL_ACTIVE;
+
+  for (size_t i = 0; i < INTERNED_COUNT; i++)
+    if (strlen(value(im, interned[i])) > DB_TEXT_LEN - 1)
+      return interned[i];
+  return COL_COUNT;
+}
+
+static void import_reject(import_t *im, uint32_t row, const char *what,
+                          const char *why) {
+  im->res->rejected++;
+  if (im->res->first_error_row == 0) {
+    im->res->first_error_row = row;
+    snprintf(im->res->first_error, sizeof(im->res->first_error), "%s %s",
+             what, why);
+    ESP_LOGW(TAG, "Row %u: %s %s", (unsigned)row, what, why);
+  }
+}
+
+// Dedupe and add the staged rows in one transaction. The database lock is
+// held for these inserts only, never while the card is read: a file is
+// imported as several transactions.
+static void import_flush(import_t *im) {
+  db_txn_begin();
+  for (int i = 0; i < im->staged && im->ret == ESP_OK; i++) {
+    import_staged_t *s = &im->batch[i];
+    reptile_t *r = &s->record;
+    // Checked here, so a row added earlier in the file counts too
+    if (db_find_reptile_by_uuid(r->uuid) >= 0 ||
+        db_find_reptile_by_microchip(r->microchip) >= 0) {
+      im->res->duplicates++;
+      continue;
+    }
+
+    r->species_common = db_intern_string(s->texts[0]);
+    r->species_scientific = db_intern_string(s->texts[1]);
+    r->origin = db_intern_string(s->texts[2]);
+    r->breeder_name = db_intern_string(s->texts[3]);
+
+    int count = db_get_reptile_count();
+    db_update_reptile(-1, r);
+    if (db_get_reptile_count() == count) {
+      import_reject(im, s->row, "Registre", "plein");
+      im->ret = ESP_ERR_NO_MEM; // Every later row would fail the same way
+      break;
+    }
+    im->res->imported++;
+  }
+  db_txn_commit();
+  im->staged = 0;
+}
+
+// Validate the row in `values` and stage it for the next batch
+static void import_row(import_t *im) {
+  import_staged_t *s = &im->batch[im->staged];
+  column_t bad = parse_row(im, &s->record);
+  if (bad != COL_COUNT) {
+    import_reject(im, im->res->rows, column_names[bad],
+                  *value(im, bad) == '\0' ? "manquant" : "invalide");
+    return;
+  }
+  s->row = im->res->rows;
+  for (size_t i = 0; i < INTERNED_COUNT; i++)
+    strcpy(s->texts[i], value(im, interned[i])); // Length checked above
+  if (++im->staged == IMPORT_BATCH_ROWS)
+    import_flush(im);
+}
+
+// ====================================================================================
+// CSV
+// ====================================================================================
+
+// Separator of the header line: whichever of ',' and ';' it has more of
+static char csv_detect_sep(const char *p, size_t n) {
+  int commas = 0, semicolons = 0;
+  for (size_t i = 0; i < n && p[i] != '\n'; i++) {
+    commas += p[i] == ',';
+    semicolons += p[i] == ';';
+  }
+  return semicolons > commas ? ';' : ',';
+}
+
+static void csv_put(csv_reader_t *c, char ch) {
+  if (c->len + 1 < IMPORT_ROW_MAX) // Room left for the NUL
+    c->row[c->len++] = ch;
+  else
+    c->overflow = true;
+}
+
+static void csv_end_field(csv_reader_t *c) {
+  if (c->fields == IMPORT_MAX_FIELDS || c->len >= IMPORT_ROW_MAX) {
+    c->overflow = true;
+    return;
+  }
+  c->row[c->len++] = '\0';
+  c->start[++c->fields] = c->len;
+}
+
+static void csv_header(import_t *im) {
+  csv_reader_t *c = &im->csv;
+  bool named = false;
+  for (int f = 0; f < c->fields; f++) {
+    const char *name = c->row + c->start[f];
+    if (f == 0 && strncmp(name, "\xEF\xBB\xBF", 3) == 0)
+      name += 3; // UTF-8 BOM left by spreadsheets
+    c->map[f] = column_find(name);
+    named |= c->map[f] == COL_NAME;
+  }
+  if (c->overflow || !named) {
+    ESP_LOGE(TAG, "CSV header has no \"Nom\" column");
+    im->ret = ESP_ERR_INVALID_ARG;
+  }
+  c->have_header = true;
+}
+
+static void csv_end_row(import_t *im) {
+  csv_reader_t *c = &im->csv;
+  if (c->len == 0 && c->fields == 0 && !c->overflow)
+    return; // Blank line
+  csv_end_field(c);
+
+  if (!c->have_header) {
+    csv_header(im);
+  } else {
+    im->res->rows++;
+    if (c->overflow) {
+      import_reject(im, im->res->rows, "Ligne", "trop longue");
+    } else {
+      memset(im->values, 0, sizeof(im->values));
+      for (int f = 0; f < c->fields; f++)
+        if (c->map[f] >= 0)
+          im->values[c->map[f]] = c->row + c->start[f];
+      import_row(im);
+    }
+  }
+  c->len = 0;
+  c->fields = 0;
+  c->overflow = false;
+}
+
+// RFC 4180: fields may be quoted, with "" for a quote; quoted fields may
+// hold separators and line breaks. State carries over between chunks.
+static void csv_feed(import_t *im, const char *p, size_t n) {
+  csv_reader_t *c = &im->csv;
+  if (c->sep == '\0')
+    c->sep = csv_detect_sep(p, n);
+  for (size_t i = 0; i < n && im->ret == ESP_OK; i++) {
+    char ch = p[i];
+    if (c->quoted) {
+      if (!c->quote) {
+        if (ch == '"')
+          c->quote = true;
+        else
+          csv_put(c, ch);
+        continue;
+      }
+      c->quote = false;
+      if (ch == '"') {
+        csv_put(c, '"');
+        continue;
+      }
+      c->quoted = false; // That was the closing quote
+    }
+    if (ch == c->sep)
+      csv_end_field(c);
+    else if (ch == '\n')
+      csv_end_row(im);
+    else if (ch == '"' && c->len == c->start[c->fields])
+      c->quoted = true;
+    else if (ch != '\r')
+      csv_put(c, ch);
+  }
+}
+
+// Last row without a final line break
+static void csv_finish(import_t *im) {
+  if (im->ret == ESP_OK && (im->csv.len > 0 || im->csv.fields > 0))
+    csv_end_row(im);
+  if (!im->csv.have_header) {
+    ESP_LOGE(TAG, "CSV file is empty");
+    im->ret = ESP_ERR_INVALID_ARG;
+  }
+}
+
+// ====================================================================================
+// JSON
+// ====================================================================================
+
+static void json_object(import_t *im) {
+  json_reader_t *j = &im->json;
+  im->res->rows++;
+  if (j->overflow) {
+    import_reject(im, im->res->rows, "Objet", "trop long");
+    return;
+  }
+  cJSON *obj = cJSON_ParseWithLength(j->obj, j->len);
+  if (!cJSON_IsObject(obj)) {
+    import_reject(im, im->res->rows, "JSON", "invalide");
+    cJSON_Delete(obj);
+    return;
+  }
+
+  memset(im->values, 0, sizeof(im->values));
+  const cJSON *item;
+  cJSON_ArrayForEach(item, obj) {
+    int c = column_find(item->string);
+    if (c < 0)
+      continue;
+    if (cJSON_IsString(item)) {
+      im->values[c] = item->valuestring;
+    } else if (cJSON_IsNumber(item)) {
+      // %.15g keeps integers (microchips included) free of exponents
+      snprintf(im->numbers[c], IMPORT_NUMBER_LEN, "%.15g", item->valuedouble);
+      im->values[c] = im->numbers[c];
+    } else if (cJSON_IsBool(item)) {
+      im->values[c] = cJSON_IsTrue(item) ? "Oui" : "Non";
+    } else if (!cJSON_IsNull(item)) {
+      im->values[c] = "[]"; // Arrays and objects never validate
+    }
+  }
+  import_row(im);
+  cJSON_Delete(obj);
+}
+
+// Cut the stream into top-level objects (array elements, or one object per
+// line) without parsing them; each is handed whole to cJSON
+static void json_feed(import_t *im, const char *p, size_t n) {
+  json_reader_t *j = &im->json;
+  for (size_t i = 0; i < n && im->ret == ESP_OK; i++) {
+    char ch = p[i];
+    if (j->capturing) {
+      if (j->len + 1 < IMPORT_ROW_MAX)
+        j->obj[j->len++] = ch;
+      else
+        j->overflow = true;
+    }
+    if (j->in_string) {
+      if (j->escape)
+        j->escape = false;
+      else if (ch == '\\')
+        j->escape = true;
+      else if (ch == '"')
+        j->in_string = false;
+      continue;
+    }
+    switch (ch) {
+    case '"':
+      j->in_string = true;
+      break;
+    case '[':
+    case '{':
+      if (ch == '{' && !j->capturing && j->depth == (j->in_array ? 1 : 0)) {
+        j->obj[0] = '{';
+        j->len = 1;
+        j->obj_depth = j->depth;
+        j->capturing = true;
+        j->overflow = false;
+      } else if (ch == '[' && j->depth == 0) {
+        j->in_array = true;
+      }
+      j->depth++;
+      break;
+    case ']':
+    case '}':
+      if (j->depth > 0)
+        j->depth--;
+      if (j->capturing && j->depth == j->obj_depth) {
+        j->capturing = false;
+        json_object(im);
+      }
+      break;
+    }
+  }
+}
+
+// ====================================================================================
+// PUBLIC API
+// ====================================================================================
+
+esp_err_t import_file(const char *path, import_result_t *out) {
+  memset(out, 0, sizeof(*out));
+  size_t n = strlen(path);
+  bool json = n > 5 && strcasecmp(path + n - 5, ".json") == 0;
+
+  FILE *f = fopen(path, "rb");
+  if (f == NULL) {
+    ESP_LOGE(TAG, "Cannot open %s", path);
+    return ESP_ERR_NOT_FOUND;
+  }
+  import_t *im = calloc(1, sizeof(*im));
+  char *chunk = malloc(IMPORT_CHUNK_BYTES);
+  if (im == NULL || chunk == NULL) {
+    ESP_LOGE(TAG, "Out of memory for import buffers");
+    free(im);
+    free(chunk);
+    fclose(f);
+    return ESP_ERR_NO_MEM;
+  }
+  im->res = out;
+
+  // Rows are added a batch at a time as they are read; a read error keeps
+  // those already read
+  size_t len;
+  while (im->ret == ESP_OK &&
+         (len = fread(chunk, 1, IMPORT_CHUNK_BYTES, f)) > 0) {
+    if (json)
+      json_feed(im, chunk, len);
+    else
+      csv_feed(im, chunk, len);
+  }
+  if (ferror(f)) {
+    ESP_LOGE(TAG, "Read error in %s", path);
+    im->ret = ESP_FAIL;
+  } else if (!json) {
+    csv_finish(im);
+  }
+  if (im->staged > 0)
+    import_flush(im);
+
+  esp_err_t ret = im->ret;
+  free(chunk);
+  free(im);
+  fclose(f);
+  ESP_LOGI(TAG, "%s: %u rows, %u imported, %u duplicates, %u rejected", path,
+           (unsigned)out->rows, (unsigned)out->imported,
+           (unsigned)out->duplicates, (unsigned)out->rejected);
+  return ret;
+}
+
+static char import_path[IMPORT_PATH_MAX];
+static import_result_t import_live; // Counts of the running import
+static volatile import_state_t import_state = IMPORT_IDLE;
+
+static void import_task(void *arg) {
+  esp_err_t ret = import_file(import_path, &import_live);
+  import_state = ret == ESP_OK ? IMPORT_DONE : IMPORT_FAILED;
+  vTaskDelete(NULL);
+}
+
+esp_err_t import_start(const char *path) {
+  if (import_state == IMPORT_RUNNING)
+    return ESP_ERR_INVALID_STATE;
+  if (strlen(path) >= sizeof(import_path))
+    return ESP_ERR_INVALID_ARG;
+  strcpy(import_path, path);
+  memset(&import_live, 0, sizeof(import_live));
+  import_state = IMPORT_RUNNING;
+  if (xTaskCreate(import_task, "db_import", IMPORT_TASK_STACK, NULL,
+                  IMPORT_TASK_PRIORITY, NULL) != pdPASS) {
+    ESP_LOGE(TAG, "Failed to start import task");
+    import_state = IMPORT_FAILED;
+    return ESP_FAIL;
+  }
+  return ESP_OK;
+}
+
+import_state_t import_progress(import_result_t *out) {
+  *out = import_live;
+  return import_state;
+}
@@ -0,0 +1,76 @@
+/**
+ * @file importer.h
+ * @brief Streaming bulk import of animals from CSV or JSON on the SD card
+ *
+ * Migrates a registre kept elsewhere (a spreadsheet, another program) in one
+ * pass. The file is read in IMPORT_CHUNK_BYTES pieces and parsed as it
+ * streams, so its size is not limited by RAM: only the row (CSV) or object
+ * (JSON) being parsed is held at once.
+ *
+ * CSV uses the columns of db_export_csv(), matched by header name in any
+ * order; unknown columns are ignored, "Nom" is required. Comma or semicolon
+ * separated (spreadsheets in French locales use ';'), RFC 4180 quoting, an
+ * optional UTF-8 BOM. JSON is an array of objects, or one object per line,
+ * keyed by the same names; numbers and booleans are accepted where the CSV
+ * holds digits or Oui/Non. The "ID" column is ignored: imported animals get
+ * new IDs.
+ *
+ * Rows are validated before anything is stored; a rejected row is counted
+ * and skipped. A row whose UUID or microchip is already in the registre
+ * (including one added earlier in the same file) is a duplicate and
+ * skipped, so importing the same file twice adds nothing.
+ *
+ * Validated rows are added 64 at a time, each batch in one transaction: the
+ * database lock is never held while the card is read, so the UI and the
+ * other modifiers keep going while a file is imported as several
+ * transactions. A batch too large for the undo log is not undoable.
+ */
+
+#ifndef IMPORTER_H
+#define IMPORTER_H
+
+#include "esp_err.h"
+#include <stdint.h>
+
+#define IMPORT_CHUNK_BYTES (16 * 1024) // Read size from the SD card
+#define IMPORT_ROW_MAX 2048            // Longest CSV row or JSON object
+#define IMPORT_ERROR_LEN 48
+
+typedef struct {
+  uint32_t rows;       // Rows (CSV) or objects (JSON) read
+  uint32_t imported;   // Added to the registre
+  uint32_t duplicates; // UUID or microchip already known
+  uint32_t rejected;   // Failed validation, or the registre is full
+  uint32_t first_error_row;             // 1-based data row, 0 if none
+  char first_error[IMPORT_ERROR_LEN]; // Why it was rejected
+} import_result_t;
+
+typedef enum {
+  IMPORT_IDLE = 0,
+  IMPORT_RUNNING,
+  IMPORT_DONE,
+  IMPORT_FAILED,
+} import_state_t;
+
+/**
+ * @brief Import `path`: JSON if it ends in ".json", CSV otherwise
+ *
+ * Blocks on the SD card: do not call from the LVGL task.
+ * @return ESP_ERR_NOT_FOUND if the file cannot be opened,
+ *         ESP_ERR_INVALID_ARG if the CSV header has no "Nom" column,
+ *         ESP_ERR_NO_MEM, or ESP_OK; `out` is filled in every case
+ */
+esp_err_t import_file(const char *path, import_result_t *out);
+
+/**
+ * @brief Run import_file() on its own task; poll with import_progress()
+ * @return ESP_ERR_INVALID_STATE if an import is already running
+ */
+esp_err_t import_start(const char *path);
+
+/**
+ * @brief State of the last import_start(); `out` gets the counts so far
+ */
+import_state_t import_progress(import_result_t *out);
+
+#endif // IMPORTER_H
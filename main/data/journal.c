@@ -0,0 +1,136 @@
+/**
+ * @file journal.c
+ * @brief Append-only write-ahead journal implementation
+ */
+
+#include "journal.h"
+#include "esp_log.h"
+#include "esp_rom_crc.h"
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+static const char *TAG = "JOURNAL";
+
+static size_t journal_bytes = 0;
+static uint32_t last_seq = 0;
+
+static uint32_t journal_crc(const journal_rec_header_t *hdr,
+                            const void *payload) {
+  uint32_t crc = esp_rom_crc32_le(0, &hdr->type, sizeof(hdr->type));
+  crc = esp_rom_crc32_le(crc, (const uint8_t *)&hdr->length,
+                         sizeof(hdr->length));
+  crc = esp_rom_crc32_le(crc, (const uint8_t *)&hdr->seq, sizeof(hdr->seq));
+  return esp_rom_crc32_le(crc, payload, hdr->length);
+}
+
+size_t journal_encode(journal_rec_type_t type, const void *payload,
+                      uint16_t length, uint8_t *out, size_t cap) {
+  if (length > JOURNAL_MAX_PAYLOAD ||
+      sizeof(journal_rec_header_t) + length > cap)
+    return 0;
+
+  journal_rec_header_t hdr = {
+      .type = (uint8_t)type, .length = length, .seq = last_seq + 1};
+  hdr.crc = journal_crc(&hdr, payload);
+  last_seq = hdr.seq;
+  memcpy(out, &hdr, sizeof(hdr));
+  memcpy(out + sizeof(hdr), payload, length);
+  return sizeof(hdr) + length;
+}
+
+esp_err_t journal_write(const void *records, size_t length) {
+  if (length == 0)
+    return ESP_OK;
+
+  FILE *f = fopen(JOURNAL_FILE_PATH, "ab");
+  if (f == NULL) {
+    ESP_LOGE(TAG, "Failed to open journal for append");
+    return ESP_FAIL;
+  }
+  size_t ok = fwrite(records, length, 1, f);
+  fclose(f);
+
+  if (ok != 1) {
+    ESP_LOGE(TAG, "Short write on journal");
+    return ESP_FAIL;
+  }
+  journal_bytes += length;
+  return ESP_OK;
+}
+
+int journal_replay(journal_apply_cb_t apply, uint32_t after_seq) {
+  journal_bytes = 0;
+  last_seq = after_seq;
+  FILE *f = fopen(JOURNAL_FILE_PATH, "rb");
+  if (f == NULL)
+    return 0;
+
+  static uint8_t payload[JOURNAL_MAX_PAYLOAD];
+  journal_rec_header_t hdr;
+  size_t valid = 0;
+  int applied = 0;
+  bool orphan = false;
+
+  while (fread(&hdr, sizeof(hdr), 1, f) == 1) {
+    if (hdr.length > JOURNAL_MAX_PAYLOAD)
+      break;
+    if (hdr.length > 0 && fread(payload, hdr.length, 1, f) != 1)
+      break; // Torn tail
+    if (journal_crc(&hdr, payload) != hdr.crc)
+      break;
+    valid += sizeof(hdr) + hdr.length;
+    if (hdr.seq <= after_seq)
+      continue; // Already part of the snapshot
+    if (hdr.seq != last_seq + 1) {
+      ESP_LOGE(TAG, "Journal resumes at record %u, records %u-%u are lost",
+               (unsigned)hdr.seq, (unsigned)(last_seq + 1),
+               (unsigned)(hdr.seq - 1));
+      orphan = true;
+      break;
+    }
+    apply((journal_rec_type_t)hdr.type, payload, hdr.length);
+    last_seq = hdr.seq;
+    applied++;
+  }
+
+  fseek(f, 0, SEEK_END);
+  long total = ftell(f);
+  fclose(f);
+
+  if (orphan) {
+    // Keep what could not be applied; the next append starts a new file
+    remove(JOURNAL_KEPT_PATH);
+    if (rename(JOURNAL_FILE_PATH, JOURNAL_KEPT_PATH) == 0)
+      ESP_LOGE(TAG, "Unapplied journal kept as %s", JOURNAL_KEPT_PATH);
+    else
+      ESP_LOGE(TAG, "Failed to set the unapplied journal aside");
+    journal_bytes = 0;
+    return applied;
+  }
+  if (total > 0 && (size_t)total != valid) {
+    ESP_LOGW(TAG, "Discarding %ld bytes of torn journal tail",
+             total - (long)valid);
+    truncate(JOURNAL_FILE_PATH, valid);
+  }
+  journal_bytes = valid;
+  ESP_LOGI(TAG, "Replayed %d journal records (%u bytes)", applied,
+           (unsigned)valid);
+  return applied;
+}
+
+esp_err_t journal_reset(void) {
+  struct stat st;
+  if (stat(JOURNAL_FILE_PATH, &st) == 0 && unlink(JOURNAL_FILE_PATH) != 0) {
+    ESP_LOGE(TAG, "Failed to remove journal");
+    return ESP_FAIL;
+  }
+  journal_bytes = 0;
+  return ESP_OK;
+}
+
+size_t journal_size(void) { return journal_bytes; }
+
+uint32_t journal_last_seq(void) { return last_seq; }
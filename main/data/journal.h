@@ -0,0 +1,203 @@
+/**
+ * @file journal.h
+ * @brief Append-only write-ahead journal for the Reptile Manager database
+ *
+ * Small typed records are appended to the SD card instead of rewriting the
+ * whole snapshot on every edit. At boot the journal is replayed on top of the
+ * last snapshot; a checkpoint writes a new snapshot and empties the journal.
+ */
+
+#ifndef JOURNAL_H
+#define JOURNAL_H
+
+#include "esp_err.h"
+#include <stddef.h>
+#include <stdint.h>
+
+#ifndef SD_ROOT
+#define SD_ROOT "/sdcard" // Mount point of the card, see main.c
+#endif
+
+#define JOURNAL_FILE_PATH SD_ROOT "/reptile_data.jnl"
+// A journal that does not follow the loaded snapshot is moved here, unapplied
+#define JOURNAL_KEPT_PATH SD_ROOT "/reptile_data.jnl.orphan"
+
+// Checkpoint once the journal grows past this size
+#define JOURNAL_CHECKPOINT_BYTES (16 * 1024)
+
+// ====================================================================================
+// RECORD TYPES
+// ====================================================================================
+
+typedef enum {
+  JOURNAL_REC_FEEDING = 1,     // journal_feeding_t
+  JOURNAL_REC_WEIGHT,          // journal_weight_t
+  JOURNAL_REC_SHED,            // journal_shed_t
+  JOURNAL_REC_FIELD,           // journal_field_t (schema v2 only, replay-only)
+  JOURNAL_REC_HEALTH,          // journal_health_t
+  JOURNAL_REC_FIELDS,          // journal_fields_t + tagged values
+  JOURNAL_REC_BATCH,           // journal_batch_entry_t + payload, repeated
+  JOURNAL_REC_BREEDING,        // journal_breeding_t
+  JOURNAL_REC_INVENTORY,       // journal_inventory_t
+  JOURNAL_REC_INVENTORY_COUNT, // journal_inventory_count_t
+} journal_rec_type_t;
+
+// On-disk record header, followed by `length` payload bytes
+typedef struct __attribute__((packed)) {
+  uint8_t type;
+  uint8_t reserved;
+  uint16_t length;
+  uint32_t seq; // Monotonic; snapshots record the last seq they contain
+  uint32_t crc; // CRC32 of type, length, seq and payload
+} journal_rec_header_t;
+
+typedef struct __attribute__((packed)) {
+  uint16_t index; // Reptile slot
+  int64_t timestamp;
+  uint8_t prey_count;
+  char prey_type[24];
+  uint8_t accepted; // 0 if refused; older records end before it (eaten)
+} journal_feeding_t;
+
+typedef struct __attribute__((packed)) {
+  uint16_t index;
+  int64_t timestamp;
+  uint16_t grams;
+} journal_weight_t;
+
+typedef struct __attribute__((packed)) {
+  uint16_t index;
+  int64_t timestamp;
+} journal_shed_t;
+
+typedef struct __attribute__((packed)) {
+  uint16_t index;
+  int64_t timestamp;
+  char event_type[24];
+  char description[64];
+} journal_health_t;
+
+// Whole clutch record; an index equal to the clutch count appends it
+typedef struct __attribute__((packed)) {
+  uint16_t index; // Clutch slot
+  uint32_t id;
+  uint32_t female_id;
+  uint32_t male_id;
+  int64_t pairing_date;
+  int64_t laying_date;
+  int64_t hatch_date;
+  uint8_t egg_count;
+  uint8_t hatched_count;
+  uint8_t active;
+} journal_breeding_t;
+
+// Whole inventory item, set or restocked
+typedef struct __attribute__((packed)) {
+  uint16_t index;
+  char name[24];
+  uint16_t quantity;
+  uint16_t alert_threshold;
+  char unit[8];
+} journal_inventory_t;
+
+// Size of the inventory table; new items start zeroed
+typedef struct __attribute__((packed)) {
+  uint16_t count;
+} journal_inventory_count_t;
+
+// Byte-range patch of a raw schema v2 reptile_t. No longer written; replayed
+// through the frozen v2 layout when upgrading an old card.
+typedef struct __attribute__((packed)) {
+  uint16_t index;
+  uint16_t offset;
+  uint16_t length;
+  uint8_t data[];
+} journal_field_t;
+
+// Field patch of a reptile_t: `count` journal_field_value_t entries follow,
+// each with `width` value bytes in db_schema encoding. An index equal to the
+// current reptile count appends a new, zero-initialised record first.
+typedef struct __attribute__((packed)) {
+  uint16_t index;
+  uint8_t count;
+  uint8_t reserved;
+  uint8_t data[];
+} journal_fields_t;
+
+typedef struct __attribute__((packed)) {
+  uint16_t tag;
+  uint16_t width;
+} journal_field_value_t;
+
+// Records of one transaction, replayed together or not at all: the batch
+// has a single CRC. Each entry is followed by `length` payload bytes of its
+// type; batches do not nest.
+typedef struct __attribute__((packed)) {
+  uint8_t type;
+  uint8_t reserved;
+  uint16_t length;
+} journal_batch_entry_t;
+
+// Largest payload accepted by journal_append()/journal_replay()
+#define JOURNAL_MAX_PAYLOAD 2048
+
+// ====================================================================================
+// API
+// ====================================================================================
+
+/**
+ * @brief Callback invoked for every valid record during replay
+ */
+typedef void (*journal_apply_cb_t)(journal_rec_type_t type, const void *payload,
+                                   uint16_t length);
+
+/**
+ * @brief Encode one record (header + payload) into a caller buffer
+ *
+ * Assigns the next sequence number; callers must serialise encoding.
+ *
+ * @return Bytes written to `out`, or 0 if it does not fit
+ */
+size_t journal_encode(journal_rec_type_t type, const void *payload,
+                      uint16_t length, uint8_t *out, size_t cap);
+
+/**
+ * @brief Append a block of encoded records to the journal file in one write
+ * @return ESP_OK on success
+ */
+esp_err_t journal_write(const void *records, size_t length);
+
+/**
+ * @brief Replay every valid record newer than `after_seq`, in order
+ *
+ * Records already folded into the snapshot (seq <= after_seq) are skipped,
+ * so a crash between writing a snapshot and emptying the journal is safe.
+ * Stops at the first torn or corrupted record and truncates the file there,
+ * so the next append starts on a clean boundary.
+ *
+ * The records applied must continue the snapshot without a gap: a journal
+ * that resumes past `after_seq` + 1 was written on top of a newer snapshot
+ * than the one loaded (an older generation was recovered) or lost records.
+ * Replay then stops there and the file is moved to JOURNAL_KEPT_PATH for the
+ * user, since patching it onto this base would corrupt the records.
+ *
+ * @return Number of records applied
+ */
+int journal_replay(journal_apply_cb_t apply, uint32_t after_seq);
+
+/**
+ * @brief Sequence number of the last record encoded or replayed
+ */
+uint32_t journal_last_seq(void);
+
+/**
+ * @brief Empty the journal (after a successful checkpoint)
+ */
+esp_err_t journal_reset(void);
+
+/**
+ * @brief Current journal size in bytes
+ */
+size_t journal_size(void);
+
+#endif // JOURNAL_H
@@ -0,0 +1,175 @@
+/**
+ * @file query.c
+ * @brief Animal query implementation
+ */
+
+#include "query.h"
+#include "esp_heap_caps.h"
+#include "esp_log.h"
+#include <string.h>
+#include <strings.h>
+
+static const char *TAG = "QUERY";
+
+#define MIN_ROWS 64
+
+typedef struct {
+  uint64_t key;
+  uint32_t row;
+} sort_item_t;
+
+static bool grow(void **buf, uint32_t *cap, uint32_t need, size_t size) {
+  if (need <= *cap)
+    return true;
+  uint32_t n = *cap ? *cap : MIN_ROWS;
+  while (n < need)
+    n *= 2;
+  void *p = heap_caps_realloc_prefer(*buf, (size_t)n * size, 2,
+                                     MALLOC_CAP_SPIRAM, MALLOC_CAP_DEFAULT);
+  if (p == NULL)
+    return false;
+  *buf = p;
+  *cap = n;
+  return true;
+}
+
+static bool matches(const hot_table_t *t, const due_queue_t *due,
+                    const query_t *q, uint32_t i) {
+  uint32_t w = q->where;
+  return ((w & QUERY_INACTIVE) || t->active[i]) &&
+         (!(w & QUERY_SPECIES) || t->species[i] == q->species) &&
+         (!(w & QUERY_SEX) || t->sex[i] == q->sex) &&
+         (!(w & QUERY_CITES) || t->cites_annex[i] == q->cites_annex) &&
+         (!(w & QUERY_CITES_LISTED) ||
+          t->cites_annex[i] != CITES_NOT_LISTED) &&
+         (!(w & QUERY_TERRARIUM) || t->terrarium[i] == q->terrarium_id) &&
+         (!(w & QUERY_HEALTH) || t->health[i] == q->health) &&
+         (!(w & QUERY_FEEDING_DUE) || due_queue_is_due(due, i));
+}
+
+static uint64_t sort_key(const hot_table_t *t, query_sort_t sort, uint32_t i) {
+  switch (sort) {
+  case QUERY_SORT_NAME:
+    return t->name_key[i];
+  case QUERY_SORT_ID:
+    return t->id[i];
+  case QUERY_SORT_SPECIES:
+    return (uint64_t)t->species[i] << 56 | t->name_key[i] >> 8;
+  case QUERY_SORT_LAST_FEEDING:
+    return (uint64_t)t->last_feeding[i] ^ (1ULL << 63); // Signed order
+  default:
+    return i;
+  }
+}
+
+// Order of two items: key, then (for name orders) the full name, then row
+static int compare(const hot_table_t *t, query_sort_t sort,
+                   const sort_item_t *a, const sort_item_t *b) {
+  if (a->key != b->key)
+    return a->key < b->key ? -1 : 1;
+  if (sort == QUERY_SORT_NAME || sort == QUERY_SORT_SPECIES) {
+    int c = strcasecmp(hot_table_str(t, t->name[a->row]),
+                       hot_table_str(t, t->name[b->row]));
+    if (c != 0)
+      return c;
+  }
+  return a->row < b->row ? -1 : a->row > b->row;
+}
+
+// Bottom-up merge sort: needs the table for tie-breaks, which qsort() cannot
+// pass to its comparator
+static sort_item_t *merge_sort(const hot_table_t *t, query_sort_t sort,
+                               sort_item_t *a, sort_item_t *tmp, uint32_t n) {
+  for (uint32_t width = 1; width < n; width *= 2) {
+    for (uint32_t lo = 0; lo < n; lo += 2 * width) {
+      uint32_t mid = lo + width < n ? lo + width : n;
+      uint32_t hi = lo + 2 * width < n ? lo + 2 * width : n;
+      uint32_t i = lo, j = mid, k = lo;
+      while (i < mid && j < hi)
+        tmp[k++] = compare(t, sort, &a[j], &a[i]) < 0 ? a[j++] : a[i++];
+      while (i < mid)
+        tmp[k++] = a[i++];
+      while (j < hi)
+        tmp[k++] = a[j++];
+    }
+    sort_item_t *swap = a;
+    a = tmp;
+    tmp = swap;
+  }
+  return a;
+}
+
+// ====================================================================================
+// API
+// ====================================================================================
+
+esp_err_t query_reserve(query_result_t *r, uint32_t rows) {
+  if (!grow((void **)&r->rows, &r->capacity, rows ? rows : 1,
+            sizeof(*r->rows))) {
+    ESP_LOGE(TAG, "Out of memory for %u rows", (unsigned)rows);
+    return ESP_ERR_NO_MEM;
+  }
+  return ESP_OK;
+}
+
+esp_err_t query_run(const hot_table_t *t, const due_queue_t *due,
+                    const query_t *q, query_result_t *out) {
+  if (q->where & QUERY_ROWS) {
+    // Filter the given rows in place
+    uint32_t n = 0;
+    for (uint32_t k = 0; k < out->count; k++) {
+      uint32_t i = out->rows[k];
+      if (i < t->count && matches(t, due, q, i))
+        out->rows[n++] = i;
+    }
+    out->count = n;
+  } else {
+    out->count = 0;
+    esp_err_t ret = query_reserve(out, t->count);
+    if (ret != ESP_OK)
+      return ret;
+    for (uint32_t i = 0; i < t->count; i++)
+      if (matches(t, due, q, i))
+        out->rows[out->count++] = i;
+  }
+
+  if (q->sort != QUERY_SORT_INDEX && out->count > 1) {
+    sort_item_t *items = heap_caps_malloc_prefer(
+        2 * (size_t)out->count * sizeof(sort_item_t), 2, MALLOC_CAP_SPIRAM,
+        MALLOC_CAP_DEFAULT);
+    if (items == NULL) {
+      ESP_LOGE(TAG, "Out of memory sorting %u rows", (unsigned)out->count);
+      out->count = 0;
+      return ESP_ERR_NO_MEM;
+    }
+    for (uint32_t i = 0; i < out->count; i++)
+      items[i] = (sort_item_t){sort_key(t, q->sort, out->rows[i]),
+                               out->rows[i]};
+    const sort_item_t *sorted =
+        merge_sort(t, q->sort, items, items + out->count, out->count);
+    for (uint32_t i = 0; i < out->count; i++)
+      out->rows[i] = sorted[i].row;
+    heap_caps_free(items);
+  }
+
+  if (q->descending) {
+    for (uint32_t i = 0, j = out->count; i + 1 < j; i++, j--) {
+      uint32_t row = out->rows[i];
+      out->rows[i] = out->rows[j - 1];
+      out->rows[j - 1] = row;
+    }
+  }
+  return ESP_OK;
+}
+
+int query_page(const query_result_t *r, uint32_t *cursor, int *out, int max) {
+  int n = 0;
+  while (n < max && *cursor < r->count)
+    out[n++] = (int)r->rows[(*cursor)++];
+  return n;
+}
+
+void query_result_free(query_result_t *r) {
+  heap_caps_free(r->rows);
+  memset(r, 0, sizeof(*r));
+}
@@ -0,0 +1,91 @@
+/**
+ * @file query.h
+ * @brief Filtered, sorted selections of the animal table
+ *
+ * A query combines predicates on the hot columns (species, sex, CITES annex,
+ * terrarium, health, feeding due) with a sort key, and materializes the
+ * matching reptile indexes, in order, into a result. Pages are then read
+ * from the result with a cursor. The result is a snapshot and reptile
+ * indexes never move, so paging stays stable while the collection changes.
+ *
+ * Predicates read a few bytes per animal from the hot columns. Name order
+ * uses the precomputed hot_table_t.name_key, so full string comparisons
+ * only happen between names sharing their first 8 letters.
+ *
+ * A text query (query_t.text) is resolved by db_query() through the search
+ * index first; query_run() then only filters and sorts the hits, passed in
+ * `out` with QUERY_ROWS.
+ */
+
+#ifndef QUERY_H
+#define QUERY_H
+
+#include "../models.h"
+#include "due_queue.h"
+#include "esp_err.h"
+#include "hot_table.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+// Predicates in use (query_t.where)
+enum {
+  QUERY_SPECIES = 1 << 0,
+  QUERY_SEX = 1 << 1,
+  QUERY_CITES = 1 << 2,        // Exact annex
+  QUERY_CITES_LISTED = 1 << 3, // Any annex but CITES_NOT_LISTED
+  QUERY_TERRARIUM = 1 << 4,
+  QUERY_HEALTH = 1 << 5,
+  QUERY_FEEDING_DUE = 1 << 6,
+  QUERY_INACTIVE = 1 << 7, // Include animals that left (default: active)
+  QUERY_ROWS = 1 << 8,     // Only the rows already in `out`, in slot order
+};
+
+typedef enum {
+  QUERY_SORT_INDEX = 0,    // Table (insertion) order
+  QUERY_SORT_NAME,         // Case-insensitive
+  QUERY_SORT_ID,
+  QUERY_SORT_SPECIES,      // Category, then name
+  QUERY_SORT_LAST_FEEDING, // Oldest meal first
+} query_sort_t;
+
+typedef struct {
+  uint32_t where; // QUERY_* bits
+  reptile_species_t species;
+  reptile_sex_t sex;
+  cites_annex_t cites_annex;
+  uint8_t terrarium_id;
+  health_status_t health;
+  query_sort_t sort;
+  bool descending;
+  const char *text; // Words to search for (db_query()), NULL or "" for none
+} query_t;
+
+typedef struct {
+  uint32_t *rows; // Reptile indexes, in order
+  uint32_t count;
+  uint32_t capacity;
+} query_result_t;
+
+#define QUERY_CURSOR_START 0
+
+/**
+ * @brief Run a query over the hot columns into `out` (its memory is reused)
+ * @param due Feeding alert state, for QUERY_FEEDING_DUE
+ */
+esp_err_t query_run(const hot_table_t *t, const due_queue_t *due,
+                    const query_t *q, query_result_t *out);
+
+/**
+ * @brief Make room for `rows` indexes in `r`
+ */
+esp_err_t query_reserve(query_result_t *r, uint32_t rows);
+
+/**
+ * @brief Copy up to `max` reptile indexes from *cursor on and advance it
+ * @return Number of indexes written, 0 at the end
+ */
+int query_page(const query_result_t *r, uint32_t *cursor, int *out, int max);
+
+void query_result_free(query_result_t *r);
+
+#endif // QUERY_H
@@ -0,0 +1,59 @@
+/**
+ * @file seqlock.h
+ * @brief Sequence lock: lock-free consistent reads of rarely written data
+ *
+ * Writers, already serialized by another lock, make the sequence odd while
+ * they change the data and even again afterwards. A reader notes the
+ * sequence, copies the data, and keeps the copy only if the sequence was
+ * even and has not moved: otherwise a writer was active and it tries again.
+ * Readers never write shared memory, so any number of tasks read in
+ * parallel with no lock and no priority inversion on the data itself.
+ *
+ * Write sections nest (a modifier that rebuilds a table calls the same
+ * helpers a single-row update does); only the outermost one moves the
+ * sequence.
+ */
+
+#ifndef SEQLOCK_H
+#define SEQLOCK_H
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+typedef struct {
+  atomic_uint_least32_t seq; // Odd while a writer is inside
+  uint32_t depth;            // Writer nesting; writers are serialized
+} seqlock_t;
+
+static inline void seqlock_write_begin(seqlock_t *l) {
+  if (l->depth++ == 0) {
+    atomic_store_explicit(
+        &l->seq, atomic_load_explicit(&l->seq, memory_order_relaxed) + 1,
+        memory_order_relaxed);
+    atomic_thread_fence(memory_order_release); // Odd before any data store
+  }
+}
+
+static inline void seqlock_write_end(seqlock_t *l) {
+  if (--l->depth == 0)
+    atomic_store_explicit(
+        &l->seq, atomic_load_explicit(&l->seq, memory_order_relaxed) + 1,
+        memory_order_release); // Even after every data store
+}
+
+static inline uint32_t seqlock_read_begin(seqlock_t *l) {
+  return atomic_load_explicit(&l->seq, memory_order_acquire);
+}
+
+/**
+ * @brief True if what was read since seqlock_read_begin() returned `seq`
+ *        may be torn and must be read again
+ */
+static inline bool seqlock_read_retry(seqlock_t *l, uint32_t seq) {
+  atomic_thread_fence(memory_order_acquire); // Data loads before the check
+  return (seq & 1) ||
+         atomic_load_explicit(&l->seq, memory_order_relaxed) != seq;
+}
+
+#endif // SEQLOCK_H
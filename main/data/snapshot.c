@@ -0,0 +1,252 @@
+/**
+ * @file snapshot.c
+ * @brief Crash-safe sectioned snapshot implementation
+ */
+
+#include "snapshot.h"
+#include "esp_log.h"
+#include "esp_rom_crc.h"
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+static const char *TAG = "SNAPSHOT";
+
+static uint32_t snapshot_generation = 0;
+static bool live_valid = false; // SNAPSHOT_FILE_PATH holds a verified image
+
+static size_t table_size(uint16_t section_count) {
+  return sizeof(snapshot_header_t) +
+         (size_t)section_count * sizeof(snapshot_section_t);
+}
+
+static uint32_t header_crc(const uint8_t *image) {
+  snapshot_header_t hdr;
+  memcpy(&hdr, image, sizeof(hdr));
+  hdr.header_crc = 0;
+  uint32_t crc = esp_rom_crc32_le(0, (const uint8_t *)&hdr, sizeof(hdr));
+  return esp_rom_crc32_le(crc, image + sizeof(hdr),
+                          hdr.section_count * sizeof(snapshot_section_t));
+}
+
+// ====================================================================================
+// WRITE
+// ====================================================================================
+
+uint8_t *snapshot_build(const snapshot_section_desc_t *sections, int count,
+                        uint32_t journal_seq, size_t *out_len) {
+  if (count < 0 || count > SNAPSHOT_MAX_SECTIONS)
+    return NULL;
+
+  size_t len = table_size(count);
+  for (int i = 0; i < count; i++)
+    len += (size_t)sections[i].record_size * sections[i].count;
+
+  uint8_t *image = malloc(len);
+  if (image == NULL)
+    return NULL;
+
+  snapshot_header_t *hdr = (snapshot_header_t *)image;
+  snapshot_section_t *table = (snapshot_section_t *)(image + sizeof(*hdr));
+  memset(hdr, 0, sizeof(*hdr));
+  hdr->magic = SNAPSHOT_MAGIC;
+  hdr->version = SNAPSHOT_VERSION;
+  hdr->journal_seq = journal_seq;
+  hdr->file_size = len;
+  hdr->section_count = count;
+
+  size_t offset = table_size(count);
+  for (int i = 0; i < count; i++) {
+    size_t bytes = (size_t)sections[i].record_size * sections[i].count;
+    table[i].id = sections[i].id;
+    table[i].record_size = sections[i].record_size;
+    table[i].count = sections[i].count;
+    table[i].offset = offset;
+    table[i].crc = 0;
+    if (sections[i].encode) {
+      for (uint32_t r = 0; r < sections[i].count; r++)
+        sections[i].encode(sections[i].data, r,
+                           image + offset + (size_t)r * table[i].record_size,
+                           sections[i].encode_ctx);
+    } else if (bytes > 0) {
+      memcpy(image + offset, sections[i].data, bytes);
+    }
+    offset += bytes;
+  }
+
+  *out_len = len;
+  return image;
+}
+
+esp_err_t snapshot_commit(uint8_t *image, size_t len) {
+  snapshot_header_t *hdr = (snapshot_header_t *)image;
+  snapshot_section_t *table = (snapshot_section_t *)(image + sizeof(*hdr));
+
+  for (int i = 0; i < hdr->section_count; i++) {
+    table[i].crc = esp_rom_crc32_le(0, image + table[i].offset,
+                                    table[i].record_size * table[i].count);
+  }
+  hdr->generation = snapshot_generation + 1;
+  hdr->header_crc = header_crc(image);
+
+  FILE *f = fopen(SNAPSHOT_TMP_PATH, "wb");
+  if (f == NULL) {
+    ESP_LOGE(TAG, "Failed to open %s for writing", SNAPSHOT_TMP_PATH);
+    return ESP_FAIL;
+  }
+  size_t ok = fwrite(image, len, 1, f);
+  fflush(f);
+  fsync(fileno(f));
+  fclose(f);
+  if (ok != 1) {
+    ESP_LOGE(TAG, "Short write on %s", SNAPSHOT_TMP_PATH);
+    return ESP_FAIL;
+  }
+
+  // FATFS rename() does not replace an existing target, so rotate by hand:
+  // live -> previous generation, temp -> live.
+  if (live_valid) {
+    remove(SNAPSHOT_PREV_PATH);
+    rename(SNAPSHOT_FILE_PATH, SNAPSHOT_PREV_PATH);
+  } else {
+    remove(SNAPSHOT_FILE_PATH); // Never demote a corrupt file to fallback
+  }
+  if (rename(SNAPSHOT_TMP_PATH, SNAPSHOT_FILE_PATH) != 0) {
+    ESP_LOGE(TAG, "Failed to rename snapshot into place");
+    live_valid = false;
+    return ESP_FAIL;
+  }
+
+  live_valid = true;
+  snapshot_generation = hdr->generation;
+  ESP_LOGI(TAG, "Snapshot generation %u written (%u bytes)",
+           (unsigned)snapshot_generation, (unsigned)len);
+  return ESP_OK;
+}
+
+// ====================================================================================
+// LOAD
+// ====================================================================================
+
+static bool snapshot_verify(const uint8_t *image, size_t len) {
+  if (len < sizeof(snapshot_header_t))
+    return false;
+
+  const snapshot_header_t *hdr = (const snapshot_header_t *)image;
+  if (hdr->magic != SNAPSHOT_MAGIC || hdr->version != SNAPSHOT_VERSION ||
+      hdr->file_size != len || hdr->section_count > SNAPSHOT_MAX_SECTIONS ||
+      table_size(hdr->section_count) > len)
+    return false;
+  if (header_crc(image) != hdr->header_crc)
+    return false;
+
+  const snapshot_section_t *table =
+      (const snapshot_section_t *)(image + sizeof(*hdr));
+  for (int i = 0; i < hdr->section_count; i++) {
+    uint64_t bytes = (uint64_t)table[i].record_size * table[i].count;
+    if (table[i].offset < table_size(hdr->section_count) ||
+        table[i].offset + bytes > len)
+      return false;
+    if (esp_rom_crc32_le(0, image + table[i].offset, bytes) != table[i].crc)
+      return false;
+  }
+  return true;
+}
+
+// Read and verify one candidate file; NULL if missing, invalid or too large
+// for the heap (then *no_mem is set)
+static uint8_t *snapshot_read(const char *path, size_t *out_len,
+                              bool *no_mem) {
+  struct stat st;
+  if (stat(path, &st) != 0)
+    return NULL;
+  if (st.st_size <= 0 || st.st_size > SNAPSHOT_MAX_BYTES) {
+    ESP_LOGW(TAG, "%s: implausible size %ld", path, (long)st.st_size);
+    return NULL;
+  }
+
+  FILE *f = fopen(path, "rb");
+  if (f == NULL)
+    return NULL;
+  uint8_t *image = malloc(st.st_size);
+  size_t got = image ? fread(image, 1, st.st_size, f) : 0;
+  fclose(f);
+
+  if (image == NULL) {
+    ESP_LOGE(TAG, "%s: no memory for %ld bytes", path, (long)st.st_size);
+    *no_mem = true;
+    return NULL;
+  }
+  if (got != (size_t)st.st_size ||
+      !snapshot_verify(image, got)) {
+    ESP_LOGW(TAG, "%s: failed verification", path);
+    free(image);
+    return NULL;
+  }
+  *out_len = got;
+  return image;
+}
+
+esp_err_t snapshot_load(snapshot_section_cb_t cb, void *ctx,
+                        uint32_t *journal_seq) {
+  static const char *const paths[] = {SNAPSHOT_FILE_PATH, SNAPSHOT_TMP_PATH,
+                                      SNAPSHOT_PREV_PATH};
+  uint8_t *best = NULL;
+  int best_index = -1;
+  bool any_file = false;
+  bool no_mem = false;
+  struct stat st;
+
+  live_valid = false;
+  for (int i = 0; i < 3; i++) {
+    if (stat(paths[i], &st) == 0)
+      any_file = true;
+    size_t len = 0;
+    uint8_t *image = snapshot_read(paths[i], &len, &no_mem);
+    if (image == NULL)
+      continue;
+    const snapshot_header_t *hdr = (const snapshot_header_t *)image;
+    if (best == NULL ||
+        hdr->generation > ((const snapshot_header_t *)best)->generation) {
+      free(best);
+      best = image;
+      best_index = i;
+    } else {
+      free(image);
+    }
+  }
+
+  if (best == NULL) {
+    if (no_mem)
+      return ESP_ERR_NO_MEM;
+    return any_file ? ESP_ERR_INVALID_CRC : ESP_ERR_NOT_FOUND;
+  }
+
+  const snapshot_header_t *hdr = (const snapshot_header_t *)best;
+  const snapshot_section_t *table =
+      (const snapshot_section_t *)(best + sizeof(*hdr));
+  esp_err_t ret = ESP_OK;
+  for (int i = 0; i < hdr->section_count && ret == ESP_OK; i++)
+    ret = cb(&table[i], best + table[i].offset, ctx);
+
+  if (ret == ESP_OK) {
+    snapshot_generation = hdr->generation;
+    *journal_seq = hdr->journal_seq;
+    if (best_index == 0) {
+      live_valid = true;
+    } else {
+      ESP_LOGW(TAG, "Recovered generation %u from %s",
+               (unsigned)hdr->generation, paths[best_index]);
+      if (best_index == 1) {
+        // Crash between write and rename: finish the rotation now
+        remove(SNAPSHOT_FILE_PATH);
+        live_valid = rename(SNAPSHOT_TMP_PATH, SNAPSHOT_FILE_PATH) == 0;
+      }
+    }
+  }
+  free(best);
+  return ret;
+}
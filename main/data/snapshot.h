@@ -0,0 +1,102 @@
+/**
+ * @file snapshot.h
+ * @brief Crash-safe sectioned snapshot file for the Reptile Manager database
+ *
+ * Layout: snapshot_header_t, a table of snapshot_section_t, then the section
+ * payloads. Every section carries its own offset, record size, count and
+ * CRC32; the header and table are covered by a separate CRC. A snapshot is
+ * written to a temporary file, synced, and renamed over the live file, and
+ * the previous generation is kept as a fallback.
+ */
+
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+
+#include "esp_err.h"
+#include <stddef.h>
+#include <stdint.h>
+
+#ifndef SD_ROOT
+#define SD_ROOT "/sdcard" // Mount point of the card, see main.c
+#endif
+
+#define SNAPSHOT_FILE_PATH SD_ROOT "/reptile_data.bin"
+#define SNAPSHOT_TMP_PATH SD_ROOT "/reptile_data.tmp"
+#define SNAPSHOT_PREV_PATH SD_ROOT "/reptile_data.old"
+
+#define SNAPSHOT_MAGIC 0x52455054 // "REPT"
+#define SNAPSHOT_VERSION 2
+#define SNAPSHOT_MAX_SECTIONS 16
+// Upper bound on what a load will read, so boot time stays bounded
+#define SNAPSHOT_MAX_BYTES (64 * 1024 * 1024)
+
+typedef struct __attribute__((packed)) {
+  uint32_t magic;
+  uint32_t version;
+  uint32_t generation;  // Incremented on every save
+  uint32_t journal_seq; // Last journal record folded into this snapshot
+  uint32_t file_size;
+  uint16_t section_count;
+  uint16_t reserved;
+  uint32_t header_crc; // CRC32 of header (this field zeroed) + section table
+} snapshot_header_t;
+
+typedef struct __attribute__((packed)) {
+  uint16_t id;
+  uint16_t record_size;
+  uint32_t count;
+  uint32_t offset; // From start of file
+  uint32_t crc;    // CRC32 of count * record_size bytes at offset
+} snapshot_section_t;
+
+typedef void (*snapshot_encode_cb_t)(const void *data, uint32_t index,
+                                     uint8_t *out, const void *ctx);
+
+// Section contents supplied by the caller when building a snapshot
+typedef struct {
+  uint16_t id;
+  uint16_t record_size; // Serialized size of one record
+  uint32_t count;
+  const void *data;
+  snapshot_encode_cb_t encode; // Optional; NULL copies `data` verbatim
+  const void *encode_ctx;
+} snapshot_section_desc_t;
+
+/**
+ * @brief Callback receiving each verified section during load
+ */
+typedef esp_err_t (*snapshot_section_cb_t)(const snapshot_section_t *section,
+                                           const void *data, void *ctx);
+
+/**
+ * @brief Copy sections into a new in-memory file image
+ *
+ * Only copies or encodes memory, so it is cheap enough to call while holding
+ * the database lock. CRCs are filled in later by snapshot_commit().
+ *
+ * @return Heap buffer (free with free()) or NULL on allocation failure
+ */
+uint8_t *snapshot_build(const snapshot_section_desc_t *sections, int count,
+                        uint32_t journal_seq, size_t *out_len);
+
+/**
+ * @brief Checksum an image from snapshot_build() and write it atomically
+ */
+esp_err_t snapshot_commit(uint8_t *image, size_t len);
+
+/**
+ * @brief Load the newest valid generation
+ *
+ * The live, temporary and previous files are all verified; the valid one
+ * with the highest generation wins. Sections are only handed to `cb` once
+ * every CRC in that file has been checked.
+ *
+ * @param[out] journal_seq Journal sequence folded into the loaded snapshot
+ * @return ESP_OK, ESP_ERR_NOT_FOUND if no file exists, ESP_ERR_INVALID_CRC if
+ *         files exist but none is valid, ESP_ERR_NO_MEM if a file could not
+ *         be read into memory (it may still be valid: do not overwrite it)
+ */
+esp_err_t snapshot_load(snapshot_section_cb_t cb, void *ctx,
+                        uint32_t *journal_seq);
+
+#endif // SNAPSHOT_H
@@ -0,0 +1,148 @@
+/**
+ * @file stats.c
+ * @brief Running aggregates of the collection
+ */
+
+#include "stats.h"
+#include "esp_heap_caps.h"
+#include "esp_log.h"
+#include <string.h>
+
+static const char *TAG = "STATS";
+
+#define MIN_ROWS 64
+#define SECONDS_PER_DAY (24 * 3600)
+
+void stats_welford_add(stats_welford_t *w, double x) {
+  w->n++;
+  double delta = x - w->mean;
+  w->mean += delta / w->n;
+  w->m2 += delta * (x - w->mean);
+}
+
+double stats_variance(const stats_welford_t *w) {
+  return w->n < 2 ? 0.0 : w->m2 / (w->n - 1);
+}
+
+// Chan et al. pairwise update
+void stats_welford_merge(stats_welford_t *a, const stats_welford_t *b) {
+  if (b->n == 0)
+    return;
+  if (a->n == 0) {
+    *a = *b;
+    return;
+  }
+  double n = (double)a->n + b->n;
+  double delta = b->mean - a->mean;
+  a->mean += delta * b->n / n;
+  a->m2 += b->m2 + delta * delta * ((double)a->n * b->n / n);
+  a->n += b->n;
+}
+
+esp_err_t stats_resize(stats_t *s, uint32_t count) {
+  if (count > s->capacity) {
+    uint32_t cap = s->capacity ? s->capacity : MIN_ROWS;
+    while (cap < count)
+      cap *= 2;
+    void *p = heap_caps_realloc_prefer(s->rows, cap * sizeof(*s->rows), 2,
+                                       MALLOC_CAP_SPIRAM, MALLOC_CAP_DEFAULT);
+    if (p == NULL) {
+      ESP_LOGE(TAG, "Out of memory for %u rows", (unsigned)cap);
+      return ESP_ERR_NO_MEM;
+    }
+    s->rows = p;
+    s->capacity = cap;
+  }
+  if (count > s->count)
+    memset(s->rows + s->count, 0, (count - s->count) * sizeof(*s->rows));
+  s->count = count;
+  return ESP_OK;
+}
+
+// Add (`sign` 1) or remove (-1) what a row contributes
+static void row_apply(stats_summary_t *m, const stats_row_t *row, int sign) {
+  if (row->counted & STATS_ROW_ACTIVE) {
+    m->active += sign;
+    if (row->species < STATS_SPECIES) {
+      m->species[row->species] += sign;
+      if (row->weight > 0) {
+        m->weighed[row->species] += sign;
+        m->weight_sum[row->species] += (int64_t)sign * row->weight;
+      }
+    }
+    if (row->annex < STATS_ANNEXES)
+      m->annex[row->annex] += sign;
+    if (row->sex < STATS_SEXES)
+      m->sex[row->sex] += sign;
+    m->stock_value += (int64_t)sign * row->purchase_price;
+  }
+  if (row->counted & STATS_ROW_SOLD) {
+    m->sold += sign;
+    m->sales_value += (int64_t)sign * row->sale_price;
+  }
+}
+
+esp_err_t stats_row_set(stats_t *s, uint32_t index, const reptile_t *r) {
+  if (index > s->count)
+    return ESP_ERR_INVALID_ARG;
+  if (index == s->count && stats_resize(s, index + 1) != ESP_OK)
+    return ESP_ERR_NO_MEM;
+
+  stats_row_t *row = &s->rows[index];
+  row_apply(&s->summary, row, -1);
+  row->counted = (r->active ? STATS_ROW_ACTIVE : 0) |
+                 (r->exit_reason == EXIT_SOLD ? STATS_ROW_SOLD : 0);
+  row->species = r->species;
+  row->annex = r->cites_annex;
+  row->sex = r->sex;
+  row->weight = r->weight_grams;
+  row->purchase_price = r->purchase_price;
+  row->sale_price = r->sale_price;
+  row_apply(&s->summary, row, 1);
+  return ESP_OK;
+}
+
+void stats_meal(stats_t *s, uint32_t index, uint8_t species, int64_t ts,
+                bool accepted) {
+  if (index >= s->count && stats_resize(s, index + 1) != ESP_OK)
+    return;
+  if (species >= STATS_SPECIES)
+    species = SPECIES_OTHER;
+  stats_events_t *e = &s->summary.events;
+  stats_row_t *row = &s->rows[index];
+  e->meals[species]++;
+  if (accepted)
+    e->accepted[species]++;
+  if (row->last_meal != 0 && ts > row->last_meal)
+    stats_welford_add(&e->interval[species],
+                      (double)(ts - row->last_meal) / SECONDS_PER_DAY);
+  row->last_meal = ts;
+}
+
+void stats_weigh(stats_t *s, uint32_t index, uint8_t species, int64_t ts,
+                 uint16_t grams) {
+  if (index >= s->count && stats_resize(s, index + 1) != ESP_OK)
+    return;
+  if (species >= STATS_SPECIES)
+    species = SPECIES_OTHER;
+  stats_row_t *row = &s->rows[index];
+  if (row->last_weigh != 0 && ts > row->last_weigh)
+    stats_welford_add(&s->summary.events.growth[species],
+                      ((double)grams - row->last_grams) * SECONDS_PER_DAY /
+                          (ts - row->last_weigh));
+  row->last_weigh = ts;
+  row->last_grams = grams;
+}
+
+void stats_clear_rows(stats_t *s) {
+  stats_events_t events = s->summary.events;
+  memset(&s->summary, 0, sizeof(s->summary));
+  s->summary.events = events;
+  for (uint32_t i = 0; i < s->count; i++)
+    s->rows[i].counted = 0;
+}
+
+void stats_clear(stats_t *s) {
+  memset(&s->summary, 0, sizeof(s->summary));
+  s->count = 0;
+}
@@ -0,0 +1,130 @@
+/**
+ * @file stats.h
+ * @brief Running aggregates of the collection for the dashboards
+ *
+ * Two kinds of figures are kept, both updated in O(1) per change and read
+ * without a scan:
+ *
+ * - Row aggregates (counts by species, annex and sex, weights, value of the
+ *   stock) describe the reptile records as they are now. Each slot keeps the
+ *   contribution it last made, so a change subtracts the old one and adds
+ *   the new one.
+ * - Event aggregates (meals, acceptance, intervals between meals, growth
+ *   between weigh-ins) only ever take new events. Means and variances are
+ *   Welford running moments, stable over any number of events. An event
+ *   counts for the species its animal had when it was recorded.
+ *
+ * Intervals and growth pair each event with the previous one of the same
+ * animal, in the order they were recorded; pairs that do not move forward in
+ * time (a meal entered late) are not counted.
+ */
+
+#ifndef STATS_H
+#define STATS_H
+
+#include "../models.h"
+#include "esp_err.h"
+#include <stdint.h>
+
+#define STATS_SPECIES (SPECIES_OTHER + 1)
+#define STATS_ANNEXES (CITES_ANNEX_D + 1)
+#define STATS_SEXES (SEX_FEMALE + 1)
+
+typedef struct {
+  uint32_t n;
+  double mean;
+  double m2; // Sum of squared deviations from the mean
+} stats_welford_t;
+
+// Event aggregates, by species
+typedef struct {
+  uint32_t meals[STATS_SPECIES];
+  uint32_t accepted[STATS_SPECIES];
+  stats_welford_t interval[STATS_SPECIES]; // Days between two meals
+  stats_welford_t growth[STATS_SPECIES];   // Grams per day between weigh-ins
+} stats_events_t;
+
+typedef struct {
+  // Active animals
+  uint32_t active;
+  uint32_t species[STATS_SPECIES];
+  uint32_t annex[STATS_ANNEXES];
+  uint32_t sex[STATS_SEXES];
+  uint32_t weighed[STATS_SPECIES]; // With a weight, for the mean below
+  uint64_t weight_sum[STATS_SPECIES];
+  uint64_t stock_value; // Sum of purchase_price, euros
+  // Animals that left the collection as EXIT_SOLD
+  uint32_t sold;
+  uint64_t sales_value; // Sum of sale_price, euros
+
+  stats_events_t events;
+} stats_summary_t;
+
+// What one slot adds to the row aggregates, and its last events
+typedef struct {
+  int64_t last_meal;  // Timestamp of its newest meal, 0 if none
+  int64_t last_weigh; // Timestamp of its newest weigh-in, 0 if none
+  uint16_t last_grams;
+  uint16_t weight;
+  uint16_t purchase_price;
+  uint16_t sale_price;
+  uint8_t counted; // STATS_ROW_* flags
+  uint8_t species;
+  uint8_t annex;
+  uint8_t sex;
+} stats_row_t;
+
+#define STATS_ROW_ACTIVE 0x01
+#define STATS_ROW_SOLD 0x02
+
+typedef struct {
+  stats_summary_t summary;
+  stats_row_t *rows; // By reptile slot
+  uint32_t count;
+  uint32_t capacity;
+} stats_t;
+
+/**
+ * @brief Replace what slot `index` adds to the row aggregates with what `r`
+ *        adds; `index` may be at most `count` (appending a slot)
+ */
+esp_err_t stats_row_set(stats_t *s, uint32_t index, const reptile_t *r);
+
+/**
+ * @brief Count a meal of slot `index`, paired with the slot's previous one
+ */
+void stats_meal(stats_t *s, uint32_t index, uint8_t species, int64_t ts,
+                bool accepted);
+
+/**
+ * @brief Count a weigh-in of slot `index`, paired with the slot's previous
+ *        one
+ */
+void stats_weigh(stats_t *s, uint32_t index, uint8_t species, int64_t ts,
+                 uint16_t grams);
+
+/**
+ * @brief Drop the row aggregates (before stats_row_set() on every row); the
+ *        event aggregates and each slot's last events are kept
+ */
+void stats_clear_rows(stats_t *s);
+
+/**
+ * @brief Drop everything, event aggregates included; memory is kept
+ */
+void stats_clear(stats_t *s);
+
+/**
+ * @brief Make room for `count` slots, new ones with no events
+ */
+esp_err_t stats_resize(stats_t *s, uint32_t count);
+
+void stats_welford_add(stats_welford_t *w, double x);
+double stats_variance(const stats_welford_t *w); // Sample variance, 0 if n < 2
+
+/**
+ * @brief Merge `b` into `a`, as if its values had been added to `a`
+ */
+void stats_welford_merge(stats_welford_t *a, const stats_welford_t *b);
+
+#endif // STATS_H
@@ -0,0 +1,126 @@
+/**
+ * @file string_pool.c
+ * @brief Interned string table implementation
+ */
+
+#include "string_pool.h"
+#include "esp_heap_caps.h"
+#include "esp_log.h"
+#include <string.h>
+
+static const char *TAG = "STRING_POOL";
+
+#define MIN_DATA 1024
+#define MIN_STRINGS 64
+
+typedef struct {
+  const string_pool_t *pool;
+  const char *s;
+  size_t len;
+} pool_key_t;
+
+static bool match_text(uint32_t index, const void *key) {
+  const pool_key_t *k = key;
+  const char *text = k->pool->data + k->pool->offsets[index];
+  return strncmp(text, k->s, k->len) == 0 && text[k->len] == '\0';
+}
+
+static bool grow(void **buf, uint32_t *cap, uint32_t need, uint32_t min,
+                 size_t size) {
+  if (need <= *cap)
+    return true;
+  uint32_t n = *cap ? *cap : min;
+  while (n < need)
+    n *= 2;
+  void *p = heap_caps_realloc_prefer(*buf, (size_t)n * size, 2,
+                                     MALLOC_CAP_SPIRAM, MALLOC_CAP_DEFAULT);
+  if (p == NULL)
+    return false;
+  *buf = p;
+  *cap = n;
+  return true;
+}
+
+// Append without looking for a duplicate
+static esp_err_t string_pool_add(string_pool_t *p, const char *s, size_t len,
+                                 uint32_t hash) {
+  if (!grow((void **)&p->data, &p->cap, p->len + len + 1, MIN_DATA, 1) ||
+      !grow((void **)&p->offsets, &p->offsets_cap, p->count + 1, MIN_STRINGS,
+            sizeof(uint32_t)) ||
+      hash_index_insert(&p->index, hash, p->count) != ESP_OK) {
+    ESP_LOGE(TAG, "Out of memory for %u strings", (unsigned)p->count + 1);
+    return ESP_ERR_NO_MEM;
+  }
+  memcpy(p->data + p->len, s, len);
+  p->data[p->len + len] = '\0';
+  p->offsets[p->count++] = p->len;
+  p->len += len + 1;
+  return ESP_OK;
+}
+
+esp_err_t string_pool_intern(string_pool_t *p, const char *s, size_t len,
+                             str_ref_t *ref) {
+  len = strnlen(s, len);
+  if (len > STRING_POOL_MAX_LEN)
+    len = STRING_POOL_MAX_LEN;
+  if (len == 0) {
+    *ref = 0;
+    return ESP_OK;
+  }
+
+  uint32_t hash = hash_bytes(s, len);
+  const pool_key_t key = {p, s, len};
+  int32_t found = hash_index_find(&p->index, hash, match_text, &key);
+  if (found >= 0) {
+    *ref = found + 1;
+    return ESP_OK;
+  }
+  esp_err_t ret = string_pool_add(p, s, len, hash);
+  if (ret == ESP_OK)
+    *ref = p->count;
+  return ret;
+}
+
+str_ref_t string_pool_find(const string_pool_t *p, const char *s) {
+  size_t len = strnlen(s, STRING_POOL_MAX_LEN);
+  if (len == 0)
+    return 0;
+  const pool_key_t key = {p, s, len};
+  int32_t found = hash_index_find(&p->index, hash_bytes(s, len), match_text,
+                                  &key);
+  return found >= 0 ? (str_ref_t)found + 1 : 0;
+}
+
+const char *string_pool_get(const string_pool_t *p, str_ref_t ref) {
+  if (ref == 0 || ref > p->count)
+    return "";
+  return p->data + p->offsets[ref - 1];
+}
+
+esp_err_t string_pool_load(string_pool_t *p, const char *data, uint32_t len) {
+  string_pool_clear(p);
+  if (len > 0 && data[len - 1] != '\0')
+    return ESP_ERR_INVALID_SIZE;
+  for (uint32_t pos = 0; pos < len;) {
+    size_t n = strlen(data + pos);
+    esp_err_t ret =
+        string_pool_add(p, data + pos, n, hash_bytes(data + pos, n));
+    if (ret != ESP_OK)
+      return ret;
+    pos += n + 1;
+  }
+  return ESP_OK;
+}
+
+void string_pool_clear(string_pool_t *p) {
+  p->len = 0;
+  p->count = 0;
+  hash_index_clear(&p->index);
+}
+
+void string_pool_free(string_pool_t *p) {
+  heap_caps_free(p->data);
+  heap_caps_free(p->offsets);
+  hash_index_free(&p->index);
+  memset(p, 0, sizeof(*p));
+}
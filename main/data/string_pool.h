@@ -0,0 +1,70 @@
+/**
+ * @file string_pool.h
+ * @brief Interned, deduplicated strings addressed by 32-bit handles
+ *
+ * Each distinct text is stored once; records keep a str_ref_t handle, so a
+ * collection of 200 animals of one species holds that species name once and
+ * compares it as an integer. Handles are 1-based positions in insertion order
+ * (0 is the empty string), which is also the persisted order, so a saved pool
+ * reloads with the same handles.
+ */
+
+#ifndef STRING_POOL_H
+#define STRING_POOL_H
+
+#include "../models.h"
+#include "esp_err.h"
+#include "hash_index.h"
+#include <stddef.h>
+#include <stdint.h>
+
+// Longer texts are truncated when interned
+#define STRING_POOL_MAX_LEN 127
+
+typedef struct {
+  char *data; // NUL-terminated strings back to back, in handle order
+  uint32_t len;
+  uint32_t cap;
+  uint32_t *offsets; // offsets[ref - 1]
+  uint32_t count;
+  uint32_t offsets_cap;
+  hash_index_t index; // Text hash -> ref - 1
+} string_pool_t;
+
+/**
+ * @brief Handle of `len` bytes of text, adding it if needed
+ * @param[out] ref Handle (0 for empty text)
+ * @return ESP_ERR_NO_MEM if the text could not be added
+ */
+esp_err_t string_pool_intern(string_pool_t *p, const char *s, size_t len,
+                             str_ref_t *ref);
+
+/**
+ * @brief Handle of an already interned text, 0 if absent or empty
+ */
+str_ref_t string_pool_find(const string_pool_t *p, const char *s);
+
+/**
+ * @brief Text of a handle; "" for 0 or unknown handles
+ *
+ * Valid until the next intern (the pool may move when it grows).
+ */
+const char *string_pool_get(const string_pool_t *p, str_ref_t ref);
+
+/**
+ * @brief Replace the contents with a saved pool (`data`/`len` as written
+ *        from `p->data`/`p->len`), keeping every handle
+ */
+esp_err_t string_pool_load(string_pool_t *p, const char *data, uint32_t len);
+
+/**
+ * @brief Drop every string (handles become invalid); memory is kept
+ */
+void string_pool_clear(string_pool_t *p);
+
+/**
+ * @brief Release all memory
+ */
+void string_pool_free(string_pool_t *p);
+
+#endif // STRING_POOL_H
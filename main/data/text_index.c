@@ -0,0 +1,306 @@
+/**
+ * @file text_index.c
+ * @brief Trigram index implementation
+ */
+
+#include "text_index.h"
+#include "esp_heap_caps.h"
+#include "esp_log.h"
+#include <stdbool.h>
+#include <string.h>
+
+static const char *TAG = "TEXT_INDEX";
+
+#define MIN_TABLE 1024
+#define MIN_POSTINGS 4
+#define MAX_QUERY_KEYS 32
+#define MAX_QUERY_WORDS 8
+
+static void *index_realloc(void *ptr, size_t size) {
+  return heap_caps_realloc_prefer(ptr, size, 2, MALLOC_CAP_SPIRAM,
+                                  MALLOC_CAP_DEFAULT);
+}
+
+// ====================================================================================
+// KEYS
+// ====================================================================================
+
+static bool is_word(uint8_t c) {
+  return (c >= '0' && c <= '9') || (c >= 'a' && c <= 'z') ||
+         (c >= 'A' && c <= 'Z') || c >= 0x80; // UTF-8 letters
+}
+
+static uint8_t fold(uint8_t c) {
+  return c >= 'A' && c <= 'Z' ? c + ('a' - 'A') : c;
+}
+
+// Key of 1 to 3 folded bytes; the top byte tells word-start keys apart and
+// keeps every key non-zero
+static uint32_t make_key(const uint8_t *w, int n, bool start) {
+  uint32_t key = (start ? 0x02000000 : 0x01000000) | (uint32_t)w[0] << 16;
+  if (n > 1)
+    key |= (uint32_t)w[1] << 8;
+  if (n > 2)
+    key |= w[2];
+  return key;
+}
+
+typedef void (*key_fn)(uint32_t key, void *arg);
+
+// Call `fn` for every key of the words of `text`; duplicates are possible.
+// A query word of 3 letters or more may sit anywhere in a word, so it only
+// brings its trigrams, not the word-start keys.
+static void for_each_key(const char *text, bool query, key_fn fn,
+                         void *arg) {
+  uint8_t w[TEXT_INDEX_MAX_TEXT];
+  const uint8_t *p = (const uint8_t *)text;
+  const uint8_t *end = p + strnlen(text, TEXT_INDEX_MAX_TEXT);
+  while (p < end) {
+    while (p < end && !is_word(*p))
+      p++;
+    int n = 0;
+    while (p < end && is_word(*p))
+      w[n++] = fold(*p++);
+    if (n == 0)
+      break;
+    if (!query || n < 3) {
+      fn(make_key(w, 1, true), arg);
+      if (n > 1)
+        fn(make_key(w, 2, true), arg);
+    }
+    for (int i = 0; i + 3 <= n; i++)
+      fn(make_key(w + i, 3, false), arg);
+  }
+}
+
+// ====================================================================================
+// POSTINGS
+// ====================================================================================
+
+static uint32_t key_hash(uint32_t key) { return key * 2654435761u; }
+
+static text_posting_t *find(const text_index_t *x, uint32_t key) {
+  if (x->size == 0)
+    return NULL;
+  uint32_t mask = x->size - 1;
+  for (uint32_t i = key_hash(key) & mask;; i = (i + 1) & mask) {
+    if (x->table[i].key == key)
+      return &x->table[i];
+    if (x->table[i].key == 0)
+      return NULL;
+  }
+}
+
+static esp_err_t grow_table(text_index_t *x) {
+  uint32_t size = x->size ? x->size * 2 : MIN_TABLE;
+  text_posting_t *table = index_realloc(NULL, size * sizeof(*table));
+  if (table == NULL)
+    return ESP_ERR_NO_MEM;
+  memset(table, 0, size * sizeof(*table));
+  for (uint32_t i = 0; i < x->size; i++) {
+    if (x->table[i].key == 0)
+      continue;
+    uint32_t j = key_hash(x->table[i].key) & (size - 1);
+    while (table[j].key != 0)
+      j = (j + 1) & (size - 1);
+    table[j] = x->table[i];
+  }
+  heap_caps_free(x->table);
+  x->table = table;
+  x->size = size;
+  return ESP_OK;
+}
+
+static text_posting_t *find_or_add(text_index_t *x, uint32_t key) {
+  text_posting_t *p = find(x, key);
+  if (p)
+    return p;
+  if ((x->used + 1) * 4 > x->size * 3 && grow_table(x) != ESP_OK)
+    return NULL;
+  uint32_t i = key_hash(key) & (x->size - 1);
+  while (x->table[i].key != 0)
+    i = (i + 1) & (x->size - 1);
+  x->used++;
+  x->table[i].key = key;
+  return &x->table[i];
+}
+
+// First position in `p` holding a slot >= `slot`
+static uint32_t lower_bound(const text_posting_t *p, uint16_t slot) {
+  uint32_t lo = 0, hi = p->count;
+  if (hi > 0 && p->slots[hi - 1] < slot)
+    return hi; // Appending in slot order, as a rebuild does
+  while (lo < hi) {
+    uint32_t mid = (lo + hi) / 2;
+    if (p->slots[mid] < slot)
+      lo = mid + 1;
+    else
+      hi = mid;
+  }
+  return lo;
+}
+
+typedef struct {
+  text_index_t *x;
+  uint16_t slot;
+  esp_err_t ret;
+} update_t;
+
+static void add_key(uint32_t key, void *arg) {
+  update_t *u = arg;
+  text_posting_t *p = u->ret == ESP_OK ? find_or_add(u->x, key) : NULL;
+  if (p == NULL) {
+    u->ret = ESP_ERR_NO_MEM;
+    return;
+  }
+  uint32_t at = lower_bound(p, u->slot);
+  if (at < p->count && p->slots[at] == u->slot)
+    return;
+  if (p->count == p->capacity) {
+    uint32_t cap = p->capacity ? p->capacity * 2 : MIN_POSTINGS;
+    uint16_t *slots = index_realloc(p->slots, cap * sizeof(uint16_t));
+    if (slots == NULL) {
+      u->ret = ESP_ERR_NO_MEM;
+      return;
+    }
+    p->slots = slots;
+    p->capacity = cap;
+  }
+  memmove(p->slots + at + 1, p->slots + at, (p->count - at) * sizeof(uint16_t));
+  p->slots[at] = u->slot;
+  p->count++;
+}
+
+static void remove_key(uint32_t key, void *arg) {
+  update_t *u = arg;
+  text_posting_t *p = find(u->x, key);
+  if (p == NULL)
+    return;
+  uint32_t at = lower_bound(p, u->slot);
+  if (at < p->count && p->slots[at] == u->slot) {
+    memmove(p->slots + at, p->slots + at + 1,
+            (p->count - at - 1) * sizeof(uint16_t));
+    p->count--;
+  }
+}
+
+// ====================================================================================
+// QUERIES
+// ====================================================================================
+
+typedef struct {
+  const text_index_t *x;
+  const text_posting_t *lists[MAX_QUERY_KEYS];
+  int count;
+  bool missing; // A key no text holds: no match at all
+} query_keys_t;
+
+static void collect_key(uint32_t key, void *arg) {
+  query_keys_t *q = arg;
+  const text_posting_t *p = find(q->x, key);
+  if (p == NULL || p->count == 0) {
+    q->missing = true;
+    return;
+  }
+  for (int i = 0; i < q->count; i++)
+    if (q->lists[i] == p)
+      return;
+  if (q->count < MAX_QUERY_KEYS)
+    q->lists[q->count++] = p;
+}
+
+// Case-folded search of `word` in `text`, anywhere or at a word start
+static bool text_has(const char *text, const uint8_t *word, int n,
+                     bool anywhere) {
+  const uint8_t *t = (const uint8_t *)text;
+  for (size_t i = 0; t[i]; i++) {
+    if (!anywhere && i > 0 && is_word(t[i - 1]))
+      continue;
+    int k = 0;
+    while (k < n && t[i + k] && fold(t[i + k]) == word[k])
+      k++;
+    if (k == n)
+      return true;
+  }
+  return false;
+}
+
+uint32_t text_index_search(const text_index_t *x, const char *query,
+                           text_index_get_fn get, void *ctx, uint32_t *out,
+                           uint32_t max) {
+  static char text[TEXT_INDEX_MAX_TEXT + 1];
+  static uint8_t words[MAX_QUERY_WORDS][TEXT_INDEX_MAX_TEXT / MAX_QUERY_WORDS];
+  int lens[MAX_QUERY_WORDS];
+  int word_count = 0;
+
+  // Split the query into folded words (as for_each_key() does)
+  const uint8_t *p = (const uint8_t *)query;
+  while (*p && word_count < MAX_QUERY_WORDS) {
+    while (*p && !is_word(*p))
+      p++;
+    int n = 0;
+    while (*p && is_word(*p)) {
+      if (n < (int)sizeof(words[0]))
+        words[word_count][n++] = fold(*p);
+      p++;
+    }
+    if (n > 0)
+      lens[word_count++] = n;
+  }
+  if (word_count == 0 || max == 0)
+    return 0;
+
+  query_keys_t q = {.x = x};
+  for_each_key(query, true, collect_key, &q);
+  if (q.missing || q.count == 0)
+    return 0;
+
+  // Walk the shortest list, probing the others in step
+  const text_posting_t *lead = q.lists[0];
+  for (int i = 1; i < q.count; i++)
+    if (q.lists[i]->count < lead->count)
+      lead = q.lists[i];
+  uint32_t at[MAX_QUERY_KEYS] = {0};
+  uint32_t found = 0;
+  for (uint32_t i = 0; i < lead->count && found < max; i++) {
+    uint16_t slot = lead->slots[i];
+    bool all = true;
+    for (int k = 0; k < q.count && all; k++) {
+      const text_posting_t *l = q.lists[k];
+      while (at[k] < l->count && l->slots[at[k]] < slot)
+        at[k]++;
+      all = at[k] < l->count && l->slots[at[k]] == slot;
+    }
+    if (!all)
+      continue;
+
+    get(slot, text, sizeof(text), ctx);
+    for (int w = 0; w < word_count && all; w++)
+      all = text_has(text, words[w], lens[w], lens[w] >= 3);
+    if (all)
+      out[found++] = slot;
+  }
+  return found;
+}
+
+// ====================================================================================
+// API
+// ====================================================================================
+
+esp_err_t text_index_add(text_index_t *x, uint16_t slot, const char *text) {
+  update_t u = {.x = x, .slot = slot, .ret = ESP_OK};
+  for_each_key(text, false, add_key, &u);
+  if (u.ret != ESP_OK)
+    ESP_LOGE(TAG, "Out of memory indexing slot %u", (unsigned)slot);
+  return u.ret;
+}
+
+void text_index_remove(text_index_t *x, uint16_t slot, const char *text) {
+  update_t u = {.x = x, .slot = slot, .ret = ESP_OK};
+  for_each_key(text, false, remove_key, &u);
+}
+
+void text_index_clear(text_index_t *x) {
+  for (uint32_t i = 0; i < x->size; i++)
+    x->table[i].count = 0;
+}
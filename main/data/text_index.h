@@ -0,0 +1,69 @@
+/**
+ * @file text_index.h
+ * @brief Trigram index for as-you-type search over short texts
+ *
+ * Texts are split into words (runs of letters and digits, ASCII folded to
+ * lower case). Each word contributes its trigrams plus two word-start keys
+ * (first letter, first two letters), and every key maps to the sorted list
+ * of slots whose text holds it. A query word of three letters or more
+ * matches anywhere in a word; a shorter one matches the start of a word.
+ *
+ * Candidates are the intersection of the posting lists of the query's keys,
+ * shortest first, and are then checked against their text, so a slot whose
+ * trigrams only match out of order is never returned. Only postings are
+ * stored (2 bytes per key occurrence); the texts are asked back from the
+ * caller on removal and verification.
+ *
+ * Searches use static buffers: callers serialize them (the database lock).
+ */
+
+#ifndef TEXT_INDEX_H
+#define TEXT_INDEX_H
+
+#include "esp_err.h"
+#include <stddef.h>
+#include <stdint.h>
+
+#define TEXT_INDEX_MAX_TEXT 512 // Longer texts are indexed up to this length
+
+typedef struct {
+  uint32_t key; // 0: free entry
+  uint32_t count;
+  uint32_t capacity;
+  uint16_t *slots; // Sorted
+} text_posting_t;
+
+typedef struct {
+  text_posting_t *table; // Open addressing on key
+  uint32_t size;         // Power of two
+  uint32_t used;
+} text_index_t;
+
+// Writes the text of `slot` (NUL-terminated, at most `len` bytes)
+typedef void (*text_index_get_fn)(uint16_t slot, char *buf, size_t len,
+                                  void *ctx);
+
+/**
+ * @brief Index `text` under `slot` (adding an indexed text again is a no-op)
+ */
+esp_err_t text_index_add(text_index_t *x, uint16_t slot, const char *text);
+
+/**
+ * @brief Remove `slot` from the keys of `text`, as it was when added
+ */
+void text_index_remove(text_index_t *x, uint16_t slot, const char *text);
+
+/**
+ * @brief Slots whose text holds every word of `query`, in slot order
+ * @return Number of slots written to `out` (at most `max`)
+ */
+uint32_t text_index_search(const text_index_t *x, const char *query,
+                           text_index_get_fn get, void *ctx, uint32_t *out,
+                           uint32_t max);
+
+/**
+ * @brief Drop every posting; memory is kept
+ */
+void text_index_clear(text_index_t *x);
+
+#endif // TEXT_INDEX_H
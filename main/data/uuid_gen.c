@@ -0,0 +1,46 @@
+/**
+ * @file uuid_gen.c
+ * @brief Random UUID generation and formatting
+ */
+
+#include "uuid_gen.h"
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef ESP_PLATFORM
+#include "esp_random.h"
+#else
+#include <stdio.h>
+#include <stdlib.h>
+#endif
+
+static const char hex[] = "0123456789abcdef";
+
+static void fill_random(uint8_t *buf, size_t len) {
+#ifdef ESP_PLATFORM
+  esp_fill_random(buf, len);
+#else
+  static FILE *urandom;
+  if (urandom == NULL)
+    urandom = fopen("/dev/urandom", "rb");
+  if (urandom == NULL || fread(buf, 1, len, urandom) != len)
+    for (size_t i = 0; i < len; i++) // No OS source: better than nothing
+      buf[i] = (uint8_t)rand();
+#endif
+}
+
+void uuid_v4(char out[UUID_STR_LEN]) {
+  uint8_t b[16];
+  fill_random(b, sizeof(b));
+  b[6] = (b[6] & 0x0f) | 0x40; // Version 4
+  b[8] = (b[8] & 0x3f) | 0x80; // RFC 4122 variant
+
+  char *p = out;
+  for (int i = 0; i < 16; i++) {
+    if (i == 4 || i == 6 || i == 8 || i == 10)
+      *p++ = '-';
+    *p++ = hex[b[i] >> 4];
+    *p++ = hex[b[i] & 0x0f];
+  }
+  *p = '\0';
+}
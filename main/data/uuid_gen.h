@@ -0,0 +1,24 @@
+/**
+ * @file uuid_gen.h
+ * @brief Random (version 4) UUIDs for the records
+ *
+ * 122 of the 128 bits come from the hardware RNG, so two UUIDs drawn
+ * anywhere, on this device or another, practically never collide: a
+ * collection would need around 2^61 of them for even odds. The database
+ * still checks each new one against its UUID index.
+ *
+ * Host builds (tests, tools) have no RNG peripheral and read the operating
+ * system's random source instead.
+ */
+
+#ifndef UUID_GEN_H
+#define UUID_GEN_H
+
+#define UUID_STR_LEN 37 // 8-4-4-4-12 hex digits + null, as reptile_t.uuid
+
+/**
+ * @brief Write a new random UUID to `out`, in lower case
+ */
+void uuid_v4(char out[UUID_STR_LEN]);
+
+#endif // UUID_GEN_H
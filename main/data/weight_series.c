@@ -0,0 +1,242 @@
+/**
+ * @file weight_series.c
+ * @brief Delta/varint weight history and its weekly and monthly tiers
+ */
+
+#include "weight_series.h"
+#include "esp_heap_caps.h"
+#include "esp_log.h"
+#include <string.h>
+#include <time.h>
+
+static const char *TAG = "WEIGHT_SERIES";
+
+#define MIN_DATA_CAPACITY 32
+#define MIN_TIER_CAPACITY 8
+#define POINT_MAX_BYTES 13 // 10-byte time varint + 3-byte gram varint
+#define SECONDS_PER_WEEK (7 * 24 * 3600)
+#define EPOCH_TO_MONDAY (3 * 24 * 3600) // 1970-01-01 was a Thursday
+
+static void *series_realloc(void *ptr, size_t size) {
+  return heap_caps_realloc_prefer(ptr, size, 2, MALLOC_CAP_SPIRAM,
+                                  MALLOC_CAP_DEFAULT);
+}
+
+// ====================================================================================
+// ENCODING
+// ====================================================================================
+
+static size_t put_varint(uint8_t *out, uint64_t v) {
+  size_t n = 0;
+  while (v >= 0x80) {
+    out[n++] = (uint8_t)v | 0x80;
+    v >>= 7;
+  }
+  out[n++] = (uint8_t)v;
+  return n;
+}
+
+// Returns false on a truncated or over-long varint
+static bool get_varint(const uint8_t *data, uint32_t len, uint32_t *pos,
+                       uint64_t *v) {
+  *v = 0;
+  for (int shift = 0; shift < 64 && *pos < len; shift += 7) {
+    uint8_t b = data[(*pos)++];
+    *v |= (uint64_t)(b & 0x7F) << shift;
+    if ((b & 0x80) == 0)
+      return true;
+  }
+  return false;
+}
+
+static uint64_t zigzag(int64_t v) { return ((uint64_t)v << 1) ^ (v >> 63); }
+
+static int64_t unzigzag(uint64_t v) {
+  return (int64_t)(v >> 1) ^ -(int64_t)(v & 1);
+}
+
+// ====================================================================================
+// TIERS
+// ====================================================================================
+
+static uint16_t clamp_period(int64_t period) {
+  if (period < 0)
+    return 0;
+  return period > UINT16_MAX ? UINT16_MAX : (uint16_t)period;
+}
+
+static uint16_t period_of(weight_tier_t tier, int64_t timestamp) {
+  if (tier == WEIGHT_TIER_WEEK)
+    return clamp_period((timestamp + EPOCH_TO_MONDAY) / SECONDS_PER_WEEK);
+  time_t t = (time_t)timestamp;
+  struct tm tm;
+  if (timestamp < 0 || localtime_r(&t, &tm) == NULL)
+    return 0;
+  return clamp_period((int64_t)(tm.tm_year - 70) * 12 + tm.tm_mon);
+}
+
+// Make room for one more bucket
+static esp_err_t tier_reserve(weight_tier_buf_t *t) {
+  if (t->count < t->capacity)
+    return ESP_OK;
+  uint32_t capacity = t->capacity ? t->capacity * 2 : MIN_TIER_CAPACITY;
+  weight_bucket_t *b =
+      series_realloc(t->buckets, capacity * sizeof(weight_bucket_t));
+  if (b == NULL)
+    return ESP_ERR_NO_MEM;
+  t->buckets = b;
+  t->capacity = capacity;
+  return ESP_OK;
+}
+
+// Fold a point into its bucket; needs a prior tier_reserve()
+static void tier_add(weight_tier_buf_t *t, uint16_t period, uint16_t grams) {
+  // Points nearly always land in the newest bucket or just after it
+  uint32_t lo = 0, hi = t->count;
+  if (t->count == 0 || t->buckets[t->count - 1].period <= period) {
+    lo = t->count > 0 && t->buckets[t->count - 1].period == period
+             ? t->count - 1
+             : t->count;
+  } else {
+    while (lo < hi) {
+      uint32_t mid = (lo + hi) / 2;
+      if (t->buckets[mid].period < period)
+        lo = mid + 1;
+      else
+        hi = mid;
+    }
+  }
+
+  weight_bucket_t *b = &t->buckets[lo];
+  if (lo == t->count || b->period != period) {
+    memmove(b + 1, b, (t->count - lo) * sizeof(*b));
+    t->count++;
+    *b = (weight_bucket_t){.period = period, .min = grams, .max = grams};
+  }
+  if (b->count < UINT16_MAX) {
+    b->count++;
+    b->sum += grams;
+  }
+  if (grams < b->min)
+    b->min = grams;
+  if (grams > b->max)
+    b->max = grams;
+}
+
+static esp_err_t tiers_add(weight_series_t *s, int64_t timestamp,
+                           uint16_t grams) {
+  for (int i = 0; i < WEIGHT_TIER_COUNT; i++)
+    if (tier_reserve(&s->tiers[i]) != ESP_OK)
+      return ESP_ERR_NO_MEM;
+  for (int i = 0; i < WEIGHT_TIER_COUNT; i++)
+    tier_add(&s->tiers[i], period_of(i, timestamp), grams);
+  return ESP_OK;
+}
+
+// ====================================================================================
+// API
+// ====================================================================================
+
+esp_err_t weight_series_append(weight_series_t *s, int64_t timestamp,
+                               uint16_t grams) {
+  if (s->len + POINT_MAX_BYTES > s->capacity) {
+    uint32_t capacity = s->capacity ? s->capacity * 2 : MIN_DATA_CAPACITY;
+    uint8_t *data = series_realloc(s->data, capacity);
+    if (data == NULL) {
+      ESP_LOGE(TAG, "Out of memory growing a series to %u bytes",
+               (unsigned)capacity);
+      return ESP_ERR_NO_MEM;
+    }
+    s->data = data;
+    s->capacity = capacity;
+  }
+  if (tiers_add(s, timestamp, grams) != ESP_OK)
+    return ESP_ERR_NO_MEM;
+
+  s->len += put_varint(s->data + s->len, zigzag(timestamp - s->last_ts));
+  s->len += put_varint(s->data + s->len,
+                       zigzag((int64_t)grams - (int64_t)s->last_grams));
+  s->count++;
+  s->last_ts = timestamp;
+  s->last_grams = grams;
+  return ESP_OK;
+}
+
+bool weight_series_next(const weight_series_t *s, weight_cursor_t *c,
+                        weight_point_t *out) {
+  uint64_t dt, dg;
+  if (c->pos >= s->len || !get_varint(s->data, s->len, &c->pos, &dt) ||
+      !get_varint(s->data, s->len, &c->pos, &dg))
+    return false;
+  c->ts += unzigzag(dt);
+  c->grams = (uint16_t)(c->grams + unzigzag(dg));
+  out->timestamp = c->ts;
+  out->grams = c->grams;
+  return true;
+}
+
+int weight_series_buckets(const weight_series_t *s, weight_tier_t tier,
+                          weight_bucket_t *out, int max) {
+  if (tier >= WEIGHT_TIER_COUNT || max <= 0)
+    return 0;
+  const weight_tier_buf_t *t = &s->tiers[tier];
+  uint32_t n = t->count < (uint32_t)max ? t->count : (uint32_t)max;
+  memcpy(out, t->buckets + (t->count - n), n * sizeof(*out));
+  return n;
+}
+
+esp_err_t weight_series_load(weight_series_t *s, const uint8_t *data,
+                             uint32_t len, uint32_t count) {
+  weight_series_free(s);
+  if (len == 0)
+    return count == 0 ? ESP_OK : ESP_ERR_INVALID_SIZE;
+
+  s->data = series_realloc(NULL, len + POINT_MAX_BYTES);
+  if (s->data == NULL)
+    return ESP_ERR_NO_MEM;
+  memcpy(s->data, data, len);
+  s->len = len;
+  s->capacity = len + POINT_MAX_BYTES;
+
+  weight_cursor_t c = WEIGHT_CURSOR_INIT;
+  weight_point_t p;
+  uint32_t n = 0;
+  while (n < count && weight_series_next(s, &c, &p)) {
+    if (tiers_add(s, p.timestamp, p.grams) != ESP_OK) {
+      weight_series_free(s);
+      return ESP_ERR_NO_MEM;
+    }
+    n++;
+  }
+  if (n != count || c.pos != len) {
+    weight_series_free(s);
+    return ESP_ERR_INVALID_SIZE;
+  }
+  s->count = count;
+  s->last_ts = c.ts;
+  s->last_grams = c.grams;
+  return ESP_OK;
+}
+
+esp_err_t weight_series_truncate(weight_series_t *s, uint32_t count) {
+  if (count >= s->count)
+    return ESP_OK;
+  weight_cursor_t c = WEIGHT_CURSOR_INIT;
+  weight_point_t p;
+  for (uint32_t n = 0; n < count; n++)
+    weight_series_next(s, &c, &p);
+
+  // Reload from the kept bytes: buckets cannot be taken apart
+  uint8_t *data = s->data;
+  s->data = NULL;
+  esp_err_t ret = weight_series_load(s, data, c.pos, count);
+  heap_caps_free(data);
+  return ret;
+}
+
+void weight_series_free(weight_series_t *s) {
+  heap_caps_free(s->data);
+  for (int i = 0; i < WEIGHT_TIER_COUNT; i++)
+    heap_caps_free(s->tiers[i].buckets);
+  memset(s, 0, sizeof(*s));
+}
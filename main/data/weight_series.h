@@ -0,0 +1,106 @@
+/**
+ * @file weight_series.h
+ * @brief Compact per-animal weight history with downsampled tiers
+ *
+ * Raw weigh-ins are stored as a byte stream: each point is the zigzag varint
+ * of its timestamp delta followed by the zigzag varint of its gram delta,
+ * both relative to the previous point, so a weekly weigh-in costs about four
+ * bytes. Weekly and monthly aggregates are kept up to date on every append,
+ * so a multi-year curve is drawn from a few hundred buckets without decoding
+ * the raw points.
+ */
+
+#ifndef WEIGHT_SERIES_H
+#define WEIGHT_SERIES_H
+
+#include "esp_err.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+typedef enum {
+  WEIGHT_TIER_WEEK = 0,
+  WEIGHT_TIER_MONTH,
+  WEIGHT_TIER_COUNT
+} weight_tier_t;
+
+typedef struct {
+  uint16_t period; // Weeks (from a Monday) or months since January 1970
+  uint16_t count;
+  uint16_t min;
+  uint16_t max;
+  uint32_t sum; // Mean is sum / count
+} weight_bucket_t;
+
+typedef struct {
+  weight_bucket_t *buckets; // Sorted by period
+  uint32_t count;
+  uint32_t capacity;
+} weight_tier_buf_t;
+
+typedef struct {
+  uint8_t *data; // Encoded points, in insertion order
+  uint32_t len;
+  uint32_t capacity;
+  uint32_t count;      // Points in `data`
+  int64_t last_ts;     // Base of the next delta
+  uint16_t last_grams; // Base of the next delta
+  weight_tier_buf_t tiers[WEIGHT_TIER_COUNT];
+} weight_series_t;
+
+typedef struct {
+  int64_t timestamp;
+  uint16_t grams;
+} weight_point_t;
+
+// Decoding position in a series; start from WEIGHT_CURSOR_INIT
+typedef struct {
+  uint32_t pos;
+  int64_t ts;
+  uint16_t grams;
+} weight_cursor_t;
+
+#define WEIGHT_CURSOR_INIT {0, 0, 0}
+
+/**
+ * @brief Append one weigh-in; points may arrive out of time order
+ * @return ESP_ERR_NO_MEM if the series could not grow (nothing is changed)
+ */
+esp_err_t weight_series_append(weight_series_t *s, int64_t timestamp,
+                               uint16_t grams);
+
+/**
+ * @brief Decode the next raw point
+ * @return false once every point has been read
+ */
+bool weight_series_next(const weight_series_t *s, weight_cursor_t *c,
+                        weight_point_t *out);
+
+/**
+ * @brief Copy the newest `max` buckets of a tier, oldest first
+ * @return Number of buckets written
+ */
+int weight_series_buckets(const weight_series_t *s, weight_tier_t tier,
+                          weight_bucket_t *out, int max);
+
+/**
+ * @brief Replace a series with `count` encoded points and rebuild its tiers
+ * @return ESP_ERR_INVALID_SIZE if the bytes do not hold exactly `count`
+ *         points (the series is left empty)
+ */
+esp_err_t weight_series_load(weight_series_t *s, const uint8_t *data,
+                             uint32_t len, uint32_t count);
+
+/**
+ * @brief Keep the first `count` points of a series and rebuild its tiers
+ * @return ESP_ERR_NO_MEM if the tiers could not be rebuilt (the series is
+ *         left empty)
+ */
+esp_err_t weight_series_truncate(weight_series_t *s, uint32_t count);
+
+/**
+ * @brief Release a series' memory and leave it empty
+ */
+void weight_series_free(weight_series_t *s);
+
+#endif // WEIGHT_SERIES_H
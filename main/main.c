@@ -756,13 +756,10 @@ void app_main(void) {
     ESP_LOGW(TAG, "Bluetooth init failed");
   }
 
-  // SD Card
-  if (sd_card_init() != ESP_OK) {
-    ESP_LOGW(TAG, "SD Card init failed");
-  }
-
-  // Data
-  db_init_demo_data();
+  // Data: the registry preview mapped from flash, so the UI comes up with
+  // the animals before the SD card is touched
+  db_init();
+  db_map_boot_view();
   app_sntp_init();
 
   // Audio
@@ -805,6 +802,17 @@ void app_main(void) {
     lvgl_port_unlock();
   }
 
+  // SD Card, then the full data (snapshot + journal replay, demo data on
+  // first boot) while the UI shows the preview
+  if (sd_card_init() != ESP_OK) {
+    ESP_LOGW(TAG, "SD Card init failed");
+  }
+  db_load_data();
+  if (lvgl_port_lock(0)) {
+    ui_refresh();
+    lvgl_port_unlock();
+  }
+
   // Loop
   while (1) {
     vTaskDelay(pdMS_TO_TICKS(1000));
@@ -14,6 +14,9 @@
 // REPTILE MANAGER DATA STRUCTURES
 // ====================================================================================
 
+// Handle of an interned string (see db_string()); 0 is the empty string
+typedef uint32_t str_ref_t;
+
 // Animal species types
 typedef enum {
   SPECIES_SNAKE = 0,
@@ -50,14 +53,14 @@ typedef enum {
 // Animal record structure - CONFORME Arrêté 10 août 2004
 typedef struct {
   // === Identification unique ===
-  uint8_t id;
+  uint32_t id;
   char uuid[37]; // UUID v4 format (36 chars + null)
 
   // === Identification espèce ===
   char name[32];               // Nom usuel
-  char species_common[48];     // Nom vernaculaire (ex: "Python Royal")
-  char species_scientific[64]; // Nom latin (ex: "Python regius")
-  char morph[32];              // Phase/mutation (ex: "Pastel Banana")
+  str_ref_t species_common;     // Nom vernaculaire (ex: "Python Royal")
+  str_ref_t species_scientific; // Nom latin (ex: "Python regius")
+  char morph[32];               // Phase/mutation (ex: "Pastel Banana")
   reptile_species_t species;
   reptile_sex_t sex;
 
@@ -79,10 +82,10 @@ typedef struct {
 
   // === Acquisition/Entrée ===
   time_t date_acquisition;   // Date d'entrée dans l'élevage
-  char origin[64];           // Provenance (Élevage X, Animalerie Y, Import)
+  str_ref_t origin;          // Provenance (Élevage X, Animalerie Y, Import)
   char origin_country[3];    // Code pays ISO 3166-1 alpha-2
-  char breeder_name[64];     // Nom éleveur/vendeur
-  char breeder_address[128]; // Adresse complète
+  str_ref_t breeder_name;    // Nom éleveur/vendeur
+  str_ref_t breeder_address; // Adresse complète
   char breeder_cdc[32];      // N° CDC vendeur si applicable
   bool captive_bred;         // Né en captivité (NC) vs prélevé (W)
 
@@ -98,6 +101,7 @@ typedef struct {
   uint8_t terrarium_id;
   uint16_t purchase_price; // Prix d'achat en euros
   time_t last_feeding;
+  uint8_t feeding_interval_days; // Jours entre repas (0 = défaut de l'espèce)
   time_t last_weight;
   time_t last_shed;
   health_status_t health;
@@ -109,12 +113,13 @@ typedef struct {
   bool doc_cession_ok; // Certificat de Cession
   bool doc_entree_ok;  // Bon d'entrée (Livre de Police)
 
-  bool active; // false = sorti du cheptel
+  bool active;      // false = sorti du cheptel
+  uint32_t mod_seq; // N° de la dernière modification (export incrémental)
 } reptile_t;
 
 // Feeding record
 typedef struct {
-  uint8_t animal_id;
+  uint32_t animal_id;
   time_t timestamp;
   char prey_type[24]; // e.g., "Souris adulte", "Grillon"
   uint8_t prey_count;
@@ -123,7 +128,7 @@ typedef struct {
 
 // Health/Vet record
 typedef struct {
-  uint8_t animal_id;
+  uint32_t animal_id;
   time_t timestamp;
   char event_type[24]; // "Vermifuge", "Mue", "Vétérinaire"
   char description[64];
@@ -132,9 +137,9 @@ typedef struct {
 
 // Breeding/Reproduction record
 typedef struct {
-  uint8_t id;
-  uint8_t female_id;
-  uint8_t male_id;
+  uint32_t id;
+  uint32_t female_id;
+  uint32_t male_id;
   time_t pairing_date;
   time_t laying_date; // Actual or estimated
   uint8_t egg_count;
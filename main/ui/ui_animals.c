@@ -1,6 +1,9 @@
 #include "ui_animals.h"
+#include "audit_log.h"
+#include "importer.h"
 #include "ui_popups.h"
 #include <string.h>
+#include <sys/stat.h>
 
 // Local handles
 lv_obj_t *page_animals = NULL;
@@ -9,6 +12,10 @@ lv_obj_t *page_breeding = NULL;
 lv_obj_t *page_conformity = NULL;
 
 static lv_obj_t *animal_list = NULL;
+static lv_obj_t *search_ta = NULL;
+static query_result_t list_rows; // Reused between list refreshes
+static uint32_t list_cursor;      // First row of list_rows not shown yet
+static lv_timer_t *search_timer = NULL;
 static lv_obj_t *detail_name_label = NULL;
 static lv_obj_t *detail_tabview = NULL;
 static lv_obj_t *lbl_detail_spec = NULL;
@@ -17,20 +24,180 @@ static lv_obj_t *lbl_detail_age = NULL;
 static lv_obj_t *lbl_detail_weight = NULL;
 static lv_obj_t *lbl_detail_feed = NULL;
 static lv_obj_t *lbl_detail_shed = NULL;
+static lv_obj_t *lbl_detail_trend = NULL;
+static lv_obj_t *chart_detail_weight = NULL;
+static lv_chart_series_t *ser_detail_weight = NULL;
+
+// Weight chart: weekly means for the first year, monthly means beyond
+#define WEIGHT_CHART_WEEKS 52
+#define WEIGHT_CHART_MONTHS 120
 
 // Callbacks
 static void add_animal_cb(lv_event_t *e); // Forward declaration
+static void animal_list_scroll_cb(lv_event_t *e);
 static void animal_detail_back_cb(lv_event_t *e) { navigate_to(PAGE_ANIMALS); }
+
+static void undo_cb(lv_event_t *e) {
+  if (!db_undo()) {
+    show_toast("Rien a annuler", COLOR_WARNING);
+    return;
+  }
+  update_animal_detail();
+  update_animal_list();
+  show_toast("Action annulee", COLOR_SUCCESS);
+}
 static void conformity_back_cb(lv_event_t *e) { navigate_to(PAGE_HOME); }
-static void export_registre_cb(lv_event_t *e) {
-  esp_err_t ret = db_export_csv("/sdcard/registre.csv");
-  if (ret == ESP_OK) {
+
+// The export runs on its own task; this timer follows it on the button
+static lv_obj_t *lbl_export = NULL;
+static lv_timer_t *export_timer = NULL;
+
+static void export_poll_cb(lv_timer_t *t) {
+  uint32_t done, total;
+  db_export_state_t state = db_export_csv_progress(&done, &total);
+  if (state == DB_EXPORT_RUNNING) {
+    lv_label_set_text_fmt(lbl_export, LV_SYMBOL_STOP " Export %u%%",
+                          total ? (unsigned)(done * 100 / total) : 0);
+    return;
+  }
+  lv_timer_delete(t);
+  export_timer = NULL;
+  lv_label_set_text(lbl_export, LV_SYMBOL_SD_CARD " Export Registre");
+  if (state == DB_EXPORT_DONE) {
     show_toast("Registre Exporte (SD)", COLOR_SUCCESS);
+  } else if (state == DB_EXPORT_CANCELLED) {
+    show_toast("Export annule", COLOR_WARNING);
   } else {
     show_toast("Erreur Export SD", COLOR_DANGER);
   }
 }
 
+static void export_registre_cb(lv_event_t *e) {
+  if (export_timer) { // Second tap cancels
+    db_export_csv_cancel();
+    return;
+  }
+  if (db_export_csv_start("/sdcard/registre.csv", DB_EXPORT_AUTO) !=
+      ESP_OK) {
+    show_toast("Erreur Export SD", COLOR_DANGER);
+    return;
+  }
+  lv_label_set_text(lbl_export, LV_SYMBOL_STOP " Export 0%");
+  export_timer = lv_timer_create(export_poll_cb, 200, NULL);
+}
+
+// Full check of the Livre de Police chain, on its own task like the export
+static lv_obj_t *lbl_audit = NULL;
+static lv_timer_t *audit_timer = NULL;
+
+static void audit_label_update(const audit_status_t *audit) {
+  if (audit->state == AUDIT_INTACT)
+    lv_label_set_text_fmt(lbl_audit, "Livre: integre (%u entrees)",
+                          (unsigned)audit->entries);
+  else if (audit->state == AUDIT_BROKEN && audit->truncated)
+    lv_label_set_text_fmt(lbl_audit, "Livre: TRONQUE (%u entrees)",
+                          (unsigned)audit->entries);
+  else if (audit->state == AUDIT_BROKEN)
+    lv_label_set_text_fmt(lbl_audit, "Livre: ALTERE (entree %u)",
+                          (unsigned)audit->first_bad);
+  else
+    lv_label_set_text(lbl_audit, "Livre: non verifie");
+}
+
+static void audit_poll_cb(lv_timer_t *t) {
+  audit_status_t audit;
+  audit_check_t state = audit_verify_progress(&audit);
+  if (state == AUDIT_CHECK_RUNNING)
+    return;
+  lv_timer_delete(t);
+  audit_timer = NULL;
+  if (state != AUDIT_CHECK_DONE) {
+    lv_label_set_text(lbl_audit, "Livre: non verifie");
+    show_toast("Erreur Lecture SD", COLOR_DANGER);
+    return;
+  }
+  audit_label_update(&audit);
+  if (audit.state == AUDIT_INTACT)
+    show_toast("Livre de Police integre", COLOR_SUCCESS);
+  else
+    show_toast("Livre de Police altere", COLOR_DANGER);
+}
+
+static void audit_verify_cb(lv_event_t *e) {
+  if (audit_timer)
+    return; // Already running
+  if (audit_verify_start(true) != ESP_OK) {
+    show_toast("Erreur Lecture SD", COLOR_DANGER);
+    return;
+  }
+  lv_label_set_text(lbl_audit, "Livre: verification...");
+  audit_timer = lv_timer_create(audit_poll_cb, 200, NULL);
+}
+
+// Import of a registre kept elsewhere, dropped on the card as import.csv
+// (spreadsheet) or import.json; same polling as the export
+#define IMPORT_CSV_PATH "/sdcard/import.csv"
+#define IMPORT_JSON_PATH "/sdcard/import.json"
+
+static lv_obj_t *lbl_import = NULL;
+static lv_timer_t *import_timer = NULL;
+
+static void import_poll_cb(lv_timer_t *t) {
+  import_result_t res;
+  import_state_t state = import_progress(&res);
+  if (state == IMPORT_RUNNING) {
+    lv_label_set_text_fmt(lbl_import, "Import %u", (unsigned)res.rows);
+    return;
+  }
+  lv_timer_delete(t);
+  import_timer = NULL;
+  lv_label_set_text(lbl_import, LV_SYMBOL_DOWNLOAD " Import");
+  if (state != IMPORT_DONE) {
+    show_toast(res.first_error[0] ? res.first_error : "Erreur Import SD",
+               COLOR_DANGER);
+    return;
+  }
+  char msg[64];
+  snprintf(msg, sizeof(msg), "%u importes, %u doublons, %u rejetes",
+           (unsigned)res.imported, (unsigned)res.duplicates,
+           (unsigned)res.rejected);
+  show_toast(msg, res.rejected ? COLOR_WARNING : COLOR_SUCCESS);
+  update_animal_list();
+}
+
+static void import_registre_cb(lv_event_t *e) {
+  if (import_timer)
+    return; // Already running
+  struct stat st;
+  const char *path =
+      stat(IMPORT_CSV_PATH, &st) == 0 ? IMPORT_CSV_PATH : IMPORT_JSON_PATH;
+  if (import_start(path) != ESP_OK) {
+    show_toast("Erreur Import SD", COLOR_DANGER);
+    return;
+  }
+  lv_label_set_text(lbl_import, "Import 0");
+  import_timer = lv_timer_create(import_poll_cb, 200, NULL);
+}
+
+// The list follows the search box as the user types, once typing pauses
+#define SEARCH_DEBOUNCE_MS 150
+#define LIST_PAGE 20        // Cards built per page of the list
+#define LIST_PRELOAD_PX 200 // Next page is built this close to the bottom
+
+static void search_timer_cb(lv_timer_t *t) {
+  search_timer = NULL; // One-shot, deleted by LVGL
+  update_animal_list();
+}
+
+static void search_changed_cb(lv_event_t *e) {
+  if (search_timer) {
+    lv_timer_reset(search_timer);
+    return;
+  }
+  search_timer = lv_timer_create(search_timer_cb, SEARCH_DEBOUNCE_MS, NULL);
+  lv_timer_set_repeat_count(search_timer, 1);
+}
+
 static void animal_list_item_cb(lv_event_t *e) {
   selected_animal_id = (int)(intptr_t)lv_event_get_user_data(e);
   navigate_to(PAGE_ANIMAL_DETAIL);
@@ -50,15 +217,26 @@ void create_animals_page(lv_obj_t *parent) {
 
   lv_obj_t *title = lv_label_create(page_animals);
   lv_label_set_text(title, "Mes Animaux");
-  lv_obj_align(title, LV_ALIGN_TOP_MID, 0, 10);
+  lv_obj_align(title, LV_ALIGN_TOP_LEFT, 10, 10);
   lv_obj_set_style_text_color(title, COLOR_TEXT, 0);
 
+  search_ta = lv_textarea_create(page_animals);
+  lv_textarea_set_one_line(search_ta, true);
+  lv_textarea_set_placeholder_text(search_ta, "Rechercher (nom, espece, puce)");
+  lv_obj_set_width(search_ta, 300);
+  lv_obj_align(search_ta, LV_ALIGN_TOP_RIGHT, -10, 0);
+  lv_obj_add_event_cb(search_ta, ta_event_cb, LV_EVENT_ALL, NULL);
+  lv_obj_add_event_cb(search_ta, search_changed_cb, LV_EVENT_VALUE_CHANGED,
+                      NULL);
+
   animal_list = lv_obj_create(page_animals);
   lv_obj_set_size(animal_list, LCD_H_RES - 20, LCD_V_RES - 150);
   lv_obj_align(animal_list, LV_ALIGN_TOP_MID, 0, 40);
   lv_obj_set_flex_flow(animal_list, LV_FLEX_FLOW_COLUMN);
   lv_obj_set_style_bg_opa(animal_list, LV_OPA_TRANSP, 0);
   lv_obj_set_style_border_width(animal_list, 0, 0);
+  lv_obj_add_event_cb(animal_list, animal_list_scroll_cb, LV_EVENT_SCROLL,
+                      NULL);
 
   // Floating Action Button (Add) - Reusing logic from 7 inch or adding here
   // In ui_manager.c it was missing in the fragment I saw, but it's usually
@@ -86,74 +264,96 @@ void create_animals_page(lv_obj_t *parent) {
   // I'll attach a local wrapper.
 }
 
+static void animal_list_add_card(int i) {
+  reptile_species_t species = db_reptile_species(i);
+
+  lv_obj_t *card = lv_obj_create(animal_list);
+  lv_obj_set_size(card, lv_pct(100), 80);
+  lv_obj_set_style_bg_color(card, lv_color_hex(0x162B1D), 0);
+  lv_obj_set_style_bg_opa(card, LV_OPA_COVER, 0);
+  lv_obj_set_style_border_width(card, 0, 0);
+  lv_obj_set_style_pad_all(card, 10, 0);
+  lv_obj_set_style_radius(card, 12, 0);
+  lv_obj_set_style_shadow_width(card, 20, 0);
+  lv_obj_set_style_shadow_opa(card, LV_OPA_20, 0);
+  lv_obj_set_style_shadow_offset_y(card, 2, 0);
+  lv_obj_clear_flag(card, LV_OBJ_FLAG_SCROLLABLE);
+  lv_obj_add_flag(card, LV_OBJ_FLAG_CLICKABLE);
+  lv_obj_add_event_cb(card, animal_list_item_cb, LV_EVENT_CLICKED,
+                      (void *)(intptr_t)i);
+
+  // Icon
+  lv_obj_t *icon = lv_label_create(card);
+  lv_label_set_text(icon, reptile_get_icon(species));
+  lv_obj_set_style_text_font(icon, &lv_font_montserrat_24, 0);
+  lv_color_t icon_color = COLOR_TEXT;
+  if (species == SPECIES_SNAKE)
+    icon_color = COLOR_SNAKE;
+  else if (species == SPECIES_LIZARD)
+    icon_color = COLOR_LIZARD;
+  else if (species == SPECIES_TURTLE)
+    icon_color = COLOR_TURTLE;
+  lv_obj_set_style_text_color(icon, icon_color, 0);
+  lv_obj_align(icon, LV_ALIGN_LEFT_MID, 5, 0);
+
+  // Name
+  char text[DB_TEXT_LEN];
+  lv_obj_t *name = lv_label_create(card);
+  lv_label_set_text(name, db_reptile_name(i, text, sizeof(text)));
+  lv_obj_set_style_text_font(name, &lv_font_montserrat_16, 0);
+  lv_obj_set_style_text_color(name, COLOR_TEXT, 0);
+  lv_obj_align(name, LV_ALIGN_TOP_LEFT, 50, 5);
+
+  // Species
+  lv_obj_t *spec = lv_label_create(card);
+  lv_label_set_text(spec, db_reptile_species_name(i, text, sizeof(text)));
+  lv_obj_set_style_text_font(spec, &lv_font_montserrat_12, 0);
+  lv_obj_set_style_text_color(spec, COLOR_TEXT_DIM, 0);
+  lv_obj_align(spec, LV_ALIGN_BOTTOM_LEFT, 50, -5);
+
+  // Status
+  lv_obj_t *badge = lv_obj_create(card);
+  lv_obj_set_size(badge, 12, 12);
+  lv_obj_set_style_radius(badge, LV_RADIUS_CIRCLE, 0);
+  lv_obj_set_style_border_width(badge, 0, 0);
+  lv_obj_align(badge, LV_ALIGN_RIGHT_MID, -5, 0);
+  if (reptile_is_feeding_due(i)) {
+    lv_obj_set_style_bg_color(badge, COLOR_DANGER, 0);
+  } else {
+    lv_obj_set_style_bg_color(badge, COLOR_SUCCESS, 0);
+  }
+}
+
+// Cards are built one page at a time as the list scrolls, so a refresh
+// costs the same whatever the number of matches
+static void animal_list_load_page(void) {
+  int page[LIST_PAGE];
+  int n = query_page(&list_rows, &list_cursor, page, LIST_PAGE);
+  for (int k = 0; k < n; k++)
+    animal_list_add_card(page[k]);
+}
+
+static void animal_list_scroll_cb(lv_event_t *e) {
+  if (list_cursor < list_rows.count &&
+      lv_obj_get_scroll_bottom(animal_list) < LIST_PRELOAD_PX)
+    animal_list_load_page();
+}
+
 void update_animal_list(void) {
   if (!animal_list)
     return;
   lv_obj_clean(animal_list);
-
-  for (int i = 0; i < reptile_count; i++) {
-    if (!reptiles[i].active)
-      continue;
-
-    lv_obj_t *card = lv_obj_create(animal_list);
-    lv_obj_set_size(card, lv_pct(100), 80);
-    lv_obj_set_style_bg_color(card, lv_color_hex(0x162B1D), 0);
-    lv_obj_set_style_bg_opa(card, LV_OPA_COVER, 0);
-    lv_obj_set_style_border_width(card, 0, 0);
-    lv_obj_set_style_pad_all(card, 10, 0);
-    lv_obj_set_style_radius(card, 12, 0);
-    lv_obj_set_style_shadow_width(card, 20, 0);
-    lv_obj_set_style_shadow_opa(card, LV_OPA_20, 0);
-    lv_obj_set_style_shadow_offset_y(card, 2, 0);
-    lv_obj_clear_flag(card, LV_OBJ_FLAG_SCROLLABLE);
-    lv_obj_add_flag(card, LV_OBJ_FLAG_CLICKABLE);
-    lv_obj_add_event_cb(card, animal_list_item_cb, LV_EVENT_CLICKED,
-                        (void *)(intptr_t)i);
-
-    // Icon
-    lv_obj_t *icon = lv_label_create(card);
-    lv_label_set_text(icon, reptile_get_icon(reptiles[i].species));
-    lv_obj_set_style_text_font(icon, &lv_font_montserrat_24, 0);
-    lv_color_t icon_color = COLOR_TEXT;
-    if (reptiles[i].species == SPECIES_SNAKE)
-      icon_color = COLOR_SNAKE;
-    else if (reptiles[i].species == SPECIES_LIZARD)
-      icon_color = COLOR_LIZARD;
-    else if (reptiles[i].species == SPECIES_TURTLE)
-      icon_color = COLOR_TURTLE;
-    lv_obj_set_style_text_color(icon, icon_color, 0);
-    lv_obj_align(icon, LV_ALIGN_LEFT_MID, 5, 0);
-
-    // Name
-    lv_obj_t *name = lv_label_create(card);
-    lv_label_set_text(name, reptiles[i].name);
-    lv_obj_set_style_text_font(name, &lv_font_montserrat_16, 0);
-    lv_obj_set_style_text_color(name, COLOR_TEXT, 0);
-    lv_obj_align(name, LV_ALIGN_TOP_LEFT, 50, 5);
-
-    // Species
-    lv_obj_t *spec = lv_label_create(card);
-    lv_label_set_text(spec, reptiles[i].species_common);
-    lv_obj_set_style_text_font(spec, &lv_font_montserrat_12, 0);
-    lv_obj_set_style_text_color(spec, COLOR_TEXT_DIM, 0);
-    lv_obj_align(spec, LV_ALIGN_BOTTOM_LEFT, 50, -5);
-
-    // Status
-    int days = reptile_days_since_feeding(i);
-    int threshold = (reptiles[i].species == SPECIES_SNAKE) ? 7 : 3;
-    lv_obj_t *badge = lv_obj_create(card);
-    lv_obj_set_size(badge, 12, 12);
-    lv_obj_set_style_radius(badge, LV_RADIUS_CIRCLE, 0);
-    lv_obj_set_style_border_width(badge, 0, 0);
-    lv_obj_align(badge, LV_ALIGN_RIGHT_MID, -5, 0);
-    if (days >= threshold) {
-      lv_obj_set_style_bg_color(badge, COLOR_DANGER, 0);
-    } else {
-      lv_obj_set_style_bg_color(badge, COLOR_SUCCESS, 0);
-    }
+  lv_obj_scroll_to_y(animal_list, 0, LV_ANIM_OFF);
+
+  // Active animals by name, narrowed to the search words if any
+  const query_t q = {.sort = QUERY_SORT_NAME,
+                     .text = lv_textarea_get_text(search_ta)};
+  list_cursor = QUERY_CURSOR_START;
+  if (db_query(&q, &list_rows) != ESP_OK) {
+    list_rows.count = 0;
+    return;
   }
-
-  // List updated
+  animal_list_load_page();
 }
 
 void create_animal_detail_page(lv_obj_t *parent) {
@@ -192,6 +392,16 @@ void create_animal_detail_page(lv_obj_t *parent) {
   lv_label_set_text(lbl_edit, LV_SYMBOL_EDIT); // Or SETTINGS
   lv_obj_center(lbl_edit);
 
+  // Undo Button
+  lv_obj_t *btn_undo = lv_button_create(top_bar);
+  lv_obj_set_size(btn_undo, 40, 40);
+  lv_obj_align(btn_undo, LV_ALIGN_RIGHT_MID, -60, 0);
+  lv_obj_set_style_bg_opa(btn_undo, LV_OPA_TRANSP, 0);
+  lv_obj_add_event_cb(btn_undo, undo_cb, LV_EVENT_CLICKED, NULL);
+  lv_obj_t *lbl_undo = lv_label_create(btn_undo);
+  lv_label_set_text(lbl_undo, LV_SYMBOL_REFRESH);
+  lv_obj_center(lbl_undo);
+
   detail_name_label = lv_label_create(top_bar);
   lv_obj_set_style_text_font(detail_name_label, &lv_font_montserrat_20, 0);
   lv_obj_set_style_text_color(detail_name_label, COLOR_TEXT, 0);
@@ -243,6 +453,31 @@ void create_animal_detail_page(lv_obj_t *parent) {
   lv_obj_set_style_text_color(lbl_detail_feed, COLOR_TEXT, 0);
   lv_obj_align_to(lbl_detail_feed, sep, LV_ALIGN_OUT_BOTTOM_LEFT, 0, 15);
 
+  lbl_detail_trend = lv_label_create(t2);
+  lv_obj_set_style_text_color(lbl_detail_trend, COLOR_TEXT, 0);
+  lv_obj_align(lbl_detail_trend, LV_ALIGN_TOP_LEFT, 20, 200);
+
+  chart_detail_weight = lv_chart_create(t2);
+  lv_obj_set_size(chart_detail_weight, LCD_H_RES - 80, 200);
+  lv_obj_align_to(chart_detail_weight, lbl_detail_trend,
+                  LV_ALIGN_OUT_BOTTOM_LEFT, 0, 10);
+  lv_obj_set_style_bg_color(chart_detail_weight, COLOR_BG_CARD, 0);
+  lv_obj_set_style_border_color(chart_detail_weight, COLOR_DIVIDER, 0);
+  lv_obj_set_style_line_color(chart_detail_weight, COLOR_DIVIDER, 0);
+  lv_obj_set_style_size(chart_detail_weight, 0, 0, LV_PART_INDICATOR);
+  lv_chart_set_type(chart_detail_weight, LV_CHART_TYPE_LINE);
+  lv_chart_set_div_line_count(chart_detail_weight, 4, 0);
+  ser_detail_weight = lv_chart_add_series(chart_detail_weight, COLOR_PRIMARY,
+                                          LV_CHART_AXIS_PRIMARY_Y);
+
+  lv_obj_t *btn_hist_feed = lv_button_create(t2);
+  lv_obj_align(btn_hist_feed, LV_ALIGN_BOTTOM_LEFT, 20, -20);
+  lv_obj_set_style_bg_color(btn_hist_feed, COLOR_BG_CARD, 0);
+  lv_obj_add_event_cb(btn_hist_feed, show_history_feed_cb, LV_EVENT_CLICKED,
+                      NULL);
+  lv_label_set_text(lv_label_create(btn_hist_feed),
+                    LV_SYMBOL_LIST " Historique");
+
   lv_obj_t *btn_feed = lv_button_create(t2);
   lv_obj_set_size(btn_feed, 60, 60);
   lv_obj_align(btn_feed, LV_ALIGN_BOTTOM_RIGHT, -20, -20);
@@ -262,6 +497,14 @@ void create_animal_detail_page(lv_obj_t *parent) {
   lv_obj_set_style_text_color(lbl_detail_shed, COLOR_TEXT, 0);
   lv_obj_align(lbl_detail_shed, LV_ALIGN_TOP_LEFT, 20, 20);
 
+  lv_obj_t *btn_hist_health = lv_button_create(t3);
+  lv_obj_align(btn_hist_health, LV_ALIGN_BOTTOM_LEFT, 20, -20);
+  lv_obj_set_style_bg_color(btn_hist_health, COLOR_BG_CARD, 0);
+  lv_obj_add_event_cb(btn_hist_health, show_history_health_cb,
+                      LV_EVENT_CLICKED, NULL);
+  lv_label_set_text(lv_label_create(btn_hist_health),
+                    LV_SYMBOL_LIST " Historique");
+
   lv_obj_t *btn_health = lv_button_create(t3);
   lv_obj_set_size(btn_health, 60, 60);
   lv_obj_align(btn_health, LV_ALIGN_BOTTOM_RIGHT, -20, -20);
@@ -278,17 +521,64 @@ void create_animal_detail_page(lv_obj_t *parent) {
   lv_obj_center(icon_hlt);
 }
 
+// Plot bucket means from the pre-aggregated tiers: a decade of history costs
+// at most WEIGHT_CHART_MONTHS points, whatever the number of weigh-ins.
+static void update_weight_chart(void) {
+  static weight_bucket_t buckets[WEIGHT_CHART_MONTHS];
+  const char *unit = "mois";
+  int n = db_get_weight_buckets(selected_animal_id, WEIGHT_TIER_MONTH, buckets,
+                                WEIGHT_CHART_MONTHS);
+  if (n <= 12) {
+    unit = "semaines";
+    n = db_get_weight_buckets(selected_animal_id, WEIGHT_TIER_WEEK, buckets,
+                              WEIGHT_CHART_WEEKS);
+  }
+
+  if (n == 0) {
+    lv_label_set_text(lbl_detail_trend, "#9E9E9E Evolution:#\nAucune pesee");
+    lv_label_set_recolor(lbl_detail_trend, true);
+    lv_obj_add_flag(chart_detail_weight, LV_OBJ_FLAG_HIDDEN);
+    return;
+  }
+
+  int lo = UINT16_MAX, hi = 0;
+  for (int i = 0; i < n; i++) {
+    if (buckets[i].min < lo)
+      lo = buckets[i].min;
+    if (buckets[i].max > hi)
+      hi = buckets[i].max;
+  }
+  int margin = (hi - lo) / 10 + 1;
+  lv_chart_set_point_count(chart_detail_weight, n);
+  lv_chart_set_axis_range(chart_detail_weight, LV_CHART_AXIS_PRIMARY_Y,
+                          lo > margin ? lo - margin : 0, hi + margin);
+  for (int i = 0; i < n; i++)
+    lv_chart_set_value_by_id(chart_detail_weight, ser_detail_weight, i,
+                             buckets[i].sum / buckets[i].count);
+  lv_chart_refresh(chart_detail_weight);
+  lv_obj_clear_flag(chart_detail_weight, LV_OBJ_FLAG_HIDDEN);
+
+  lv_label_set_text_fmt(lbl_detail_trend,
+                        "#9E9E9E Evolution (%d %s):# %d - %d g", n, unit, lo,
+                        hi);
+  lv_label_set_recolor(lbl_detail_trend, true);
+}
+
 void update_animal_detail(void) {
-  if (selected_animal_id < 0 || selected_animal_id >= reptile_count)
+  static reptile_t record; // Over a kilobyte: kept off the LVGL stack
+  reptile_t *r = &record;
+  if (!db_read_reptile(selected_animal_id, r))
     return;
 
-  reptile_t *r = &reptiles[selected_animal_id];
   char buf[64];
+  char common[DB_TEXT_LEN], scientific[DB_TEXT_LEN];
 
   lv_label_set_text(detail_name_label, r->name);
 
-  lv_label_set_text_fmt(lbl_detail_spec, "#9E9E9E Espece:#\n%s\n#6B8E6B %s#",
-                        r->species_common, r->species_scientific);
+  lv_label_set_text_fmt(
+      lbl_detail_spec, "#9E9E9E Espece:#\n%s\n#6B8E6B %s#",
+      db_string(r->species_common, common, sizeof(common)),
+      db_string(r->species_scientific, scientific, sizeof(scientific)));
   lv_label_set_recolor(lbl_detail_spec, true);
 
   lv_label_set_text_fmt(lbl_detail_morph, "#9E9E9E Phase:#\n%s",
@@ -318,14 +608,50 @@ void update_animal_detail(void) {
   }
   lv_label_set_recolor(lbl_detail_feed, true);
 
-  // Add History button if not exists or update it?
-  // It was created in update_animal_detail in original code, which is bad
-  // practice (duplicates). Better to create it once. I'll stick to original
-  // logic for now but clean it up if I can. In original code: `lv_obj_t
-  // *btn_hist_feed = lv_button_create...` inside update. I should check if it
-  // exists or just recreate. Using `lv_obj_clean` on the tab is aggressive. I
-  // will skip adding it repeatedly for now to avoid memory leak if called
-  // often.
+  update_weight_chart();
+}
+
+// Breeding calendar: the events of the next days, above the clutches
+#define BREEDING_CALENDAR_DAYS 30
+#define BREEDING_CALENDAR_MAX 32 // Rows shown
+
+static const char *animal_name(uint32_t id, char *buf, size_t len) {
+  int i = db_find_reptile_by_id(id);
+  if (i >= 0)
+    return db_reptile_name(i, buf, len);
+  snprintf(buf, len, "#%u", (unsigned)id);
+  return buf;
+}
+
+static void format_day(int64_t t, char *buf, size_t len) {
+  time_t tt = t;
+  struct tm tm;
+  localtime_r(&tt, &tm);
+  strftime(buf, len, "%d/%m", &tm);
+}
+
+static void add_calendar_row(lv_obj_t *list, const calendar_event_t *e) {
+  static const char *const kinds[][2] = {
+      [CALENDAR_LAYING] = {"Ponte", "Ponte prevue"},
+      [CALENDAR_HATCH] = {"Eclosion", "Eclosion prevue"},
+  };
+  char start[8], end[8], female[DB_TEXT_LEN];
+  breeding_record_t b;
+  if (!db_read_breeding(e->clutch, &b))
+    return;
+  format_day(e->start, start, sizeof(start));
+  format_day(e->end, end, sizeof(end));
+
+  lv_obj_t *l = lv_label_create(list);
+  if (e->predicted && strcmp(start, end) != 0)
+    lv_label_set_text_fmt(l, "%s - %s  %s  %s", start, end,
+                          kinds[e->kind][1],
+                          animal_name(b.female_id, female, sizeof(female)));
+  else
+    lv_label_set_text_fmt(l, "%s  %s  %s", start, kinds[e->kind][e->predicted],
+                          animal_name(b.female_id, female, sizeof(female)));
+  lv_obj_set_style_text_color(l, e->predicted ? COLOR_TEXT : COLOR_TEXT_DIM,
+                              0);
 }
 
 void create_breeding_page(lv_obj_t *parent) {
@@ -348,24 +674,60 @@ void create_breeding_page(lv_obj_t *parent) {
   lv_obj_set_style_border_width(list, 0, 0);
   lv_obj_set_flex_flow(list, LV_FLEX_FLOW_COLUMN);
 
-  if (breeding_count == 0) {
+  if (db_get_breeding_count() == 0) {
     lv_obj_t *empty = lv_label_create(list);
     lv_label_set_text(empty, "Aucun projet en cours.");
     lv_obj_set_style_text_color(empty, COLOR_TEXT_DIM, 0);
     lv_obj_center(empty);
   } else {
-    // ... (Breeding List Logic similar to original) ...
-    // For brevity implementing basic list
-    for (int i = 0; i < breeding_count; i++) {
-      // ...
+    static calendar_event_t events[BREEDING_CALENDAR_MAX];
+    time_t now = time(NULL);
+    int n = db_breeding_calendar(
+        now, now + BREEDING_CALENDAR_DAYS * 24 * 3600, events,
+        BREEDING_CALENDAR_MAX);
+    lv_obj_t *head = lv_label_create(list);
+    lv_label_set_text_fmt(head, "%d prochains jours", BREEDING_CALENDAR_DAYS);
+    lv_obj_set_style_text_color(head, COLOR_TEXT_DIM, 0);
+    for (int i = 0; i < n; i++)
+      add_calendar_row(list, &events[i]);
+    if (n == 0) {
+      lv_obj_t *none = lv_label_create(list);
+      lv_label_set_text(none, "Rien de prevu.");
+      lv_obj_set_style_text_color(none, COLOR_TEXT_DIM, 0);
+    }
+
+    for (int i = 0; i < db_get_breeding_count(); i++) {
+      breeding_record_t b;
+      if (!db_read_breeding(i, &b))
+        continue;
       lv_obj_t *card = lv_obj_create(list);
       lv_obj_set_size(card, lv_pct(100), 100);
       lv_obj_set_style_bg_color(card, COLOR_BG_CARD, 0);
       lv_obj_set_style_radius(card, 12, 0);
 
+      // The latest stage the keeper entered
+      char female[DB_TEXT_LEN], male[DB_TEXT_LEN], day[8];
       lv_obj_t *l = lv_label_create(card);
-      lv_label_set_text_fmt(l, "Projet %d", breedings[i].id);
-      lv_obj_set_style_text_color(l, COLOR_TEXT, 0);
+      if (b.hatch_date) {
+        format_day(b.hatch_date, day, sizeof(day));
+        lv_label_set_text_fmt(l, "%s x %s\nEclosion %s: %d/%d",
+                              animal_name(b.female_id, female, sizeof(female)),
+                              animal_name(b.male_id, male, sizeof(male)), day,
+                              b.hatched_count, b.egg_count);
+      } else if (b.laying_date) {
+        format_day(b.laying_date, day, sizeof(day));
+        lv_label_set_text_fmt(l, "%s x %s\nPonte %s: %d oeufs",
+                              animal_name(b.female_id, female, sizeof(female)),
+                              animal_name(b.male_id, male, sizeof(male)), day,
+                              b.egg_count);
+      } else {
+        format_day(b.pairing_date, day, sizeof(day));
+        lv_label_set_text_fmt(l, "%s x %s\nAccouplement %s",
+                              animal_name(b.female_id, female, sizeof(female)),
+                              animal_name(b.male_id, male, sizeof(male)), day);
+      }
+      lv_obj_set_style_text_color(l, b.active ? COLOR_TEXT : COLOR_TEXT_DIM,
+                                  0);
 
       lv_obj_add_flag(card, LV_OBJ_FLAG_CLICKABLE);
       lv_obj_add_event_cb(card, show_breeding_popup_cb, LV_EVENT_CLICKED,
@@ -404,21 +766,41 @@ void create_conformity_page(lv_obj_t *parent) {
   lv_obj_align(stats_cont, LV_ALIGN_TOP_MID, 0, 40);
   lv_obj_set_style_bg_color(stats_cont, COLOR_BG_CARD, 0);
 
-  int total = 0;
-  int protected_count = 0;
-  for (int i = 0; i < reptile_count; i++) {
-    if (reptiles[i].active) {
-      total++;
-      if (reptiles[i].cites_annex != CITES_NOT_LISTED)
-        protected_count++;
-    }
-  }
+  // Counts from the running aggregates; only the listed animals are queried
+  stats_summary_t st;
+  db_get_stats(&st);
+  int total = st.active;
+  int protected_count = st.active - st.annex[CITES_NOT_LISTED];
+  query_result_t rows = {0};
+  const query_t q_listed = {.where = QUERY_CITES_LISTED,
+                            .sort = QUERY_SORT_NAME};
+  if (protected_count > 0 && db_query(&q_listed, &rows) != ESP_OK)
+    protected_count = 0;
 
   lv_obj_t *lbl_stats = lv_label_create(stats_cont);
-  lv_label_set_text_fmt(lbl_stats, "Total: %d\nProteges: %d", total,
-                        protected_count);
+  lv_label_set_text_fmt(lbl_stats,
+                        "Total: %d   Proteges: %d\nStock: %lu EUR   "
+                        "Ventes: %lu EUR",
+                        total, protected_count,
+                        (unsigned long)st.stock_value,
+                        (unsigned long)st.sales_value);
   lv_obj_set_style_text_color(lbl_stats, COLOR_TEXT, 0);
-  lv_obj_center(lbl_stats);
+  lv_obj_align(lbl_stats, LV_ALIGN_TOP_LEFT, 0, 0);
+
+  // Livre de Police chain, as checked at boot; the button re-reads it all
+  audit_status_t audit;
+  audit_status(&audit);
+  lbl_audit = lv_label_create(stats_cont);
+  audit_label_update(&audit);
+  lv_obj_set_style_text_color(lbl_audit, COLOR_TEXT, 0);
+  lv_obj_align(lbl_audit, LV_ALIGN_BOTTOM_LEFT, 0, 0);
+
+  lv_obj_t *btn_verify = lv_button_create(stats_cont);
+  lv_obj_set_size(btn_verify, 110, 32);
+  lv_obj_align(btn_verify, LV_ALIGN_BOTTOM_RIGHT, 0, 0);
+  lv_obj_set_style_bg_color(btn_verify, COLOR_PRIMARY, 0);
+  lv_obj_add_event_cb(btn_verify, audit_verify_cb, LV_EVENT_CLICKED, NULL);
+  lv_label_set_text(lv_label_create(btn_verify), LV_SYMBOL_REFRESH " Verifier");
 
   // List
   lv_obj_t *list = lv_obj_create(page_conformity);
@@ -428,9 +810,10 @@ void create_conformity_page(lv_obj_t *parent) {
 
   // Minimal list of non-compliant animals (placeholder logic)
   if (protected_count > 0) {
-    for (int i = 0; i < reptile_count; i++) {
-      if (!reptiles[i].active || reptiles[i].cites_annex == CITES_NOT_LISTED)
-        continue;
+    uint32_t cursor = QUERY_CURSOR_START;
+    int i;
+    while (query_page(&rows, &cursor, &i, 1) == 1) {
+      cites_annex_t cites = db_reptile_cites_annex(i);
 
       lv_obj_t *row = lv_obj_create(list);
       lv_obj_set_size(row, lv_pct(100), 50);
@@ -438,16 +821,17 @@ void create_conformity_page(lv_obj_t *parent) {
       lv_obj_set_style_border_side(row, LV_BORDER_SIDE_BOTTOM, 0);
       lv_obj_set_style_border_color(row, COLOR_DIVIDER, 0);
 
+      char text[DB_TEXT_LEN];
       lv_obj_t *name = lv_label_create(row);
-      lv_label_set_text(name, reptiles[i].name);
+      lv_label_set_text(name, db_reptile_name(i, text, sizeof(text)));
       lv_obj_align(name, LV_ALIGN_LEFT_MID, 0, 0);
       lv_obj_set_style_text_color(name, COLOR_TEXT, 0);
 
       lv_obj_t *status = lv_label_create(row);
       const char *annex =
-          (reptiles[i].cites_annex == CITES_ANNEX_A)   ? "Annexe A"
-          : (reptiles[i].cites_annex == CITES_ANNEX_B) ? "Annexe B"
-                                                       : "Prot.";
+          (cites == CITES_ANNEX_A)   ? "Annexe A"
+          : (cites == CITES_ANNEX_B) ? "Annexe B"
+                                     : "Prot.";
       lv_label_set_text(status, annex);
       lv_obj_align(status, LV_ALIGN_CENTER, 0, 0);
       lv_obj_set_style_text_color(status, COLOR_TEXT_DIM, 0);
@@ -463,6 +847,7 @@ void create_conformity_page(lv_obj_t *parent) {
     lv_obj_set_style_text_color(l, COLOR_TEXT_DIM, 0);
     lv_obj_center(l);
   }
+  query_result_free(&rows);
 
   // Export Button
   lv_obj_t *btn_export = lv_button_create(page_conformity);
@@ -470,8 +855,17 @@ void create_conformity_page(lv_obj_t *parent) {
   lv_obj_align(btn_export, LV_ALIGN_BOTTOM_RIGHT, -10, -10);
   lv_obj_set_style_bg_color(btn_export, COLOR_PRIMARY, 0);
   lv_obj_add_event_cb(btn_export, export_registre_cb, LV_EVENT_CLICKED, NULL);
-  lv_label_set_text(lv_label_create(btn_export),
-                    LV_SYMBOL_SD_CARD " Export Registre");
+  lbl_export = lv_label_create(btn_export);
+  lv_label_set_text(lbl_export, LV_SYMBOL_SD_CARD " Export Registre");
+
+  // Import Button
+  lv_obj_t *btn_import = lv_button_create(page_conformity);
+  lv_obj_set_size(btn_import, 140, 50);
+  lv_obj_align(btn_import, LV_ALIGN_BOTTOM_LEFT, 120, -10);
+  lv_obj_set_style_bg_color(btn_import, COLOR_BG_CARD, 0);
+  lv_obj_add_event_cb(btn_import, import_registre_cb, LV_EVENT_CLICKED, NULL);
+  lbl_import = lv_label_create(btn_import);
+  lv_label_set_text(lbl_import, LV_SYMBOL_DOWNLOAD " Import");
 
   // Back Button
   lv_obj_t *btn_back = lv_button_create(page_conformity);
@@ -5,6 +5,14 @@ static lv_obj_t *label_time = NULL;
 static lv_obj_t *label_date = NULL;
 static lv_obj_t *icon_wifi = NULL;
 static lv_obj_t *icon_bluetooth = NULL;
+static lv_obj_t *lbl_alert = NULL;
+static lv_obj_t *lbl_anim_count = NULL;
+static lv_obj_t *lbl_breed_count = NULL;
+static int shown_alerts = -1;
+static int shown_animals = -1;
+static int shown_breedings = -1;
+static int shown_clutches = -1;
+static int shown_reorders = -1;
 lv_obj_t *page_home = NULL;
 
 // Navigation Callbacks
@@ -15,6 +23,58 @@ static void nav_gallery_cb(lv_event_t *e) { navigate_to(PAGE_GALLERY); }
 static void nav_conformity_cb(lv_event_t *e) { navigate_to(PAGE_CONFORMITY); }
 static void nav_settings_cb(lv_event_t *e) { navigate_to(PAGE_SETTINGS); }
 
+// The counts are kept live by the database, so polling them is free. They
+// also change once at boot, when the full data replaces the flash preview.
+static void update_home_cards(lv_timer_t *t) {
+  stats_summary_t st;
+  db_get_stats(&st);
+  if ((int)st.active != shown_animals) {
+    shown_animals = st.active;
+    lv_label_set_text_fmt(lbl_anim_count, "%d", shown_animals);
+  }
+  if (db_get_breeding_count() != shown_breedings) {
+    shown_breedings = db_get_breeding_count();
+    lv_label_set_text_fmt(lbl_breed_count, "%d", shown_breedings);
+  }
+
+  // Clutches whose predicted laying or hatching window is open today, and
+  // prey to reorder
+  int alerts = reptile_count_feeding_alerts();
+  int clutches = db_breeding_alert_count();
+  int reorders = db_inventory_reorder_count();
+  if (alerts == shown_alerts && clutches == shown_clutches &&
+      reorders == shown_reorders)
+    return;
+  shown_alerts = alerts;
+  shown_clutches = clutches;
+  shown_reorders = reorders;
+  if ((alerts > 0) + (clutches > 0) + (reorders > 0) > 1) {
+    char text[64] = "";
+    if (alerts > 0)
+      snprintf(text, sizeof(text), "%d a nourrir", alerts);
+    if (clutches > 0)
+      snprintf(text + strlen(text), sizeof(text) - strlen(text), "%s%d couvees",
+               text[0] ? ", " : "", clutches);
+    if (reorders > 0)
+      snprintf(text + strlen(text), sizeof(text) - strlen(text),
+               "%s%d proies", text[0] ? ", " : "", reorders);
+    lv_label_set_text(lbl_alert, text);
+    lv_obj_set_style_text_color(lbl_alert, COLOR_TEXT, 0);
+  } else if (alerts > 0) {
+    lv_label_set_text_fmt(lbl_alert, "%d Animaux a nourrir", alerts);
+    lv_obj_set_style_text_color(lbl_alert, COLOR_TEXT, 0);
+  } else if (clutches > 0) {
+    lv_label_set_text_fmt(lbl_alert, "%d Couvees a surveiller", clutches);
+    lv_obj_set_style_text_color(lbl_alert, COLOR_TEXT, 0);
+  } else if (reorders > 0) {
+    lv_label_set_text_fmt(lbl_alert, "%d Proies a commander", reorders);
+    lv_obj_set_style_text_color(lbl_alert, COLOR_TEXT, 0);
+  } else {
+    lv_label_set_text(lbl_alert, "Tout est OK");
+    lv_obj_set_style_text_color(lbl_alert, COLOR_SUCCESS, 0);
+  }
+}
+
 void create_status_bar(lv_obj_t *parent) {
   ui_status_bar = lv_obj_create(parent);
   lv_obj_set_size(ui_status_bar, LCD_H_RES, 40);
@@ -162,8 +222,7 @@ void create_home_page(lv_obj_t *parent) {
   lv_obj_set_style_text_color(icon_anim, COLOR_SNAKE, 0);
   lv_obj_align(icon_anim, LV_ALIGN_TOP_RIGHT, 0, 0);
 
-  lv_obj_t *lbl_anim_count = lv_label_create(card_anim);
-  lv_label_set_text_fmt(lbl_anim_count, "%d", reptile_count);
+  lbl_anim_count = lv_label_create(card_anim);
   lv_obj_set_style_text_font(lbl_anim_count, &lv_font_montserrat_34, 0);
   lv_obj_align(lbl_anim_count, LV_ALIGN_BOTTOM_LEFT, 0, -20);
 
@@ -184,8 +243,7 @@ void create_home_page(lv_obj_t *parent) {
   lv_obj_set_style_text_color(icon_breed, COLOR_LIZARD, 0);
   lv_obj_align(icon_breed, LV_ALIGN_TOP_RIGHT, 0, 0);
 
-  lv_obj_t *lbl_breed_count = lv_label_create(card_breed);
-  lv_label_set_text_fmt(lbl_breed_count, "%d", breeding_count);
+  lbl_breed_count = lv_label_create(card_breed);
   lv_obj_set_style_text_font(lbl_breed_count, &lv_font_montserrat_34, 0);
   lv_obj_align(lbl_breed_count, LV_ALIGN_BOTTOM_LEFT, 0, -20);
 
@@ -206,15 +264,9 @@ void create_home_page(lv_obj_t *parent) {
   lv_obj_set_style_text_color(icon_alert, COLOR_DANGER, 0);
   lv_obj_align(icon_alert, LV_ALIGN_LEFT_MID, 10, 0);
 
-  int alerts = reptile_count_feeding_alerts();
-  lv_obj_t *lbl_alert = lv_label_create(card_alert);
-  if (alerts > 0) {
-    lv_label_set_text_fmt(lbl_alert, "%d Animaux a nourrir", alerts);
-    lv_obj_set_style_text_color(lbl_alert, COLOR_TEXT, 0);
-  } else {
-    lv_label_set_text(lbl_alert, "Tout est OK");
-    lv_obj_set_style_text_color(lbl_alert, COLOR_SUCCESS, 0);
-  }
+  lbl_alert = lv_label_create(card_alert);
   lv_obj_set_style_text_font(lbl_alert, &lv_font_montserrat_20, 0);
   lv_obj_align(lbl_alert, LV_ALIGN_LEFT_MID, 60, 0);
+  update_home_cards(NULL);
+  lv_timer_create(update_home_cards, 1000, NULL);
 }
@@ -48,6 +48,8 @@ void ui_init(lv_display_t *disp) {
   lv_timer_create((lv_timer_cb_t)update_status_bar, 1000, NULL);
 }
 
+void ui_refresh(void) { navigate_to(current_page); }
+
 void navigate_to(page_id_t page) {
   // Hide all known pages
   if (page_home)
@@ -20,6 +20,11 @@ void ui_init(lv_display_t *display_handle);
  */
 void ui_update_status_bar(void);
 
+/**
+ * @brief Redraw the current page from the database (after loading)
+ */
+void ui_refresh(void);
+
 // Hardware accessors (implemented in main.c or hardware module, exposed here
 // for UI to use) Alternatively, UI callbacks can call these if they are extern.
 // For now, we will assume main.c exposes:
@@ -1,5 +1,6 @@
 #include "ui_popups.h"
-#include "ui_animals.h" // For update_animal_detail/list calls
+#include "ui_animals.h"  // For update_animal_detail/list calls
+#include "ui_settings.h" // For update_stock_list
 #include <stdlib.h>
 #include <string.h>
 
@@ -9,11 +10,13 @@ static lv_obj_t *popup_edit = NULL;
 static lv_obj_t *popup_history = NULL;
 static lv_obj_t *popup_breeding = NULL;
 static lv_obj_t *popup_health = NULL;
+static lv_obj_t *popup_stock = NULL;
 static lv_obj_t *popup_overlay = NULL;
 
 // Widgets for Forms
 static lv_obj_t *feed_prey_dd = NULL;
 static lv_obj_t *feed_qty_spinbox = NULL;
+static lv_obj_t *feed_refused_cb = NULL;
 
 static lv_obj_t *edit_name_ta = NULL;
 static lv_obj_t *edit_weight_ta = NULL;
@@ -23,19 +26,28 @@ static lv_obj_t *edit_chip_ta = NULL;
 static lv_obj_t *edit_morph_ta = NULL;
 static lv_obj_t *edit_cites_dd = NULL;
 static lv_obj_t *edit_origin_ta = NULL;
+static lv_obj_t *edit_feed_days_ta = NULL;
 
 static lv_obj_t *edit_breed_male_dd = NULL;
 // static lv_obj_t *edit_breed_female_dd = NULL; // Unused
 static int edit_breeding_id = -1;
 
+// Copy of the selected animal (over a kilobyte: kept off the LVGL stack)
+static reptile_t selected_record;
+
 static lv_obj_t *health_type_dd = NULL;
 static lv_obj_t *health_desc_ta = NULL;
 
 static lv_obj_t *list_history = NULL;
 
+static lv_obj_t *stock_name_ta = NULL;
+static lv_obj_t *stock_qty_ta = NULL;
+static lv_obj_t *stock_alert_ta = NULL;
+static int edit_stock_index = -1; // -1: new item
+
 // Helper: Keyboard handling
 static lv_obj_t *ui_keyboard = NULL;
-static void ta_event_cb(lv_event_t *e) {
+void ta_event_cb(lv_event_t *e) {
   lv_event_code_t code = lv_event_get_code(e);
   lv_obj_t *ta = lv_event_get_target(e);
   if (code == LV_EVENT_FOCUSED) {
@@ -65,6 +77,8 @@ void close_popup_cb(lv_event_t *e) {
     lv_obj_add_flag(popup_breeding, LV_OBJ_FLAG_HIDDEN);
   if (popup_health)
     lv_obj_add_flag(popup_health, LV_OBJ_FLAG_HIDDEN);
+  if (popup_stock)
+    lv_obj_add_flag(popup_stock, LV_OBJ_FLAG_HIDDEN);
   if (popup_overlay)
     lv_obj_add_flag(popup_overlay, LV_OBJ_FLAG_HIDDEN);
 
@@ -73,14 +87,19 @@ void close_popup_cb(lv_event_t *e) {
 }
 
 static void save_feeding_cb(lv_event_t *e) {
-  if (selected_animal_id >= 0 && selected_animal_id < reptile_count) {
+  if (db_read_reptile(selected_animal_id, &selected_record)) {
     char buf[32];
     lv_dropdown_get_selected_str(feed_prey_dd, buf, sizeof(buf));
     int qty = lv_spinbox_get_value(feed_qty_spinbox);
+    bool accepted = !lv_obj_has_state(feed_refused_cb, LV_STATE_CHECKED);
 
-    db_record_feeding(selected_animal_id, time(NULL), buf, qty);
-
-    show_toast("Repas Enregistre", COLOR_SUCCESS);
+    if (db_record_feeding(selected_animal_id, time(NULL), buf, qty,
+                          accepted) != ESP_OK)
+      show_toast("Quantite invalide", COLOR_DANGER);
+    else if (accepted)
+      show_toast("Repas Enregistre", COLOR_SUCCESS);
+    else
+      show_toast("Refus Enregistre", COLOR_WARNING);
     update_animal_detail();
     update_animal_list();
   }
@@ -113,17 +132,23 @@ static void save_edit_cb(lv_event_t *e) {
     show_toast("Nom requis", COLOR_DANGER);
     return;
   }
+  // Checked before the 16-bit field takes it, which would wrap it
+  long grams = strtol(lv_textarea_get_text(edit_weight_ta), NULL, 10);
+  if (grams < 0 || grams > MAX_WEIGHT_GRAMS) {
+    show_toast("Poids invalide", COLOR_DANGER);
+    return;
+  }
 
   reptile_t data;
+  int old_weight = -1;
   // If editing existing, copy first to preserve un-edited fields?
   // STRICT MVC: We should ask DB for current data, modify it, then send back
   // via update. We included database.h in ui_popups via ui_shared? ui_shared
   // includes models.h. database.h includes models.h. ui_popups includes
   // ui_shared. We need database.h access.
   if (selected_animal_id >= 0) {
-    reptile_t *current = db_get_reptile(selected_animal_id);
-    if (current)
-      data = *current;
+    if (db_read_reptile(selected_animal_id, &data))
+      old_weight = data.weight_grams;
     else
       strncpy(data.name, "Unknown", sizeof(data.name) - 1);
   } else {
@@ -135,7 +160,7 @@ static void save_edit_cb(lv_event_t *e) {
   // Update fields from UI
   strncpy(data.name, txt_name, sizeof(data.name) - 1);
 
-  data.weight_grams = atoi(lv_textarea_get_text(edit_weight_ta));
+  data.weight_grams = (uint16_t)grams;
   data.birth_year = atoi(lv_textarea_get_text(edit_birth_ta));
   data.sex = (reptile_sex_t)lv_dropdown_get_selected(edit_sex_dd);
 
@@ -143,12 +168,23 @@ static void save_edit_cb(lv_event_t *e) {
           sizeof(data.microchip) - 1);
   strncpy(data.morph, lv_textarea_get_text(edit_morph_ta),
           sizeof(data.morph) - 1);
-  strncpy(data.origin, lv_textarea_get_text(edit_origin_ta),
-          sizeof(data.origin) - 1);
+  data.origin = db_intern_string(lv_textarea_get_text(edit_origin_ta));
 
   data.cites_annex = (cites_annex_t)lv_dropdown_get_selected(edit_cites_dd);
 
+  // Left empty: keep the current interval
+  const char *txt_days = lv_textarea_get_text(edit_feed_days_ta);
+  if (txt_days[0] != '\0') {
+    int days = atoi(txt_days);
+    data.feeding_interval_days = days < 0 ? 0 : days > 90 ? 90 : days;
+  }
+
+  // A new weight also goes on the curve: one save, one undo step
+  db_txn_begin();
   db_update_reptile(selected_animal_id, &data);
+  if (old_weight >= 0 && data.weight_grams != old_weight)
+    db_record_weight(selected_animal_id, time(NULL), data.weight_grams);
+  db_txn_commit();
 
   if (selected_animal_id == -1) {
     update_animal_list();
@@ -187,6 +223,38 @@ static void save_breeding_cb(lv_event_t *e) {
   close_popup_cb(NULL);
 }
 
+static void save_stock_cb(lv_event_t *e) {
+  inventory_item_t it = {0};
+  int index = edit_stock_index;
+  if (index >= 0 && !db_read_inventory_item(index, &it))
+    index = -1;
+  const char *name = lv_textarea_get_text(stock_name_ta);
+  if (name[0] == '\0') {
+    show_toast("Nom requis", COLOR_WARNING);
+    return;
+  }
+  snprintf(it.name, sizeof(it.name), "%s", name);
+  int qty = atoi(lv_textarea_get_text(stock_qty_ta));
+  int alert = atoi(lv_textarea_get_text(stock_alert_ta));
+  it.quantity = (uint16_t)(qty > UINT16_MAX ? UINT16_MAX : qty);
+  it.alert_threshold = (uint16_t)(alert > UINT16_MAX ? UINT16_MAX : alert);
+  if (index < 0 && it.unit[0] == '\0')
+    strcpy(it.unit, "pcs");
+
+  // A new item and its contents land in one journal record
+  db_txn_begin();
+  if (index < 0) {
+    index = db_get_inventory_count();
+    db_set_inventory_count(index + 1);
+  }
+  db_set_inventory_item(index, &it);
+  db_txn_commit();
+
+  show_toast("Stock Enregistre", COLOR_SUCCESS);
+  update_stock_list();
+  close_popup_cb(NULL);
+}
+
 void create_popups(void) {
   // Dimmed Overlay
   popup_overlay = lv_obj_create(lv_layer_top());
@@ -219,6 +287,12 @@ void create_popups(void) {
   lv_spinbox_set_step(feed_qty_spinbox, 1);
   lv_obj_align(feed_qty_spinbox, LV_ALIGN_TOP_RIGHT, -60, 95);
 
+  // Offered but not eaten
+  feed_refused_cb = lv_checkbox_create(popup_feed);
+  lv_checkbox_set_text(feed_refused_cb, "Refuse");
+  lv_obj_set_style_text_color(feed_refused_cb, COLOR_TEXT, 0);
+  lv_obj_align(feed_refused_cb, LV_ALIGN_TOP_LEFT, 0, 150);
+
   // Buttons
   lv_obj_t *btn_save = lv_button_create(popup_feed);
   lv_label_set_text(lv_label_create(btn_save), "Valider");
@@ -277,6 +351,13 @@ void create_popups(void) {
   lv_obj_add_event_cb(edit_origin_ta, ta_event_cb, LV_EVENT_ALL, NULL);
   lv_obj_align(edit_origin_ta, LV_ALIGN_TOP_RIGHT, 0, 210);
 
+  edit_feed_days_ta = lv_textarea_create(popup_edit);
+  lv_textarea_set_one_line(edit_feed_days_ta, true);
+  lv_textarea_set_accepted_chars(edit_feed_days_ta, "0123456789");
+  lv_textarea_set_placeholder_text(edit_feed_days_ta, "Jours/repas");
+  lv_obj_add_event_cb(edit_feed_days_ta, ta_event_cb, LV_EVENT_ALL, NULL);
+  lv_obj_align(edit_feed_days_ta, LV_ALIGN_TOP_LEFT, 0, 255);
+
   lv_obj_t *btn_edit_save = lv_button_create(popup_edit);
   lv_label_set_text(lv_label_create(btn_edit_save), "Sauver");
   lv_obj_align(btn_edit_save, LV_ALIGN_BOTTOM_RIGHT, 0, 0);
@@ -335,16 +416,58 @@ void create_popups(void) {
   list_history = lv_obj_create(popup_history);
   lv_obj_set_size(list_history, 320, 380);
   lv_obj_align(list_history, LV_ALIGN_TOP_MID, 0, 40);
+  lv_obj_set_flex_flow(list_history, LV_FLEX_FLOW_COLUMN);
 
   lv_obj_t *btn_hist_close = lv_button_create(popup_history);
   lv_label_set_text(lv_label_create(btn_hist_close), "Fermer");
   lv_obj_align(btn_hist_close, LV_ALIGN_BOTTOM_MID, 0, 0);
   lv_obj_add_event_cb(btn_hist_close, close_popup_cb, LV_EVENT_CLICKED, NULL);
+
+  // --- STOCK POPUP ---
+  popup_stock = lv_obj_create(lv_layer_top());
+  lv_obj_set_size(popup_stock, 340, 320);
+  lv_obj_center(popup_stock);
+  lv_obj_set_style_bg_color(popup_stock, COLOR_BG_CARD, 0);
+  lv_obj_add_flag(popup_stock, LV_OBJ_FLAG_HIDDEN);
+
+  lbl = lv_label_create(popup_stock);
+  lv_label_set_text(lbl, "Stock de proies");
+  lv_obj_align(lbl, LV_ALIGN_TOP_MID, 0, 0);
+
+  stock_name_ta = lv_textarea_create(popup_stock);
+  lv_textarea_set_one_line(stock_name_ta, true);
+  lv_textarea_set_max_length(stock_name_ta,
+                             sizeof(((inventory_item_t *)0)->name) - 1);
+  lv_textarea_set_placeholder_text(stock_name_ta, "Proie");
+  lv_obj_add_event_cb(stock_name_ta, ta_event_cb, LV_EVENT_ALL, NULL);
+  lv_obj_align(stock_name_ta, LV_ALIGN_TOP_LEFT, 0, 40);
+
+  stock_qty_ta = lv_textarea_create(popup_stock);
+  lv_textarea_set_one_line(stock_qty_ta, true);
+  lv_textarea_set_accepted_chars(stock_qty_ta, "0123456789");
+  lv_textarea_set_max_length(stock_qty_ta, 5);
+  lv_textarea_set_placeholder_text(stock_qty_ta, "Quantite");
+  lv_obj_add_event_cb(stock_qty_ta, ta_event_cb, LV_EVENT_ALL, NULL);
+  lv_obj_align(stock_qty_ta, LV_ALIGN_TOP_LEFT, 0, 95);
+
+  stock_alert_ta = lv_textarea_create(popup_stock);
+  lv_textarea_set_one_line(stock_alert_ta, true);
+  lv_textarea_set_accepted_chars(stock_alert_ta, "0123456789");
+  lv_textarea_set_max_length(stock_alert_ta, 5);
+  lv_textarea_set_placeholder_text(stock_alert_ta, "Seuil d'alerte");
+  lv_obj_add_event_cb(stock_alert_ta, ta_event_cb, LV_EVENT_ALL, NULL);
+  lv_obj_align(stock_alert_ta, LV_ALIGN_TOP_LEFT, 0, 150);
+
+  lv_obj_t *btn_st_save = lv_button_create(popup_stock);
+  lv_label_set_text(lv_label_create(btn_st_save), "Valider");
+  lv_obj_align(btn_st_save, LV_ALIGN_BOTTOM_RIGHT, 0, 0);
+  lv_obj_add_event_cb(btn_st_save, save_stock_cb, LV_EVENT_CLICKED, NULL);
 }
 
 void show_feed_popup_cb(lv_event_t *e) {
   if (!popup_feed)
     create_popups();
+  lv_obj_remove_state(feed_refused_cb, LV_STATE_CHECKED);
   lv_obj_clear_flag(popup_overlay, LV_OBJ_FLAG_HIDDEN);
   lv_obj_clear_flag(popup_feed, LV_OBJ_FLAG_HIDDEN);
   lv_obj_move_foreground(popup_overlay);
@@ -356,8 +479,8 @@ void show_edit_popup_cb(lv_event_t *e) {
     create_popups();
 
   // Fill data if selected_animal_id >= 0
-  if (selected_animal_id >= 0) {
-    lv_textarea_set_text(edit_name_ta, reptiles[selected_animal_id].name);
+  if (db_read_reptile(selected_animal_id, &selected_record)) {
+    lv_textarea_set_text(edit_name_ta, selected_record.name);
     // ...
   } else {
     lv_textarea_set_text(edit_name_ta, "");
@@ -375,11 +498,18 @@ void show_breeding_popup_cb(lv_event_t *e) {
 
   edit_breeding_id = (int)(intptr_t)lv_event_get_user_data(e);
 
-  // Populate dropdowns from reptiles array
+  // Populate dropdowns with the active males, by name
+  static query_result_t males;
+  const query_t q = {
+      .where = QUERY_SEX, .sex = SEX_MALE, .sort = QUERY_SORT_NAME};
   lv_dropdown_clear_options(edit_breed_male_dd);
-  for (int i = 0; i < reptile_count; i++) {
-    if (reptiles[i].sex == SEX_MALE)
-      lv_dropdown_add_option(edit_breed_male_dd, reptiles[i].name,
+  if (db_query(&q, &males) == ESP_OK) {
+    uint32_t cursor = QUERY_CURSOR_START;
+    int i;
+    char name[DB_TEXT_LEN];
+    while (query_page(&males, &cursor, &i, 1) == 1)
+      lv_dropdown_add_option(edit_breed_male_dd,
+                             db_reptile_name(i, name, sizeof(name)),
                              LV_DROPDOWN_POS_LAST);
   }
 
@@ -389,6 +519,35 @@ void show_breeding_popup_cb(lv_event_t *e) {
   lv_obj_move_foreground(popup_breeding);
 }
 
+// User data: the inventory index, -1 for a new item
+void show_stock_popup_cb(lv_event_t *e) {
+  if (!popup_stock)
+    create_popups();
+
+  edit_stock_index = (int)(intptr_t)lv_event_get_user_data(e);
+  inventory_item_t it;
+  if (db_read_inventory_item(edit_stock_index, &it)) {
+    char name[sizeof(it.name) + 1];
+    snprintf(name, sizeof(name), "%.*s", (int)sizeof(it.name), it.name);
+    lv_textarea_set_text(stock_name_ta, name);
+    char num[8];
+    snprintf(num, sizeof(num), "%u", (unsigned)it.quantity);
+    lv_textarea_set_text(stock_qty_ta, num);
+    snprintf(num, sizeof(num), "%u", (unsigned)it.alert_threshold);
+    lv_textarea_set_text(stock_alert_ta, num);
+  } else {
+    edit_stock_index = -1;
+    lv_textarea_set_text(stock_name_ta, "");
+    lv_textarea_set_text(stock_qty_ta, "");
+    lv_textarea_set_text(stock_alert_ta, "");
+  }
+
+  lv_obj_clear_flag(popup_overlay, LV_OBJ_FLAG_HIDDEN);
+  lv_obj_clear_flag(popup_stock, LV_OBJ_FLAG_HIDDEN);
+  lv_obj_move_foreground(popup_overlay);
+  lv_obj_move_foreground(popup_stock);
+}
+
 void show_add_health_popup_cb(lv_event_t *e) {
   if (!popup_health)
     create_popups();
@@ -398,26 +557,146 @@ void show_add_health_popup_cb(lv_event_t *e) {
   lv_obj_move_foreground(popup_health);
 }
 
-void show_history_feed_cb(lv_event_t *e) {
-  if (!popup_history)
-    create_popups();
-  // Populate list
-  lv_obj_clean(list_history);
-  // Loop stored feedings
+// History is read one page at a time through the per-animal chains, so
+// opening it costs the same whatever the size of the collection. Pages in
+// RAM are read directly; older ones are fetched from the SD archive by the
+// database's worker while a timer polls for the result.
+#define HISTORY_PAGE 20
+
+static uint32_t history_cursor = DB_HISTORY_START;
+static bool history_is_health = false;
+static lv_timer_t *history_timer = NULL; // Archived page being fetched
+static lv_obj_t *history_wait = NULL;    // Its placeholder row
+static bool history_stale = false; // Fetch started for a list since reopened
+
+typedef union {
+  feeding_record_t feeding[HISTORY_PAGE];
+  health_record_t health[HISTORY_PAGE];
+} history_page_t;
+
+static void history_load_page(void);
+static void history_fetch(void);
+
+static void history_more_cb(lv_event_t *e) {
+  lv_obj_delete_async(lv_event_get_target(e));
+  history_load_page();
+}
 
-  lv_obj_clear_flag(popup_overlay, LV_OBJ_FLAG_HIDDEN);
-  lv_obj_clear_flag(popup_history, LV_OBJ_FLAG_HIDDEN);
-  lv_obj_move_foreground(popup_overlay);
-  lv_obj_move_foreground(popup_history);
+static void history_add_row(const char *text) {
+  lv_obj_t *row = lv_label_create(list_history);
+  lv_label_set_text(row, text);
+  lv_obj_set_width(row, lv_pct(100));
+  lv_obj_set_style_text_color(row, COLOR_TEXT, 0);
 }
 
-void show_history_health_cb(lv_event_t *e) {
+static void history_add_page(const history_page_t *page, int n) {
+  char date[16];
+  char line[128];
+
+  for (int i = 0; i < n; i++) {
+    if (history_is_health) {
+      const health_record_t *h = &page->health[i];
+      format_date(h->timestamp, date, sizeof(date));
+      snprintf(line, sizeof(line), "%s  %s %s", date, h->event_type,
+               h->description);
+    } else {
+      const feeding_record_t *f = &page->feeding[i];
+      format_date(f->timestamp, date, sizeof(date));
+      snprintf(line, sizeof(line), "%s  %dx %s%s", date, f->prey_count,
+               f->prey_type, f->accepted ? "" : " (refuse)");
+    }
+    history_add_row(line);
+  }
+
+  if (history_cursor != DB_HISTORY_END) {
+    lv_obj_t *btn_more = lv_button_create(list_history);
+    lv_label_set_text(lv_label_create(btn_more), "Plus anciens");
+    lv_obj_add_event_cb(btn_more, history_more_cb, LV_EVENT_CLICKED, NULL);
+  }
+}
+
+static void history_fetch_poll_cb(lv_timer_t *t) {
+  static history_page_t page;
+  int n;
+  uint32_t cursor;
+  db_fetch_state_t state = db_history_fetch_result(&page, &n, &cursor);
+  if (state == DB_FETCH_RUNNING)
+    return;
+  lv_timer_delete(t);
+  history_timer = NULL;
+  if (history_stale) {
+    // Read for the list shown before: fetch again for the current one
+    history_stale = false;
+    if (history_wait)
+      history_fetch();
+    return;
+  }
+  if (history_wait) {
+    lv_obj_delete(history_wait);
+    history_wait = NULL;
+  }
+  if (state == DB_FETCH_FAILED) {
+    history_cursor = DB_HISTORY_END;
+    history_add_row("Archive illisible.");
+    return;
+  }
+  history_cursor = cursor;
+  history_add_page(&page, n);
+}
+
+static void history_fetch(void) {
+  if (history_wait == NULL) {
+    history_wait = lv_label_create(list_history);
+    lv_label_set_text(history_wait, "Chargement...");
+    lv_obj_set_style_text_color(history_wait, COLOR_TEXT_DIM, 0);
+  }
+  if (history_timer)
+    return; // Still reading for the previous list, see the poll
+  if (db_history_fetch_start(history_is_health, history_cursor,
+                             HISTORY_PAGE) != ESP_OK) {
+    lv_obj_delete(history_wait);
+    history_wait = NULL;
+    history_add_row("Archive illisible.");
+    return;
+  }
+  history_timer = lv_timer_create(history_fetch_poll_cb, 100, NULL);
+}
+
+static void history_load_page(void) {
+  static history_page_t page;
+  int n = history_is_health
+              ? db_get_health_history(selected_animal_id, &history_cursor,
+                                      page.health, HISTORY_PAGE)
+              : db_get_feeding_history(selected_animal_id, &history_cursor,
+                                       page.feeding, HISTORY_PAGE);
+  if (n == 0 && history_cursor != DB_HISTORY_END)
+    history_fetch(); // The rest has rolled out to the card
+  else
+    history_add_page(&page, n);
+}
+
+static void show_history(bool health) {
   if (!popup_history)
     create_popups();
   lv_obj_clean(list_history);
+  history_wait = NULL;
+  history_stale = history_timer != NULL;
+
+  history_is_health = health;
+  history_cursor = DB_HISTORY_START;
+  int total = health ? db_get_health_history_count(selected_animal_id)
+                     : db_get_feeding_history_count(selected_animal_id);
+  if (total == 0)
+    history_add_row("Aucun historique.");
+  else
+    history_load_page();
 
   lv_obj_clear_flag(popup_overlay, LV_OBJ_FLAG_HIDDEN);
   lv_obj_clear_flag(popup_history, LV_OBJ_FLAG_HIDDEN);
   lv_obj_move_foreground(popup_overlay);
   lv_obj_move_foreground(popup_history);
 }
+
+void show_history_feed_cb(lv_event_t *e) { show_history(false); }
+
+void show_history_health_cb(lv_event_t *e) { show_history(true); }
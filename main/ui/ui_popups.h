@@ -10,7 +10,11 @@ void show_feed_popup_cb(lv_event_t *e);
 void show_edit_popup_cb(lv_event_t *e);
 void show_breeding_popup_cb(lv_event_t *e);
 void show_add_health_popup_cb(lv_event_t *e);
+void show_stock_popup_cb(lv_event_t *e); // User data: index, -1 for new
 void show_history_feed_cb(lv_event_t *e);
 void show_history_health_cb(lv_event_t *e);
 
+// Shows the on-screen keyboard while a text area has focus
+void ta_event_cb(lv_event_t *e);
+
 #endif
@@ -1,4 +1,5 @@
 #include "ui_settings.h"
+#include "ui_popups.h"
 
 lv_obj_t *page_settings = NULL;
 lv_obj_t *page_wifi = NULL;
@@ -7,6 +8,7 @@ lv_obj_t *page_bluetooth = NULL;
 static lv_obj_t *wifi_list = NULL;
 static lv_obj_t *bt_list = NULL;
 static lv_obj_t *wifi_status_label = NULL;
+static lv_obj_t *stock_list = NULL;
 
 static void wifi_back_btn_cb(lv_event_t *e) { navigate_to(PAGE_SETTINGS); }
 static void bt_back_btn_cb(lv_event_t *e) { navigate_to(PAGE_SETTINGS); }
@@ -33,6 +35,45 @@ static void bt_toggle_cb(lv_event_t *e) {
   }
 }
 
+// Prey stock, with the days it lasts at the recent consumption. Refreshed
+// while the page is shown: meals change it from any page. A row opens the
+// item's restock popup.
+static void refresh_stock(lv_timer_t *t) {
+  if (t && lv_obj_has_flag(page_settings, LV_OBJ_FLAG_HIDDEN))
+    return;
+  lv_obj_clean(stock_list);
+  int count = db_get_inventory_count();
+  for (int i = 0; i < count; i++) {
+    inventory_item_t it;
+    if (!db_read_inventory_item(i, &it))
+      continue;
+    int days = db_inventory_days_left(i);
+    bool reorder = db_inventory_needs_reorder(i);
+
+    lv_obj_t *l = lv_label_create(stock_list);
+    if (days >= 0)
+      lv_label_set_text_fmt(l, "%s: %d %s, %d j%s", it.name, it.quantity,
+                            it.unit, days, reorder ? "  A commander" : "");
+    else
+      lv_label_set_text_fmt(l, "%s: %d %s%s", it.name, it.quantity, it.unit,
+                            reorder ? "  A commander" : "");
+    lv_obj_set_style_text_color(l, reorder ? COLOR_WARNING : COLOR_TEXT, 0);
+    lv_obj_add_flag(l, LV_OBJ_FLAG_CLICKABLE);
+    lv_obj_add_event_cb(l, show_stock_popup_cb, LV_EVENT_CLICKED,
+                        (void *)(intptr_t)i);
+  }
+  if (count == 0) {
+    lv_obj_t *l = lv_label_create(stock_list);
+    lv_label_set_text(l, "Aucun stock de proies.");
+    lv_obj_set_style_text_color(l, COLOR_TEXT_DIM, 0);
+  }
+}
+
+void update_stock_list(void) {
+  if (stock_list)
+    refresh_stock(NULL);
+}
+
 void create_settings_page(lv_obj_t *parent) {
   page_settings = lv_obj_create(parent);
   lv_obj_set_size(page_settings, LCD_H_RES, LCD_V_RES - 110);
@@ -73,6 +114,28 @@ void create_settings_page(lv_obj_t *parent) {
   lv_obj_t *l_bt = lv_label_create(btn_bt);
   lv_label_set_text(l_bt, LV_SYMBOL_BLUETOOTH " Bluetooth");
   lv_obj_center(l_bt);
+
+  // Prey stock
+  lv_obj_t *l_stock = lv_label_create(list);
+  lv_label_set_text(l_stock, "Stock de proies");
+  lv_obj_set_style_text_color(l_stock, COLOR_TEXT_DIM, 0);
+
+  stock_list = lv_obj_create(list);
+  lv_obj_set_size(stock_list, lv_pct(100), LV_SIZE_CONTENT);
+  lv_obj_set_style_bg_color(stock_list, COLOR_BG_CARD, 0);
+  lv_obj_set_flex_flow(stock_list, LV_FLEX_FLOW_COLUMN);
+  refresh_stock(NULL);
+  lv_timer_create(refresh_stock, 5000, NULL);
+
+  lv_obj_t *btn_stock = lv_button_create(list);
+  lv_obj_set_size(btn_stock, lv_pct(100), 50);
+  lv_obj_set_style_bg_color(btn_stock, COLOR_BG_CARD, 0);
+  lv_obj_add_event_cb(btn_stock, show_stock_popup_cb, LV_EVENT_CLICKED,
+                      (void *)(intptr_t)-1);
+
+  lv_obj_t *l_add = lv_label_create(btn_stock);
+  lv_label_set_text(l_add, LV_SYMBOL_PLUS " Ajouter une proie");
+  lv_obj_center(l_add);
 }
 
 void create_wifi_page(lv_obj_t *parent) {
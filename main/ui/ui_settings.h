@@ -10,5 +10,7 @@ extern lv_obj_t *page_bluetooth;
 void create_settings_page(lv_obj_t *parent);
 void create_wifi_page(lv_obj_t *parent);
 void create_bluetooth_page(lv_obj_t *parent);
+// Redraw the prey stock after an edit
+void update_stock_list(void);
 
 #endif
@@ -0,0 +1,143 @@
+/**
+ * @file bench_export.c
+ * @brief Registre export throughput, 10k animals
+ *
+ * The streaming exporter (db_export_csv(), and the same code on the worker
+ * through db_export_csv_start()) against the export it replaced: one
+ * fprintf() per row with 20 arguments and a localtime() per date. Some
+ * recipients' addresses hold quotes, which the exporter must double.
+ */
+
+#include "bench_util.h"
+
+#include <time.h>
+
+#define ANIMALS 10000
+#define QUOTED 100 // Animals with quotes in their recipient address
+#define CSV_PATH SD_ROOT "/registre.csv"
+#define OLD_PATH SD_ROOT "/registre_fprintf.csv"
+
+static void format_date(time_t t, char *buf, size_t len) {
+  if (t == 0) {
+    buf[0] = '\0';
+    return;
+  }
+  struct tm tm;
+  localtime_r(&t, &tm);
+  strftime(buf, len, "%Y-%m-%d", &tm);
+}
+
+// The export before the streaming writer, less its CSV escaping bugs
+static int export_fprintf(const char *path) {
+  FILE *f = fopen(path, "w");
+  CHECK(f != NULL);
+  if (!f)
+    return 0;
+  fprintf(f, "ID,UUID,Nom,Espece_Commune,Espece_Scientifique,"
+             "Identification,Sexe,Date_Naissance,Naissance_Estimee,"
+             "CITES_Annexe,CITES_Permis,Date_Entree,Provenance,"
+             "Pays_Origine,Eleveur_Nom,Ne_Captivite,Date_Sortie,"
+             "Motif_Sortie,Destinataire_Nom,Destinataire_Adresse,"
+             "Poids_Grammes,Actif\n");
+  int n = db_get_reptile_count();
+  for (int i = 0; i < n; i++) {
+    reptile_t r;
+    char birth[16], acq[16], exit_date[16], common[64], sci[64], origin[64],
+        breeder[64];
+    CHECK(db_read_reptile(i, &r));
+    snprintf(birth, sizeof(birth), "%04d-%02d-%02d", r.birth_year,
+             r.birth_month ? r.birth_month : 1, r.birth_day ? r.birth_day : 1);
+    format_date(r.date_acquisition, acq, sizeof(acq));
+    format_date(r.date_exit, exit_date, sizeof(exit_date));
+    fprintf(f,
+            "%d,\"%s\",\"%s\",\"%s\",\"%s\",\"%s\",%s,%s,%s,%s,\"%s\",%s,"
+            "\"%s\",\"%s\",\"%s\",%s,%s,%s,\"%s\",\"%s\",%d,%s\n",
+            (int)r.id, r.uuid, r.name,
+            db_string(r.species_common, common, sizeof(common)),
+            db_string(r.species_scientific, sci, sizeof(sci)), r.microchip,
+            r.sex == SEX_MALE ? "M" : r.sex == SEX_FEMALE ? "F" : "?", birth,
+            r.birth_estimated ? "Oui" : "Non",
+            db_cites_annex_to_string(r.cites_annex), r.cites_permit, acq,
+            db_string(r.origin, origin, sizeof(origin)), r.origin_country,
+            db_string(r.breeder_name, breeder, sizeof(breeder)),
+            r.captive_bred ? "Oui" : "Non", exit_date,
+            db_exit_reason_to_string(r.exit_reason), r.recipient_name,
+            r.recipient_address, r.weight_grams, r.active ? "Oui" : "Non");
+  }
+  fclose(f);
+  return n;
+}
+
+static long count_lines(const char *path, bool *doubled_quotes) {
+  FILE *f = fopen(path, "r");
+  long lines = 0;
+  int c, prev = 0;
+  *doubled_quotes = false;
+  if (!f)
+    return -1;
+  while ((c = fgetc(f)) != EOF) {
+    lines += c == '\n';
+    *doubled_quotes |= c == '"' && prev == '"';
+    prev = c == '"' && prev == '"' ? 0 : c;
+  }
+  fclose(f);
+  return lines;
+}
+
+static void report(const char *what, double seconds, const char *path) {
+  long size = test_file_size(path);
+  printf("%-22s %8.1f ms %9.0f rows/s %6.1f MB/s\n", what, seconds * 1e3,
+         ANIMALS / seconds, size / seconds / 1e6);
+}
+
+int main(int argc, char **argv) {
+  bench_collection(ANIMALS);
+  db_txn_begin();
+  for (int i = 0; i < QUOTED; i++) {
+    reptile_t r;
+    CHECK(db_read_reptile(i * (ANIMALS / QUOTED), &r));
+    snprintf(r.recipient_address, sizeof(r.recipient_address),
+             "Résidence \"Les Iguanes\", %d rue Haute", i);
+    r.date_exit = time(NULL);
+    r.exit_reason = EXIT_SOLD;
+    db_update_reptile(r.id, &r);
+  }
+  db_txn_commit();
+  CHECK(db_flush() == ESP_OK); // Or the first export would time the save
+
+  double t0 = bench_now();
+  CHECK_EQ(export_fprintf(OLD_PATH), ANIMALS);
+  report("fprintf per row", bench_now() - t0, OLD_PATH);
+
+  // The first export also writes the whole Livre de Police history; later
+  // ones only append to it
+  t0 = bench_now();
+  CHECK(db_export_csv(CSV_PATH, DB_EXPORT_FULL) == ESP_OK);
+  report("first, with history", bench_now() - t0, CSV_PATH);
+  t0 = bench_now();
+  CHECK(db_export_csv(CSV_PATH, DB_EXPORT_FULL) == ESP_OK);
+  report("db_export_csv", bench_now() - t0, CSV_PATH);
+  bool doubled;
+  long lines = count_lines(CSV_PATH, &doubled);
+  CHECK(lines > ANIMALS);
+  CHECK(doubled);
+
+  // The worker: same rows, with progress along the way
+  const struct timespec tick = {.tv_nsec = 1000000}; // The UI polls too
+  uint32_t done = 0, total = 0, polls = 0;
+  t0 = bench_now();
+  CHECK(db_export_csv_start(CSV_PATH, DB_EXPORT_FULL) == ESP_OK);
+  db_export_state_t state;
+  while ((state = db_export_csv_progress(&done, &total)) ==
+         DB_EXPORT_RUNNING) {
+    polls++;
+    nanosleep(&tick, NULL);
+  }
+  report("db_export_csv_start", bench_now() - t0, CSV_PATH);
+  CHECK_EQ(state, DB_EXPORT_DONE);
+  CHECK_EQ(total, ANIMALS);
+  CHECK_EQ(done, total);
+  CHECK_EQ(count_lines(CSV_PATH, &doubled), lines);
+  printf("%u progress polls while it ran\n", (unsigned)polls);
+  return test_result(argv[0]);
+}
@@ -0,0 +1,147 @@
+/**
+ * @file bench_hot.c
+ * @brief Alert and conformity scans: full records against the hot columns
+ *
+ * The same two scans run over 10k animals, once striding through an array
+ * of full reptile_t, as the UI did before the hot table, and once over the
+ * hot_table_t columns. The feeding alert count reads active, species and
+ * last_feeding; the conformity count reads active and cites_annex.
+ *
+ * Cache misses are estimated from the memory layout: the 64-byte lines a
+ * scan touches per animal. Each scan is timed with a warm cache and after
+ * evicting it, when every one of those lines is a miss.
+ */
+
+#include "bench_util.h"
+
+#include <stddef.h>
+
+#include "hot_table.h"
+
+#define ANIMALS 10000
+#define ROUNDS 20
+#define LINE 64
+#define EVICT_BYTES (64u << 20)
+
+static const int interval_days[] = {10, 7, 14, 10}; // Per species
+
+static reptile_t *records;
+static hot_table_t hot;
+static uint8_t *evict;
+static time_t now;
+
+static int alerts_records(void) {
+  int n = 0;
+  for (int i = 0; i < ANIMALS; i++) {
+    const reptile_t *r = &records[i];
+    if (r->active &&
+        now - r->last_feeding > interval_days[r->species] * 86400)
+      n++;
+  }
+  return n;
+}
+
+static int alerts_hot(void) {
+  int n = 0;
+  for (uint32_t i = 0; i < hot.count; i++)
+    if (hot.active[i] &&
+        now - hot.last_feeding[i] > interval_days[hot.species[i]] * 86400)
+      n++;
+  return n;
+}
+
+static int listed_records(void) {
+  int n = 0;
+  for (int i = 0; i < ANIMALS; i++)
+    n += records[i].active && records[i].cites_annex != CITES_NOT_LISTED;
+  return n;
+}
+
+static int listed_hot(void) {
+  int n = 0;
+  for (uint32_t i = 0; i < hot.count; i++)
+    n += hot.active[i] && hot.cites_annex[i] != CITES_NOT_LISTED;
+  return n;
+}
+
+static void evict_cache(void) {
+  for (size_t i = 0; i < EVICT_BYTES; i += LINE)
+    evict[i]++;
+}
+
+// Best of ROUNDS, in ns per animal
+static double time_scan(int (*scan)(void), bool cold, int expected) {
+  double best = 1e9;
+  for (int round = 0; round < ROUNDS; round++) {
+    if (cold)
+      evict_cache();
+    double t0 = bench_now();
+    int n = scan();
+    double s = bench_now() - t0;
+    CHECK_EQ(n, expected);
+    if (s < best)
+      best = s;
+  }
+  return best / ANIMALS * 1e9;
+}
+
+// Distinct cache lines of one record holding the given fields
+static int record_lines(const size_t *offsets, int count) {
+  int lines = 0;
+  for (int i = 0; i < count; i++) {
+    bool seen = false;
+    for (int j = 0; j < i; j++)
+      seen |= offsets[j] / LINE == offsets[i] / LINE;
+    lines += !seen;
+  }
+  return lines;
+}
+
+static void report(const char *what, int (*old)(void), int (*cols)(void),
+                   int old_lines, size_t hot_bytes) {
+  int expected = old();
+  CHECK_EQ(cols(), expected);
+  double warm_old = time_scan(old, false, expected);
+  double warm_hot = time_scan(cols, false, expected);
+  double cold_old = time_scan(old, true, expected);
+  double cold_hot = time_scan(cols, true, expected);
+  printf("%-11s records: %4d B/animal (%d lines), %5.2f ns warm, %6.2f ns "
+         "cold\n",
+         what, old_lines * LINE, old_lines, warm_old, cold_old);
+  printf("%-11s hot:     %4zu B/animal (%.2f lines), %5.2f ns warm, %6.2f ns "
+         "cold, %.0fx fewer misses\n",
+         what, hot_bytes, (double)hot_bytes / LINE, warm_hot, cold_hot,
+         old_lines * (double)LINE / hot_bytes);
+}
+
+int main(int argc, char **argv) {
+  bench_collection(ANIMALS);
+  now = time(NULL);
+  records = malloc(sizeof(reptile_t) * ANIMALS);
+  evict = malloc(EVICT_BYTES);
+  CHECK(records && evict);
+  memset(evict, 0, EVICT_BYTES);
+  for (int i = 0; i < ANIMALS; i++) {
+    CHECK(db_read_reptile(i, &records[i]));
+    records[i].last_feeding = now - (i % 21) * 86400;
+    CHECK(hot_table_set(&hot, i, &records[i]) == ESP_OK);
+  }
+
+  const size_t alert_fields[] = {offsetof(reptile_t, active),
+                                 offsetof(reptile_t, species),
+                                 offsetof(reptile_t, last_feeding)};
+  const size_t listed_fields[] = {offsetof(reptile_t, active),
+                                  offsetof(reptile_t, cites_annex)};
+  printf("%d animals, reptile_t is %zu bytes\n", ANIMALS, sizeof(reptile_t));
+  report("alerts", alerts_records, alerts_hot, record_lines(alert_fields, 3),
+         sizeof(*hot.active) + sizeof(*hot.species) +
+             sizeof(*hot.last_feeding));
+  report("conformity", listed_records, listed_hot,
+         record_lines(listed_fields, 2),
+         sizeof(*hot.active) + sizeof(*hot.cites_annex));
+
+  hot_table_clear(&hot);
+  free(records);
+  free(evict);
+  return test_result(argv[0]);
+}
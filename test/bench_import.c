@@ -0,0 +1,95 @@
+/**
+ * @file bench_import.c
+ * @brief Import throughput: the exported registre back in, CSV and JSON
+ *
+ * 5k synthetic animals are exported with db_export_csv() and written as a
+ * JSON array with the same names; the card is then emptied and each file
+ * imported into an empty registre. Every row must come back.
+ */
+
+#include "bench_util.h"
+
+#include "importer.h"
+
+#define ANIMALS 5000
+#define CSV_PATH SD_ROOT "/registre.csv"
+#define JSON_PATH SD_ROOT "/registre.json"
+#define SAVED_CSV SD_ROOT "/../bench_import.csv" // Off the card
+#define SAVED_JSON SD_ROOT "/../bench_import.json"
+
+static void write_json(const char *path) {
+  FILE *f = fopen(path, "w");
+  CHECK(f != NULL);
+  if (!f)
+    return;
+  fputs("[\n", f);
+  for (int i = 0; i < ANIMALS; i++) {
+    reptile_t r;
+    char common[64], sci[64], breeder[64];
+    CHECK(db_read_reptile(i, &r));
+    fprintf(f,
+            " {\"UUID\": \"%s\", \"Nom\": \"%s\", \"Espece_Commune\": \"%s\", "
+            "\"Espece_Scientifique\": \"%s\", \"Identification\": \"%s\", "
+            "\"Sexe\": \"%s\", \"Eleveur_Nom\": \"%s\", \"Poids_Grammes\": "
+            "%u, \"Actif\": %s}%s\n",
+            r.uuid, r.name, db_string(r.species_common, common, sizeof(common)),
+            db_string(r.species_scientific, sci, sizeof(sci)), r.microchip,
+            r.sex == SEX_MALE ? "M" : r.sex == SEX_FEMALE ? "F" : "?",
+            db_string(r.breeder_name, breeder, sizeof(breeder)),
+            (unsigned)r.weight_grams, r.active ? "true" : "false",
+            i + 1 < ANIMALS ? "," : "");
+  }
+  fputs("]\n", f);
+  fclose(f);
+}
+
+static void copy_file(const char *from, const char *to) {
+  FILE *in = fopen(from, "rb"), *out = fopen(to, "wb");
+  CHECK(in && out);
+  char buf[16384];
+  size_t n;
+  while (in && out && (n = fread(buf, 1, sizeof(buf), in)) > 0)
+    fwrite(buf, 1, n, out);
+  if (in)
+    fclose(in);
+  if (out)
+    fclose(out);
+}
+
+static void bench(const char *what, const char *saved, const char *path) {
+  bench_collection(0);
+  copy_file(saved, path);
+  import_result_t res;
+  double t0 = bench_now();
+  CHECK(import_file(path, &res) == ESP_OK);
+  double s = bench_now() - t0;
+  CHECK_EQ(res.rows, ANIMALS);
+  CHECK_EQ(res.imported, ANIMALS);
+  CHECK_EQ(res.rejected, 0);
+  CHECK_EQ(db_get_reptile_count(), ANIMALS);
+  printf("%-4s %d rows in %7.1f ms: %7.0f rows/s, %5.1f MB/s\n", what,
+         ANIMALS, s * 1e3, ANIMALS / s, test_file_size(path) / s / 1e6);
+
+  // Importing the same file again adds nothing
+  t0 = bench_now();
+  CHECK(import_file(path, &res) == ESP_OK);
+  s = bench_now() - t0;
+  CHECK_EQ(res.duplicates, ANIMALS);
+  CHECK_EQ(db_get_reptile_count(), ANIMALS);
+  printf("%-4s again, all duplicates: %7.0f rows/s\n", what, ANIMALS / s);
+}
+
+int main(int argc, char **argv) {
+  bench_collection(ANIMALS);
+  CHECK(db_export_csv(CSV_PATH, DB_EXPORT_FULL) == ESP_OK);
+  write_json(JSON_PATH);
+  // The card is emptied before each import
+  copy_file(CSV_PATH, SAVED_CSV);
+  copy_file(JSON_PATH, SAVED_JSON);
+
+  bench("CSV", SAVED_CSV, CSV_PATH);
+  bench("JSON", SAVED_JSON, JSON_PATH);
+  remove(SAVED_CSV);
+  remove(SAVED_JSON);
+  return test_result(argv[0]);
+}
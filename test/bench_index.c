@@ -0,0 +1,87 @@
+/**
+ * @file bench_index.c
+ * @brief Hash index lookups against the linear scan, at 1k and 10k animals
+ *
+ * The scan is the one db_get_reptile_by_id() did before the indexes: a walk
+ * of the reptile array comparing each record, here over a private copy of
+ * the table. Both sides look up the same keys, one in ten of them absent,
+ * and must agree on every answer.
+ */
+
+#include "bench_util.h"
+
+#include "uuid_gen.h"
+
+#define LOOKUPS 20000
+
+static const int sizes[] = {1000, 10000};
+
+typedef enum { KEY_ID, KEY_MICROCHIP, KEY_UUID } lookup_key_t;
+static const char *const key_names[] = {"id", "microchip", "uuid"};
+
+static reptile_t *table;
+static int table_count;
+
+static int scan(lookup_key_t key, const reptile_t *want) {
+  for (int i = 0; i < table_count; i++) {
+    const reptile_t *r = &table[i];
+    if (key == KEY_ID ? r->id == want->id
+        : key == KEY_MICROCHIP ? strcmp(r->microchip, want->microchip) == 0
+                               : strcmp(r->uuid, want->uuid) == 0)
+      return i;
+  }
+  return -1;
+}
+
+static int find(lookup_key_t key, const reptile_t *want) {
+  return key == KEY_ID          ? db_find_reptile_by_id((int)want->id)
+         : key == KEY_MICROCHIP ? db_find_reptile_by_microchip(want->microchip)
+                                : db_find_reptile_by_uuid(want->uuid);
+}
+
+static void bench(int animals) {
+  bench_collection(animals);
+  table_count = animals;
+  table = malloc(sizeof(reptile_t) * animals);
+  CHECK(table != NULL);
+  for (int i = 0; i < animals; i++)
+    CHECK(db_read_reptile(i, &table[i]));
+
+  // The keys: every tenth one belongs to nobody
+  static reptile_t keys[LOOKUPS];
+  static int expected[LOOKUPS];
+  uint32_t seed = 2463534242u;
+  for (int k = 0; k < LOOKUPS; k++) {
+    seed ^= seed << 13, seed ^= seed >> 17, seed ^= seed << 5;
+    int i = (int)(seed % animals);
+    keys[k] = table[i];
+    expected[k] = i;
+    if (k % 10 == 0) {
+      keys[k].id += 1000000;
+      snprintf(keys[k].microchip, sizeof(keys[k].microchip), "999%012d", k);
+      uuid_v4(keys[k].uuid);
+      expected[k] = -1;
+    }
+  }
+
+  for (lookup_key_t key = KEY_ID; key <= KEY_UUID; key++) {
+    double t0 = bench_now();
+    for (int k = 0; k < LOOKUPS; k++)
+      CHECK_EQ(scan(key, &keys[k]), expected[k]);
+    double linear = (bench_now() - t0) / LOOKUPS;
+    t0 = bench_now();
+    for (int k = 0; k < LOOKUPS; k++)
+      CHECK_EQ(find(key, &keys[k]), expected[k]);
+    double hashed = (bench_now() - t0) / LOOKUPS;
+    printf("%5d animals, %-9s: scan %9.1f ns | hash %6.1f ns | %6.0fx\n",
+           animals, key_names[key], linear * 1e9, hashed * 1e9,
+           linear / hashed);
+  }
+  free(table);
+}
+
+int main(int argc, char **argv) {
+  for (size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++)
+    bench(sizes[i]);
+  return test_result(argv[0]);
+}
@@ -0,0 +1,89 @@
+/**
+ * @file bench_journal.c
+ * @brief Bytes written per edit: snapshot rewrite against journal append
+ *
+ * Before the journal, every modifier rewrote reptile_data.bin whole; now it
+ * appends a record to reptile_data.jnl and the snapshot is only rewritten
+ * by the checkpoint, once the journal passes JOURNAL_CHECKPOINT_BYTES. A
+ * feeding session (every animal fed, weighed and edited once) is persisted
+ * one edit at a time, the worst case, and the bytes that reach the card are
+ * counted, checkpoints included.
+ */
+
+#include "bench_util.h"
+
+#include "journal.h"
+#include "snapshot.h"
+
+static const int sizes[] = {30, 100, 1000};
+
+typedef struct {
+  long bytes;
+  long journal; // Size after the previous edit
+  int checkpoints;
+  int edits;
+} tally_t;
+
+// Persist the edit just made and count what it wrote
+static void persist(tally_t *t) {
+  CHECK(db_flush() == ESP_OK);
+  long size = test_file_size(JOURNAL_FILE_PATH);
+  if (size < 0)
+    size = 0;
+  if (size < t->journal) { // Checkpoint: a new snapshot, then the tail
+    t->bytes += test_file_size(SNAPSHOT_FILE_PATH) + size;
+    t->checkpoints++;
+  } else {
+    t->bytes += size - t->journal;
+  }
+  t->journal = size;
+  t->edits++;
+}
+
+static void bench(int animals) {
+  bench_collection(animals);
+  db_save_data();
+  CHECK(db_flush() == ESP_OK);
+  long snapshot = test_file_size(SNAPSHOT_FILE_PATH);
+  CHECK(snapshot > 0);
+
+  // Before: one full rewrite per edit
+  double t0 = bench_now();
+  for (int i = 0; i < 10; i++) {
+    db_save_data();
+    CHECK(db_flush() == ESP_OK);
+  }
+  double rewrite_us = (bench_now() - t0) / 10 * 1e6;
+
+  // After: the session through the journal
+  tally_t t = {.journal = test_file_size(JOURNAL_FILE_PATH)};
+  if (t.journal < 0)
+    t.journal = 0;
+  time_t now = time(NULL);
+  t0 = bench_now();
+  for (int i = 0; i < animals; i++) {
+    db_record_feeding(i, now, "Souris adulte", 1, true);
+    persist(&t);
+    db_record_weight(i, now, 100 + i % 900);
+    persist(&t);
+    reptile_t r;
+    CHECK(db_read_reptile(i, &r));
+    snprintf(r.notes, sizeof(r.notes), "Mue le %d", i);
+    db_update_reptile(r.id, &r);
+    persist(&t);
+  }
+  double append_us = (bench_now() - t0) / t.edits * 1e6;
+  CHECK_EQ(db_get_feeding_count(), animals);
+
+  printf("%5d animals: rewrite %8ld B %8.1f us | journal %6.1f B %7.1f us "
+         "per edit, %d checkpoint(s) in %d edits, %.0fx fewer bytes\n",
+         animals, snapshot, rewrite_us, (double)t.bytes / t.edits, append_us,
+         t.checkpoints, t.edits, (double)snapshot * t.edits / t.bytes);
+  CHECK(t.bytes < snapshot * t.edits);
+}
+
+int main(int argc, char **argv) {
+  for (size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++)
+    bench(sizes[i]);
+  return test_result(argv[0]);
+}
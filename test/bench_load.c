@@ -0,0 +1,156 @@
+/**
+ * @file bench_load.c
+ * @brief Load throughput of 10k records, and the cost of the tagged format
+ *
+ * A snapshot of 10k animals with a meal and a weighing each is loaded back
+ * whole, the best of ten rounds. Then 10k reptile records are decoded three ways: a raw memcpy, as
+ * fread() did before the schema; through the plan of the current schema;
+ * and through the plan of the frozen version 2 layout, the migration path,
+ * which also interns the species and breeder texts.
+ */
+
+#include "bench_util.h"
+
+#include <stdint.h>
+
+#include "db_schema.h"
+#include "snapshot.h"
+
+#define RECORDS 10000
+#define ROUNDS 10
+
+static uint8_t *stored;
+static reptile_t *native;
+
+static double load_seconds(void) {
+  int meals = db_get_feeding_count(); // The recent ones, kept in RAM
+  double best = 1e9;
+  for (int round = 0; round < ROUNDS; round++) {
+    double t0 = bench_now();
+    db_load_data();
+    double t = bench_now() - t0;
+    if (t < best)
+      best = t;
+    CHECK_EQ(db_get_reptile_count(), RECORDS);
+    CHECK_EQ(db_get_feeding_count(), meals);
+  }
+  return best;
+}
+
+// Best time of ROUNDS decodes of RECORDS records laid out with `stride`
+static double decode_seconds(const table_schema_t *t, const field_map_t *plan,
+                             int n, uint16_t stride) {
+  double best = 1e9;
+  for (int round = 0; round < ROUNDS; round++) {
+    double t0 = bench_now();
+    for (int i = 0; i < RECORDS; i++)
+      schema_decode_record(t, plan, n, stored + (size_t)i * stride,
+                           &native[i]);
+    double s = bench_now() - t0;
+    if (s < best)
+      best = s;
+  }
+  return best;
+}
+
+static void report(const char *what, double seconds, size_t bytes) {
+  printf("%-24s %8.2f ms %10.0f records/s %8.1f MB/s\n", what, seconds * 1e3,
+         RECORDS / seconds, bytes / seconds / 1e6);
+}
+
+static void bench_snapshot(void) {
+  bench_collection(RECORDS);
+  time_t now = time(NULL);
+  db_txn_begin();
+  for (int i = 0; i < RECORDS; i++) {
+    db_record_feeding(i, now - i % 30 * 86400, "Souris adulte", 1, true);
+    db_record_weight(i, now - i % 30 * 86400, 100 + i % 900);
+  }
+  db_txn_commit();
+  db_save_data();
+  CHECK(db_flush() == ESP_OK);
+  long size = test_file_size(SNAPSHOT_FILE_PATH);
+  CHECK(size > 0);
+
+  reptile_t before, after;
+  CHECK(db_read_reptile(RECORDS / 2, &before));
+  report("snapshot load", load_seconds(), (size_t)size);
+  CHECK(db_read_reptile(RECORDS / 2, &after));
+  // String handles are renumbered by the load; their texts are not
+  char a[64], b[64];
+  CHECK_EQ(after.id, before.id);
+  CHECK(strcmp(after.uuid, before.uuid) == 0);
+  CHECK(strcmp(after.name, before.name) == 0);
+  CHECK(strcmp(db_string(after.breeder_name, a, sizeof(a)),
+               bench_breeders[RECORDS / 2 % BENCH_BREEDERS]) == 0);
+  CHECK(strcmp(db_string(after.species_common, b, sizeof(b)),
+               bench_species[RECORDS / 2 % BENCH_SPECIES][0]) == 0);
+  CHECK_EQ(after.weight_grams, before.weight_grams);
+  CHECK_EQ(after.last_feeding, before.last_feeding);
+}
+
+static void bench_decode(void) {
+  const table_schema_t *t = schema_table(SECTION_REPTILES);
+  const table_schema_t *raw = schema_raw_v2(SECTION_REPTILES);
+  CHECK(t && raw);
+  size_t width = schema_width(t);
+  size_t stride = width > raw->record_size ? width : raw->record_size;
+  stride = stride > sizeof(reptile_t) ? stride : sizeof(reptile_t);
+  stored = calloc(RECORDS, stride);
+  native = calloc(RECORDS, sizeof(reptile_t));
+  CHECK(stored && native);
+
+  // Before the schema: the struct array as fread() left it
+  double best = 1e9;
+  for (int round = 0; round < ROUNDS; round++) {
+    double t0 = bench_now();
+    memcpy(native, stored, (size_t)RECORDS * sizeof(reptile_t));
+    double s = bench_now() - t0;
+    if (s < best)
+      best = s;
+  }
+  report("raw struct copy", best, (size_t)RECORDS * sizeof(reptile_t));
+
+  // Current schema: every field through its tag
+  schema_entry_t entries[SCHEMA_MAX_ENTRIES];
+  int count = schema_describe(entries, SCHEMA_MAX_ENTRIES);
+  field_map_t plan[SCHEMA_MAX_FIELDS];
+  uint16_t current;
+  int n = schema_plan_stored(t, entries, count, plan, &current);
+  CHECK(n > 0);
+  for (int i = 0; i < RECORDS; i++) {
+    bench_reptile(i, &native[i]);
+    schema_encode_record(t, &native[i], stored + (size_t)i * current);
+  }
+  report("tagged decode", decode_seconds(t, plan, n, current),
+         (size_t)RECORDS * current);
+  reptile_t check;
+  bench_reptile(RECORDS - 1, &check);
+  CHECK(memcmp(&check, &native[RECORDS - 1], sizeof(check)) == 0);
+
+  // Version 2 file: raw layout, texts where handles are now
+  memset(stored, 0, (size_t)RECORDS * raw->record_size);
+  for (int i = 0; i < RECORDS; i++) {
+    uint8_t *rec = stored + (size_t)i * raw->record_size;
+    for (int f = 0; f < raw->field_count; f++) {
+      const field_desc_t *fd = &raw->fields[f];
+      if (fd->kind == FIELD_STR)
+        snprintf((char *)rec + fd->offset, fd->size, "%s",
+                 bench_species[(i + f) % BENCH_SPECIES][0]);
+    }
+  }
+  uint16_t v2;
+  n = schema_plan_raw(t, raw, plan, &v2);
+  CHECK_EQ(v2, raw->record_size);
+  report("version 2 migration", decode_seconds(t, plan, n, v2),
+         (size_t)RECORDS * v2);
+
+  free(stored);
+  free(native);
+}
+
+int main(int argc, char **argv) {
+  bench_snapshot();
+  bench_decode();
+  return test_result(argv[0]);
+}
@@ -0,0 +1,142 @@
+/**
+ * @file bench_query.c
+ * @brief db_query() over 10k animals, against the list filter it replaced
+ *
+ * Before the query module the screens walked the reptile array, tested
+ * each record and sorted the matches with strcasecmp(). Here the same
+ * filters and orders run both ways on 10k animals, and must agree on the
+ * count and on the order of the names. The walk gets a private, warm copy
+ * of the records, its best case; on the board they sit in PSRAM.
+ */
+
+#include "bench_util.h"
+
+#include <strings.h>
+
+#include "query.h"
+
+#define ANIMALS 10000
+#define ROUNDS 20
+#define PAGE 50
+
+typedef struct {
+  const char *name;
+  query_t q;
+} bench_query_t;
+
+static const bench_query_t queries[] = {
+    {"active, by name", {.sort = QUERY_SORT_NAME}},
+    {"snake females, by name",
+     {.where = QUERY_SPECIES | QUERY_SEX,
+      .species = SPECIES_SNAKE,
+      .sex = SEX_FEMALE,
+      .sort = QUERY_SORT_NAME}},
+    {"CITES listed, by id",
+     {.where = QUERY_CITES_LISTED | QUERY_INACTIVE, .sort = QUERY_SORT_ID}},
+    {"terrarium 7, by name",
+     {.where = QUERY_TERRARIUM, .terrarium_id = 7, .sort = QUERY_SORT_NAME}},
+    {"all, table order", {.where = QUERY_INACTIVE}},
+};
+#define QUERIES (sizeof(queries) / sizeof(queries[0]))
+
+static reptile_t *records;
+static const reptile_t **matches;
+
+static bool matches_query(const reptile_t *r, const query_t *q) {
+  return (r->active || (q->where & QUERY_INACTIVE)) &&
+         (!(q->where & QUERY_SPECIES) || r->species == q->species) &&
+         (!(q->where & QUERY_SEX) || r->sex == q->sex) &&
+         (!(q->where & QUERY_CITES_LISTED) ||
+          r->cites_annex != CITES_NOT_LISTED) &&
+         (!(q->where & QUERY_TERRARIUM) || r->terrarium_id == q->terrarium_id);
+}
+
+static int by_name(const void *a, const void *b) {
+  return strcasecmp((*(const reptile_t **)a)->name,
+                    (*(const reptile_t **)b)->name);
+}
+
+static int by_id(const void *a, const void *b) {
+  uint32_t x = (*(const reptile_t **)a)->id, y = (*(const reptile_t **)b)->id;
+  return (x > y) - (x < y);
+}
+
+// The walk the screens did, over the array of full records
+static int scan(const query_t *q) {
+  int n = 0;
+  for (int i = 0; i < ANIMALS; i++)
+    if (matches_query(&records[i], q))
+      matches[n++] = &records[i];
+  if (q->sort == QUERY_SORT_NAME)
+    qsort(matches, n, sizeof(*matches), by_name);
+  else if (q->sort == QUERY_SORT_ID)
+    qsort(matches, n, sizeof(*matches), by_id);
+  return n;
+}
+
+static void check_order(const query_t *q, const query_result_t *res,
+                        int expected) {
+  CHECK_EQ(res->count, expected);
+  for (uint32_t i = 0; i < res->count && i < (uint32_t)expected; i++) {
+    const reptile_t *r = &records[res->rows[i]];
+    if (q->sort == QUERY_SORT_NAME)
+      CHECK(strcasecmp(r->name, matches[i]->name) == 0);
+    else
+      CHECK_EQ(r->id, matches[i]->id);
+  }
+}
+
+int main(int argc, char **argv) {
+  bench_collection(ANIMALS);
+  time_t today = time(NULL);
+  db_txn_begin();
+  for (int i = 0; i < ANIMALS; i++)
+    db_record_feeding(i, today - i % 21 * 86400, "Souris", 1, true);
+  db_txn_commit();
+  records = malloc(sizeof(reptile_t) * ANIMALS);
+  matches = malloc(sizeof(*matches) * ANIMALS);
+  CHECK(records && matches);
+  for (int i = 0; i < ANIMALS; i++)
+    CHECK(db_read_reptile(i, &records[i]));
+
+  query_result_t res = {0};
+  for (size_t k = 0; k < QUERIES; k++) {
+    const query_t *q = &queries[k].q;
+    double old = 1e9, now = 1e9;
+    int expected = 0;
+    for (int round = 0; round < ROUNDS; round++) {
+      double t0 = bench_now();
+      expected = scan(q);
+      double s = bench_now() - t0;
+      old = s < old ? s : old;
+      t0 = bench_now();
+      CHECK(db_query(q, &res) == ESP_OK);
+      s = bench_now() - t0;
+      now = s < now ? s : now;
+    }
+    check_order(q, &res, expected);
+    printf("%-24s %5d rows: scan %7.1f us | db_query %6.1f us | %4.1fx\n",
+           queries[k].name, expected, old * 1e6, now * 1e6, old / now);
+  }
+
+  // Feeding due has no equivalent in the old walk; paging a result is free
+  query_t due = {.where = QUERY_FEEDING_DUE, .sort = QUERY_SORT_LAST_FEEDING};
+  double t0 = bench_now();
+  CHECK(db_query(&due, &res) == ESP_OK);
+  printf("%-24s %5u rows: db_query %6.1f us\n", "feeding due, oldest first",
+         (unsigned)res.count, (bench_now() - t0) * 1e6);
+  CHECK_EQ(res.count, reptile_count_feeding_alerts());
+  CHECK(res.count > 0);
+  CHECK(db_query(&queries[0].q, &res) == ESP_OK);
+  uint32_t cursor = res.count / 2;
+  int page[PAGE];
+  t0 = bench_now();
+  CHECK_EQ(query_page(&res, &cursor, page, PAGE), PAGE);
+  printf("%-24s %5d rows: query_page %5.2f us\n", "one page", PAGE,
+         (bench_now() - t0) * 1e6);
+
+  query_result_free(&res);
+  free(records);
+  free(matches);
+  return test_result(argv[0]);
+}
@@ -0,0 +1,111 @@
+/**
+ * @file bench_scale.c
+ * @brief 10k animals and 1M feedings in the growable tables
+ *
+ * The fixed arrays capped the collection at 30 animals and 100 meals. This
+ * fills the tables to 10k animals and 1M feeding events, 100 per animal,
+ * and checks that records never move as the arenas grow: a pointer taken
+ * to the first records stays valid and keeps its contents to the end.
+ */
+
+#include "bench_util.h"
+
+#include "arena.h"
+#include "snapshot.h"
+
+#define ANIMALS 10000
+#define FEEDINGS 1000000
+#define DAY (24 * 3600)
+
+static void bench_arena(void) {
+  arena_t a = ARENA_INIT(feeding_record_t, 10, MAX_FEEDINGS);
+  feeding_record_t *first = arena_append(&a);
+  CHECK(first != NULL);
+  first->animal_id = 42;
+  double t0 = bench_now();
+  for (uint32_t i = 1; i < FEEDINGS; i++) {
+    feeding_record_t *f = arena_append(&a);
+    if (!f)
+      break;
+    f->animal_id = i;
+  }
+  double s = bench_now() - t0;
+  CHECK_EQ(a.count, FEEDINGS);
+  CHECK(arena_at(&a, 0) == first); // Never moved
+  CHECK_EQ(first->animal_id, 42);
+  CHECK_EQ(((feeding_record_t *)arena_at(&a, FEEDINGS - 1))->animal_id,
+           FEEDINGS - 1);
+  CHECK(arena_append(&a) == NULL); // The cap holds
+  printf("arena: %d appends in %.1f ms (%.0f ns each), %u chunks, "
+         "%.1f MB\n",
+         FEEDINGS, s * 1e3, s / FEEDINGS * 1e9, (unsigned)a.chunk_count,
+         (double)a.chunk_count * (a.record_size << a.chunk_shift) / 1e6);
+}
+
+static void bench_database(void) {
+  double t0 = bench_now();
+  bench_collection(ANIMALS);
+  printf("database: %d animals added in %.1f ms\n", ANIMALS,
+         (bench_now() - t0) * 1e3);
+
+  static uint32_t ids[ANIMALS];
+  for (int i = 0; i < ANIMALS; i++) {
+    reptile_t r;
+    CHECK(db_read_reptile(i, &r));
+    ids[i] = r.id;
+  }
+  reptile_t first;
+  CHECK(db_read_reptile(0, &first));
+  time_t start = time(NULL) - FEEDINGS / ANIMALS * DAY;
+  t0 = bench_now();
+  for (int i = 0; i < FEEDINGS; i++) {
+    feeding_record_t f = {.animal_id = ids[i % ANIMALS],
+                          .timestamp = start + i / ANIMALS * DAY,
+                          .prey_count = 1,
+                          .accepted = true};
+    strcpy(f.prey_type, "Souris adulte");
+    db_add_feeding(&f);
+  }
+  double s = bench_now() - t0;
+  printf("database: %d feedings added in %.1f ms (%.0f ns each)\n",
+         FEEDINGS, s * 1e3, s / FEEDINGS * 1e9);
+  CHECK_EQ(db_get_feeding_count(), FEEDINGS);
+
+  // Every animal's chain holds its 100 meals, newest first
+  t0 = bench_now();
+  feeding_record_t page[20];
+  for (int i = 0; i < ANIMALS; i++) {
+    uint32_t cursor = DB_HISTORY_START;
+    int n = db_get_feeding_history(i, &cursor, page, 20);
+    CHECK_EQ(n, 20);
+    CHECK_EQ(page[0].timestamp, start + (FEEDINGS / ANIMALS - 1) * DAY);
+  }
+  s = bench_now() - t0;
+  printf("database: first history page of each animal in %.1f ms "
+         "(%.1f us each)\n",
+         s * 1e3, s / ANIMALS * 1e6);
+  CHECK_EQ(db_get_feeding_history_count(ANIMALS / 2), FEEDINGS / ANIMALS);
+
+  reptile_t again;
+  CHECK(db_read_reptile(0, &again));
+  CHECK_EQ(again.id, first.id);
+  CHECK(strcmp(again.uuid, first.uuid) == 0);
+
+  t0 = bench_now();
+  db_save_data();
+  CHECK(db_flush() == ESP_OK);
+  printf("database: snapshot of %.1f MB saved in %.1f ms\n",
+         test_file_size(SNAPSHOT_FILE_PATH) / 1e6, (bench_now() - t0) * 1e3);
+  t0 = bench_now();
+  db_load_data();
+  printf("database: loaded back in %.1f ms, %d feedings in RAM\n",
+         (bench_now() - t0) * 1e3, db_get_feeding_count());
+  CHECK_EQ(db_get_reptile_count(), ANIMALS);
+  CHECK_EQ(db_get_feeding_history_count(ANIMALS / 2), FEEDINGS / ANIMALS);
+}
+
+int main(int argc, char **argv) {
+  bench_arena();
+  bench_database();
+  return test_result(argv[0]);
+}
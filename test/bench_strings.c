@@ -0,0 +1,124 @@
+/**
+ * @file bench_strings.c
+ * @brief Memory and load time of the interned strings, 5k animals
+ *
+ * Before the pool every reptile_t carried species_common[48],
+ * species_scientific[64], breeder_name[64], breeder_address[128] and
+ * origin[64]. Now it holds five handles, and each distinct text is stored
+ * once in the pool. This counts both footprints on a synthetic collection,
+ * and times the pool load against the whole snapshot load and a species
+ * filter by text against one by handle.
+ */
+
+#include "bench_util.h"
+
+#include "string_pool.h"
+
+#define ANIMALS 5000
+#define ROUNDS 20
+#define FIXED_BYTES (48 + 64 + 64 + 128 + 64) // The buffers before the pool
+
+static const char *texts(const reptile_t *r, int field, char *buf,
+                         size_t len) {
+  const str_ref_t refs[] = {r->species_common, r->species_scientific,
+                            r->breeder_name, r->breeder_address, r->origin};
+  return db_string(refs[field], buf, len);
+}
+
+static void bench_memory(string_pool_t *pool) {
+  for (int i = 0; i < ANIMALS; i++) {
+    reptile_t r;
+    CHECK(db_read_reptile(i, &r));
+    for (int f = 0; f < 5; f++) {
+      char buf[STRING_POOL_MAX_LEN + 1];
+      const char *s = texts(&r, f, buf, sizeof(buf));
+      str_ref_t ref;
+      CHECK(string_pool_intern(pool, s, strlen(s), &ref) == ESP_OK);
+    }
+  }
+  size_t before = (size_t)ANIMALS * FIXED_BYTES;
+  size_t handles = (size_t)ANIMALS * 5 * sizeof(str_ref_t);
+  size_t shared = pool->len + pool->count * sizeof(uint32_t) +
+                  pool->index.capacity * sizeof(hash_slot_t);
+  printf("%d animals, %u distinct texts\n", ANIMALS, (unsigned)pool->count);
+  printf("fixed buffers: %8zu B (%d B/animal)\n", before, FIXED_BYTES);
+  printf("interned:      %8zu B (%zu B of handles + %zu B of pool), "
+         "%.0fx smaller\n",
+         handles + shared, handles, shared,
+         (double)before / (handles + shared));
+  CHECK(handles + shared < before);
+}
+
+static void bench_load(const string_pool_t *pool) {
+  db_save_data();
+  CHECK(db_flush() == ESP_OK);
+  double load = 1e9;
+  for (int round = 0; round < ROUNDS / 4; round++) {
+    double t0 = bench_now();
+    db_load_data();
+    double s = bench_now() - t0;
+    if (s < load)
+      load = s;
+  }
+  CHECK_EQ(db_get_reptile_count(), ANIMALS);
+
+  string_pool_t copy = {0};
+  double strings = 1e9;
+  for (int round = 0; round < ROUNDS; round++) {
+    double t0 = bench_now();
+    CHECK(string_pool_load(&copy, pool->data, pool->len) == ESP_OK);
+    double s = bench_now() - t0;
+    if (s < strings)
+      strings = s;
+  }
+  CHECK_EQ(copy.count, pool->count);
+  string_pool_free(&copy);
+  printf("load: snapshot %.2f ms, of which the pool section %.3f ms "
+         "(%.2f%%)\n",
+         load * 1e3, strings * 1e3, strings / load * 100);
+}
+
+static void bench_filter(void) {
+  static char species[ANIMALS][48];
+  static str_ref_t handles[ANIMALS];
+  for (int i = 0; i < ANIMALS; i++) {
+    reptile_t r;
+    CHECK(db_read_reptile(i, &r));
+    texts(&r, 0, species[i], sizeof(species[i]));
+    handles[i] = r.species_common;
+  }
+  const char *want = bench_species[0][0];
+  str_ref_t ref = db_find_string(want);
+  CHECK(ref != 0);
+
+  double by_text = 1e9, by_handle = 1e9;
+  int a = 0, b = 0;
+  for (int round = 0; round < ROUNDS; round++) {
+    double t0 = bench_now();
+    a = 0;
+    for (int i = 0; i < ANIMALS; i++)
+      a += strcmp(species[i], want) == 0;
+    double s = bench_now() - t0;
+    by_text = s < by_text ? s : by_text;
+    t0 = bench_now();
+    b = 0;
+    for (int i = 0; i < ANIMALS; i++)
+      b += handles[i] == ref;
+    s = bench_now() - t0;
+    by_handle = s < by_handle ? s : by_handle;
+  }
+  CHECK_EQ(a, (ANIMALS + BENCH_SPECIES - 1) / BENCH_SPECIES);
+  CHECK_EQ(b, a);
+  printf("species filter: strcmp %.1f us, handle %.1f us\n", by_text * 1e6,
+         by_handle * 1e6);
+}
+
+int main(int argc, char **argv) {
+  bench_collection(ANIMALS);
+  string_pool_t pool = {0};
+  bench_memory(&pool);
+  bench_load(&pool);
+  bench_filter();
+  string_pool_free(&pool);
+  return test_result(argv[0]);
+}
@@ -0,0 +1,91 @@
+/**
+ * @file bench_util.h
+ * @brief Clock and synthetic collection shared by the host benchmarks
+ *
+ * Benchmarks check what they measure, so a run that prints numbers also
+ * proves they are the right ones. The figures are for the development
+ * machine and only compare approaches; the ESP32-P4 and its SD card are
+ * slower by a roughly constant factor.
+ */
+
+#ifndef BENCH_UTIL_H
+#define BENCH_UTIL_H
+
+#include "test_util.h"
+
+#include <time.h>
+
+#include "database.h"
+
+static inline double bench_now(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static const char *const bench_species[][2] = {
+    {"Python royal", "Python regius"},
+    {"Serpent des blés", "Pantherophis guttatus"},
+    {"Gecko léopard", "Eublepharis macularius"},
+    {"Pogona", "Pogona vitticeps"},
+    {"Tortue d'Hermann", "Testudo hermanni"},
+    {"Boa constricteur", "Boa constrictor"},
+    {"Gecko à crête", "Correlophus ciliatus"},
+    {"Serpent roi", "Lampropeltis getula"},
+};
+#define BENCH_SPECIES (sizeof(bench_species) / sizeof(bench_species[0]))
+
+static const char *const bench_breeders[] = {
+    "Élevage du Lac", "Reptiles Passion", "Animalerie Centrale",
+    "Import Madagascar", "Élevage des Cévennes",
+};
+#define BENCH_BREEDERS (sizeof(bench_breeders) / sizeof(bench_breeders[0]))
+
+static const char *const bench_addresses[BENCH_BREEDERS] = {
+    "12 chemin du Lac, 74200 Thonon-les-Bains",
+    "3 rue des Écailles, 69003 Lyon",
+    "45 avenue de la République, 75011 Paris",
+    "Zone portuaire, Toamasina, Madagascar",
+    "Mas des Cévennes, 30270 Saint-Jean-du-Gard",
+};
+
+// The synthetic animal number `i`: a few species and breeders shared by
+// everyone, as in a real room, and a name and chip of its own
+static inline void bench_reptile(int i, reptile_t *r) {
+  const char *const *sp = bench_species[i % BENCH_SPECIES];
+  memset(r, 0, sizeof(*r));
+  snprintf(r->name, sizeof(r->name), "%s %d", i % 3 ? "Nala" : "Kaa", i);
+  snprintf(r->morph, sizeof(r->morph), "%s", i % 4 ? "Classique" : "Pastel");
+  snprintf(r->microchip, sizeof(r->microchip), "250269%09d", i);
+  r->species_common = db_intern_string(sp[0]);
+  r->species_scientific = db_intern_string(sp[1]);
+  r->breeder_name = db_intern_string(bench_breeders[i % BENCH_BREEDERS]);
+  r->breeder_address = db_intern_string(bench_addresses[i % BENCH_BREEDERS]);
+  r->origin = db_intern_string(i % 5 ? "Né en captivité" : "Import");
+  r->species = (reptile_species_t)(i % BENCH_SPECIES % 4);
+  r->sex = (reptile_sex_t)(i % 3);
+  r->cites_annex = (cites_annex_t)(i % 4);
+  r->terrarium_id = (uint8_t)(i % 40);
+  r->weight_grams = (uint16_t)(50 + i % 2000);
+  r->birth_year = (uint16_t)(2010 + i % 15);
+  r->captive_bred = i % 5 != 0;
+  r->active = i % 20 != 0; // One in twenty has left
+}
+
+// A fresh card holding `count` synthetic animals and nothing else
+static inline void bench_collection(int count) {
+  test_sd_reset();
+  db_init();
+  db_load_data(); // Empty card: demo data
+  db_set_reptile_count(0);
+  db_txn_begin();
+  for (int i = 0; i < count; i++) {
+    reptile_t r;
+    bench_reptile(i, &r);
+    db_update_reptile(-1, &r);
+  }
+  db_txn_commit();
+  CHECK_EQ(db_get_reptile_count(), count);
+}
+
+#endif // BENCH_UTIL_H
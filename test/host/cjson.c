@@ -0,0 +1,274 @@
+/**
+ * @file cjson.c
+ * @brief RFC 8259 parser behind the cJSON calls the importer makes
+ *
+ * Builds the same tree as cJSON (siblings linked by next/prev, members
+ * keyed by `string`), from a buffer that need not be NUL-terminated. Only
+ * parsing is provided; the importer never prints JSON.
+ */
+
+#include "cJSON.h"
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define MAX_DEPTH 64
+
+typedef struct {
+  const char *p;
+  const char *end;
+  int depth;
+} parser_t;
+
+static cJSON *parse_value(parser_t *ps);
+
+static void skip_space(parser_t *ps) {
+  while (ps->p < ps->end && (*ps->p == ' ' || *ps->p == '\t' ||
+                             *ps->p == '\n' || *ps->p == '\r'))
+    ps->p++;
+}
+
+static bool literal(parser_t *ps, const char *word) {
+  size_t n = strlen(word);
+  if ((size_t)(ps->end - ps->p) < n || memcmp(ps->p, word, n) != 0)
+    return false;
+  ps->p += n;
+  return true;
+}
+
+static int hex4(const char *p) {
+  int v = 0;
+  for (int i = 0; i < 4; i++) {
+    char c = p[i];
+    v = v * 16 + (c >= '0' && c <= '9'   ? c - '0'
+                  : c >= 'a' && c <= 'f' ? c - 'a' + 10
+                  : c >= 'A' && c <= 'F' ? c - 'A' + 10
+                                         : -1000000);
+  }
+  return v;
+}
+
+static char *put_utf8(char *out, uint32_t cp) {
+  if (cp < 0x80) {
+    *out++ = (char)cp;
+  } else if (cp < 0x800) {
+    *out++ = (char)(0xC0 | cp >> 6);
+    *out++ = (char)(0x80 | (cp & 0x3F));
+  } else if (cp < 0x10000) {
+    *out++ = (char)(0xE0 | cp >> 12);
+    *out++ = (char)(0x80 | (cp >> 6 & 0x3F));
+    *out++ = (char)(0x80 | (cp & 0x3F));
+  } else {
+    *out++ = (char)(0xF0 | cp >> 18);
+    *out++ = (char)(0x80 | (cp >> 12 & 0x3F));
+    *out++ = (char)(0x80 | (cp >> 6 & 0x3F));
+    *out++ = (char)(0x80 | (cp & 0x3F));
+  }
+  return out;
+}
+
+// A string at ps->p (on its opening quote), unescaped into a new buffer
+static char *parse_string(parser_t *ps) {
+  const char *s = ++ps->p;
+  while (ps->p < ps->end && *ps->p != '"')
+    ps->p += *ps->p == '\\' ? 2 : 1;
+  if (ps->p >= ps->end)
+    return NULL;
+  char *out = malloc(ps->p - s + 1); // Escapes never grow the text
+  if (out == NULL)
+    return NULL;
+  char *o = out;
+  for (const char *q = s; q < ps->p; q++) {
+    if (*q != '\\') {
+      *o++ = *q;
+      continue;
+    }
+    switch (*++q) {
+    case 'b':
+      *o++ = '\b';
+      break;
+    case 'f':
+      *o++ = '\f';
+      break;
+    case 'n':
+      *o++ = '\n';
+      break;
+    case 'r':
+      *o++ = '\r';
+      break;
+    case 't':
+      *o++ = '\t';
+      break;
+    case 'u': {
+      int cp = ps->p - q > 4 ? hex4(q + 1) : -1;
+      if (cp < 0) {
+        free(out);
+        return NULL;
+      }
+      q += 4;
+      if (cp >= 0xD800 && cp < 0xDC00 && ps->p - q > 6 && q[1] == '\\' &&
+          q[2] == 'u') {
+        int low = hex4(q + 3);
+        if (low >= 0xDC00 && low < 0xE000) {
+          cp = 0x10000 + ((cp - 0xD800) << 10) + (low - 0xDC00);
+          q += 6;
+        }
+      }
+      o = put_utf8(o, (uint32_t)cp);
+      break;
+    }
+    default: // '"', '\\', '/'
+      *o++ = *q;
+      break;
+    }
+  }
+  *o = '\0';
+  ps->p++; // Closing quote
+  return out;
+}
+
+static bool parse_number(parser_t *ps, cJSON *item) {
+  char buf[64];
+  size_t n = 0;
+  while (ps->p + n < ps->end && n + 1 < sizeof(buf) &&
+         strchr("+-0123456789.eE", ps->p[n]))
+    n++;
+  memcpy(buf, ps->p, n);
+  buf[n] = '\0';
+  char *end;
+  item->valuedouble = strtod(buf, &end);
+  if (n == 0 || end != buf + n)
+    return false;
+  item->valueint = (int)item->valuedouble;
+  ps->p += n;
+  return true;
+}
+
+// Members (object) or elements (array) up to the closing bracket
+static bool parse_children(parser_t *ps, cJSON *parent, char close) {
+  cJSON *last = NULL;
+  ps->p++;
+  skip_space(ps);
+  if (ps->p < ps->end && *ps->p == close) {
+    ps->p++;
+    return true;
+  }
+  while (ps->p < ps->end) {
+    char *key = NULL;
+    if (close == '}') {
+      if (*ps->p != '"' || (key = parse_string(ps)) == NULL)
+        return false;
+      skip_space(ps);
+      if (ps->p >= ps->end || *ps->p != ':') {
+        free(key);
+        return false;
+      }
+      ps->p++;
+    }
+    cJSON *child = parse_value(ps);
+    if (child == NULL) {
+      free(key);
+      return false;
+    }
+    child->string = key;
+    child->prev = last;
+    if (last)
+      last->next = child;
+    else
+      parent->child = child;
+    last = child;
+
+    skip_space(ps);
+    if (ps->p >= ps->end)
+      return false;
+    if (*ps->p == close) {
+      ps->p++;
+      return true;
+    }
+    if (*ps->p++ != ',')
+      return false;
+    skip_space(ps);
+  }
+  return false;
+}
+
+static cJSON *parse_value(parser_t *ps) {
+  skip_space(ps);
+  if (ps->p >= ps->end || ps->depth >= MAX_DEPTH)
+    return NULL;
+  cJSON *item = calloc(1, sizeof(*item));
+  if (item == NULL)
+    return NULL;
+  bool ok;
+  char c = *ps->p;
+  if (c == '{' || c == '[') {
+    item->type = c == '{' ? cJSON_Object : cJSON_Array;
+    ps->depth++;
+    ok = parse_children(ps, item, c == '{' ? '}' : ']');
+    ps->depth--;
+  } else if (c == '"') {
+    item->type = cJSON_String;
+    ok = (item->valuestring = parse_string(ps)) != NULL;
+  } else if (literal(ps, "true")) {
+    item->type = cJSON_True;
+    ok = true;
+  } else if (literal(ps, "false")) {
+    item->type = cJSON_False;
+    ok = true;
+  } else if (literal(ps, "null")) {
+    item->type = cJSON_NULL;
+    ok = true;
+  } else {
+    item->type = cJSON_Number;
+    ok = parse_number(ps, item);
+  }
+  if (!ok) {
+    cJSON_Delete(item);
+    return NULL;
+  }
+  return item;
+}
+
+cJSON *cJSON_ParseWithLength(const char *value, size_t length) {
+  if (value == NULL)
+    return NULL;
+  parser_t ps = {.p = value, .end = value + length};
+  cJSON *item = parse_value(&ps);
+  skip_space(&ps);
+  if (item && ps.p < ps.end && *ps.p != '\0') { // Trailing garbage
+    cJSON_Delete(item);
+    return NULL;
+  }
+  return item;
+}
+
+void cJSON_Delete(cJSON *item) {
+  while (item) {
+    cJSON *next = item->next;
+    cJSON_Delete(item->child);
+    free(item->valuestring);
+    free(item->string);
+    free(item);
+    item = next;
+  }
+}
+
+cJSON_bool cJSON_IsObject(const cJSON *item) {
+  return item && item->type == cJSON_Object;
+}
+cJSON_bool cJSON_IsString(const cJSON *item) {
+  return item && item->type == cJSON_String;
+}
+cJSON_bool cJSON_IsNumber(const cJSON *item) {
+  return item && item->type == cJSON_Number;
+}
+cJSON_bool cJSON_IsBool(const cJSON *item) {
+  return item && (item->type == cJSON_True || item->type == cJSON_False);
+}
+cJSON_bool cJSON_IsTrue(const cJSON *item) {
+  return item && item->type == cJSON_True;
+}
+cJSON_bool cJSON_IsNull(const cJSON *item) {
+  return item && item->type == cJSON_NULL;
+}
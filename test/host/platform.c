@@ -0,0 +1,340 @@
+/**
+ * @file platform.c
+ * @brief ESP-IDF and FreeRTOS services main/data needs, on POSIX
+ *
+ * Tasks are real threads and mutexes real pthread mutexes, so the save
+ * task, the workers and the locks run concurrently as on the device.
+ */
+
+#include "esp_err.h"
+#include "esp_heap_caps.h"
+#include "esp_partition.h"
+#include "esp_rom_crc.h"
+#include "esp_system.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/event_groups.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+#include "lvgl.h"
+#include <errno.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+// ====================================================================================
+// ERRORS, CRC, HEAP
+// ====================================================================================
+
+const char *esp_err_to_name(esp_err_t code) {
+  switch (code) {
+  case ESP_OK:
+    return "ESP_OK";
+  case ESP_FAIL:
+    return "ESP_FAIL";
+  case ESP_ERR_NO_MEM:
+    return "ESP_ERR_NO_MEM";
+  case ESP_ERR_INVALID_STATE:
+    return "ESP_ERR_INVALID_STATE";
+  case ESP_ERR_NOT_FOUND:
+    return "ESP_ERR_NOT_FOUND";
+  case ESP_ERR_NOT_SUPPORTED:
+    return "ESP_ERR_NOT_SUPPORTED";
+  case ESP_ERR_INVALID_CRC:
+    return "ESP_ERR_INVALID_CRC";
+  default:
+    return "ESP_ERR";
+  }
+}
+
+uint32_t esp_rom_crc32_le(uint32_t crc, uint8_t const *buf, uint32_t len) {
+  crc = ~crc;
+  for (uint32_t i = 0; i < len; i++) {
+    crc ^= buf[i];
+    for (int k = 0; k < 8; k++)
+      crc = (crc >> 1) ^ (0xEDB88320u & -(crc & 1));
+  }
+  return ~crc;
+}
+
+void *heap_caps_malloc(size_t size, uint32_t caps) { return malloc(size); }
+
+void *heap_caps_calloc(size_t n, size_t size, uint32_t caps) {
+  return calloc(n, size);
+}
+
+void *heap_caps_realloc(void *ptr, size_t size, uint32_t caps) {
+  return realloc(ptr, size);
+}
+
+void *heap_caps_aligned_alloc(size_t alignment, size_t size, uint32_t caps) {
+  return aligned_alloc(alignment, (size + alignment - 1) / alignment *
+                                      alignment);
+}
+
+void *heap_caps_malloc_prefer(size_t size, size_t num, ...) {
+  return malloc(size);
+}
+
+void *heap_caps_calloc_prefer(size_t n, size_t size, size_t num, ...) {
+  return calloc(n, size);
+}
+
+void *heap_caps_realloc_prefer(void *ptr, size_t size, size_t num, ...) {
+  return realloc(ptr, size);
+}
+
+void heap_caps_free(void *ptr) { free(ptr); }
+
+lv_color_t lv_color_hex(uint32_t c) {
+  return (lv_color_t){.blue = c & 0xff, .green = (c >> 8) & 0xff,
+                      .red = (c >> 16) & 0xff};
+}
+
+// ====================================================================================
+// MUTEXES
+// ====================================================================================
+
+static SemaphoreHandle_t mutex_create(int type) {
+  pthread_mutex_t *m = malloc(sizeof(*m));
+  pthread_mutexattr_t attr;
+  pthread_mutexattr_init(&attr);
+  pthread_mutexattr_settype(&attr, type);
+  pthread_mutex_init(m, &attr);
+  pthread_mutexattr_destroy(&attr);
+  return m;
+}
+
+SemaphoreHandle_t xSemaphoreCreateMutex(void) {
+  return mutex_create(PTHREAD_MUTEX_NORMAL);
+}
+
+SemaphoreHandle_t xSemaphoreCreateRecursiveMutex(void) {
+  return mutex_create(PTHREAD_MUTEX_RECURSIVE);
+}
+
+BaseType_t xSemaphoreTake(SemaphoreHandle_t sem, TickType_t ticks) {
+  if (ticks == 0)
+    return pthread_mutex_trylock(sem) == 0 ? pdTRUE : pdFALSE;
+  pthread_mutex_lock(sem); // Every caller in main/data waits forever
+  return pdTRUE;
+}
+
+BaseType_t xSemaphoreGive(SemaphoreHandle_t sem) {
+  pthread_mutex_unlock(sem);
+  return pdTRUE;
+}
+
+BaseType_t xSemaphoreTakeRecursive(SemaphoreHandle_t sem, TickType_t ticks) {
+  return xSemaphoreTake(sem, ticks);
+}
+
+BaseType_t xSemaphoreGiveRecursive(SemaphoreHandle_t sem) {
+  return xSemaphoreGive(sem);
+}
+
+// ====================================================================================
+// TASKS
+// ====================================================================================
+
+struct host_task {
+  TaskFunction_t fn;
+  void *arg;
+  pthread_mutex_t lock;
+  pthread_cond_t cond;
+  uint32_t notified; // Pending xTaskNotifyGive() count
+};
+
+static __thread struct host_task *current;
+static __thread struct host_task thread_self; // For plain pthreads
+
+static void *task_main(void *arg) {
+  current = arg;
+  current->fn(current->arg);
+  return NULL;
+}
+
+BaseType_t xTaskCreate(TaskFunction_t fn, const char *name, uint32_t stack,
+                       void *arg, UBaseType_t priority, TaskHandle_t *out) {
+  struct host_task *t = calloc(1, sizeof(*t));
+  t->fn = fn;
+  t->arg = arg;
+  pthread_mutex_init(&t->lock, NULL);
+  pthread_cond_init(&t->cond, NULL);
+  pthread_t thread;
+  if (pthread_create(&thread, NULL, task_main, t) != 0) {
+    free(t);
+    return pdFALSE;
+  }
+  pthread_detach(thread);
+  if (out)
+    *out = t;
+  return pdPASS;
+}
+
+void vTaskDelete(TaskHandle_t task) {
+  // Workers end themselves; the handle may still be notified, so keep it
+  pthread_exit(NULL);
+}
+
+void vTaskDelay(TickType_t ticks) { usleep((useconds_t)ticks * 1000); }
+
+TickType_t xTaskGetTickCount(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (TickType_t)(ts.tv_sec * 1000 + ts.tv_nsec / 1000000);
+}
+
+BaseType_t xTaskNotifyGive(TaskHandle_t task) {
+  pthread_mutex_lock(&task->lock);
+  task->notified++;
+  pthread_cond_signal(&task->cond);
+  pthread_mutex_unlock(&task->lock);
+  return pdPASS;
+}
+
+uint32_t ulTaskNotifyTake(BaseType_t clear, TickType_t ticks) {
+  struct host_task *t = current;
+  struct timespec until;
+  clock_gettime(CLOCK_REALTIME, &until);
+  until.tv_sec += ticks / 1000;
+  until.tv_nsec += (long)(ticks % 1000) * 1000000;
+  if (until.tv_nsec >= 1000000000) {
+    until.tv_sec++;
+    until.tv_nsec -= 1000000000;
+  }
+
+  pthread_mutex_lock(&t->lock);
+  while (t->notified == 0) {
+    int ret = ticks == portMAX_DELAY
+                  ? pthread_cond_wait(&t->cond, &t->lock)
+                  : pthread_cond_timedwait(&t->cond, &t->lock, &until);
+    if (ret == ETIMEDOUT)
+      break;
+  }
+  uint32_t value = t->notified;
+  if (value)
+    t->notified = clear ? 0 : value - 1;
+  pthread_mutex_unlock(&t->lock);
+  return value;
+}
+
+TaskHandle_t xTaskGetCurrentTaskHandle(void) {
+  return current ? current : &thread_self;
+}
+
+// ====================================================================================
+// EVENT GROUPS
+// ====================================================================================
+
+struct host_event_group {
+  pthread_mutex_t lock;
+  pthread_cond_t cond;
+  EventBits_t bits;
+};
+
+EventGroupHandle_t xEventGroupCreate(void) {
+  struct host_event_group *g = calloc(1, sizeof(*g));
+  if (g) {
+    pthread_mutex_init(&g->lock, NULL);
+    pthread_cond_init(&g->cond, NULL);
+  }
+  return g;
+}
+
+EventBits_t xEventGroupSetBits(EventGroupHandle_t g, EventBits_t bits) {
+  pthread_mutex_lock(&g->lock);
+  g->bits |= bits;
+  EventBits_t now = g->bits;
+  pthread_cond_broadcast(&g->cond);
+  pthread_mutex_unlock(&g->lock);
+  return now;
+}
+
+EventBits_t xEventGroupClearBits(EventGroupHandle_t g, EventBits_t bits) {
+  pthread_mutex_lock(&g->lock);
+  EventBits_t before = g->bits;
+  g->bits &= ~bits;
+  pthread_mutex_unlock(&g->lock);
+  return before;
+}
+
+EventBits_t xEventGroupGetBits(EventGroupHandle_t g) {
+  pthread_mutex_lock(&g->lock);
+  EventBits_t bits = g->bits;
+  pthread_mutex_unlock(&g->lock);
+  return bits;
+}
+
+// Every caller in main/data waits forever
+EventBits_t xEventGroupWaitBits(EventGroupHandle_t g, EventBits_t bits,
+                                BaseType_t clear, BaseType_t all,
+                                TickType_t ticks) {
+  pthread_mutex_lock(&g->lock);
+  while (all ? (g->bits & bits) != bits : (g->bits & bits) == 0)
+    pthread_cond_wait(&g->cond, &g->lock);
+  EventBits_t now = g->bits;
+  if (clear)
+    g->bits &= ~bits;
+  pthread_mutex_unlock(&g->lock);
+  return now;
+}
+
+// ====================================================================================
+// TIMERS, FLASH, SHUTDOWN
+// ====================================================================================
+// Alert timers never fire: tests read the alert state directly. There is no
+// preview partition, so every boot takes the SD card path. Nothing restarts,
+// so shutdown handlers never run: tests call db_flush() themselves.
+
+esp_err_t esp_register_shutdown_handler(shutdown_handler_t handle) {
+  return ESP_OK;
+}
+
+struct esp_timer {
+  esp_timer_create_args_t args;
+};
+
+esp_err_t esp_timer_create(const esp_timer_create_args_t *args,
+                           esp_timer_handle_t *out) {
+  *out = calloc(1, sizeof(**out));
+  (*out)->args = *args;
+  return ESP_OK;
+}
+
+esp_err_t esp_timer_start_once(esp_timer_handle_t timer, uint64_t us) {
+  return ESP_OK;
+}
+
+esp_err_t esp_timer_stop(esp_timer_handle_t timer) { return ESP_OK; }
+
+const esp_partition_t *esp_partition_find_first(esp_partition_type_t type,
+                                                esp_partition_subtype_t sub,
+                                                const char *label) {
+  return NULL;
+}
+
+esp_err_t esp_partition_mmap(const esp_partition_t *p, size_t offset,
+                             size_t size, esp_partition_mmap_memory_t memory,
+                             const void **out, esp_partition_mmap_handle_t *h) {
+  return ESP_ERR_NOT_SUPPORTED;
+}
+
+void esp_partition_munmap(esp_partition_mmap_handle_t h) {}
+
+esp_err_t esp_partition_erase_range(const esp_partition_t *p, size_t offset,
+                                    size_t size) {
+  return ESP_ERR_NOT_SUPPORTED;
+}
+
+esp_err_t esp_partition_write(const esp_partition_t *p, size_t offset,
+                              const void *src, size_t size) {
+  return ESP_ERR_NOT_SUPPORTED;
+}
+
+esp_err_t esp_partition_read(const esp_partition_t *p, size_t offset,
+                             void *dst, size_t size) {
+  return ESP_ERR_NOT_SUPPORTED;
+}
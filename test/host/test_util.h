@@ -0,0 +1,59 @@
+/**
+ * @file test_util.h
+ * @brief Checks and SD card helpers shared by the host tests
+ */
+
+#ifndef TEST_UTIL_H
+#define TEST_UTIL_H
+
+#define _XOPEN_SOURCE 700
+#include <ftw.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+static int test_failures;
+
+// Record a failure and go on, so one run reports every broken expectation
+#define CHECK(cond)                                                            \
+  do {                                                                         \
+    if (!(cond)) {                                                             \
+      fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #cond); \
+      test_failures++;                                                         \
+    }                                                                          \
+  } while (0)
+
+#define CHECK_EQ(a, b)                                                         \
+  do {                                                                         \
+    long long a_ = (long long)(a), b_ = (long long)(b);                        \
+    if (a_ != b_) {                                                            \
+      fprintf(stderr, "%s:%d: %s == %lld, expected %s == %lld\n", __FILE__,    \
+              __LINE__, #a, a_, #b, b_);                                       \
+      test_failures++;                                                         \
+    }                                                                          \
+  } while (0)
+
+static int test_unlink(const char *path, const struct stat *st, int flag,
+                       struct FTW *ftw) {
+  return ftw->level > 0 ? remove(path) : 0;
+}
+
+// Empty the card (the SD_ROOT directory), creating it if needed
+static inline void test_sd_reset(void) {
+  mkdir(SD_ROOT, 0775);
+  nftw(SD_ROOT, test_unlink, 16, FTW_DEPTH | FTW_PHYS);
+}
+
+static inline long test_file_size(const char *path) {
+  struct stat st;
+  return stat(path, &st) == 0 ? (long)st.st_size : -1;
+}
+
+static inline int test_result(const char *name) {
+  if (test_failures)
+    fprintf(stderr, "%s: %d check(s) failed\n", name, test_failures);
+  return test_failures ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+
+#endif // TEST_UTIL_H
@@ -0,0 +1,47 @@
+/**
+ * @file cJSON.h
+ * @brief Host stand-in for the part of cJSON the importer uses
+ */
+
+#ifndef HOST_CJSON_H
+#define HOST_CJSON_H
+
+#include <stddef.h>
+
+typedef int cJSON_bool;
+
+#define cJSON_Invalid 0
+#define cJSON_False (1 << 0)
+#define cJSON_True (1 << 1)
+#define cJSON_NULL (1 << 2)
+#define cJSON_Number (1 << 3)
+#define cJSON_String (1 << 4)
+#define cJSON_Array (1 << 5)
+#define cJSON_Object (1 << 6)
+
+typedef struct cJSON {
+  struct cJSON *next;
+  struct cJSON *prev;
+  struct cJSON *child;
+  int type;
+  char *valuestring;
+  int valueint;
+  double valuedouble;
+  char *string; // Key, for members of an object
+} cJSON;
+
+#define cJSON_ArrayForEach(element, array)                                     \
+  for (element = (array) != NULL ? (array)->child : NULL; element != NULL;     \
+       element = element->next)
+
+cJSON *cJSON_ParseWithLength(const char *value, size_t length);
+void cJSON_Delete(cJSON *item);
+
+cJSON_bool cJSON_IsObject(const cJSON *item);
+cJSON_bool cJSON_IsString(const cJSON *item);
+cJSON_bool cJSON_IsNumber(const cJSON *item);
+cJSON_bool cJSON_IsBool(const cJSON *item);
+cJSON_bool cJSON_IsTrue(const cJSON *item);
+cJSON_bool cJSON_IsNull(const cJSON *item);
+
+#endif // HOST_CJSON_H
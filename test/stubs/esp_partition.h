@@ -0,0 +1,55 @@
+/**
+ * @file esp_partition.h
+ * @brief Host stand-in for the partition API: no partition is ever found,
+ *        so the boot preview is off
+ */
+
+#ifndef HOST_ESP_PARTITION_H
+#define HOST_ESP_PARTITION_H
+
+#include "esp_err.h"
+#include <stddef.h>
+#include <stdint.h>
+
+typedef enum {
+  ESP_PARTITION_TYPE_APP = 0,
+  ESP_PARTITION_TYPE_DATA = 1,
+} esp_partition_type_t;
+
+typedef enum {
+  ESP_PARTITION_SUBTYPE_DATA_UNDEFINED = 0x06,
+  ESP_PARTITION_SUBTYPE_DATA_SPIFFS = 0x82,
+  ESP_PARTITION_SUBTYPE_ANY = 0xff,
+} esp_partition_subtype_t;
+
+typedef enum {
+  ESP_PARTITION_MMAP_DATA,
+  ESP_PARTITION_MMAP_INST,
+} esp_partition_mmap_memory_t;
+
+typedef struct {
+  esp_partition_type_t type;
+  esp_partition_subtype_t subtype;
+  uint32_t address;
+  uint32_t size;
+  uint32_t erase_size;
+  char label[17];
+} esp_partition_t;
+
+typedef uint32_t esp_partition_mmap_handle_t;
+
+const esp_partition_t *esp_partition_find_first(esp_partition_type_t type,
+                                                esp_partition_subtype_t sub,
+                                                const char *label);
+esp_err_t esp_partition_mmap(const esp_partition_t *p, size_t offset,
+                             size_t size, esp_partition_mmap_memory_t memory,
+                             const void **out, esp_partition_mmap_handle_t *h);
+void esp_partition_munmap(esp_partition_mmap_handle_t h);
+esp_err_t esp_partition_erase_range(const esp_partition_t *p, size_t offset,
+                                    size_t size);
+esp_err_t esp_partition_write(const esp_partition_t *p, size_t offset,
+                              const void *src, size_t size);
+esp_err_t esp_partition_read(const esp_partition_t *p, size_t offset,
+                             void *dst, size_t size);
+
+#endif // HOST_ESP_PARTITION_H
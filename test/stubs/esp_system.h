@@ -0,0 +1,15 @@
+/**
+ * @file esp_system.h
+ * @brief Host stand-in for the shutdown hooks: registered, never run
+ */
+
+#ifndef HOST_ESP_SYSTEM_H
+#define HOST_ESP_SYSTEM_H
+
+#include "esp_err.h"
+
+typedef void (*shutdown_handler_t)(void);
+
+esp_err_t esp_register_shutdown_handler(shutdown_handler_t handle);
+
+#endif // HOST_ESP_SYSTEM_H
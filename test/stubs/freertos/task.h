@@ -0,0 +1,25 @@
+/**
+ * @file task.h
+ * @brief Host stand-in for FreeRTOS tasks, on pthreads; priorities and stack
+ *        sizes are ignored
+ */
+
+#ifndef HOST_TASK_H
+#define HOST_TASK_H
+
+#include "FreeRTOS.h"
+
+typedef struct host_task *TaskHandle_t;
+typedef void (*TaskFunction_t)(void *arg);
+
+BaseType_t xTaskCreate(TaskFunction_t fn, const char *name, uint32_t stack,
+                       void *arg, UBaseType_t priority, TaskHandle_t *out);
+void vTaskDelete(TaskHandle_t task); // NULL only: ends the calling task
+void vTaskDelay(TickType_t ticks);
+TickType_t xTaskGetTickCount(void);
+BaseType_t xTaskNotifyGive(TaskHandle_t task);
+uint32_t ulTaskNotifyTake(BaseType_t clear, TickType_t ticks);
+// Threads not made by xTaskCreate() get a handle of their own too
+TaskHandle_t xTaskGetCurrentTaskHandle(void);
+
+#endif // HOST_TASK_H
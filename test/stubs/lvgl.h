@@ -0,0 +1,19 @@
+/**
+ * @file lvgl.h
+ * @brief Host stand-in for the LVGL colour type, for ui_theme.h
+ */
+
+#ifndef HOST_LVGL_H
+#define HOST_LVGL_H
+
+#include <stdint.h>
+
+typedef struct {
+  uint8_t blue;
+  uint8_t green;
+  uint8_t red;
+} lv_color_t;
+
+lv_color_t lv_color_hex(uint32_t c);
+
+#endif // HOST_LVGL_H
@@ -0,0 +1,15 @@
+/**
+ * @file sdkconfig.h
+ * @brief Kconfig defaults of the options main/data reads (Kconfig.projbuild)
+ */
+
+#ifndef HOST_SDKCONFIG_H
+#define HOST_SDKCONFIG_H
+
+#define CONFIG_APP_FEED_DAYS_SNAKE 7
+#define CONFIG_APP_FEED_DAYS_LIZARD 3
+#define CONFIG_APP_FEED_DAYS_TURTLE 3
+#define CONFIG_APP_FEED_DAYS_OTHER 3
+#define CONFIG_APP_PREY_REORDER_DAYS 14
+
+#endif // HOST_SDKCONFIG_H
@@ -0,0 +1,223 @@
+/**
+ * @file test_audit.c
+ * @brief audit_append() queues without writing, audit_flush() keeps the
+ *        chain; altered, removed, reordered and cut entries are found, from
+ *        the checkpoint or on the check task
+ */
+
+#include "test_util.h"
+
+#include "audit_log.h"
+#include "freertos/task.h"
+
+#define ENTRIES 200 // Several times the initial queue
+#define SMALL 20    // Entries of the tamper cases
+
+static void append(int n) {
+  for (int i = 0; i < n; i++) {
+    char before[16], after[16];
+    snprintf(before, sizeof(before), "%d", i);
+    snprintf(after, sizeof(after), "%d", i + 1);
+    CHECK(audit_append(i, 1, before, after) == ESP_OK);
+  }
+}
+
+static void setup(int n) {
+  test_sd_reset();
+  CHECK(audit_open() == ESP_OK);
+  append(n);
+  CHECK(audit_flush() == ESP_OK);
+  CHECK_EQ(audit_count(), n);
+}
+
+// The whole log, `*n` entries
+static audit_entry_t *load_log(int *n) {
+  long len = test_file_size(AUDIT_FILE_PATH);
+  CHECK(len > 0 && len % sizeof(audit_entry_t) == 0);
+  *n = (int)(len / sizeof(audit_entry_t));
+  audit_entry_t *log = malloc(len);
+  FILE *f = fopen(AUDIT_FILE_PATH, "rb");
+  CHECK(log && f && fread(log, sizeof(*log), *n, f) == (size_t)*n);
+  if (f)
+    fclose(f);
+  return log;
+}
+
+static void save_log(const audit_entry_t *log, int n) {
+  FILE *f = fopen(AUDIT_FILE_PATH, "wb");
+  CHECK(f && fwrite(log, sizeof(*log), n, f) == (size_t)n);
+  if (f)
+    fclose(f);
+}
+
+static void check_broken(bool full, uint32_t entries, uint32_t first_bad) {
+  audit_status_t status;
+  CHECK(audit_verify(full, &status) == ESP_ERR_INVALID_CRC);
+  CHECK_EQ(status.state, AUDIT_BROKEN);
+  CHECK_EQ(status.entries, entries);
+  CHECK_EQ(status.first_bad, first_bad);
+}
+
+static void check_intact(bool full, uint32_t entries) {
+  audit_status_t status;
+  CHECK(audit_verify(full, &status) == ESP_OK);
+  CHECK_EQ(status.state, AUDIT_INTACT);
+  CHECK_EQ(status.entries, entries);
+}
+
+static void test_queue(void) {
+  test_sd_reset();
+  CHECK(audit_open() == ESP_OK);
+  append(ENTRIES);
+  CHECK_EQ(audit_count(), 0);
+  CHECK(test_file_size(AUDIT_FILE_PATH) <= 0);
+
+  CHECK(audit_flush() == ESP_OK);
+  CHECK_EQ(audit_count(), ENTRIES);
+  CHECK_EQ(test_file_size(AUDIT_FILE_PATH),
+           (long)ENTRIES * sizeof(audit_entry_t));
+  check_intact(true, ENTRIES);
+
+  // Entries queued after a flush chain on from the last one written
+  CHECK(audit_append(0, 1, "a", "b") == ESP_OK);
+  CHECK(audit_flush() == ESP_OK);
+  CHECK(audit_open() == ESP_OK);
+  check_intact(true, ENTRIES + 1);
+}
+
+// Each change is found at the first entry it touches, whatever the order
+// of the bytes after it
+static void test_tamper(void) {
+  setup(SMALL);
+  int n;
+  audit_entry_t *log = load_log(&n), *copy = malloc(n * sizeof(*log));
+  CHECK(copy != NULL);
+
+  // One value rewritten
+  memcpy(copy, log, n * sizeof(*log));
+  copy[7].after[0] ^= 1;
+  save_log(copy, n);
+  check_broken(true, SMALL, 7);
+  CHECK(audit_open() == ESP_ERR_INVALID_CRC);
+
+  // One entry removed
+  memcpy(copy, log, 7 * sizeof(*log));
+  memcpy(copy + 7, log + 8, (n - 8) * sizeof(*log));
+  save_log(copy, n - 1);
+  check_broken(true, SMALL - 1, 7);
+
+  // Two entries swapped
+  memcpy(copy, log, n * sizeof(*log));
+  copy[7] = log[8];
+  copy[8] = log[7];
+  save_log(copy, n);
+  check_broken(true, SMALL, 7);
+
+  // The last hash, with nothing after it
+  memcpy(copy, log, n * sizeof(*log));
+  copy[n - 1].hash[0] ^= 1;
+  save_log(copy, n);
+  check_broken(true, SMALL, SMALL - 1);
+
+  save_log(log, n);
+  check_intact(true, SMALL);
+  free(copy);
+  free(log);
+}
+
+// The boot check reads from livre_police.chk on; a log cut below it is
+// truncated, even for a full check
+static void test_checkpoint(void) {
+  setup(SMALL);
+  check_intact(false, SMALL);
+  CHECK(test_file_size(AUDIT_CHECKPOINT_PATH) > 0);
+  append(10);
+  CHECK(audit_flush() == ESP_OK);
+  int n;
+  audit_entry_t *log = load_log(&n);
+  CHECK_EQ(n, SMALL + 10);
+
+  // An entry under the checkpoint is not read again, one above it is
+  log[5].after[0] ^= 1;
+  save_log(log, n);
+  check_intact(false, SMALL + 10); // Checkpoint now at SMALL + 10
+  log[5].after[0] ^= 1;
+  save_log(log, n);
+  free(log);
+  append(5);
+  CHECK(audit_flush() == ESP_OK);
+  log = load_log(&n);
+  log[SMALL + 12].before[0] ^= 1;
+  save_log(log, n);
+  check_broken(false, n, SMALL + 12);
+  log[SMALL + 12].before[0] ^= 1;
+  save_log(log, n);
+  check_intact(true, n);
+
+  // Cut below the checkpoint
+  save_log(log, 12);
+  audit_status_t status;
+  CHECK(audit_verify(false, &status) == ESP_ERR_INVALID_CRC);
+  CHECK_EQ(status.state, AUDIT_BROKEN);
+  CHECK(status.truncated);
+  CHECK_EQ(status.entries, 12);
+  CHECK_EQ(status.first_bad, 12);
+  CHECK(audit_verify(true, &status) == ESP_ERR_INVALID_CRC);
+  CHECK(status.truncated);
+  CHECK(audit_open() == ESP_ERR_INVALID_CRC);
+
+  // The log is gone altogether
+  remove(AUDIT_FILE_PATH);
+  CHECK(audit_verify(false, &status) == ESP_ERR_INVALID_CRC);
+  CHECK(status.truncated);
+  CHECK_EQ(status.entries, 0);
+  free(log);
+}
+
+static audit_check_t wait_check(audit_status_t *status) {
+  audit_check_t state;
+  for (int i = 0; i < 5000; i++) {
+    if ((state = audit_verify_progress(status)) != AUDIT_CHECK_RUNNING)
+      return state;
+    vTaskDelay(1);
+  }
+  return state;
+}
+
+// audit_verify_start(): the conformity page's full check
+static void test_worker(void) {
+  setup(ENTRIES);
+  audit_status_t status;
+  CHECK(audit_verify_start(true) == ESP_OK);
+  CHECK_EQ(wait_check(&status), AUDIT_CHECK_DONE);
+  CHECK_EQ(status.state, AUDIT_INTACT);
+  CHECK_EQ(status.entries, ENTRIES);
+
+  int n;
+  audit_entry_t *log = load_log(&n);
+  log[3].animal_id++;
+  save_log(log, n);
+  CHECK(audit_verify_start(true) == ESP_OK);
+  CHECK_EQ(wait_check(&status), AUDIT_CHECK_DONE);
+  CHECK_EQ(status.state, AUDIT_BROKEN);
+  CHECK_EQ(status.first_bad, 3);
+  CHECK(!status.truncated);
+  free(log);
+}
+
+int main(int argc, char **argv) {
+  const char *which = argc > 1 ? argv[1] : "";
+  if (strcmp(which, "queue") == 0) {
+    test_queue();
+  } else if (strcmp(which, "tamper") == 0) {
+    test_tamper();
+  } else if (strcmp(which, "checkpoint") == 0) {
+    test_checkpoint();
+  } else if (strcmp(which, "worker") == 0) {
+    test_worker();
+  } else {
+    fprintf(stderr, "usage: %s queue|tamper|checkpoint|worker\n", argv[0]);
+    return EXIT_FAILURE;
+  }
+  return test_result(argv[0]);
+}
@@ -0,0 +1,117 @@
+/**
+ * @file test_ids.c
+ * @brief Reptile ids are never reused; UUIDs are valid and unique
+ */
+
+#include "test_util.h"
+
+#include <stdlib.h>
+
+#include "database.h"
+#include "uuid_gen.h"
+
+#define UUIDS 100000
+
+static void add_reptiles(int count) {
+  for (int i = 0; i < count; i++) {
+    reptile_t r = {.active = true};
+    snprintf(r.name, sizeof(r.name), "R%d", i);
+    db_update_reptile(-1, &r);
+  }
+}
+
+static bool uuid_valid(const char *u) {
+  if (strlen(u) != UUID_STR_LEN - 1 || u[14] != '4' || !strchr("89ab", u[19]))
+    return false;
+  for (int i = 0; i < UUID_STR_LEN - 1; i++)
+    if (i == 8 || i == 13 || i == 18 || i == 23 ? u[i] != '-'
+                                                : !strchr("0123456789abcdef",
+                                                          u[i]))
+      return false;
+  return true;
+}
+
+// Every record has a valid UUID that finds it, and an id of its own
+static void check_records(void) {
+  int n = db_get_reptile_count();
+  for (int i = 0; i < n; i++) {
+    reptile_t r;
+    CHECK(db_read_reptile(i, &r));
+    CHECK(uuid_valid(r.uuid));
+    CHECK_EQ(db_find_reptile_by_uuid(r.uuid), i);
+    CHECK_EQ(db_find_reptile_by_id(r.id), i);
+  }
+}
+
+static uint32_t id_at(int index) {
+  reptile_t r;
+  CHECK(db_read_reptile(index, &r));
+  return r.id;
+}
+
+// The demo animals plus 125 records, truncated back to 100: the next id
+// follows the highest one ever given, not the highest one left
+static void test_write(void) {
+  test_sd_reset();
+  db_init();
+  db_load_data(); // Empty card: demo data
+  add_reptiles(125);
+  check_records();
+  int top = db_get_reptile_next_id() - 1;
+  CHECK_EQ(id_at(db_get_reptile_count() - 1), top);
+
+  db_set_reptile_count(100);
+  CHECK_EQ(db_get_reptile_next_id(), top + 1);
+  add_reptiles(1);
+  CHECK_EQ(id_at(100), top + 1);
+  check_records();
+  db_save_data();
+  CHECK(db_flush() == ESP_OK);
+}
+
+// The allocator comes back from the snapshot
+static void test_load(void) {
+  db_init();
+  db_load_data();
+  CHECK_EQ(db_get_reptile_count(), 101);
+  check_records();
+  uint32_t last = id_at(100);
+  CHECK(last > 100);
+  add_reptiles(1);
+  CHECK_EQ(id_at(101), last + 1);
+}
+
+static int compare_uuid(const void *a, const void *b) { return strcmp(a, b); }
+
+static void test_uuid(void) {
+  char(*u)[UUID_STR_LEN] = malloc(UUIDS * sizeof(*u));
+  CHECK(u != NULL);
+  if (u == NULL)
+    return;
+  for (int i = 0; i < UUIDS; i++)
+    uuid_v4(u[i]);
+  int bad = 0, duplicates = 0;
+  for (int i = 0; i < UUIDS; i++)
+    bad += !uuid_valid(u[i]);
+  qsort(u, UUIDS, sizeof(*u), compare_uuid);
+  for (int i = 1; i < UUIDS; i++)
+    duplicates += strcmp(u[i], u[i - 1]) == 0;
+  CHECK_EQ(bad, 0);
+  CHECK_EQ(duplicates, 0);
+  free(u);
+}
+
+int main(int argc, char **argv) {
+  const char *which = argc > 1 ? argv[1] : "";
+  if (strcmp(which, "write") == 0) {
+    test_write();
+  } else if (strcmp(which, "load") == 0) {
+    test_load();
+  } else if (strcmp(which, "uuid") == 0) {
+    test_uuid();
+  } else {
+    fprintf(stderr, "usage: %s write|load|uuid\n", argv[0]);
+    return EXIT_FAILURE;
+  }
+  return test_result(argv[0]);
+}
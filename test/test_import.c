@@ -0,0 +1,237 @@
+/**
+ * @file test_import.c
+ * @brief CSV and JSON import: quoting across chunks, separators, BOM,
+ *        duplicates and a full registre
+ */
+
+#include "test_util.h"
+
+#include "database.h"
+#include "importer.h"
+
+#define CSV_PATH SD_ROOT "/import.csv"
+#define JSON_PATH SD_ROOT "/import.json"
+
+static void write_file(const char *path, const char *data, size_t len) {
+  FILE *f = fopen(path, "wb");
+  CHECK(f != NULL);
+  if (f) {
+    CHECK_EQ(fwrite(data, 1, len, f), len);
+    fclose(f);
+  }
+}
+
+static esp_err_t import_text(const char *path, const char *text,
+                             import_result_t *res) {
+  write_file(path, text, strlen(text));
+  return import_file(path, res);
+}
+
+// The record with microchip `chip`, zeroed if there is none
+static reptile_t by_chip(const char *chip) {
+  reptile_t r = {0};
+  int index = db_find_reptile_by_microchip(chip);
+  CHECK(index >= 0);
+  if (index >= 0)
+    CHECK(db_read_reptile(index, &r));
+  return r;
+}
+
+static void setup(void) {
+  test_sd_reset();
+  db_init();
+  db_load_data(); // Empty card: demo data
+}
+
+// A quoted field with "" pairs, a separator and a line break, read with the
+// chunk boundary at every byte of its row: blank lines, which are skipped,
+// move the row along
+static void test_chunks(void) {
+  static const char header[] = "Nom,Identification,Destinataire_Adresse\n";
+  static const char address[] = "12 \"Les Iguanes\", bât. B\nParis";
+  char row[160], *file = malloc(2 * IMPORT_CHUNK_BYTES);
+  CHECK(file != NULL);
+  setup();
+  // Chips of a fixed width, so the rows are as long at every k
+  for (int k = 0, len = 1; k <= len; k++) {
+    char chip[2][20];
+    snprintf(chip[0], sizeof(chip[0]), "2502690000%05d", k);
+    snprintf(chip[1], sizeof(chip[1]), "2502690001%05d", k);
+    len = snprintf(row, sizeof(row),
+                   "Rex,%s,\"12 \"\"Les Iguanes\"\", bât. B\nParis\"\r\n"
+                   "Max,\"%s\",\"\"\r\n",
+                   chip[0], chip[1]);
+    size_t pad = IMPORT_CHUNK_BYTES - strlen(header) - k;
+    strcpy(file, header);
+    memset(file + strlen(header), '\n', pad);
+    strcpy(file + strlen(header) + pad, row);
+
+    import_result_t res;
+    write_file(CSV_PATH, file, strlen(file));
+    CHECK(import_file(CSV_PATH, &res) == ESP_OK);
+    CHECK_EQ(res.rows, 2);
+    CHECK_EQ(res.imported, 2);
+    CHECK_EQ(res.rejected, 0);
+    reptile_t r = by_chip(chip[0]);
+    CHECK(strcmp(r.name, "Rex") == 0);
+    CHECK(strcmp(r.recipient_address, address) == 0);
+    r = by_chip(chip[1]);
+    CHECK(strcmp(r.name, "Max") == 0);
+    CHECK(r.recipient_address[0] == '\0');
+  }
+  free(file);
+}
+
+// A header with more ';' than ',' sets the separator; commas are then text
+static void test_semicolon(void) {
+  setup();
+  import_result_t res;
+  CHECK(import_text(CSV_PATH,
+                    "Nom;Identification;Destinataire_Adresse;Poids_Grammes\n"
+                    "Semi;250269000000100;1, rue Haute;350\n"
+                    "Colon;250269000000101;\"2; place Basse\";\n",
+                    &res) == ESP_OK);
+  CHECK_EQ(res.imported, 2);
+  reptile_t r = by_chip("250269000000100");
+  CHECK(strcmp(r.recipient_address, "1, rue Haute") == 0);
+  CHECK_EQ(r.weight_grams, 350);
+  r = by_chip("250269000000101");
+  CHECK(strcmp(r.recipient_address, "2; place Basse") == 0);
+}
+
+// A spreadsheet's UTF-8 BOM does not hide the first column name
+static void test_bom(void) {
+  setup();
+  import_result_t res;
+  CHECK(import_text(CSV_PATH,
+                    "\xEF\xBB\xBFNom,Identification\r\n"
+                    "Bom,250269000000200\r\n",
+                    &res) == ESP_OK);
+  CHECK_EQ(res.imported, 1);
+  CHECK(strcmp(by_chip("250269000000200").name, "Bom") == 0);
+}
+
+// Duplicates within one batch, by chip or UUID (in any case), and of the
+// registre; rows without either key are never duplicates
+static void test_dedupe(void) {
+  setup();
+  reptile_t demo;
+  CHECK(db_read_reptile(0, &demo));
+  CHECK(demo.microchip[0] != '\0');
+  char file[512];
+  snprintf(file, sizeof(file),
+           "Nom,Identification,UUID\n"
+           "A,250269000000300,\n"
+           "B,250269000000300,\n"
+           "C,,0f8e4c1a-2b3d-4e5f-8a9b-0c1d2e3f4a5b\n"
+           "D,,0F8E4C1A-2B3D-4E5F-8A9B-0C1D2E3F4A5B\n"
+           "E,,\n"
+           "F,,\n"
+           "G,%s,\n",
+           demo.microchip);
+  int before = db_get_reptile_count();
+  import_result_t res;
+  CHECK(import_text(CSV_PATH, file, &res) == ESP_OK);
+  CHECK_EQ(res.rows, 7);
+  CHECK_EQ(res.imported, 4);
+  CHECK_EQ(res.duplicates, 3);
+  CHECK_EQ(res.rejected, 0);
+  CHECK_EQ(db_get_reptile_count(), before + 4);
+  CHECK(strcmp(by_chip("250269000000300").name, "A") == 0);
+  int c = db_find_reptile_by_uuid("0f8e4c1a-2b3d-4e5f-8a9b-0c1d2e3f4a5b");
+  reptile_t r;
+  CHECK(c >= 0 && db_read_reptile(c, &r) && strcmp(r.name, "C") == 0);
+}
+
+// The registre fills up mid-batch: the rows before are kept, the row that
+// did not fit is the error and the import stops
+static void test_full(void) {
+  setup();
+  db_txn_begin();
+  while (db_get_reptile_count() < MAX_REPTILES - 2) {
+    reptile_t r = {.active = true};
+    snprintf(r.name, sizeof(r.name), "R%d", db_get_reptile_count());
+    db_update_reptile(-1, &r);
+  }
+  db_txn_commit();
+
+  import_result_t res;
+  CHECK(import_text(CSV_PATH,
+                    "Nom,Identification\n"
+                    "F1,250269000000500\n"
+                    "F2,250269000000501\n"
+                    "F3,250269000000502\n"
+                    "F4,250269000000503\n",
+                    &res) == ESP_ERR_NO_MEM);
+  CHECK_EQ(res.rows, 4);
+  CHECK_EQ(res.imported, 2);
+  CHECK_EQ(res.rejected, 1);
+  CHECK_EQ(res.first_error_row, 3);
+  CHECK(strcmp(res.first_error, "Registre plein") == 0);
+  CHECK_EQ(db_get_reptile_count(), MAX_REPTILES);
+  CHECK(strcmp(by_chip("250269000000501").name, "F2") == 0);
+  CHECK(db_find_reptile_by_microchip("250269000000502") < 0);
+}
+
+// An array of objects, then one object per line; numbers and booleans
+// stand for their CSV text, escapes and brackets inside strings are text
+static void test_json(void) {
+  setup();
+  import_result_t res;
+  CHECK(import_text(JSON_PATH,
+                    "[\n"
+                    " {\"Nom\": \"Json \\\"Kaa\\\" {1]\", \"Identification\": "
+                    "250269000000400, \"Poids_Grammes\": 420, \"Actif\": "
+                    "false, \"Sexe\": \"F\", \"Remarque\": null},\n"
+                    " {\"Nom\": \"Bad\", \"Sexe\": \"X\"},\n"
+                    " {\"Nom\": \"Caf\\u00e9\", \"Identification\": "
+                    "\"250269000000401\", \"Espece_Commune\": \"Python "
+                    "royal\"}\n"
+                    "]\n",
+                    &res) == ESP_OK);
+  CHECK_EQ(res.rows, 3);
+  CHECK_EQ(res.imported, 2);
+  CHECK_EQ(res.rejected, 1);
+  CHECK_EQ(res.first_error_row, 2);
+  CHECK(strcmp(res.first_error, "Sexe invalide") == 0);
+  reptile_t r = by_chip("250269000000400");
+  CHECK(strcmp(r.name, "Json \"Kaa\" {1]") == 0);
+  CHECK_EQ(r.weight_grams, 420);
+  CHECK(!r.active);
+  CHECK_EQ(r.sex, SEX_FEMALE);
+  r = by_chip("250269000000401");
+  char species[32];
+  CHECK(strcmp(r.name, "Caf\xC3\xA9") == 0);
+  CHECK(strcmp(db_string(r.species_common, species, sizeof(species)),
+               "Python royal") == 0);
+
+  CHECK(import_text(JSON_PATH,
+                    "{\"Nom\":\"Line1\",\"Identification\":\"250269000000402\"}"
+                    "\n{\"Nom\":\"Line2\",\"Identification\":"
+                    "\"250269000000403\"}\n",
+                    &res) == ESP_OK);
+  CHECK_EQ(res.imported, 2);
+  CHECK(strcmp(by_chip("250269000000403").name, "Line2") == 0);
+}
+
+int main(int argc, char **argv) {
+  const char *which = argc > 1 ? argv[1] : "";
+  if (strcmp(which, "chunks") == 0) {
+    test_chunks();
+  } else if (strcmp(which, "semicolon") == 0) {
+    test_semicolon();
+  } else if (strcmp(which, "bom") == 0) {
+    test_bom();
+  } else if (strcmp(which, "dedupe") == 0) {
+    test_dedupe();
+  } else if (strcmp(which, "full") == 0) {
+    test_full();
+  } else if (strcmp(which, "json") == 0) {
+    test_json();
+  } else {
+    fprintf(stderr, "usage: %s chunks|semicolon|bom|dedupe|full|json\n",
+            argv[0]);
+    return EXIT_FAILURE;
+  }
+  return test_result(argv[0]);
+}
@@ -0,0 +1,344 @@
+/**
+ * @file test_journal.c
+ * @brief Journal replay: torn tails, sequence gaps, snapshot fallback
+ */
+
+#include "test_util.h"
+
+#include <time.h>
+
+#include "database.h"
+#include "journal.h"
+#include "snapshot.h"
+
+#define RECORDS 24
+
+static uint8_t image[RECORDS * (sizeof(journal_rec_header_t) + 64)];
+static size_t ends[RECORDS]; // Byte offset just past each record
+
+static int applied;
+static int skipped; // Records the replay is expected to pass over first
+static uint32_t applied_seq[RECORDS];
+
+static void collect(journal_rec_type_t type, const void *payload,
+                    uint16_t length) {
+  // Record k carries k + 1 bytes of value k, as written by build_journal()
+  const uint8_t *p = payload;
+  CHECK_EQ(type, JOURNAL_REC_SHED);
+  CHECK_EQ(length, skipped + applied + 1);
+  for (uint16_t i = 0; i < length; i++)
+    CHECK_EQ(p[i], skipped + applied);
+  if (applied < RECORDS)
+    applied_seq[applied] = journal_last_seq() + 1;
+  applied++;
+}
+
+static void write_file(const char *path, const void *data, size_t len) {
+  FILE *f = fopen(path, "wb");
+  CHECK(f != NULL);
+  if (f) {
+    fwrite(data, 1, len, f);
+    fclose(f);
+  }
+}
+
+// Encode RECORDS records numbered from first_seq into `image`
+static size_t build_journal(uint32_t first_seq) {
+  journal_reset();
+  journal_replay(collect, first_seq - 1); // Sets the next seq
+  size_t len = 0;
+  for (int k = 0; k < RECORDS; k++) {
+    uint8_t payload[RECORDS];
+    memset(payload, k, sizeof(payload));
+    len += journal_encode(JOURNAL_REC_SHED, payload, k + 1, image + len,
+                          sizeof(image) - len);
+    ends[k] = len;
+  }
+  return len;
+}
+
+// A torn write may stop at any byte: replay applies the whole records before
+// the cut, truncates the rest, and the next append follows them cleanly
+static void test_truncation(void) {
+  size_t total = build_journal(1);
+  for (size_t cut = 0; cut <= total; cut++) {
+    int whole = 0;
+    while (whole < RECORDS && ends[whole] <= cut)
+      whole++;
+    size_t boundary = whole ? ends[whole - 1] : 0;
+
+    write_file(JOURNAL_FILE_PATH, image, cut);
+    applied = 0;
+    CHECK_EQ(journal_replay(collect, 0), whole);
+    CHECK_EQ(applied, whole);
+    CHECK_EQ(journal_last_seq(), whole);
+    CHECK_EQ(test_file_size(JOURNAL_FILE_PATH), boundary);
+    CHECK_EQ(journal_size(), boundary);
+
+    // Append the next record after the surviving ones and read them back
+    uint8_t rec[sizeof(journal_rec_header_t) + RECORDS];
+    uint8_t payload[RECORDS];
+    memset(payload, whole, sizeof(payload));
+    size_t n = journal_encode(JOURNAL_REC_SHED, payload, whole + 1, rec,
+                              sizeof(rec));
+    if (whole < RECORDS) {
+      CHECK(journal_write(rec, n) == ESP_OK);
+      applied = 0;
+      CHECK_EQ(journal_replay(collect, 0), whole + 1);
+    }
+  }
+
+  // A flipped byte ends replay at the damaged record
+  build_journal(1);
+  image[ends[9] + sizeof(journal_rec_header_t)] ^= 0x40;
+  write_file(JOURNAL_FILE_PATH, image, total);
+  applied = 0;
+  CHECK_EQ(journal_replay(collect, 0), 10);
+  CHECK_EQ(test_file_size(JOURNAL_FILE_PATH), ends[9]);
+}
+
+// Records the snapshot already holds are skipped; a journal that does not
+// continue the snapshot is set aside whole, nothing applied
+static void test_gap(void) {
+  size_t total = build_journal(11); // Records 11..34
+  write_file(JOURNAL_FILE_PATH, image, total);
+  applied = 0;
+  skipped = 4;
+  CHECK_EQ(journal_replay(collect, 14), RECORDS - 4);
+  CHECK_EQ(applied_seq[0], 15);
+  skipped = 0;
+  CHECK_EQ(journal_last_seq(), 10 + RECORDS);
+
+  write_file(JOURNAL_FILE_PATH, image, total);
+  remove(JOURNAL_KEPT_PATH);
+  applied = 0;
+  CHECK_EQ(journal_replay(collect, 7), 0); // 8..10 missing
+  CHECK_EQ(applied, 0);
+  CHECK_EQ(journal_last_seq(), 7);
+  CHECK_EQ(journal_size(), 0);
+  CHECK_EQ(test_file_size(JOURNAL_FILE_PATH), -1);
+  CHECK_EQ(test_file_size(JOURNAL_KEPT_PATH), total);
+
+  // New records start a fresh journal that follows the snapshot
+  uint8_t rec[64], payload[1] = {0};
+  size_t n = journal_encode(JOURNAL_REC_SHED, payload, 1, rec, sizeof(rec));
+  CHECK(journal_write(rec, n) == ESP_OK);
+  applied = 0;
+  CHECK_EQ(journal_replay(collect, 7), 1);
+  CHECK_EQ(applied_seq[0], 8);
+}
+
+static void rename_reptile(int index, const char *name) {
+  reptile_t r;
+  CHECK(db_read_reptile(index, &r));
+  strcpy(r.name, name);
+  db_update_reptile(index, &r);
+}
+
+static int add_reptile(const char *name) {
+  reptile_t r = {.active = true};
+  strcpy(r.name, name);
+  db_update_reptile(-1, &r);
+  return db_get_reptile_count() - 1;
+}
+
+// Snapshot generation 1 holds A, generation 2 adds B; the journal then
+// renames B. With generation 2 damaged, boot falls back to generation 1,
+// where the journal's patch of slot 4 would have made a nameless record.
+// Contents of a file, NULL if it does not exist
+static uint8_t *read_file(const char *path, long *len) {
+  *len = test_file_size(path);
+  uint8_t *data = *len >= 0 ? malloc(*len + 1) : NULL;
+  FILE *f = data ? fopen(path, "rb") : NULL;
+  CHECK(*len < 0 || f != NULL);
+  if (f) {
+    CHECK_EQ(fread(data, 1, *len, f), *len);
+    fclose(f);
+  }
+  return data;
+}
+
+static bool has_name(const char *name) {
+  for (int i = 0; i < db_get_reptile_count(); i++) {
+    reptile_t r;
+    if (db_read_reptile(i, &r) && strcmp(r.name, name) == 0)
+      return true;
+  }
+  return false;
+}
+
+// Boot with the live snapshot cut at every length: only the whole file
+// loads (with the journal on top); any shorter one falls back to the
+// previous generation, or to a fresh start when there is none
+static void check_snapshot_cuts(void) {
+  long live_len, prev_len, journal_len;
+  uint8_t *live = read_file(SNAPSHOT_FILE_PATH, &live_len);
+  uint8_t *prev = read_file(SNAPSHOT_PREV_PATH, &prev_len);
+  uint8_t *journal = read_file(JOURNAL_FILE_PATH, &journal_len);
+  CHECK(live && prev && journal);
+  if (!live || !prev || !journal)
+    return;
+
+  for (int with_prev = 1; with_prev >= 0; with_prev--) {
+    for (long cut = 0; cut <= live_len; cut++) {
+      remove(SNAPSHOT_TMP_PATH);
+      remove(SNAPSHOT_PREV_PATH);
+      remove(JOURNAL_KEPT_PATH);
+      write_file(SNAPSHOT_FILE_PATH, live, cut);
+      if (with_prev)
+        write_file(SNAPSHOT_PREV_PATH, prev, prev_len);
+      write_file(JOURNAL_FILE_PATH, journal, journal_len);
+      db_load_data();
+      CHECK(db_flush() == ESP_OK); // Settle before the files are replaced
+
+      int failures = test_failures;
+      if (cut == live_len) { // Generation 2 and the journal
+        CHECK_EQ(db_get_reptile_count(), 5);
+        CHECK(has_name("B2") && has_name("Renamed"));
+      } else if (with_prev) { // Generation 1, journal set aside
+        CHECK_EQ(db_get_reptile_count(), 4);
+        CHECK(has_name("A") && !has_name("B") && !has_name("Renamed"));
+      } else { // Nothing valid: the demo animals
+        CHECK_EQ(db_get_reptile_count(), 3);
+        CHECK(!has_name("A") && !has_name("Renamed"));
+      }
+      if (test_failures != failures) {
+        fprintf(stderr, "snapshot cut at %ld of %ld bytes, %s\n", cut,
+                live_len, with_prev ? "previous generation kept" : "alone");
+        break;
+      }
+    }
+  }
+
+  // Put the card back as it was
+  remove(SNAPSHOT_TMP_PATH);
+  remove(JOURNAL_KEPT_PATH);
+  write_file(SNAPSHOT_FILE_PATH, live, live_len);
+  write_file(SNAPSHOT_PREV_PATH, prev, prev_len);
+  write_file(JOURNAL_FILE_PATH, journal, journal_len);
+  free(live);
+  free(prev);
+  free(journal);
+}
+
+static void test_fallback_write(void) {
+  test_sd_reset();
+  db_init();
+  db_load_data(); // Empty card: demo data
+  CHECK_EQ(db_get_reptile_count(), 3);
+  add_reptile("A");
+  db_save_data();
+  CHECK(db_flush() == ESP_OK); // Generation 1
+  int b = add_reptile("B");
+  db_save_data();
+  CHECK(db_flush() == ESP_OK); // Generation 2, generation 1 kept as .old
+  rename_reptile(b, "B2");
+  rename_reptile(0, "Renamed");
+  CHECK(db_flush() == ESP_OK); // Journal only
+  CHECK(test_file_size(JOURNAL_FILE_PATH) > 0);
+  CHECK(test_file_size(SNAPSHOT_PREV_PATH) > 0);
+  check_snapshot_cuts();
+
+  // Damage the live file past its header
+  FILE *f = fopen(SNAPSHOT_FILE_PATH, "r+b");
+  CHECK(f != NULL);
+  if (f) {
+    fseek(f, 200, SEEK_SET);
+    fputc(fgetc(f) ^ 0xff, f);
+    fclose(f);
+  }
+}
+
+static void test_fallback_load(void) {
+  db_init();
+  db_load_data();
+  // Generation 1: the demo animals and A, untouched by the journal
+  CHECK_EQ(db_get_reptile_count(), 4);
+  for (int i = 0; i < db_get_reptile_count(); i++) {
+    reptile_t r;
+    CHECK(db_read_reptile(i, &r));
+    CHECK(r.name[0] != '\0');
+    CHECK(strcmp(r.name, "Renamed") != 0);
+    CHECK(strcmp(r.name, "B2") != 0);
+  }
+  reptile_t a;
+  CHECK(db_read_reptile(3, &a) && strcmp(a.name, "A") == 0);
+  CHECK(test_file_size(JOURNAL_KEPT_PATH) > 0);
+
+  // Edits after the fallback are journaled and replay on the next boot
+  rename_reptile(3, "A2");
+  CHECK(db_flush() == ESP_OK);
+  CHECK(test_file_size(JOURNAL_FILE_PATH) > 0);
+}
+
+// Edits left in the journal alone, with no snapshot after them
+static void test_replay_write(void) {
+  test_sd_reset();
+  db_init();
+  db_load_data(); // Empty card: demo data
+  inventory_item_t stock = {.name = "Souris", .quantity = 10};
+  db_set_inventory_count(1);
+  db_set_inventory_item(0, &stock);
+  db_save_data();
+  CHECK(db_flush() == ESP_OK);
+  long snapshot = test_file_size(SNAPSHOT_FILE_PATH);
+
+  // A restock, then meals taken from it
+  stock.quantity = 50;
+  db_set_inventory_item(0, &stock);
+  db_record_feeding(0, time(NULL), "Souris", 2, true);
+
+  breeding_record_t b = {.id = 7,
+                         .female_id = 1,
+                         .male_id = 2,
+                         .pairing_date = 1700000000,
+                         .active = true};
+  CHECK_EQ(db_add_breeding(&b), 0);
+  b.egg_count = 6;
+  db_update_breeding(0, &b);
+  CHECK(db_flush() == ESP_OK);
+  CHECK(test_file_size(JOURNAL_FILE_PATH) > 0);
+  CHECK_EQ(test_file_size(SNAPSHOT_FILE_PATH), snapshot);
+}
+
+static void test_replay_load(void) {
+  db_init();
+  db_load_data();
+  breeding_record_t b;
+  CHECK_EQ(db_get_breeding_count(), 1);
+  CHECK(db_read_breeding(0, &b));
+  CHECK_EQ(b.id, 7);
+  CHECK_EQ(b.female_id, 1);
+  CHECK_EQ(b.pairing_date, 1700000000);
+  CHECK_EQ(b.egg_count, 6);
+  CHECK(b.active);
+
+  inventory_item_t stock;
+  CHECK_EQ(db_get_inventory_count(), 1);
+  CHECK(db_read_inventory_item(0, &stock));
+  CHECK(strcmp(stock.name, "Souris") == 0);
+  CHECK_EQ(stock.quantity, 48);
+}
+
+int main(int argc, char **argv) {
+  const char *which = argc > 1 ? argv[1] : "";
+  if (strcmp(which, "truncation") == 0 || strcmp(which, "gap") == 0) {
+    test_sd_reset();
+    strcmp(which, "gap") == 0 ? test_gap() : test_truncation();
+  } else if (strcmp(which, "fallback-write") == 0) {
+    test_fallback_write();
+  } else if (strcmp(which, "fallback-load") == 0) {
+    test_fallback_load();
+  } else if (strcmp(which, "replay-write") == 0) {
+    test_replay_write();
+  } else if (strcmp(which, "replay-load") == 0) {
+    test_replay_load();
+  } else {
+    fprintf(stderr,
+            "usage: %s truncation|gap|fallback-write|fallback-load|"
+            "replay-write|replay-load\n",
+            argv[0]);
+    return EXIT_FAILURE;
+  }
+  return test_result(argv[0]);
+}
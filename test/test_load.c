@@ -0,0 +1,102 @@
+/**
+ * @file test_load.c
+ * @brief During a load, readers return at once and modifiers wait for it
+ *
+ * Between db_map_boot_view() and db_load_data() the SD card is mounted and
+ * read. A reader on another task (the LVGL task on the device) must not wait
+ * for that; a modifier must, and lands in the loaded tables.
+ */
+
+#include "test_util.h"
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <time.h>
+
+#include "database.h"
+
+#define WAIT_MS 2000
+
+static atomic_bool read_done;
+static atomic_bool write_done;
+static int found_id, found_chip, weights, buckets, items, hits;
+static bool got_reptile, got_item;
+
+static void *reader(void *arg) {
+  reptile_t r;
+  inventory_item_t it;
+  weight_bucket_t b[4];
+  query_result_t result = {0};
+  got_reptile = db_read_reptile(0, &r);
+  found_id = db_find_reptile_by_id(1);
+  found_chip = db_find_reptile_by_microchip("250000000000001");
+  items = db_get_inventory_count();
+  got_item = db_read_inventory_item(0, &it);
+  weights = db_get_weight_count(0);
+  buckets = db_get_weight_buckets(0, WEIGHT_TIER_WEEK, b, 4);
+  reptile_feeding_interval(0);
+  const query_t q = {.text = "pyth"};
+  hits = db_query(&q, &result) == ESP_OK ? (int)result.count : -1;
+  query_result_free(&result);
+  read_done = true;
+  return NULL;
+}
+
+static void *modifier(void *arg) {
+  db_record_weight(0, time(NULL), 1234);
+  write_done = true;
+  return NULL;
+}
+
+static void sleep_ms(int ms) {
+  struct timespec t = {.tv_sec = ms / 1000, .tv_nsec = ms % 1000 * 1000000L};
+  nanosleep(&t, NULL);
+}
+
+static bool wait_for(atomic_bool *flag) {
+  for (int ms = 0; ms < WAIT_MS && !*flag; ms += 10)
+    sleep_ms(10);
+  return *flag;
+}
+
+int main(int argc, char **argv) {
+  test_sd_reset();
+  db_init();
+  db_load_data(); // Empty card: demo data
+  db_set_inventory_count(1);
+  db_set_inventory_item(0, &(inventory_item_t){.name = "Souris",
+                                               .quantity = 10});
+  db_save_data();
+  CHECK(db_flush() == ESP_OK);
+  int weighed = db_get_weight_count(0);
+
+  // Boot again: the preview is up, the card is not loaded yet
+  db_map_boot_view();
+  pthread_t r, w;
+  pthread_create(&r, NULL, reader, NULL);
+  CHECK(wait_for(&read_done));
+  if (read_done) {
+    pthread_join(r, NULL);
+    CHECK(!got_reptile);
+    CHECK_EQ(found_id, -1);
+    CHECK_EQ(found_chip, -1);
+    CHECK_EQ(items, 0);
+    CHECK(!got_item);
+    CHECK_EQ(weights, 0);
+    CHECK_EQ(buckets, 0);
+    CHECK_EQ(hits, 0);
+  }
+
+  pthread_create(&w, NULL, modifier, NULL);
+  sleep_ms(100);
+  CHECK(!write_done); // Waits for the load
+
+  db_load_data();
+  CHECK(wait_for(&write_done));
+  if (write_done)
+    pthread_join(w, NULL);
+  CHECK_EQ(db_get_weight_count(0), weighed + 1);
+  CHECK_EQ(db_get_inventory_count(), 1);
+  CHECK(db_find_reptile_by_id(1) >= 0);
+  return test_result(argv[0]);
+}
@@ -0,0 +1,158 @@
+/**
+ * @file test_txn.c
+ * @brief db_txn_abort() leaves no trace of the transaction, nor does a
+ *        rejected modifier
+ */
+
+#include "test_util.h"
+
+#include <time.h>
+
+#include "audit_log.h"
+#include "database.h"
+#include "journal.h"
+
+#define PREY "Souris"
+
+typedef struct {
+  int reptiles;
+  int next_id;
+  reptile_t slot[3];
+  int feedings;
+  int healths;
+  int meals[3];
+  int weighs[3];
+  int items;
+  inventory_item_t stock;
+  int days_left;
+  stats_summary_t stats;
+  int clutches;
+  breeding_record_t clutch;
+} state_t;
+
+static void capture(state_t *s) {
+  memset(s, 0, sizeof(*s));
+  s->reptiles = db_get_reptile_count();
+  s->next_id = db_get_reptile_next_id();
+  for (int i = 0; i < 3; i++) {
+    CHECK(db_read_reptile(i, &s->slot[i]));
+    s->meals[i] = db_get_feeding_history_count(i);
+    s->weighs[i] = db_get_weight_count(i);
+  }
+  s->feedings = db_get_feeding_count();
+  s->healths = db_get_health_count();
+  s->items = db_get_inventory_count();
+  CHECK(db_read_inventory_item(0, &s->stock));
+  s->days_left = db_inventory_days_left(0);
+  db_get_stats(&s->stats);
+  s->clutches = db_get_breeding_count();
+  CHECK(db_read_breeding(0, &s->clutch));
+}
+
+static void compare(const state_t *a, const state_t *b) {
+  CHECK_EQ(b->reptiles, a->reptiles);
+  CHECK_EQ(b->next_id, a->next_id);
+  for (int i = 0; i < 3; i++) {
+    CHECK(memcmp(&b->slot[i], &a->slot[i], sizeof(reptile_t)) == 0);
+    CHECK_EQ(b->meals[i], a->meals[i]);
+    CHECK_EQ(b->weighs[i], a->weighs[i]);
+  }
+  CHECK_EQ(b->feedings, a->feedings);
+  CHECK_EQ(b->healths, a->healths);
+  CHECK_EQ(b->items, a->items);
+  CHECK(memcmp(&b->stock, &a->stock, sizeof(inventory_item_t)) == 0);
+  CHECK_EQ(b->days_left, a->days_left);
+  CHECK(memcmp(&b->stats, &a->stats, sizeof(stats_summary_t)) == 0);
+  CHECK_EQ(b->clutches, a->clutches);
+  CHECK(memcmp(&b->clutch, &a->clutch, sizeof(breeding_record_t)) == 0);
+}
+
+int main(int argc, char **argv) {
+  test_sd_reset();
+  db_init();
+  db_load_data(); // Empty card: demo data
+  db_set_inventory_count(1);
+  db_set_inventory_item(0, &(inventory_item_t){.name = PREY,
+                                               .quantity = 40,
+                                               .alert_threshold = 5});
+  db_record_feeding(0, time(NULL) - 7 * 24 * 3600, PREY, 1, true);
+  breeding_record_t clutch = {.id = 1, .female_id = 1, .active = true};
+  db_add_breeding(&clutch);
+  CHECK(db_flush() == ESP_OK);
+  long journal = test_file_size(JOURNAL_FILE_PATH);
+  uint32_t audited = audit_count();
+  int undo = db_undo_count();
+
+  state_t before, after;
+  capture(&before);
+
+  db_txn_begin();
+  reptile_t r = before.slot[1];
+  strcpy(r.name, "Renamed");
+  r.weight_grams += 100;
+  r.active = false;
+  db_update_reptile(1, &r);
+  db_record_feeding(0, time(NULL), PREY, 3, true);
+  db_record_feeding(2, time(NULL), "Rat", 1, true); // A prey the forecast lacks
+  db_record_weight(2, time(NULL), 999);
+  db_record_shed(0, time(NULL));
+  db_record_vet_visit(1, time(NULL), "Controle");
+  reptile_t added = {.name = "New", .species = SPECIES_LIZARD, .active = true};
+  db_update_reptile(-1, &added);
+  db_record_feeding(3, time(NULL), PREY, 2, true);
+  db_delete_reptile(0);
+  clutch.egg_count = 8;
+  db_update_breeding(0, &clutch);
+  db_add_breeding(&clutch);
+  db_set_inventory_item(0, &(inventory_item_t){.name = PREY, .quantity = 99});
+  db_set_inventory_count(2);
+  db_txn_begin(); // Nested: the outer abort takes it back too
+  db_record_weight(0, time(NULL), 50);
+  db_txn_commit();
+  CHECK_EQ(db_get_reptile_count(), 4);
+  db_txn_abort();
+
+  capture(&after);
+  compare(&before, &after);
+  CHECK_EQ(db_undo_count(), undo);
+  CHECK(db_find_reptile_by_id(before.next_id) < 0);
+
+  // Nothing of it reaches the card
+  CHECK(db_flush() == ESP_OK);
+  CHECK_EQ(test_file_size(JOURNAL_FILE_PATH), journal);
+  CHECK_EQ(audit_count(), audited);
+
+  // The next add takes the id the aborted one had
+  db_update_reptile(-1, &added);
+  reptile_t again;
+  CHECK(db_read_reptile(3, &again));
+  CHECK_EQ(again.id, before.next_id);
+  CHECK(db_flush() == ESP_OK);
+  CHECK(audit_count() > audited || test_file_size(JOURNAL_FILE_PATH) > journal);
+
+  // Prey counts and weights that would not fit the history or the journal
+  journal = test_file_size(JOURNAL_FILE_PATH);
+  capture(&before);
+  CHECK(db_record_feeding(0, time(NULL), PREY, 0, true) == ESP_ERR_INVALID_ARG);
+  CHECK(db_record_feeding(0, time(NULL), PREY, -3, true) ==
+        ESP_ERR_INVALID_ARG);
+  CHECK(db_record_feeding(0, time(NULL), PREY, MAX_PREY_COUNT + 1, true) ==
+        ESP_ERR_INVALID_ARG);
+  CHECK(db_record_feeding(99, time(NULL), PREY, 1, true) ==
+        ESP_ERR_INVALID_ARG);
+  CHECK(db_record_weight(0, time(NULL), -1) == ESP_ERR_INVALID_ARG);
+  CHECK(db_record_weight(0, time(NULL), MAX_WEIGHT_GRAMS + 1) ==
+        ESP_ERR_INVALID_ARG);
+  CHECK(db_record_weight(99, time(NULL), 100) == ESP_ERR_INVALID_ARG);
+  capture(&after);
+  compare(&before, &after);
+  CHECK(db_flush() == ESP_OK);
+  CHECK_EQ(test_file_size(JOURNAL_FILE_PATH), journal);
+  CHECK(db_record_feeding(0, time(NULL), PREY, MAX_PREY_COUNT, true) ==
+        ESP_OK);
+  CHECK(db_record_weight(0, time(NULL), MAX_WEIGHT_GRAMS) == ESP_OK);
+  reptile_t heavy;
+  CHECK(db_read_reptile(0, &heavy));
+  CHECK_EQ(heavy.weight_grams, MAX_WEIGHT_GRAMS);
+  return test_result(argv[0]);
+}